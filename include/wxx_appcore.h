@@ -63,7 +63,7 @@ namespace Win32xx
     //
 
     // Constructor
-    inline CWinApp::CWinApp() : m_callback(NULL)
+    inline CWinApp::CWinApp() : m_callback(NULL), m_wndMapGeneration(0), m_wndChainGeneration(0)
     {
         static CCriticalSection cs;
         CThreadLock appLock(cs);
@@ -118,10 +118,12 @@ namespace Win32xx
     {
         // Forcibly destroy any remaining windows now. Windows created from
         //  static CWnds or dangling pointers are destroyed here.
-        std::map<HWND, CWnd*, CompareHWND>::const_iterator m;
-        for (m = m_mapHWND.begin(); m != m_mapHWND.end(); ++m)
+        std::vector<HWND> wnds;
+        m_mapHWND.GetHandles(wnds);
+        std::vector<HWND>::const_iterator it;
+        for (it = wnds.begin(); it != wnds.end(); ++it)
         {
-            HWND wnd = (*m).first;
+            HWND wnd = *it;
             if (::IsWindow(wnd))
             {
                 ::DestroyWindow(wnd);
@@ -147,107 +149,112 @@ namespace Win32xx
     inline void CWinApp::AddCDCData(HDC dc, CDC_Data* pData)
     {
         CThreadLock mapLock(m_gdiLock);
-        m_mapCDCData.insert(std::make_pair(dc, pData));
+        m_mapCDCData.Insert(dc, pData);
     }
 
     // Adds a HGDIOBJ and CGDI_Data* pair to the map.
     inline void CWinApp::AddCGDIData(HGDIOBJ gdi, CGDI_Data* pData)
     {
         CThreadLock mapLock(m_gdiLock);
-        m_mapCGDIData.insert(std::make_pair(gdi, pData));
+        m_mapCGDIData.Insert(gdi, pData);
     }
 
     // Adds a HIMAGELIST and Ciml_Data* pair to the map.
     inline void CWinApp::AddCImlData(HIMAGELIST images, CIml_Data* pData)
     {
         CThreadLock mapLock(m_wndLock);
-        m_mapCImlData.insert(std::make_pair(images, pData));
+        m_mapCImlData.Insert(images, pData);
     }
 
     // Adds a HMENU and CMenu_Data* to the map.
     inline void CWinApp::AddCMenuData(HMENU menu, CMenu_Data* pData)
     {
         CThreadLock mapLock(m_wndLock);
-        m_mapCMenuData.insert(std::make_pair(menu, pData));
+        m_mapCMenuData.Insert(menu, pData);
+    }
+
+    // Adds a HWND and CWnd* pair to the current thread's window cache.
+    // Called with m_wndLock held, so the map generation can't change.
+    inline void CWinApp::AddToWndCache(HWND wnd, CWnd* pWnd)
+    {
+        TLSData* pTLSData = GetTlsData();
+        if (pTLSData != NULL)
+        {
+            WndCache& cache = pTLSData->wndCache;
+            if (cache.generation != m_wndMapGeneration)
+            {
+                // Entries have been removed from the map. Discard the stale cache.
+                cache.Clear();
+                cache.generation = m_wndMapGeneration;
+            }
+
+            UINT index = GetWndCacheIndex(wnd);
+            cache.wnds[index] = wnd;
+            cache.pWnds[index] = pWnd;
+        }
     }
 
     // Retrieves a pointer to CDC_Data from the map
     inline CDC_Data* CWinApp::GetCDCData(HDC dc)
     {
-        std::map<HDC, CDC_Data*, CompareHDC>::const_iterator m;
-
         // Find the CDC data mapped to this HDC
-        CDC_Data* pCDCData = 0;
         CThreadLock mapLock(m_gdiLock);
-        m = m_mapCDCData.find(dc);
-
-        if (m != m_mapCDCData.end())
-            pCDCData = m->second;
-
-        return pCDCData;
+        return m_mapCDCData.Find(dc);
     }
 
     // Retrieves a pointer to CGDI_Data from the map
     inline CGDI_Data* CWinApp::GetCGDIData(HGDIOBJ object)
     {
-        std::map<HGDIOBJ, CGDI_Data*, CompareGDI>::const_iterator m;
-
         // Find the CGDIObject data mapped to this HGDIOBJ
-        CGDI_Data* pCGDIData = 0;
         CThreadLock mapLock(m_gdiLock);
-        m = m_mapCGDIData.find(object);
-
-        if (m != m_mapCGDIData.end())
-            pCGDIData = m->second;
-
-        return pCGDIData;
+        return m_mapCGDIData.Find(object);
     }
 
     // Retrieves a pointer to CIml_Data from the map
     inline CIml_Data* CWinApp::GetCImlData(HIMAGELIST images)
     {
-        std::map<HIMAGELIST, CIml_Data*, CompareHIMAGELIST>::const_iterator m;
-
         // Find the CImageList data mapped to this HIMAGELIST
-        CIml_Data* pCImlData = 0;
         CThreadLock mapLock(m_wndLock);
-        m = m_mapCImlData.find(images);
-
-        if (m != m_mapCImlData.end())
-            pCImlData = m->second;
-
-        return pCImlData;
+        return m_mapCImlData.Find(images);
     }
 
     // Retrieves a pointer to CMenu_Data from the map
     inline CMenu_Data* CWinApp::GetCMenuData(HMENU menu)
     {
-        std::map<HMENU, CMenu_Data*, CompareHMENU>::const_iterator m;
-
         // Find the CMenu data mapped to this HMENU
-        CMenu_Data* pCMenuData = 0;
         CThreadLock mapLock(m_wndLock);
-        m = m_mapCMenuData.find(menu);
+        return m_mapCMenuData.Find(menu);
+    }
 
-        if (m != m_mapCMenuData.end())
-            pCMenuData = m->second;
+    // Retrieves the CWnd pointer from the current thread's window cache.
+    // Returns NULL if the window isn't cached. No lock is required.
+    inline CWnd* CWinApp::GetCWndFromCache(HWND wnd) const
+    {
+        TLSData* pTLSData = GetTlsData();
+        if (pTLSData != NULL && wnd != 0)
+        {
+            const WndCache& cache = pTLSData->wndCache;
+            UINT index = GetWndCacheIndex(wnd);
+            if (cache.wnds[index] == wnd && cache.generation == m_wndMapGeneration)
+                return cache.pWnds[index];
+        }
 
-        return pCMenuData;
+        return 0;
     }
 
     // Retrieves the CWnd pointer associated with the specified wnd.
     inline CWnd* CWinApp::GetCWndFromMap(HWND wnd)
     {
-        // Allocate an iterator for our HWND map
-        std::map<HWND, CWnd*, CompareHWND>::const_iterator m;
+        // Windows used recently by this thread are found without locking.
+        CWnd* pWnd = GetCWndFromCache(wnd);
+        if (pWnd != 0)
+            return pWnd;
 
         // Find the CWnd pointer mapped to this HWND
-        CWnd* pWnd = 0;
         CThreadLock mapLock(m_wndLock);
-        m = m_mapHWND.find(wnd);
-
-        if (m != m_mapHWND.end())
-            pWnd = m->second;
+        pWnd = m_mapHWND.Find(wnd);
+        if (pWnd != 0)
+            AddToWndCache(wnd, pWnd);
 
         return pWnd;
     }
@@ -265,12 +272,54 @@ namespace Win32xx
         return pTLSData ? pTLSData->mainWnd : 0;
     }
 
+    // Retrieves the current thread's pre-translate chain for the specified window.
+    // The chain is rebuilt if it was built for a different window, or if windows
+    // have been mapped, unmapped or reparented since. Returns NULL if the thread
+    // doesn't have TLSData.
+    inline const PreTranslateChain* CWinApp::GetPreTranslateChain(HWND wnd)
+    {
+        TLSData* pTLSData = GetTlsData();
+        if (pTLSData == NULL)
+            return NULL;
+
+        PreTranslateChain& chain = pTLSData->preTranslateChain;
+        if (!IsPreTranslateChainValid(chain, wnd))
+        {
+            // Read the generation first, so changes made while the chain
+            // is built cause it to be rebuilt for the next message.
+            chain.wnd = 0;
+            chain.generation = m_wndChainGeneration;
+            chain.wnds.clear();
+            chain.pWnds.clear();
+            for (HWND parent = wnd; parent != 0; parent = ::GetParent(parent))
+            {
+                CWnd* pWnd = GetCWndFromMap(parent);
+                if (pWnd && pWnd->IsPreTranslateEnabled())
+                {
+                    chain.wnds.push_back(parent);
+                    chain.pWnds.push_back(pWnd);
+                }
+            }
+
+            chain.wnd = wnd;
+        }
+
+        return &chain;
+    }
+
     // Retrieves the pointer to the Thread Local Storage data for the current thread.
     inline TLSData* CWinApp::GetTlsData() const
     {
         return static_cast<TLSData*>(TlsGetValue(m_tlsData));
     }
 
+    // Returns TRUE if the pre-translate chain was built for the specified window,
+    // and no windows have been mapped, unmapped or reparented since.
+    inline BOOL CWinApp::IsPreTranslateChainValid(const PreTranslateChain& chain, HWND wnd) const
+    {
+        return (wnd != 0 && chain.wnd == wnd && chain.generation == m_wndChainGeneration);
+    }
+
     // Loads the cursor resource from the resource script (resource.rc)
     // Refer to LoadCursor in the Windows API documentation for more information.
     inline HCURSOR CWinApp::LoadCursor(LPCTSTR resourceName) const
@@ -395,11 +444,14 @@ namespace Win32xx
         return pWinApp;
     }
 
-    // Sets the main window for this thread.
+    // Sets the main window for this thread. The thread's message pump posts
+    // the wake-up message for its thread tasks to this window.
     inline void CWinApp::SetMainWnd(HWND wnd) const
     {
         TLSData* pTLSData = GetApp()->GetTlsData();
         pTLSData->mainWnd = wnd;
+        if (pTLSData->pMessagePump)
+            pTLSData->pMessagePump->m_taskWnd = wnd;
     }
 
     // This function can be used to load a resource dll.
@@ -501,6 +553,9 @@ namespace Win32xx
     inline CString CWinApp::MsgFileLock() const
     { return _T("Failed to lock the file."); }
 
+    inline CString CWinApp::MsgFileMap() const
+    { return _T("Failed to map a view of the file."); }
+
     inline CString CWinApp::MsgFileOpen() const
     { return _T("Failed to open file."); }
 
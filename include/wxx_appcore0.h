@@ -170,39 +170,277 @@ namespace Win32xx
         long count;
     };
 
-    // The comparison function object used by CWinApp::m_mapHDC
-    struct CompareHDC
+    ////////////////////////////////////////////////////////////////////
+    // CHandleMap is a hash table which maps a handle, such as a HWND or
+    // HDC, to a pointer. It uses open addressing with linear probing, so
+    // finding, inserting and erasing a handle are O(1) operations.
+    // A NULL handle marks an empty slot, so it can't be used as a key.
+    // CHandleMap isn't thread safe. CWinApp locks the map before use.
+    template <class H, class T>
+    class CHandleMap
     {
-        bool operator()(const HDC a, const HDC b) const
-            {return (reinterpret_cast<DWORD_PTR>(a) < reinterpret_cast<DWORD_PTR>(b));}
+    public:
+        CHandleMap() : m_count(0) {}
+
+        bool   Erase(H handle);
+        T      Find(H handle) const;
+        void   GetHandles(std::vector<H>& handles) const;
+        bool   Insert(H handle, T value);
+        size_t Size() const { return m_count; }
+
+    private:
+        struct Entry
+        {
+            Entry() : handle(0), value(0) {}
+            H handle;
+            T value;
+        };
+
+        size_t GetSlot(H handle) const;
+        void   Grow();
+
+        std::vector<Entry> m_table;     // The size is zero or a power of 2
+        size_t m_count;                 // Number of handles in the table
     };
 
-    // The comparison function object used by CWinApp::m_mapGDI
-    struct CompareGDI
+    // Removes the handle from the map. Returns true if the handle was found.
+    template <class H, class T>
+    inline bool CHandleMap<H, T>::Erase(H handle)
+    {
+        if (m_table.empty() || handle == 0)
+            return false;
+
+        size_t mask = m_table.size() - 1;
+        size_t i = GetSlot(handle);
+        while (m_table[i].handle != handle)
+        {
+            if (m_table[i].handle == 0)
+                return false;
+
+            i = (i + 1) & mask;
+        }
+
+        // Shift back the entries that follow in the probe sequence,
+        // so no tombstones are required.
+        size_t j = i;
+        for (;;)
+        {
+            m_table[i] = Entry();
+            for (;;)
+            {
+                j = (j + 1) & mask;
+                if (m_table[j].handle == 0)
+                {
+                    --m_count;
+                    return true;
+                }
+
+                // Move the entry unless its home slot lies cyclically within (i, j].
+                size_t home = GetSlot(m_table[j].handle);
+                bool inRange = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+                if (!inRange)
+                    break;
+            }
+
+            m_table[i] = m_table[j];
+            i = j;
+        }
+    }
+
+    // Returns the value mapped to the handle, or 0 if the handle isn't found.
+    template <class H, class T>
+    inline T CHandleMap<H, T>::Find(H handle) const
+    {
+        if (m_table.empty() || handle == 0)
+            return 0;
+
+        size_t mask = m_table.size() - 1;
+        for (size_t i = GetSlot(handle); m_table[i].handle != 0; i = (i + 1) & mask)
+        {
+            if (m_table[i].handle == handle)
+                return m_table[i].value;
+        }
+
+        return 0;
+    }
+
+    // Fills the vector with all the handles in the map.
+    template <class H, class T>
+    inline void CHandleMap<H, T>::GetHandles(std::vector<H>& handles) const
+    {
+        handles.clear();
+        handles.reserve(m_count);
+        for (size_t i = 0; i < m_table.size(); ++i)
+        {
+            if (m_table[i].handle != 0)
+                handles.push_back(m_table[i].handle);
+        }
+    }
+
+    // Returns the home slot of the handle in the table.
+    template <class H, class T>
+    inline size_t CHandleMap<H, T>::GetSlot(H handle) const
+    {
+        // Mix the bits of the handle value, as handles are often sequential.
+        DWORD_PTR key = reinterpret_cast<DWORD_PTR>(handle);
+        DWORD hash = static_cast<DWORD>(key) ^ static_cast<DWORD>((key >> 16) >> 16);
+        hash = (hash ^ (hash >> 16)) * 0x45d9f3b;
+        hash = hash ^ (hash >> 16);
+        return static_cast<size_t>(hash) & (m_table.size() - 1);
+    }
+
+    // Doubles the size of the table and rehashes the existing entries.
+    template <class H, class T>
+    inline void CHandleMap<H, T>::Grow()
+    {
+        std::vector<Entry> oldTable(m_table.empty() ? 32 : m_table.size() * 2);
+        oldTable.swap(m_table);
+
+        size_t mask = m_table.size() - 1;
+        for (size_t i = 0; i < oldTable.size(); ++i)
+        {
+            if (oldTable[i].handle != 0)
+            {
+                size_t j = GetSlot(oldTable[i].handle);
+                while (m_table[j].handle != 0)
+                    j = (j + 1) & mask;
+
+                m_table[j] = oldTable[i];
+            }
+        }
+    }
+
+    // Adds the handle and value pair to the map. Like std::map::insert,
+    // an existing value isn't replaced. Returns true if the pair was added.
+    template <class H, class T>
+    inline bool CHandleMap<H, T>::Insert(H handle, T value)
     {
-        bool operator()(const HGDIOBJ a, const HGDIOBJ b) const
-            {return (reinterpret_cast<DWORD_PTR>(a) < reinterpret_cast<DWORD_PTR>(b));}
+        assert(handle != 0);
+        if (handle == 0)
+            return false;
+
+        // Keep the load factor at or below one half.
+        if ((m_count + 1) * 2 > m_table.size())
+            Grow();
+
+        size_t mask = m_table.size() - 1;
+        size_t i = GetSlot(handle);
+        while (m_table[i].handle != 0)
+        {
+            if (m_table[i].handle == handle)
+                return false;
+
+            i = (i + 1) & mask;
+        }
+
+        m_table[i].handle = handle;
+        m_table[i].value = value;
+        ++m_count;
+        return true;
+    }
+
+    // The number of entries in the per-thread window cache. Must be a power of 2.
+    const int WXX_WNDCACHE_SIZE = 64;
+
+    // A small direct-mapped cache of HWND to CWnd* lookups. Each thread has
+    // its own cache, so it can be read without locking. The cache is discarded
+    // whenever an entry is removed from CWinApp's window map.
+    struct WndCache
+    {
+        WndCache() : generation(0) { Clear(); }   // Constructor
+        void Clear()
+        {
+            ZeroMemory(wnds, sizeof(wnds));
+            ZeroMemory(pWnds, sizeof(pWnds));
+        }
+
+        HWND  wnds[WXX_WNDCACHE_SIZE];   // The cached window handles
+        CWnd* pWnds[WXX_WNDCACHE_SIZE];  // The CWnd pointers for the cached handles
+        LONG  generation;                // The window map generation the cache is valid for
     };
 
-    // The comparison function object used by CWinApp::m_mapHIMAGELIST
-    struct CompareHIMAGELIST
+    // The maximum number of bitmaps, and the maximum bytes, kept by each thread's back buffer pool.
+    const int WXX_BACKBUFFER_POOL_SIZE = 8;
+    const size_t WXX_BACKBUFFER_POOL_BYTES = 32 * 1024 * 1024;
+
+    // Keeps the bitmaps used as back buffers by CDC::CreatePooledBitmap, so
+    // later paints can borrow them instead of creating new bitmaps. Each thread
+    // has its own pool, so it is used without locking. A bitmap is borrowed if it
+    // is compatible with the device context, at least the requested size, and not
+    // much larger. New bitmaps are rounded up to a multiple of 64 pixels so they
+    // can be reused while a window is resized.
+    struct BackBufferPool
     {
-        bool operator()(const HIMAGELIST a, const HIMAGELIST b) const
-            {return (reinterpret_cast<DWORD_PTR>(a) < reinterpret_cast<DWORD_PTR>(b));}
+        BackBufferPool() : hits(0), misses(0), bytesRetained(0), clock(0) {}    // Constructor
+        ~BackBufferPool();
+
+        HBITMAP Borrow(HDC dc, int cx, int cy);
+        void    Clear();
+        void    Return(HBITMAP bitmap);
+        void    Trim();
+
+        struct PooledBitmap
+        {
+            HBITMAP bitmap;
+            int     cx;
+            int     cy;
+            int     bitsPerPixel;
+            size_t  bytes;
+            bool    isBorrowed;
+            UINT    lastUsed;   // The clock value when the bitmap was last borrowed or returned
+        };
+
+        std::vector<PooledBitmap> bitmaps;
+        UINT   hits;            // The number of bitmaps borrowed from the pool
+        UINT   misses;          // The number of bitmaps created for the pool
+        size_t bytesRetained;   // The bytes used by the pool's bitmaps, borrowed or not
+        UINT   clock;           // Incremented when a bitmap is borrowed or returned
     };
 
-    // The comparison function object used by CWinApp::m_mapHMENU
-    struct CompareHMENU
+    // The maximum number of strips kept by each thread's gradient cache.
+    const int WXX_GRADIENT_CACHE_SIZE = 32;
+
+    // Keeps the one pixel wide gradient strips used by CDC::GradientFill, so
+    // repeated fills with the same colors and length are a single blit. Each
+    // strip is a 32 bit DIB section, which is stretched across the rectangle.
+    // Each thread has its own cache, so it is used without locking.
+    struct GradientCache
     {
-        bool operator()(const HMENU a, const HMENU b) const
-            {return (reinterpret_cast<DWORD_PTR>(a) < reinterpret_cast<DWORD_PTR>(b));}
+        GradientCache() : hits(0), misses(0), clock(0) {}  // Constructor
+        ~GradientCache() { Clear(); }
+
+        void    Clear();
+        HBITMAP GetStrip(COLORREF color1, COLORREF color2, BOOL isVertical, int length);
+
+        struct GradientStrip
+        {
+            HBITMAP  bitmap;
+            COLORREF color1;
+            COLORREF color2;
+            BOOL     isVertical;
+            int      length;
+            UINT     lastUsed;  // The clock value when the strip was last used
+        };
+
+        std::vector<GradientStrip> strips;
+        UINT hits;              // The number of fills which used a cached strip
+        UINT misses;            // The number of strips created
+        UINT clock;             // Incremented when a strip is used
     };
 
-    // The comparison function object used by CWinApp::m_mapHWND
-    struct CompareHWND
+    // The windows whose PreTranslateMessage is called for input messages sent to
+    // a window. It lists the CWnd objects with pre-translation enabled, for the
+    // window and its chain of parents, from the window outwards. Each thread
+    // keeps the chain for the last window it pre-translated a message for.
+    // The chain is rebuilt when windows are mapped, unmapped or reparented.
+    struct PreTranslateChain
     {
-        bool operator()(const HWND a, const HWND b) const
-            {return (reinterpret_cast<DWORD_PTR>(a) < reinterpret_cast<DWORD_PTR>(b));}
+        PreTranslateChain() : wnd(0), generation(0) {}   // Constructor
+
+        HWND wnd;                   // The window the chain was built for
+        LONG generation;            // The window chain generation the chain is valid for
+        std::vector<HWND> wnds;     // The windows with pre-translation enabled
+        std::vector<CWnd*> pWnds;   // The CWnd objects for those windows
     };
 
     // Used for Thread Local Storage (TLS)
@@ -213,10 +451,242 @@ namespace Win32xx
         CMenuBar* pMenuBar; // Pointer to CMenuBar object used for the WH_MSGFILTER hook
         HHOOK msgHook;      // WH_MSGFILTER hook for CMenuBar and modal dialogs
         long  dlgHooks;     // Number of dialog MSG hooks
+        CMessagePump* pMessagePump; // The message pump running this thread's message loop
+        WndCache wndCache;  // Lock free HWND to CWnd* lookups for this thread
+        BackBufferPool backBuffers; // Back buffer bitmaps used by CDC::CreatePooledBitmap for this thread
+        GradientCache gradients;    // Gradient strips used by CDC::GradientFill for this thread
+        PreTranslateChain preTranslateChain; // The windows that pre-translate input for the last window
 
-        TLSData() : pWnd(0), mainWnd(0), pMenuBar(0), msgHook(0), dlgHooks(0) {} // Constructor
+        TLSData() : pWnd(0), mainWnd(0), pMenuBar(0), msgHook(0), dlgHooks(0), pMessagePump(0) {} // Constructor
     };
 
+    ////////////////////////////////////////////
+    // Definitions for the BackBufferPool struct
+    //
+
+    inline BackBufferPool::~BackBufferPool()
+    {
+        for (size_t i = 0; i < bitmaps.size(); ++i)
+            ::DeleteObject(bitmaps[i].bitmap);
+    }
+
+    // Borrows a bitmap compatible with the device context, of at least the
+    // specified size. Returns 0 if the pool can't be used for the device context.
+    inline HBITMAP BackBufferPool::Borrow(HDC dc, int cx, int cy)
+    {
+        // Bitmaps created for memory DCs match the DC's selected bitmap, so only
+        // window and screen DCs are used.
+        if (cx <= 0 || cy <= 0 || ::GetObjectType(dc) != OBJ_DC)
+            return 0;
+
+        int bitsPerPixel = ::GetDeviceCaps(dc, BITSPIXEL) * ::GetDeviceCaps(dc, PLANES);
+        int cxAlloc = (cx + 63) & ~63;
+        int cyAlloc = (cy + 63) & ~63;
+
+        // Find the smallest unused bitmap which is large enough, but less than four
+        // times the area of a new bitmap.
+        size_t best = bitmaps.size();
+        for (size_t i = 0; i < bitmaps.size(); ++i)
+        {
+            const PooledBitmap& pooled = bitmaps[i];
+            if (!pooled.isBorrowed && pooled.bitsPerPixel == bitsPerPixel &&
+                pooled.cx >= cx && pooled.cy >= cy &&
+                pooled.cx / 2 * (pooled.cy / 2) <= cxAlloc * cyAlloc)
+            {
+                if (best == bitmaps.size() || pooled.bytes < bitmaps[best].bytes)
+                    best = i;
+            }
+        }
+
+        if (best < bitmaps.size())
+        {
+            ++hits;
+            bitmaps[best].isBorrowed = true;
+            bitmaps[best].lastUsed = ++clock;
+            return bitmaps[best].bitmap;
+        }
+
+        HBITMAP bitmap = ::CreateCompatibleBitmap(dc, cxAlloc, cyAlloc);
+        if (bitmap == 0)
+            return 0;
+
+        ++misses;
+        PooledBitmap pooled;
+        pooled.bitmap = bitmap;
+        pooled.cx = cxAlloc;
+        pooled.cy = cyAlloc;
+        pooled.bitsPerPixel = bitsPerPixel;
+        pooled.bytes = static_cast<size_t>(cxAlloc) * cyAlloc * bitsPerPixel / 8;
+        pooled.isBorrowed = true;
+        pooled.lastUsed = ++clock;
+        bitmaps.push_back(pooled);
+        bytesRetained += pooled.bytes;
+
+        return bitmap;
+    }
+
+    // Deletes the bitmaps which aren't borrowed.
+    inline void BackBufferPool::Clear()
+    {
+        size_t i = 0;
+        while (i < bitmaps.size())
+        {
+            if (bitmaps[i].isBorrowed)
+                ++i;
+            else
+            {
+                ::DeleteObject(bitmaps[i].bitmap);
+                bytesRetained -= bitmaps[i].bytes;
+                bitmaps.erase(bitmaps.begin() + i);
+            }
+        }
+    }
+
+    // Returns a borrowed bitmap to the pool. The bitmap must not be
+    // selected into a device context.
+    inline void BackBufferPool::Return(HBITMAP bitmap)
+    {
+        for (size_t i = 0; i < bitmaps.size(); ++i)
+        {
+            if (bitmaps[i].bitmap == bitmap)
+            {
+                assert(bitmaps[i].isBorrowed);
+                bitmaps[i].isBorrowed = false;
+                bitmaps[i].lastUsed = ++clock;
+                Trim();
+                return;
+            }
+        }
+
+        // The bitmap doesn't belong to the pool.
+        ::DeleteObject(bitmap);
+    }
+
+    // Deletes the least recently used bitmaps which aren't borrowed, until the
+    // pool is within WXX_BACKBUFFER_POOL_SIZE and WXX_BACKBUFFER_POOL_BYTES.
+    inline void BackBufferPool::Trim()
+    {
+        while (bitmaps.size() > static_cast<size_t>(WXX_BACKBUFFER_POOL_SIZE) ||
+               bytesRetained > WXX_BACKBUFFER_POOL_BYTES)
+        {
+            size_t oldest = bitmaps.size();
+            for (size_t i = 0; i < bitmaps.size(); ++i)
+            {
+                if (!bitmaps[i].isBorrowed &&
+                    (oldest == bitmaps.size() || bitmaps[i].lastUsed < bitmaps[oldest].lastUsed))
+                    oldest = i;
+            }
+
+            if (oldest == bitmaps.size())
+                break;
+
+            ::DeleteObject(bitmaps[oldest].bitmap);
+            bytesRetained -= bitmaps[oldest].bytes;
+            bitmaps.erase(bitmaps.begin() + oldest);
+        }
+    }
+
+
+    ///////////////////////////////////////////
+    // Definitions for the GradientCache struct
+    //
+
+    // Deletes all the cached strips.
+    inline void GradientCache::Clear()
+    {
+        for (size_t i = 0; i < strips.size(); ++i)
+            ::DeleteObject(strips[i].bitmap);
+
+        strips.clear();
+    }
+
+    // Returns a strip which is length pixels wide and 1 pixel high for vertical
+    // gradients, or 1 pixel wide and length pixels high otherwise. The strip is
+    // created if it isn't already cached. Returns 0 if it can't be created.
+    // The strip is owned by the cache and must not be deleted.
+    inline HBITMAP GradientCache::GetStrip(COLORREF color1, COLORREF color2, BOOL isVertical, int length)
+    {
+        if (length <= 0)
+            return 0;
+
+        isVertical = isVertical ? TRUE : FALSE;
+        for (size_t i = 0; i < strips.size(); ++i)
+        {
+            GradientStrip& strip = strips[i];
+            if (strip.color1 == color1 && strip.color2 == color2 &&
+                strip.isVertical == isVertical && strip.length == length)
+            {
+                ++hits;
+                strip.lastUsed = ++clock;
+                return strip.bitmap;
+            }
+        }
+
+        // Create a top-down 32 bit DIB section for the strip.
+        BITMAPINFO bmi;
+        ZeroMemory(&bmi, sizeof(bmi));
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = isVertical ? length : 1;
+        bmi.bmiHeader.biHeight = isVertical ? -1 : -length;
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+
+        void* pBits = 0;
+        HBITMAP bitmap = ::CreateDIBSection(0, &bmi, DIB_RGB_COLORS, &pBits, 0, 0);
+        if (bitmap == 0 || pBits == 0)
+        {
+            if (bitmap != 0)
+                ::DeleteObject(bitmap);
+
+            return 0;
+        }
+
+        // Use the same interpolation as a fill with one solid line per pixel.
+        int r1 = GetRValue(color1);
+        int g1 = GetGValue(color1);
+        int b1 = GetBValue(color1);
+        int r2 = GetRValue(color2);
+        int g2 = GetGValue(color2);
+        int b2 = GetBValue(color2);
+
+        DWORD* pPixels = static_cast<DWORD*>(pBits);
+        for (int i = 0; i < length; ++i)
+        {
+            DWORD r = static_cast<DWORD>(r1 + (i * (r2 - r1) / length));
+            DWORD g = static_cast<DWORD>(g1 + (i * (g2 - g1) / length));
+            DWORD b = static_cast<DWORD>(b1 + (i * (b2 - b1) / length));
+            pPixels[i] = (r << 16) | (g << 8) | b;
+        }
+
+        ++misses;
+        GradientStrip strip;
+        strip.bitmap = bitmap;
+        strip.color1 = color1;
+        strip.color2 = color2;
+        strip.isVertical = isVertical;
+        strip.length = length;
+        strip.lastUsed = ++clock;
+
+        // Replace the least recently used strip when the cache is full.
+        if (strips.size() >= static_cast<size_t>(WXX_GRADIENT_CACHE_SIZE))
+        {
+            size_t oldest = 0;
+            for (size_t i = 1; i < strips.size(); ++i)
+            {
+                if (strips[i].lastUsed < strips[oldest].lastUsed)
+                    oldest = i;
+            }
+
+            ::DeleteObject(strips[oldest].bitmap);
+            strips[oldest] = strip;
+        }
+        else
+            strips.push_back(strip);
+
+        return bitmap;
+    }
+
 
     ///////////////////////////////////////////////////////////////
     // CWinApp manages the application. Its constructor initializes
@@ -231,6 +701,7 @@ namespace Win32xx
         friend class CGDIObject;
         friend class CImageList;
         friend class CMenu;
+        friend class CMessagePump;
         friend class CPageSetupDialog;
         friend class CPrintDialog;
         friend class CPrintDialogEx;
@@ -269,21 +740,25 @@ namespace Win32xx
         void AddCGDIData(HGDIOBJ gdi, CGDI_Data* pData);
         void AddCImlData(HIMAGELIST images, CIml_Data* pData);
         void AddCMenuData(HMENU menu, CMenu_Data* pData);
+        void AddToWndCache(HWND wnd, CWnd* pWnd);
         CDC_Data*   GetCDCData(HDC dc);
         CGDI_Data*  GetCGDIData(HGDIOBJ object);
         CIml_Data*  GetCImlData(HIMAGELIST images);
         CMenu_Data* GetCMenuData(HMENU menu);
+        CWnd* GetCWndFromCache(HWND wnd) const;
+        const PreTranslateChain* GetPreTranslateChain(HWND wnd);
+        BOOL IsPreTranslateChainValid(const PreTranslateChain& chain, HWND wnd) const;
         void SetCallback();
         void SetTlsData();
         void UpdateDefaultPrinter();
 
         static CWinApp* SetnGetThis(CWinApp* pThis = 0, bool reset = false);
 
-        std::map<HDC, CDC_Data*, CompareHDC> m_mapCDCData;
-        std::map<HGDIOBJ, CGDI_Data*, CompareGDI> m_mapCGDIData;
-        std::map<HIMAGELIST, CIml_Data*, CompareHIMAGELIST> m_mapCImlData;
-        std::map<HMENU, CMenu_Data*, CompareHMENU> m_mapCMenuData;
-        std::map<HWND, CWnd*, CompareHWND> m_mapHWND;       // maps window handles to CWnd objects
+        CHandleMap<HDC, CDC_Data*> m_mapCDCData;
+        CHandleMap<HGDIOBJ, CGDI_Data*> m_mapCGDIData;
+        CHandleMap<HIMAGELIST, CIml_Data*> m_mapCImlData;
+        CHandleMap<HMENU, CMenu_Data*> m_mapCMenuData;
+        CHandleMap<HWND, CWnd*> m_mapHWND;        // maps window handles to CWnd objects
         std::vector<TLSDataPtr> m_allTLSData;     // vector of TLSData smart pointers, one for each thread
         CCriticalSection m_appLock;   // thread synchronization for CWinApp and TLS.
         CCriticalSection m_gdiLock;   // thread synchronization for m_mapCDCData and m_mapCGDIData.
@@ -295,6 +770,8 @@ namespace Win32xx
         WNDPROC m_callback;           // callback address of CWnd::StaticWndowProc
         CHGlobal m_devMode;           // Used by CPrintDialog and CPageSetupDialog
         CHGlobal m_devNames;          // Used by CPrintDialog and CPageSetupDialog
+        volatile LONG m_wndMapGeneration; // Incremented when an entry is removed from m_mapHWND
+        volatile LONG m_wndChainGeneration; // Incremented when windows are mapped, unmapped or reparented
 
     public:
         // Messages used for exceptions.
@@ -320,6 +797,7 @@ namespace Win32xx
         virtual CString MsgFileClose() const;
         virtual CString MsgFileFlush() const;
         virtual CString MsgFileLock() const;
+        virtual CString MsgFileMap() const;
         virtual CString MsgFileOpen() const;
         virtual CString MsgFileRead() const;
         virtual CString MsgFileRename() const;
@@ -362,6 +840,14 @@ namespace Win32xx
         virtual CString MsgDDV_StringSize() const;
     };
 
+    // Returns the index of the window handle's slot in the window cache.
+    inline UINT GetWndCacheIndex(HWND wnd)
+    {
+        // Window handles are multiples of 2, so skip the lowest bit.
+        DWORD_PTR key = reinterpret_cast<DWORD_PTR>(wnd);
+        return static_cast<UINT>((key >> 1) ^ (key >> 7)) & (WXX_WNDCACHE_SIZE - 1);
+    }
+
     // Returns a pointer to the CWinApp derived class.
     inline CWinApp* GetApp()
     {
@@ -77,6 +77,9 @@
 
 namespace Win32xx
 {
+    // The default size of the buffer used by CArchive, in bytes.
+    const UINT WXX_ARCHIVE_BUFFER_SIZE = 64 * 1024;
+
     // An object used for serialization that can hold any type of data.
     // Specify a pointer to the data, and the size of the data in bytes.
     struct ArchiveObject
@@ -98,6 +101,13 @@ namespace Win32xx
     // CArchive serializes data to and from a file archive.
     // CArchive uses the >> and << operator overloads to serialize
     // the various data types to the archive.
+    // Data is transferred to and from the file through an internal
+    // buffer, so small values don't each require a file system call.
+    // Reads and writes larger than the buffer bypass it.
+    // An archive loaded from a CFile with a mapped view reads directly
+    // from the view, and can return pointers into it with ReadView.
+    // An archive can also store to, or load from, a vector of bytes in
+    // memory, for data kept in a registry value or similar.
     class CArchive
     {
     public:
@@ -105,11 +115,13 @@ namespace Win32xx
         enum Mode {store = 0, load = 1};
 
         // construction and  destruction
-        CArchive(CFile& file, Mode mode);
-        CArchive(LPCTSTR fileName, Mode mode);
+        CArchive(CFile& file, Mode mode, UINT bufferSize = WXX_ARCHIVE_BUFFER_SIZE);
+        CArchive(LPCTSTR fileName, Mode mode, UINT bufferSize = WXX_ARCHIVE_BUFFER_SIZE);
+        CArchive(std::vector<BYTE>& memory, Mode mode);
         virtual ~CArchive();
 
         // method members
+        void            Flush();
         const CFile&    GetFile();
         UINT    GetObjectSchema();
         bool    IsLoading() const;
@@ -118,6 +130,7 @@ namespace Win32xx
         LPTSTR  ReadString(LPTSTR string, UINT max);
         LPSTR   ReadStringA(LPSTR string, UINT max);
         LPWSTR  ReadStringW(LPWSTR string, UINT max);
+        LPCVOID ReadView(UINT size);
         void    SetObjectSchema(UINT schema);
         void    Write(const void* buffer, UINT size);
         void    WriteString(LPCTSTR string);
@@ -183,11 +196,20 @@ namespace Win32xx
         CArchive(const CArchive&);              // Disable copy construction
         CArchive& operator = (const CArchive&); // Disable assignment operator
 
+        LPCTSTR GetFilePath() const { return m_pFile ? m_pFile->GetFilePath().c_str() : _T(""); }
+
         // private data members
         CFile*  m_pFile;            // archive file FILE
         UINT    m_schema;           // archive version schema
         bool    m_isStoring;        // archive direction switch
         bool    m_isFileManaged;    // delete the CFile pointer in destructor;
+        std::vector<BYTE> m_buffer; // data waiting to be written, or read ahead
+        UINT    m_bufferPos;        // position of the next byte in m_buffer
+        UINT    m_bufferEnd;        // number of bytes read into m_buffer
+        const BYTE* m_pView;        // the file's mapped view, if loading from one
+        size_t  m_viewLength;       // length of the mapped view
+        size_t  m_viewPos;          // position of the next byte in the view
+        std::vector<BYTE>* m_pMemory;   // the memory archived to or from, if any
     };
 
 } // namespace Win32xx
@@ -204,24 +226,41 @@ namespace Win32xx
 
     // Constructs a CArchive object.
     // The specified file must already be open for loading or storing.
-    inline CArchive::CArchive(CFile& file, CArchive::Mode mode) : m_schema(static_cast<UINT>(-1)), m_isFileManaged(false)
+    // A bufferSize of 0 disables buffering. When loading from a file with a
+    // mapped view, the archive reads from the view instead of the buffer.
+    inline CArchive::CArchive(CFile& file, CArchive::Mode mode, UINT bufferSize)
+        : m_schema(static_cast<UINT>(-1)), m_isFileManaged(false),
+          m_bufferPos(0), m_bufferEnd(0), m_pView(0), m_viewLength(0), m_viewPos(0), m_pMemory(0)
     {
         m_pFile = &file;
 
         if (mode == load)
         {
             m_isStoring = false;
+            if (file.GetView() != 0)
+            {
+                // Read from the current file position onwards.
+                m_pView = static_cast<const BYTE*>(file.GetView());
+                m_viewLength = static_cast<size_t>(file.GetViewLength());
+                m_viewPos = static_cast<size_t>(file.GetPosition());
+                bufferSize = 0;
+            }
         }
         else
         {
             m_isStoring = true;
         }
+
+        m_buffer.resize(bufferSize);
     }
 
     // Constructs a CArchive object.
     // A file with the specified name is created for storing (if required), and
     // also opened. A failure to open the file will throw an exception.
-    inline CArchive::CArchive(LPCTSTR fileName, Mode mode) : m_pFile(0), m_schema(static_cast<UINT>(-1))
+    // A bufferSize of 0 disables buffering.
+    inline CArchive::CArchive(LPCTSTR fileName, Mode mode, UINT bufferSize)
+        : m_pFile(0), m_schema(static_cast<UINT>(-1)), m_buffer(bufferSize),
+          m_bufferPos(0), m_bufferEnd(0), m_pView(0), m_viewLength(0), m_viewPos(0), m_pMemory(0)
     {
         m_isFileManaged = true;
 
@@ -248,6 +287,29 @@ namespace Win32xx
         }
     }
 
+    // Constructs a CArchive object that stores to, or loads from, memory.
+    // When storing, the memory is cleared, and the archived data is appended
+    // to it. When loading, the memory must not change while the archive is used.
+    inline CArchive::CArchive(std::vector<BYTE>& memory, Mode mode)
+        : m_pFile(0), m_schema(static_cast<UINT>(-1)), m_isFileManaged(false),
+          m_bufferPos(0), m_bufferEnd(0), m_pView(0), m_viewLength(0), m_viewPos(0), m_pMemory(&memory)
+    {
+        if (mode == load)
+        {
+            // Read from the memory as if it were a mapped view.
+            m_isStoring = false;
+            if (!memory.empty())
+                m_pView = &memory[0];
+
+            m_viewLength = memory.size();
+        }
+        else
+        {
+            m_isStoring = true;
+            memory.clear();
+        }
+    }
+
     inline CArchive::~CArchive()
     {
         if (m_pFile)
@@ -255,11 +317,33 @@ namespace Win32xx
             // if the file is open
             if (m_pFile->GetHandle())
             {
-                // flush if in write mode
-                if (IsStoring())
-                    m_pFile->Flush();
-
-                m_pFile->Close();
+                // Exceptions can't propagate from a destructor, so errors
+                // are only traced here. Call Flush before the archive is
+                // destroyed to detect errors writing the buffered data.
+                try
+                {
+                    // flush if in write mode
+                    if (IsStoring())
+                    {
+                        Flush();
+                        m_pFile->Flush();
+                    }
+                }
+
+                catch (const CException&)
+                {
+                    TRACE("*** Failed to flush the archive's data to the file. ***\n");
+                }
+
+                try
+                {
+                    m_pFile->Close();
+                }
+
+                catch (const CException&)
+                {
+                    TRACE("*** Failed to close the archive's file. ***\n");
+                }
             }
 
             if (m_isFileManaged)
@@ -269,7 +353,44 @@ namespace Win32xx
         }
     }
 
-    // Returns the file associated with the archive.
+    // When storing, writes any buffered data to the file. When loading,
+    // discards the data read ahead, and moves the file pointer back to
+    // the next byte to be read from the archive. Call this before using
+    // the archive's file directly.
+    // The destructor flushes a storing archive, but can't report errors.
+    // Call Flush before the archive is destroyed to detect them.
+    // Throws an exception if an error occurs.
+    inline void CArchive::Flush()
+    {
+        assert(m_pFile || m_pMemory);
+
+        if (m_pFile)
+        {
+            if (IsStoring())
+            {
+                UINT count = m_bufferPos;
+                m_bufferPos = 0;
+                if (count > 0)
+                    m_pFile->Write(&m_buffer[0], count);
+            }
+            else if (m_pView != 0)
+            {
+                m_pFile->Seek(static_cast<LONGLONG>(m_viewPos), FILE_BEGIN);
+            }
+            else
+            {
+                UINT unread = m_bufferEnd - m_bufferPos;
+                m_bufferPos = 0;
+                m_bufferEnd = 0;
+                if (unread > 0)
+                    m_pFile->Seek(-static_cast<LONGLONG>(unread), FILE_CURRENT);
+            }
+        }
+    }
+
+    // Returns the file associated with the archive. An archive stored to,
+    // or loaded from, memory has no file.
+    // Call Flush before using the file directly.
     inline const CFile& CArchive::GetFile()
     {
         assert(m_pFile);
@@ -304,16 +425,72 @@ namespace Win32xx
     inline void CArchive::Read(void* buffer, UINT size)
     {
         // read, simply and  in binary mode, the size into the buffer
-        assert(m_pFile);
+        assert(m_pFile || m_pMemory);
 
-        if (m_pFile)
+        if (size > 0)
         {
-            UINT nBytes = m_pFile->Read(buffer, size);
-            if (nBytes != size)
-                throw CFileException(m_pFile->GetFilePath(), GetApp()->MsgArReadFail());
+            if (m_pView != 0 || m_pMemory != 0)
+            {
+                // Copy directly from the memory or the file's mapped view.
+                memcpy(buffer, ReadView(size), size);
+                return;
+            }
+
+            BYTE* pDest = static_cast<BYTE*>(buffer);
+
+            // Copy the bytes already read ahead into our buffer.
+            UINT copied = MIN(m_bufferEnd - m_bufferPos, size);
+            if (copied > 0)
+            {
+                memcpy(pDest, &m_buffer[m_bufferPos], copied);
+                m_bufferPos += copied;
+                pDest += copied;
+                size -= copied;
+            }
+
+            if (size == 0)
+                return;
+
+            UINT bufferSize = static_cast<UINT>(m_buffer.size());
+            if (size >= bufferSize)
+            {
+                // Large reads go directly to the destination.
+                UINT nBytes = m_pFile->Read(pDest, size);
+                if (nBytes != size)
+                    throw CFileException(GetFilePath(), GetApp()->MsgArReadFail());
+            }
+            else
+            {
+                // Refill our buffer, then copy the remaining bytes.
+                m_bufferPos = 0;
+                m_bufferEnd = m_pFile->Read(&m_buffer[0], bufferSize);
+                if (m_bufferEnd < size)
+                    throw CFileException(GetFilePath(), GetApp()->MsgArReadFail());
+
+                memcpy(pDest, &m_buffer[0], size);
+                m_bufferPos = size;
+            }
         }
     }
 
+    // Returns a pointer to the next size bytes in the archive without copying
+    // them, and moves past them. This requires an archive loaded from memory,
+    // or from a CFile with a mapped view. The pointer remains valid until the
+    // view is unmapped, which occurs when the archive is destroyed and closes
+    // the file.
+    // Throws an exception if not successful.
+    inline LPCVOID CArchive::ReadView(UINT size)
+    {
+        assert(m_pView || m_pMemory);   // The file must have a mapped view.
+
+        if (m_pView == 0 || m_viewPos > m_viewLength || size > m_viewLength - m_viewPos)
+            throw CFileException(GetFilePath(), GetApp()->MsgArReadFail());
+
+        LPCVOID pData = m_pView + m_viewPos;
+        m_viewPos += size;
+        return pData;
+    }
+
     // Records the archived data schema number.  This acts as a version number
     // on the format of the archived data for special handling when there
     // are several versions of the serialized data to be accommodated
@@ -328,8 +505,31 @@ namespace Win32xx
     inline void CArchive::Write(const void* buffer, UINT size)
     {
         // write size characters in buffer to the  file
-        assert(m_pFile);
-        m_pFile->Write(buffer, size);
+        assert(m_pFile || m_pMemory);
+
+        if (m_pMemory != 0)
+        {
+            // Append directly to the memory.
+            const BYTE* pSource = static_cast<const BYTE*>(buffer);
+            m_pMemory->insert(m_pMemory->end(), pSource, pSource + size);
+        }
+        else if (m_pFile && size > 0)
+        {
+            UINT bufferSize = static_cast<UINT>(m_buffer.size());
+            if (size > bufferSize - m_bufferPos)
+                Flush();
+
+            if (size >= bufferSize)
+            {
+                // Large writes go directly to the file.
+                m_pFile->Write(buffer, size);
+            }
+            else
+            {
+                memcpy(&m_buffer[m_bufferPos], buffer, size);
+                m_bufferPos += size;
+            }
+        }
     }
 
     // Writes the BYTE b into the archive file.
@@ -703,7 +903,7 @@ namespace Win32xx
         *this >> chars;
 
         if (isUnicode)
-            throw CFileException(m_pFile->GetFilePath(), GetApp()->MsgArNotCStringA());
+            throw CFileException(GetFilePath(), GetApp()->MsgArNotCStringA());
 
         Read(string.GetBuffer(chars), chars);
         string.ReleaseBuffer(chars);
@@ -723,7 +923,7 @@ namespace Win32xx
         *this >> chars;
 
         if (!isUnicode)
-            throw CFileException(m_pFile->GetFilePath(), GetApp()->MsgArNotCStringW());
+            throw CFileException(GetFilePath(), GetApp()->MsgArNotCStringW());
 
         Read(string.GetBuffer(chars), chars * 2);
         string.ReleaseBuffer(chars);
@@ -811,12 +1011,11 @@ namespace Win32xx
     // Throws an exception if an error occurs.
     inline CArchive& CArchive::operator>>(ArchiveObject& ao)
     {
-        assert(m_pFile);
         UINT size;
         Read(&size, sizeof(size));
         if (size != ao.m_size)
         {
-            throw CFileException(m_pFile->GetFilePath(), GetApp()->MsgArReadFail());
+            throw CFileException(GetFilePath(), GetApp()->MsgArReadFail());
         }
 
         Read(ao.m_pData, ao.m_size);
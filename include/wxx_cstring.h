@@ -80,8 +80,7 @@
 //       c_str          Returns a const TCHAR string. This is an alternative for casting to LPCTSTR.
 //       GetErrorString Assigns CString to the error string for the specified System Error Code
 //                      (from ::GetLastError() for example).
-//       GetString      Returns a reference to the underlying std::basic_string<TCHAR>. This
-//                      reference can be used to modify the string directly.
+//       GetString      Returns a const reference to the underlying std::basic_string<TCHAR>.
 
 
 #ifndef _WIN32XX_CSTRING_H_
@@ -96,6 +95,13 @@
 
 namespace Win32xx
 {
+    // The size of the stack buffer used by FormatV, in characters.
+    // Longer results are formatted into a buffer on the heap.
+    const int WXX_FORMAT_BUFFER_SIZE = 256;
+
+    // The largest buffer FormatV grows when the runtime can't measure
+    // the length of the result, in characters.
+    const int WXX_FORMAT_MAX_SIZE = 0x1000000;
 
     /////////////////////////////////////////////////
     // CStringT is a class template used to implement
@@ -130,7 +136,7 @@ namespace Win32xx
 
         public:
         CStringT();
-        virtual ~CStringT();
+        ~CStringT();
         CStringT(const CStringT& str);
         CStringT(const T * text);
         CStringT(T ch, int length = 1);
@@ -140,6 +146,11 @@ namespace Win32xx
         CStringT& operator = (const T ch);
         CStringT& operator = (const T* text);
 
+#ifdef WXX_MOVE_SEMANTICS
+        CStringT(CStringT&& str);
+        CStringT& operator = (CStringT&& str);
+#endif
+
         bool     operator == (const T* text) const;
         bool     operator == (const CStringT& str) const;
         bool     operator != (const T* text) const;
@@ -153,7 +164,7 @@ namespace Win32xx
 
         // Accessors
         const T* c_str() const          { return m_str.c_str(); }                   // alternative for casting to const T*
-        virtual  std::basic_string<T> GetString() const { return m_str; }           // returns copy of the std::basic_string<T>
+        const std::basic_string<T>& GetString() const { return m_str; }             // returns the std::basic_string<T>
         int      GetLength() const  { return static_cast<int>(m_str.length()); }    // returns the length in characters
 
         // Operations
@@ -213,11 +224,14 @@ namespace Win32xx
 
     protected:
         std::basic_string<T> m_str;
-        std::vector<T> m_buf;
 
     private:
         int     lstrlenT(const CHAR* text) const  { return lstrlenA(text); }
         int     lstrlenT(const WCHAR* text) const { return lstrlenW(text); }
+        int     vscprintfT(const CHAR* format, va_list args) const;
+        int     vscprintfT(const WCHAR* format, va_list args) const;
+        int     vsnprintfT(CHAR* buffer, int size, const CHAR* format, va_list args) const;
+        int     vsnprintfT(WCHAR* buffer, int size, const WCHAR* format, va_list args) const;
     };
 
     // CStringA is a char only version of CString
@@ -250,20 +264,49 @@ namespace Win32xx
 
         CString(char ch, int length = 1)
         {
+            // The character can convert to more than one TCHAR,
+            // such as a double byte character.
+            char str[2] = {0};
+            str[0] = ch;
+            AtoT tch(str);
+            LPCTSTR converted = tch;
+            size_t units = ch ? ::lstrlen(converted) : 1;  // A null character is kept.
+            m_str.reserve(units * (length > 0 ? length : 0));
             for (int i = 0; i < length; ++i)
-            {
-                operator +=(ch);
-            }
+                m_str.append(converted, units);
         }
 
         CString(WCHAR ch, int length = 1)
         {
+            // The character can convert to more than one TCHAR,
+            // such as a double byte character.
+            WCHAR str[2] = {0};
+            str[0] = ch;
+            WtoT tch(str);
+            LPCTSTR converted = tch;
+            size_t units = ch ? ::lstrlen(converted) : 1;  // A null character is kept.
+            m_str.reserve(units * (length > 0 ? length : 0));
             for (int i = 0; i < length; ++i)
-            {
-                operator +=(ch);
-            }
+                m_str.append(converted, units);
+        }
+
+#ifdef WXX_MOVE_SEMANTICS
+        CString(CString&& str) : CStringT<TCHAR>(std::move(str)) {}
+        CString(CStringT<TCHAR>&& str) : CStringT<TCHAR>(std::move(str)) {}
+
+        CString& operator = (CString&& str)
+        {
+            CStringT<TCHAR>::operator = (std::move(str));
+            return *this;
         }
 
+        CString& operator = (CStringT<TCHAR>&& str)
+        {
+            CStringT<TCHAR>::operator = (std::move(str));
+            return *this;
+        }
+#endif
+
         CString& operator = (const CString& str)
         {
             m_str.assign(str.GetString());
@@ -329,7 +372,8 @@ namespace Win32xx
             char str[2] = {0};
             str[0] = ch;
             AtoT tch(str);
-            m_str.append(1, static_cast<LPCTSTR>(tch)[0]);
+            LPCTSTR converted = tch;
+            m_str.append(converted, ch ? ::lstrlen(converted) : 1);
             return *this;
         }
 
@@ -338,7 +382,8 @@ namespace Win32xx
             WCHAR str[2] = {0};
             str[0] = ch;
             WtoT tch(str);
-            m_str.append(1, static_cast<LPCTSTR>(tch)[0]);
+            LPCTSTR converted = tch;
+            m_str.append(converted, ch ? ::lstrlen(converted) : 1);
             return *this;
         }
 
@@ -425,6 +470,30 @@ namespace Win32xx
         m_str.assign(str.m_str);
     }
 
+#ifdef WXX_MOVE_SEMANTICS
+
+    // Move constructor. Takes ownership of the contents of str, leaving str empty.
+    template <class T>
+    inline CStringT<T>::CStringT(CStringT&& str) : m_str(std::move(str.m_str))
+    {
+        str.m_str.clear();
+    }
+
+    // Move assignment. Takes ownership of the contents of str, leaving str empty.
+    template <class T>
+    inline CStringT<T>& CStringT<T>::operator = (CStringT<T>&& str)
+    {
+        if (this != &str)
+        {
+            m_str.swap(str.m_str);
+            str.m_str.clear();
+        }
+
+        return *this;
+    }
+
+#endif
+
     // Constructor. Assigns from from a const T* character array.
     template <class T>
     inline CStringT<T>::CStringT(const T* text)
@@ -447,8 +516,8 @@ namespace Win32xx
     template <class T>
     inline CStringT<T>::CStringT(const T* text, int length)
     {
-        memcpy(GetBuffer(length), text, length*sizeof(T));
-        ReleaseBuffer(length);
+        assert(length >= 0);
+        m_str.assign(text, length);
     }
 
     // Assign from a const CStringT<T>.
@@ -595,7 +664,7 @@ namespace Win32xx
         str.FormatV(format, args);
         va_end(args);
 
-        m_str.append(str);
+        m_str.append(str.m_str);
     }
 
     // Assigns the specified number of characters from text to the CStringT.
@@ -755,58 +824,120 @@ namespace Win32xx
     }
 
     // Formats the string using a variable list of arguments.
-    template <>
-    inline void CStringT<CHAR>::FormatV(const CHAR*  format, va_list args)
+    // Short results are formatted into a stack buffer. Longer results are measured
+    // first, then formatted into a buffer on the heap. The string is only assigned
+    // once the result is complete, so the arguments can include the string itself.
+    // Throws std::bad_alloc if a result that can't be measured doesn't fit in
+    // WXX_FORMAT_MAX_SIZE characters.
+    template <class T>
+    inline void CStringT<T>::FormatV(const T* format, va_list args)
     {
-
         if (format)
         {
-            int result = -1;
-            int length = 256;
+            // Try the stack buffer first.
+            T buffer[WXX_FORMAT_BUFFER_SIZE];
+            va_list argsCopy;
+            va_copy(argsCopy, args);
+            int result = vsnprintfT(buffer, WXX_FORMAT_BUFFER_SIZE, format, argsCopy);
+            va_end(argsCopy);
+
+            if (result >= 0 && result < WXX_FORMAT_BUFFER_SIZE - 1)
+            {
+                m_str.assign(buffer, result);
+                return;
+            }
+
+            // Measure the length of the result.
+            va_copy(argsCopy, args);
+            int length = vscprintfT(format, argsCopy);
+            va_end(argsCopy);
 
-            // A vector is used to store the CHAR array
-            std::vector<CHAR> buffer;
+            std::vector<T> heapBuffer;
+            if (length >= 0)
+            {
+                heapBuffer.resize(size_t(length) + 2);
+                va_copy(argsCopy, args);
+                result = vsnprintfT(&heapBuffer[0], length + 2, format, argsCopy);
+                va_end(argsCopy);
+                assert(result == length);
+                m_str.assign(&heapBuffer[0], length);
+                return;
+            }
 
-            while (-1 == result)
+            // The length can't be measured, so grow the buffer until the result fits.
+            int size = WXX_FORMAT_BUFFER_SIZE;
+            while (result < 0 || result >= size - 1)
             {
-                buffer.assign( size_t(length)+1, 0 );
+                if (size >= WXX_FORMAT_MAX_SIZE)
+                    throw std::bad_alloc();
+
+                size *= 2;
+                heapBuffer.resize(size);
+                va_copy(argsCopy, args);
+                result = vsnprintfT(&heapBuffer[0], size, format, argsCopy);
+                va_end(argsCopy);
+            }
 
-#if !defined (_MSC_VER) ||  ( _MSC_VER < 1400 )
-                result = _vsnprintf(&buffer.front(), length, format, args);
+            m_str.assign(&heapBuffer[0], result);
+        }
+    }
+
+    // Returns the number of characters the formatted string requires,
+    // or -1 if the compiler's runtime can't measure it.
+    template <class T>
+    inline int CStringT<T>::vscprintfT(const CHAR* format, va_list args) const
+    {
+#if (defined (_MSC_VER) && (_MSC_VER >= 1300)) || defined (__GNUC__)
+        return _vscprintf(format, args);
 #else
-                result = _vsnprintf_s(&buffer.front(), length, size_t(length)-1, format, args);
+        UNREFERENCED_PARAMETER(format);
+        UNREFERENCED_PARAMETER(args);
+        return -1;
 #endif
-                length *= 2;
-            }
-            m_str.assign(&buffer.front());
-        }
     }
 
-    // Formats the string using a variable list of arguments.
-    template <>
-    inline void CStringT<WCHAR>::FormatV(const WCHAR*  format, va_list args)
+    // Returns the number of characters the formatted string requires,
+    // or -1 if the compiler's runtime can't measure it.
+    template <class T>
+    inline int CStringT<T>::vscprintfT(const WCHAR* format, va_list args) const
     {
+#if (defined (_MSC_VER) && (_MSC_VER >= 1300)) || defined (__GNUC__)
+        return _vscwprintf(format, args);
+#else
+        UNREFERENCED_PARAMETER(format);
+        UNREFERENCED_PARAMETER(args);
+        return -1;
+#endif
+    }
 
-        if (format)
-        {
-            int result = -1;
-            int length = 256;
+    // Formats at most size - 1 characters into the buffer. Returns the number
+    // of characters written, or a negative value if the buffer is too small.
+    template <class T>
+    inline int CStringT<T>::vsnprintfT(CHAR* buffer, int size, const CHAR* format, va_list args) const
+    {
+        assert(size > 1);
+        buffer[size - 1] = 0;
 
-            // A vector is used to store the WCHAR array
-            std::vector<WCHAR> buffer;
+#if !defined (_MSC_VER) ||  ( _MSC_VER < 1400 )
+        return _vsnprintf(buffer, size_t(size) - 1, format, args);
+#else
+        return _vsnprintf_s(buffer, size, size_t(size) - 1, format, args);
+#endif
+    }
+
+    // Formats at most size - 1 characters into the buffer. Returns the number
+    // of characters written, or a negative value if the buffer is too small.
+    template <class T>
+    inline int CStringT<T>::vsnprintfT(WCHAR* buffer, int size, const WCHAR* format, va_list args) const
+    {
+        assert(size > 1);
+        buffer[size - 1] = 0;
 
-            while (-1 == result)
-            {
-                buffer.assign( size_t(length)+1, 0 );
 #if !defined (_MSC_VER) ||  ( _MSC_VER < 1400 )
-                result = _vsnwprintf(&buffer.front(), length, format, args);
+        return _vsnwprintf(buffer, size_t(size) - 1, format, args);
 #else
-                result = _vsnwprintf_s(&buffer.front(), length, size_t(length)-1, format, args);
+        return _vsnwprintf_s(buffer, size, size_t(size) - 1, format, args);
 #endif
-                length *= 2;
-            }
-            m_str.assign(&buffer.front());
-        }
     }
 
     // Formats a message string.
@@ -871,30 +1002,20 @@ namespace Win32xx
 
     // Creates a buffer of minBufLength characters (+1 extra for NULL termination) and returns
     // a pointer to this buffer. This buffer can be used by any function which accepts a LPTSTR.
-    // Care must be taken not to exceed the length of the buffer. Use ReleaseBuffer to safely
-    // copy this buffer back to the CStringT object.
-    // Note: The buffer uses a vector. Vectors are required to be contiguous in memory under
-    //       the current standard, whereas std::strings do not have this requirement.
+    // Care must be taken not to exceed the length of the buffer. Use ReleaseBuffer to set the
+    // length of the CStringT object when the buffer is no longer required.
+    // Note: The buffer is the string's own storage, so the existing contents are preserved
+    //       and no copy is made. The string's characters are stored contiguously.
     template <class T>
     inline T* CStringT<T>::GetBuffer(int minBufLength)
     {
         assert (minBufLength >= 0);
 
         T ch = 0;
-        m_buf.assign(size_t(minBufLength) + 1, ch);
-        typename std::basic_string<T>::iterator it_end;
-
-        if (m_str.length() >= (size_t)minBufLength)
-        {
-            it_end = m_str.begin();
-            std::advance(it_end, minBufLength);
-        }
-        else
-            it_end = m_str.end();
-
-        std::copy(m_str.begin(), it_end, m_buf.begin());
+        m_str.resize(size_t(minBufLength) + 1, ch);
+        m_str[minBufLength] = ch;
 
-        return &m_buf.front();
+        return &m_str[0];
     }
 
     // Sets the string to the value of the specified environment variable.
@@ -1091,30 +1212,22 @@ namespace Win32xx
         return str;
     }
 
-    // This copies the contents of the buffer (acquired by GetBuffer) to this CStringT.
-    // The default length of -1 copies from the buffer until a null terminator is reached.
+    // Sets the length of this CStringT after its buffer (acquired by GetBuffer) is modified.
+    // The default length of -1 uses the buffer up to the first null terminator.
     // If the buffer doesn't contain a null terminator, you must specify the buffer's length.
     template <class T>
     inline void CStringT<T>::ReleaseBuffer( int newLength /*= -1*/ )
     {
+        assert(m_str.size() > 0);
 
         if (-1 == newLength)
         {
-            newLength = lstrlenT(&m_buf.front());
+            newLength = lstrlenT(m_str.c_str());
         }
 
-        assert(m_buf.size() > 0);
-        assert(newLength <= static_cast<int>(m_buf.size() -1));
-        newLength = MIN(newLength, static_cast<int>(m_buf.size() -1));
-
-        T ch = 0;
-        m_str.assign(newLength, ch);
-
-        typename std::vector<T>::iterator it_end = m_buf.begin();
-        std::advance(it_end, newLength);
-
-        std::copy(m_buf.begin(), it_end, m_str.begin());
-        m_buf.clear();
+        assert(newLength <= static_cast<int>(m_str.size() -1));
+        newLength = MIN(newLength, static_cast<int>(m_str.size() -1));
+        m_str.resize(newLength);
     }
 
     // Removes each occurrence of the specified substring from the string.
@@ -1457,7 +1570,9 @@ namespace Win32xx
     // Addition operator.
     inline CStringT<CHAR> operator + (const CStringT<CHAR>& string1, const CStringT<CHAR>& string2)
     {
-        CStringT<CHAR> str(string1);
+        CStringT<CHAR> str;
+        str.m_str.reserve(string1.m_str.size() + string2.m_str.size());
+        str.m_str.append(string1.m_str);
         str.m_str.append(string2.m_str);
         return str;
     }
@@ -1465,7 +1580,9 @@ namespace Win32xx
     // Addition operator.
     inline CStringT<WCHAR> operator + (const CStringT<WCHAR>& string1, const CStringT<WCHAR>& string2)
     {
-        CStringT<WCHAR> str(string1);
+        CStringT<WCHAR> str;
+        str.m_str.reserve(string1.m_str.size() + string2.m_str.size());
+        str.m_str.append(string1.m_str);
         str.m_str.append(string2.m_str);
         return str;
     }
@@ -1506,7 +1623,7 @@ namespace Win32xx
     inline CStringT<CHAR> operator + (const CHAR* text, const CStringT<CHAR>& string1)
     {
         CStringT<CHAR> str(text);
-        str.m_str.append(string1);
+        str.m_str.append(string1.m_str);
         return str;
     }
 
@@ -1514,7 +1631,7 @@ namespace Win32xx
     inline CStringT<WCHAR> operator + (const WCHAR* text, const CStringT<WCHAR>& string1)
     {
         CStringT<WCHAR> str(text);
-        str.m_str.append(string1);
+        str.m_str.append(string1.m_str);
         return str;
     }
 
@@ -1522,7 +1639,7 @@ namespace Win32xx
     inline CStringT<CHAR> operator + (CHAR ch, const CStringT<CHAR>& string1)
     {
         CStringT<CHAR> str(ch);
-        str.m_str.append(string1);
+        str.m_str.append(string1.m_str);
         return str;
     }
 
@@ -1530,7 +1647,7 @@ namespace Win32xx
     inline CStringT<WCHAR> operator + (WCHAR ch, const CStringT<WCHAR>& string1)
     {
         CStringT<WCHAR> str(ch);
-        str.m_str.append(string1);
+        str.m_str.append(string1.m_str);
         return str;
     }
 
@@ -1624,7 +1741,9 @@ namespace Win32xx
     //
     inline CString operator + (const CString& string1, const CString& string2)
     {
-        CString str(string1);
+        CString str;
+        str.m_str.reserve(string1.m_str.size() + string2.m_str.size());
+        str.m_str.append(string1.m_str);
         str.m_str.append(string2.m_str);
         return str;
     }
@@ -1646,39 +1765,35 @@ namespace Win32xx
     inline CString operator + (const CString& string1, CHAR ch)
     {
         CString str(string1);
-        CString str1(ch);
-        str += str1;
+        str += ch;
         return str;
     }
 
     inline CString operator + (const CString& string1, WCHAR ch)
     {
         CString str(string1);
-        CString str1(ch);
-        str += str1;
+        str += ch;
         return str;
     }
 
     inline CString operator + (const TCHAR* text, const CString& string1)
     {
         CString str(text);
-        str.m_str.append(string1);
+        str.m_str.append(string1.m_str);
         return str;
     }
 
     inline CString operator + (CHAR ch, const CString& string1)
     {
-        CString str1(string1);
         CString str(ch);
-        str += str1;
+        str.m_str.append(string1.m_str);
         return str;
     }
 
     inline CString operator + (WCHAR ch, const CString& string1)
     {
-        CString str1(string1);
         CString str(ch);
-        str += str1;
+        str.m_str.append(string1.m_str);
         return str;
     }
 
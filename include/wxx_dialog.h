@@ -300,6 +300,12 @@ namespace Win32xx
             {
                 // Center the dialog
                 CenterWindow();
+
+                // A dialog is the main window of a thread which has none, such
+                // as the thread of a dialog based application. Tasks posted
+                // with PostThreadTask then wake the thread inside DoModal.
+                if (GetApp()->GetMainWnd() == 0)
+                    GetApp()->SetMainWnd(*this);
             }
             return OnInitDialog();
         case WM_CLOSE:
@@ -337,7 +343,12 @@ namespace Win32xx
 
 
         case WM_DESTROY:
-            OnDestroy();
+            {
+                if (GetApp()->GetMainWnd() == *this)
+                    GetApp()->SetMainWnd(0);
+
+                OnDestroy();
+            }
             break;
         case WM_NOTIFY:
             {
@@ -417,6 +428,16 @@ namespace Win32xx
             return TRUE;
         }
 
+        case UWM_RUNTHREADTASKS:
+        {
+            // Run the tasks other threads posted to this thread's message pump.
+            TLSData* pTLSData = GetApp()->GetTlsData();
+            if (pTLSData && pTLSData->pMessagePump)
+                pTLSData->pMessagePump->ProcessThreadTasks();
+
+            return TRUE;
+        }
+
         } // switch(msg)
 
         return 0;
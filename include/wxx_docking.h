@@ -60,6 +60,7 @@
 #include "wxx_toolbar.h"
 #include "wxx_tab.h"
 #include "wxx_regkey.h"
+#include "wxx_archive.h"
 #include "wxx_themes.h"
 #include "default_resource.h"
 
@@ -113,6 +114,10 @@ namespace Win32xx
     const int DS_DOCKED_TOPMOST      = 0x40000; // Topmost outer docking
     const int DS_DOCKED_BOTTOMMOST   = 0x80000; // Bottommost outer docking
 
+    // The signature and version at the start of a binary dock layout.
+    const DWORD DOCK_LAYOUT_SIGNATURE = 0x4C445857;  // "WXDL"
+    const UINT  DOCK_LAYOUT_VERSION   = 1;
+
     // Class declarations
     class CDockContainer;
     class CDocker;
@@ -266,6 +271,28 @@ namespace Win32xx
         CDocker* pDocker;
     } *LPDRAGPOS;
 
+    // A docker in the in-memory docker tree used by CDocker::CalcDockLayout.
+    // The dock layout's geometry is calculated from these nodes without
+    // using any windows.
+    struct DockLayoutNode
+    {
+        DWORD dockStyle;        // The docker's dock style
+        int dockStartSize;      // The docker's dock size
+        double dockSizeRatio;   // The docker's size as a proportion of its dock parent's size
+        int barWidth;           // The width of the docker's dock bar
+        BOOL isDocked;          // TRUE if the docker is docked
+        BOOL isRTL;             // TRUE if the docker has a right to left layout
+        CSize windowSize;       // The docker's window size. Calculated for docked dockers
+        int firstChild;         // The index of the docker's first dock child
+        int childCount;         // The number of the docker's dock children
+        CRect childRect;        // The docker's rect within its dock parent
+        CRect barRect;          // The dock bar's rect within the dock parent
+        CRect clientRect;       // The DockClient's rect within the docker
+        CDocker* pDocker;       // The docker, or NULL
+        DockLayoutNode() : dockStyle(0), dockStartSize(0), dockSizeRatio(1.0), barWidth(0), isDocked(FALSE),
+                            isRTL(FALSE), firstChild(0), childCount(0), pDocker(0) {}
+    };
+
 
     /////////////////////////////////////////////////////////////////////////////////
     // A CDocker window allows other CDocker windows to be "docked" inside it.
@@ -502,13 +529,17 @@ namespace Win32xx
         virtual void DockInContainer(CDocker* pDocker, DWORD dockStyle, BOOL selectPage = TRUE);
         virtual void Hide();
         virtual BOOL LoadContainerRegistrySettings(LPCTSTR registryKeyName);
+        virtual BOOL LoadDockLayout(CArchive& ar);
+        virtual BOOL LoadDockLayoutPreset(LPCTSTR registryKeyName, LPCTSTR presetName);
         virtual BOOL LoadDockRegistrySettings(LPCTSTR registryKeyName);
         virtual void RecalcDockLayout();
+        virtual BOOL SaveDockLayout(CArchive& ar);
+        virtual BOOL SaveDockLayoutPreset(LPCTSTR registryKeyName, LPCTSTR presetName);
         virtual BOOL SaveDockRegistrySettings(LPCTSTR registryKeyName);
-        virtual void SaveContainerRegistrySettings(CRegKey& dockKey, CDockContainer* pContainer, UINT& container);
         virtual void Undock(CPoint pt, BOOL showUndocked = TRUE);
         virtual void UndockContainer(CDockContainer* pContainer, CPoint pt, BOOL showUndocked);
         virtual BOOL VerifyDockers();
+        static void CalcDockLayout(std::vector<DockLayoutNode>& nodes, const RECT& viewRect);
 
         // Virtual accessors and mutators
         virtual CWnd& GetView() const       { return GetDockClient().GetView(); }
@@ -572,6 +603,14 @@ namespace Win32xx
         virtual void PreCreate(CREATESTRUCT& cs);
         virtual void PreRegisterClass(WNDCLASS& wc);
 
+        // Dock target lookup used while this docker is dragged
+        virtual CDocker* GetDockUnderDragPoint(POINT pt);
+        void ClearDragTargets();
+        void SnapshotDragTargets();
+
+        // Dock layout
+        void GetDockLayoutNodes(std::vector<DockLayoutNode>& nodes);
+
         // Not intended to be overwritten
         LRESULT WndProcDefault(UINT msg, WPARAM wparam, LPARAM lparam);
 
@@ -591,8 +630,22 @@ namespace Win32xx
     private:
         CDocker(const CDocker&);                // Disable copy construction
         CDocker& operator = (const CDocker&);   // Disable assignment operator
+
+        // A window in the snapshot of dock targets taken when a drag starts.
+        struct DragTarget
+        {
+            CRect rect;             // The window rectangle, in screen coordinates
+            CRect clientRect;       // The client rectangle of a docker, in screen coordinates
+            CRect dockClientRect;   // The window rectangle of a docker's DockClient
+            CDocker* pDocker;       // The docker, or NULL if the window isn't a related docker
+            int firstChild;         // The index of the window's first child window
+            int childCount;         // The number of the window's child windows
+        };
+
         std::vector <DockPtr> & GetAllChildren() const {return GetDockAncestor()->m_allDockChildren;}
-        virtual CDocker* GetDockUnderDragPoint(POINT pt);
+        void AddDragTarget(HWND wnd);
+        void AddLayoutChild(CDocker* pDocker, DWORD dockStyle, int dockSize, double dockSizeRatio, int dockID);
+        static int ApplyDockLayout(const std::vector<DockLayoutNode>& nodes);
         void CheckAllTargets(LPDRAGPOS pDragPos);
         void CloseAllTargets();
         void DockOuter(CDocker* pDocker, DWORD dockStyle);
@@ -601,13 +654,17 @@ namespace Win32xx
         void ConvertToChild(HWND hWndParent);
         void ConvertToPopup(const RECT& rc, BOOL showUndocked);
         void MoveDockChildren(CDocker* pDockTarget);
+        static BOOL IsRepositionNeeded(const CWnd& wnd, const RECT& rc);
         void PromoteFirstChild();
-        void RecalcDockChildLayout(CRect& rc);
+        static BOOL ReadDockLayoutValue(LPCTSTR keyName, LPCTSTR valueName, std::vector<BYTE>& layout);
         void ResizeDockers(LPDRAGPOS pDragPos);
         CDocker* SeparateFromDock();
         void SendNotify(UINT messageID);
+        void SetActiveContainer(int dockID);
+        void SetContainerTabOrder(int parentID, const std::vector<UINT>& tabOrder);
         void SetUndockPosition(CPoint pt, BOOL showUndocked);
         std::vector<CDocker*> SortDockers();
+        static BOOL WriteDockLayoutValue(LPCTSTR keyName, LPCTSTR valueName, const std::vector<BYTE>& layout);
         static BOOL CALLBACK EnumWindowsProc(HWND top, LPARAM lparam);
 
         CDockBar        m_dockBar;
@@ -629,6 +686,7 @@ namespace Win32xx
         std::vector <CDocker*> m_dockChildren;     // Docker's immediate children
         std::vector <DockPtr> m_allDockChildren;   // All descendants of the DockAncestor (only used by the DockAncestor)
         std::vector <CDocker*> m_allDockers;       // DockAncestor + all descendants (only used by the DockAncestor)
+        std::vector <DragTarget> m_dragTargets;    // Top level dock targets in Z order, followed by their child windows
 
         CRect m_barRect;
         CRect m_childRect;
@@ -638,15 +696,20 @@ namespace Win32xx
         BOOL m_isClosing;
         BOOL m_isDragging;
         BOOL m_isDragAutoResize;
+        BOOL m_isFrameChanged;      // TRUE if the docker's frame needs to be recalculated when it's positioned
+        BOOL m_isLayoutDeferred;    // TRUE while LoadDockLayout adds dockers (only used by the DockAncestor)
         int m_dockStartSize;
         int m_dockID;
         int m_redrawCount;
         int m_ncHeight;
+        int m_clientNCHeight;       // The DockClient's caption height when it was last positioned, or -1
+        DWORD m_clientExStyle;      // The DockClient's extended style when it was last positioned
         DWORD m_dockZone;
         double m_dockSizeRatio;
         DWORD m_dockStyle;
-        HWND m_dockUnderPoint;
-        CPoint m_dockPoint;
+        int m_dragTopCount;         // The number of top level dock targets, or -1 if there is no snapshot
+        UINT m_dragLayoutCount;     // The layout count when the dock targets were taken
+        UINT m_layoutCount;         // Incremented when the dock layout changes (only used by the DockAncestor)
 
     }; // class CDocker
 
@@ -673,6 +736,7 @@ namespace Win32xx
     inline CDocker::CDockBar::CDockBar() : m_pDocker(NULL), m_dockBarWidth(4)
     {
         ZeroMemory(&m_dragPos, sizeof(m_dragPos));
+        EnablePreTranslate(FALSE);
     }
 
     inline CDocker::CDockBar::~CDockBar()
@@ -799,6 +863,7 @@ namespace Win32xx
         m_foregnd2 = GetSysColor(COLOR_BTNTEXT);
         m_backgnd2 = GetSysColor(COLOR_BTNFACE);
         m_penColor = RGB(160, 150, 140);
+        EnablePreTranslate(FALSE);
     }
 
     inline void CDocker::CDockClient::Draw3DBorder(const RECT& rect)
@@ -872,7 +937,7 @@ namespace Win32xx
                 int Width = MAX(rc.Width() - rcAdjust, 0);
 
                 int Height = m_pDocker->m_ncHeight + rcAdjust;
-                memDC.CreateCompatibleBitmap(dc, Width, Height);
+                memDC.CreatePooledBitmap(dc, Width, Height);
                 m_isOldFocusStored = Focus;
 
                 // Set the font for the title
@@ -2011,8 +2076,10 @@ namespace Win32xx
     // Constructor.
     inline CDocker::CDocker() : m_pDockParent(NULL), m_pDockAncestor(NULL), m_isBlockMove(FALSE),
                     m_isUndocking(FALSE), m_isClosing(FALSE), m_isDragging(FALSE),
-                    m_isDragAutoResize(TRUE), m_dockStartSize(0), m_dockID(0), m_redrawCount(0),
-                    m_ncHeight(0), m_dockZone(0), m_dockSizeRatio(1.0), m_dockStyle(0), m_dockUnderPoint(0)
+                    m_isDragAutoResize(TRUE), m_isFrameChanged(TRUE), m_isLayoutDeferred(FALSE),
+                    m_dockStartSize(0), m_dockID(0), m_redrawCount(0), m_ncHeight(0), m_clientNCHeight(-1), m_clientExStyle(0), m_dockZone(0),
+                    m_dockSizeRatio(1.0), m_dockStyle(0), m_dragTopCount(-1),
+                    m_dragLayoutCount(0), m_layoutCount(0)
     {
         // Assume this docker is the DockAncestor for now.
         SetDockBar(m_dockBar);
@@ -2127,6 +2194,254 @@ namespace Win32xx
         return pDocker;
     }
 
+    // Adds a docker restored by LoadDockLayout as a docked child. Unlike
+    // AddDockedChild, the saved dock size and ratio are used as they are,
+    // and the dockers are positioned later by a single RecalcDockLayout.
+    inline void CDocker::AddLayoutChild(CDocker* pDocker, DWORD dockStyle, int dockSize, double dockSizeRatio, int dockID)
+    {
+        assert(pDocker);
+
+        // Store the docker's pointer in the DockAncestor's vector for later deletion.
+        GetAllChildren().push_back(DockPtr(pDocker));
+        GetDockAncestor()->m_allDockers.push_back(pDocker);
+
+        pDocker->SetDockStyle(dockStyle);
+        pDocker->m_dockID = dockID;
+        pDocker->m_dockStartSize = dockSize;
+        pDocker->m_dockSizeRatio = dockSizeRatio;
+        pDocker->m_pDockAncestor = GetDockAncestor();
+        pDocker->m_pDockParent = this;
+        pDocker->m_isBlockMove = FALSE;
+        pDocker->Create(GetDockAncestor()->GetAncestor());
+
+        m_dockChildren.push_back(pDocker);
+        pDocker->ConvertToChild(*this);
+    }
+
+    // Adds a window to the snapshot of dock targets. The client rectangles
+    // are recorded for the dockers related to this docker.
+    inline void CDocker::AddDragTarget(HWND wnd)
+    {
+        DragTarget target;
+        VERIFY(::GetWindowRect(wnd, &target.rect));
+        target.pDocker = NULL;
+        target.firstChild = 0;
+        target.childCount = 0;
+
+        if (IsRelated(wnd))
+        {
+            target.pDocker = reinterpret_cast<CDocker*>(::SendMessage(wnd, UWM_GETCDOCKER, 0, 0));
+            assert(target.pDocker);
+            target.clientRect = target.pDocker->GetClientRect();
+            target.pDocker->ClientToScreen(target.clientRect);
+            target.clientRect.NormalizeRect();  // For RTL layouts
+            target.dockClientRect = target.pDocker->GetDockClient().GetWindowRect();
+        }
+
+        m_dragTargets.push_back(target);
+    }
+
+    // Positions the dockers, DockClients and dock bars at the rectangles
+    // calculated by CalcDockLayout. Only the windows which are hidden or
+    // have moved are repositioned. The frame is recalculated only for the
+    // dockers converted to child windows, and for the DockClients whose
+    // caption or border has changed. Returns the number of windows repositioned.
+    inline int CDocker::ApplyDockLayout(const std::vector<DockLayoutNode>& nodes)
+    {
+        int moved = 0;
+        std::vector<DockLayoutNode>::const_iterator iter;
+        for (iter = nodes.begin(); iter != nodes.end(); ++iter)
+        {
+            CDocker* pDocker = (*iter).pDocker;
+            HDWP hdwp = 0;
+
+            // Step 1: Position the docker's dock children and DockClient simultaneously.
+            for (int i = (*iter).firstChild; i < (*iter).firstChild + (*iter).childCount; ++i)
+            {
+                const DockLayoutNode& child = nodes[i];
+                CDocker* pChild = child.pDocker;
+                if (child.isDocked)
+                {
+                    pChild->m_childRect = child.childRect;
+                    pChild->m_barRect = child.barRect;
+
+                    if (pChild->m_isFrameChanged || IsRepositionNeeded(*pChild, child.childRect))
+                    {
+                        UINT flags = pChild->m_isFrameChanged ? SWP_SHOWWINDOW|SWP_FRAMECHANGED : SWP_SHOWWINDOW;
+                        if (hdwp == 0)
+                            hdwp = ::BeginDeferWindowPos((*iter).childCount + 1);
+
+                        hdwp = pChild->DeferWindowPos(hdwp, 0, child.childRect, flags);
+                        pChild->m_isFrameChanged = FALSE;
+                        ++moved;
+                    }
+                }
+            }
+
+            CDockClient& client = pDocker->GetDockClient();
+            if (client.IsWindow())
+            {
+                // The DockClient's non-client area holds the caption and the border.
+                int ncHeight = 0;
+                if (!(pDocker->GetDockStyle() & DS_NO_CAPTION) && pDocker->IsUndockable())
+                    ncHeight = pDocker->m_ncHeight;
+
+                DWORD exStyle = client.GetExStyle();
+                BOOL isFrameChanged = (ncHeight != pDocker->m_clientNCHeight) || (exStyle != pDocker->m_clientExStyle);
+                if (isFrameChanged || IsRepositionNeeded(client, (*iter).clientRect))
+                {
+                    UINT flags = isFrameChanged ? SWP_SHOWWINDOW|SWP_FRAMECHANGED : SWP_SHOWWINDOW;
+                    if (hdwp == 0)
+                        hdwp = ::BeginDeferWindowPos(1);
+
+                    hdwp = client.DeferWindowPos(hdwp, 0, (*iter).clientRect, flags);
+                    pDocker->m_clientNCHeight = ncHeight;
+                    pDocker->m_clientExStyle = exStyle;
+                    ++moved;
+                }
+            }
+
+            if (hdwp != 0)
+                VERIFY(::EndDeferWindowPos(hdwp));
+
+            // Step 2: Position the dockbar. Only docked dockers have a dock bar.
+            if ((*iter).isDocked)
+            {
+                CRect barRect;
+                barRect.IntersectRect(pDocker->m_barRect, pDocker->GetDockParent()->GetViewRect());
+                if (IsRepositionNeeded(pDocker->GetDockBar(), barRect))
+                {
+                    // The SWP_NOCOPYBITS forces a redraw of the dock bar.
+                    VERIFY(pDocker->GetDockBar().SetWindowPos(0, barRect, SWP_SHOWWINDOW|SWP_NOCOPYBITS));
+                    ++moved;
+                }
+            }
+        }
+
+        return moved;
+    }
+
+    // Calculates the position of each docker, dock bar and DockClient in a
+    // tree of dock layout nodes. No windows are used, so the geometry of a
+    // dock layout can be calculated without creating any dockers.
+    // The first node is the top level docker. The dock children of each node
+    // are stored contiguously, after their dock parent. The viewRect is the
+    // top level docker's area for its dock children and DockClient.
+    inline void CDocker::CalcDockLayout(std::vector<DockLayoutNode>& nodes, const RECT& viewRect)
+    {
+        // Notes:
+        // 1) A docker's rect is calculated before its dock children's rects.
+        // 2) The DockClient's rect is the docker's rect minus the area of the
+        //     dock children and their dock bars (splitter bars).
+        // 3) A docker that isn't docked keeps its childRect.
+
+        const int minSize = 30;
+        for (size_t n = 0; n < nodes.size(); ++n)
+        {
+            DockLayoutNode& node = nodes[n];
+            CRect rc = (n == 0) ? CRect(viewRect) : node.childRect;
+            if (node.isDocked)
+            {
+                rc.OffsetRect(-rc.left, -rc.top);
+            }
+
+            for (int i = node.firstChild; i < node.firstChild + node.childCount; ++i)
+            {
+                DockLayoutNode& child = nodes[i];
+                CRect rcChild = rc;
+                double dockSize = child.dockStartSize;
+
+                // Calculate the size of the Docker children
+                switch (child.dockStyle & 0xF)
+                {
+                case DS_DOCKED_LEFT:
+                    if (child.dockStyle & DS_NO_FIXED_RESIZE)
+                        dockSize = MIN(child.dockSizeRatio*(node.windowSize.cx), rcChild.Width());
+
+                    if (node.isRTL)
+                    {
+                        rcChild.left = rcChild.right - static_cast<int>(dockSize);
+                        rcChild.left = MIN(rcChild.left, rc.right - minSize);
+                        rcChild.left = MAX(rcChild.left, rc.left + minSize);
+                    }
+                    else
+                    {
+                        rcChild.right = rcChild.left + static_cast<int>(dockSize);
+                        rcChild.right = MAX(rcChild.right, rc.left + minSize);
+                        rcChild.right = MIN(rcChild.right, rc.right - minSize);
+                    }
+                    break;
+                case DS_DOCKED_RIGHT:
+                    if (child.dockStyle & DS_NO_FIXED_RESIZE)
+                        dockSize = MIN(child.dockSizeRatio*(node.windowSize.cx), rcChild.Width());
+
+                    if (node.isRTL)
+                    {
+                        rcChild.right = rcChild.left + static_cast<int>(dockSize);
+                        rcChild.right = MAX(rcChild.right, rc.left + minSize);
+                        rcChild.right = MIN(rcChild.right, rc.right - minSize);
+                    }
+                    else
+                    {
+                        rcChild.left = rcChild.right - static_cast<int>(dockSize);
+                        rcChild.left = MIN(rcChild.left, rc.right - minSize);
+                        rcChild.left = MAX(rcChild.left, rc.left + minSize);
+                    }
+
+                    break;
+                case DS_DOCKED_TOP:
+                    if (child.dockStyle & DS_NO_FIXED_RESIZE)
+                        dockSize = MIN(child.dockSizeRatio*(node.windowSize.cy), rcChild.Height());
+
+                    rcChild.bottom = rcChild.top + static_cast<int>(dockSize);
+                    rcChild.bottom = MAX(rcChild.bottom, rc.top + minSize);
+                    rcChild.bottom = MIN(rcChild.bottom, rc.bottom - minSize);
+                    break;
+                case DS_DOCKED_BOTTOM:
+                    if (child.dockStyle & DS_NO_FIXED_RESIZE)
+                        dockSize = MIN(child.dockSizeRatio*(node.windowSize.cy), rcChild.Height());
+
+                    rcChild.top = rcChild.bottom - static_cast<int>(dockSize);
+                    rcChild.top = MIN(rcChild.top, rc.bottom - minSize);
+                    rcChild.top = MAX(rcChild.top, rc.top + minSize);
+
+                    break;
+                }
+
+                if (child.isDocked)
+                {
+                    child.childRect = rcChild;
+                    child.windowSize = rcChild.Size();
+                    rc.SubtractRect(rc, rcChild);
+
+                    // Calculate the dimensions of the splitter bar.
+                    CRect barRect = rc;
+                    DWORD DockSide = child.dockStyle & 0xF;
+
+                    if (DS_DOCKED_LEFT   == DockSide)
+                    {
+                        if (node.isRTL) barRect.left   = barRect.right - child.barWidth;
+                        else            barRect.right  = barRect.left + child.barWidth;
+                    }
+
+                    if (DS_DOCKED_RIGHT  == DockSide)
+                    {
+                        if (node.isRTL) barRect.right  = barRect.left + child.barWidth;
+                        else            barRect.left   = barRect.right - child.barWidth;
+                    }
+
+                    if (DS_DOCKED_TOP    == DockSide) barRect.bottom = barRect.top + child.barWidth;
+                    if (DS_DOCKED_BOTTOM == DockSide) barRect.top    = barRect.bottom - child.barWidth;
+
+                    child.barRect = barRect;
+                    rc.SubtractRect(rc, barRect);
+                }
+            }
+
+            node.clientRect = rc;
+        }
+    }
+
     // Calls CheckTarget for each possible target zone.
     inline void CDocker::CheckAllTargets(LPDRAGPOS pDragPos)
     {
@@ -2237,6 +2552,13 @@ namespace Win32xx
         Destroy();
     }
 
+    // Discards the snapshot of dock targets taken by SnapshotDragTargets.
+    inline void CDocker::ClearDragTargets()
+    {
+        m_dragTargets.clear();
+        m_dragTopCount = -1;
+    }
+
     // Closes all the child dockers of this dock ancestor.
     inline void CDocker::CloseAllDockers()
     {
@@ -2546,44 +2868,98 @@ namespace Win32xx
         return m_pDockAncestor;
     }
 
+    // Fills the vector with the dock layout nodes of this docker and its
+    // dock descendants, ready for CalcDockLayout. This docker is the first
+    // node, and the dock children of each docker are stored contiguously.
+    inline void CDocker::GetDockLayoutNodes(std::vector<DockLayoutNode>& nodes)
+    {
+        nodes.clear();
+        std::vector<CDocker*> dockers(1, this);
+        for (size_t n = 0; n < dockers.size(); ++n)
+        {
+            CDocker* pDocker = dockers[n];
+            DockLayoutNode node;
+            node.dockStyle = pDocker->GetDockStyle();
+            node.dockStartSize = pDocker->m_dockStartSize;
+            node.dockSizeRatio = pDocker->m_dockSizeRatio;
+            node.barWidth = pDocker->GetBarWidth();
+            node.isDocked = pDocker->IsDocked();
+#ifdef WS_EX_LAYOUTRTL
+            node.isRTL = (pDocker->GetExStyle() & WS_EX_LAYOUTRTL) ? TRUE : FALSE;
+#endif
+            // The size of a docked docker is calculated by the layout.
+            if (!node.isDocked)
+                node.windowSize = pDocker->GetWindowRect().Size();
+
+            node.firstChild = static_cast<int>(dockers.size());
+            node.childCount = static_cast<int>(pDocker->m_dockChildren.size());
+            node.childRect = pDocker->m_childRect;
+            node.pDocker = pDocker;
+            nodes.push_back(node);
+
+            dockers.insert(dockers.end(), pDocker->m_dockChildren.begin(), pDocker->m_dockChildren.end());
+        }
+    }
+
     // Retrieves the Docker whose view window contains the specified point.
     // Used when dragging undocked dockers over other dockers to provide
     // the docker which needs to display the dock targets and dock hints.
+    // The point is tested against the snapshot of dock targets taken when
+    // the drag started, so no windows are queried while the mouse moves.
     inline CDocker* CDocker::GetDockUnderDragPoint(POINT pt)
     {
-        // Step 1: Find the top level Docker under the point
-        // EnumWindows assigns the Docker under the point to m_dockUnderPoint
+        // Take a snapshot for this call if we aren't dragging, and update
+        // the drag's snapshot if the dock layout has changed.
+        BOOL isTemporary = (m_dragTopCount < 0);
+        if (isTemporary || m_dragLayoutCount != GetDockAncestor()->m_layoutCount)
+            SnapshotDragTargets();
 
-        m_dockUnderPoint = 0;
-        m_dockPoint = pt;
-        EnumWindows(EnumWindowsProc, (LPARAM)this);
+        // Step 1: Find the top level Docker under the point.
+        int target = -1;
+        for (int i = 0; i < m_dragTopCount; ++i)
+        {
+            if (m_dragTargets[i].rect.PtInRect(pt))
+            {
+                target = i;
+                break;
+            }
+        }
 
-        // Step 2: Find the docker child whose view window has the point
+        // Step 2: Find the docker child whose view window has the point.
+        // Like ChildWindowFromPoint, this picks the first child in Z order
+        // that contains the point, and stops at a point outside the client area.
         CDocker* pDockTarget = NULL;
-
-        HWND dockTest = m_dockUnderPoint;
-        HWND dockParent = m_dockUnderPoint;
-
-        if (m_dockUnderPoint != 0)
+        if (target >= 0)
         {
-            while (IsRelated(dockTest))
+            for (;;)
             {
-                dockParent = dockTest;
-                CPoint ptLocal = pt;
-                VERIFY(::ScreenToClient(dockParent, &ptLocal));
-                dockTest = ::ChildWindowFromPoint(dockParent, ptLocal);
-                if (dockTest == dockParent) break;
-            }
+                const DragTarget& parent = m_dragTargets[target];
+                if (!parent.clientRect.PtInRect(pt))
+                    break;
 
-            CDocker* pDockParent = reinterpret_cast<CDocker*>(::SendMessage(dockParent, UWM_GETCDOCKER, 0, 0));
-            assert(pDockParent);
+                int child = -1;
+                for (int i = parent.firstChild; i < parent.firstChild + parent.childCount; ++i)
+                {
+                    if (m_dragTargets[i].rect.PtInRect(pt))
+                    {
+                        child = i;
+                        break;
+                    }
+                }
 
-            CRect rc = pDockParent->GetDockClient().GetWindowRect();
-            if (rc.PtInRect(pt))
-                pDockTarget = pDockParent;
+                if (child < 0 || m_dragTargets[child].pDocker == NULL)
+                    break;
 
+                target = child;
+            }
+
+            if (m_dragTargets[target].dockClientRect.PtInRect(pt))
+                pDockTarget = m_dragTargets[target].pDocker;
         }
 
+        if (isTemporary)
+            ClearDragTargets();
+
         return pDockTarget;
     }
 
@@ -2745,6 +3121,22 @@ namespace Win32xx
         return FALSE;
     }
 
+    // Returns TRUE if the window is hidden, or isn't at the specified
+    // position in its parent's client area.
+    inline BOOL CDocker::IsRepositionNeeded(const CWnd& wnd, const RECT& rc)
+    {
+        if (!(wnd.GetStyle() & WS_VISIBLE))
+            return TRUE;
+
+        // The window's rect in its parent's client coordinates. The left and
+        // right are swapped if the parent has a right to left layout.
+        CRect wndRect = wnd.GetWindowRect();
+        ::MapWindowPoints(0, ::GetParent(wnd), (LPPOINT)&wndRect, 2);
+        wndRect.NormalizeRect();
+
+        return !::EqualRect(&wndRect, &rc);
+    }
+
     // Returns TRUE if the docker is docked, or is a dock ancestor that
     // has a CDockContainer with tabs.
     inline BOOL CDocker::IsUndockable() const
@@ -2767,6 +3159,193 @@ namespace Win32xx
         return (!((m_dockStyle&0xF)|| (m_dockStyle & DS_DOCKED_CONTAINER)) && !m_isUndocking); // Boolean expression
     }
 
+    // Recreates the docker layout from a binary dock layout written by
+    // SaveDockLayout. Any existing dockers are closed first, so this can be
+    // used to switch between dock layouts at any time. The whole layout is
+    // read before any dockers are created. The dockers are then created with
+    // redraw suspended, and positioned by a single layout at the end.
+    // Assumes the DockAncestor window is already created.
+    inline BOOL CDocker::LoadDockLayout(CArchive& ar)
+    {
+        assert(this == GetDockAncestor());  // Must call LoadDockLayout from the DockAncestor.
+
+        std::vector<DockInfo> dockList;
+        std::vector<double> dockSizeRatios;
+        std::vector<int> containerList;     // The parent, active container, tab count and tabs of each container group
+
+        try
+        {
+            DWORD signature = 0;
+            UINT version = 0;
+            ar >> signature;
+            ar >> version;
+            if ((signature != DOCK_LAYOUT_SIGNATURE) || (version != DOCK_LAYOUT_VERSION))
+                throw CUserException();
+
+            UINT dockCount = 0;
+            ar >> dockCount;
+            for (UINT u = 0; u < dockCount; ++u)
+            {
+                DockInfo di;
+                ZeroMemory(&di, sizeof(di));
+                double dockSizeRatio = 1.0;
+                ar >> di.dockID;
+                ar >> di.dockStyle;
+                ar >> di.dockSize;
+                ar >> dockSizeRatio;
+                ar >> di.dockParentID;
+                ar >> di.isInAncestor;
+                ar >> di.rect;
+                dockList.push_back(di);
+                dockSizeRatios.push_back(dockSizeRatio);
+            }
+
+            UINT containerCount = 0;
+            ar >> containerCount;
+            for (UINT container = 0; container < containerCount; ++container)
+            {
+                int parentID = 0;
+                int activeID = 0;
+                int tabCount = 0;
+                ar >> parentID;
+                ar >> activeID;
+                ar >> tabCount;
+                containerList.push_back(parentID);
+                containerList.push_back(activeID);
+                containerList.push_back(tabCount);
+
+                for (int tab = 0; tab < tabCount; ++tab)
+                {
+                    int tabID = 0;
+                    ar >> tabID;
+                    containerList.push_back(tabID);
+                }
+            }
+        }
+
+        catch (const CException&)
+        {
+            TRACE("*** The dock layout isn't valid. ***\n");
+            return FALSE;
+        }
+
+        // Suspend redraw and layout while the dockers are added.
+        BOOL isLoaded = TRUE;
+        m_isLayoutDeferred = TRUE;
+        SetRedraw(FALSE);
+        CloseAllDockers();
+
+        try
+        {
+            // Dock parents are stored before their dock children.
+            std::map<int, CDocker*> dockers;    // The dockers added, by DockID
+            for (size_t i = 0; i < dockList.size(); ++i)
+            {
+                const DockInfo& di = dockList[i];
+                CDocker* pDockParent = this;
+                if ((di.dockParentID != 0) && !di.isInAncestor)
+                {
+                    std::map<int, CDocker*>::const_iterator it = dockers.find(di.dockParentID);
+                    if (it == dockers.end())
+                        throw CUserException();
+
+                    pDockParent = it->second;
+                }
+
+                CDocker* pDocker = NewDockerFromID(di.dockID);
+                if (!pDocker)
+                    throw CUserException();
+
+                if ((pDockParent == this) && !(di.dockStyle & 0xF) && !di.isInAncestor)
+                    AddUndockedChild(pDocker, di.dockStyle, di.dockSize, di.rect, di.dockID);
+                else if (di.dockStyle & 0xF)
+                    pDockParent->AddLayoutChild(pDocker, di.dockStyle, di.dockSize, dockSizeRatios[i], di.dockID);
+                else
+                    pDockParent->AddDockedChild(pDocker, di.dockStyle, di.dockSize, di.dockID);
+
+                dockers[di.dockID] = pDocker;
+            }
+
+            // Position the dockers with one layout of each top level docker.
+            m_isLayoutDeferred = FALSE;
+            RecalcDockLayout();
+            std::vector<DockPtr>::const_iterator iter;
+            for (iter = GetAllChildren().begin(); iter != GetAllChildren().end(); ++iter)
+            {
+                if (!(*iter)->GetDockParent())
+                    (*iter)->RecalcDockLayout();
+            }
+
+            // Restore the tab order and active container of each container group.
+            size_t pos = 0;
+            while (pos < containerList.size())
+            {
+                if (pos + 3 > containerList.size())
+                    throw CUserException();
+
+                int parentID = containerList[pos];
+                int activeID = containerList[pos + 1];
+                size_t tabCount = static_cast<size_t>(containerList[pos + 2]);
+                pos += 3;
+                if (tabCount > containerList.size() - pos)
+                    throw CUserException();
+
+                std::vector<UINT> tabOrder(containerList.begin() + pos, containerList.begin() + pos + tabCount);
+                pos += tabCount;
+                SetContainerTabOrder(parentID, tabOrder);
+                SetActiveContainer(activeID);
+            }
+
+            if (!VerifyDockers())
+                throw CUserException();
+        }
+
+        catch (const CUserException&)
+        {
+            TRACE("*** Failed to load the dock layout. ***\n");
+            m_isLayoutDeferred = FALSE;
+            isLoaded = FALSE;
+            CloseAllDockers();
+        }
+
+        catch (...)
+        {
+            // Restore layout and redraw before passing on other exceptions,
+            // such as a CWinException from a docker that can't be created.
+            TRACE("*** Failed to load the dock layout. ***\n");
+            m_isLayoutDeferred = FALSE;
+            CloseAllDockers();
+            SetRedraw(TRUE);
+            RedrawWindow(RDW_INVALIDATE|RDW_UPDATENOW|RDW_ERASE|RDW_ALLCHILDREN);
+            throw;  // Rethrow
+        }
+
+        SetRedraw(TRUE);
+        RedrawWindow(RDW_INVALIDATE|RDW_UPDATENOW|RDW_ERASE|RDW_ALLCHILDREN);
+
+        // Update the Dock captions.
+        if (isLoaded && GetAncestor().IsWindowVisible())
+            PostMessage(UWM_DOCKACTIVATE);
+
+        return isLoaded;
+    }
+
+    // Replaces the current dockers with the dock layout saved in the registry
+    // as the named preset by SaveDockLayoutPreset.
+    inline BOOL CDocker::LoadDockLayoutPreset(LPCTSTR registryKeyName, LPCTSTR presetName)
+    {
+        assert(registryKeyName);
+        assert(presetName);
+
+        const CString presetKeyName = _T("Software\\") + CString(registryKeyName) + _T("\\Dock Layouts");
+        std::vector<BYTE> layout;
+        if (!ReadDockLayoutValue(presetKeyName, presetName, layout))
+            return FALSE;
+
+        CArchive ar(layout, CArchive::load);
+        return LoadDockLayout(ar);
+    }
+
     // Recreates the docker layout based on information stored in the registry.
     // Assumes the DockAncestor window is already created.
     inline BOOL CDocker::LoadDockRegistrySettings(LPCTSTR registryKeyName)
@@ -2778,6 +3357,26 @@ namespace Win32xx
             std::vector<DockInfo> dockList;
             const CString dockSettings = _T("\\Dock Settings");
             const CString dockKeyName = _T("Software\\") + CString(registryKeyName) + dockSettings;
+
+            // The settings are stored as a single dock layout value. Settings
+            // stored by earlier versions have a value for each docker.
+            std::vector<BYTE> layout;
+            if (ReadDockLayoutValue(dockKeyName, _T("Dock Layout"), layout))
+            {
+                CArchive ar(layout, CArchive::load);
+                isLoaded = LoadDockLayout(ar);
+                if (!isLoaded)
+                {
+                    // Delete the bad key from the registry.
+                    const CString appKeyName = _T("Software\\") + CString(registryKeyName);
+                    CRegKey appKey;
+                    if (ERROR_SUCCESS == appKey.Open(HKEY_CURRENT_USER, appKeyName, KEY_READ))
+                        appKey.RecurseDeleteKey(dockSettings);
+                }
+
+                return isLoaded;
+            }
+
             CRegKey settingsKey;
             if (ERROR_SUCCESS == settingsKey.Open(HKEY_CURRENT_USER, dockKeyName, KEY_READ))
             {
@@ -2916,53 +3515,12 @@ namespace Win32xx
                         // Set tab order.
                         DWORD parentID;
                         if (ERROR_SUCCESS == containerKey.QueryDWORDValue(_T("Parent Container"), parentID))
-                        {
-                            CDocker* pDocker = GetDockFromID(parentID);
-                            if (!pDocker)
-                                pDocker = this;
-
-                            CDockContainer* pParentContainer = pDocker->GetContainer();
-                            if (!pParentContainer)
-                                throw CUserException();
-
-                            for (UINT tab = 0; tab < tabOrder.size(); ++tab)
-                            {
-                                CDocker* pOldDocker = GetDockFromView(pParentContainer->GetContainerFromIndex(tab));
-                                if (!pOldDocker)
-                                    throw CUserException();
-
-                                UINT oldID = pOldDocker->GetDockID();
-
-                                std::vector<UINT>::const_iterator it = std::find(tabOrder.begin(), tabOrder.end(), oldID);
-                                UINT oldTab = static_cast<UINT>((it - tabOrder.begin()));
-
-                                if (tab >= pParentContainer->GetAllContainers().size())
-                                    throw CUserException();
-
-                                if (oldTab >= pParentContainer->GetAllContainers().size())
-                                    throw CUserException();
-
-                                if (tab != oldTab)
-                                    pParentContainer->SwapTabs(tab, oldTab);
-                            }
-                        }
+                            SetContainerTabOrder(parentID, tabOrder);
 
                         // Set the active container.
                         DWORD activeContainer;
                         if (ERROR_SUCCESS == containerKey.QueryDWORDValue(_T("Active Container"), activeContainer))
-                        {
-                            CDocker* pDocker = GetDockFromID(activeContainer);
-                            if (pDocker)
-                            {
-                                CDockContainer* pContainer = pDocker->GetContainer();
-                                if (!pContainer)
-                                    throw CUserException();
-
-                                int page = pContainer->GetContainerIndex(pContainer);
-                                if (page >= 0)
-                                    pContainer->SelectPage(page);
-                            }
-                        }
+                            SetActiveContainer(activeContainer);
 
                         dockContainerName.Format(_T("DockContainer%u"), ++container);
                     }
@@ -3407,8 +3965,12 @@ namespace Win32xx
                 // Turn on DragFullWindows for this move.
                 VERIFY(::SystemParametersInfo(SPI_SETDRAGFULLWINDOWS, TRUE, 0, 0));
 
+                // Find the dock targets once, rather than for each mouse move.
+                SnapshotDragTargets();
+
                 // Process this message.
                 DefWindowProc(WM_SYSCOMMAND, wparam, lparam);
+                ClearDragTargets();
 
                 // Return DragFullWindows to its previous state.
                 VERIFY(::SystemParametersInfo(SPI_SETDRAGFULLWINDOWS, isEnabled, 0, 0));
@@ -3473,163 +4035,81 @@ namespace Win32xx
         wc.hCursor = ::LoadCursor(0, IDC_ARROW);
     }
 
-    // Repositions child windows.
-    inline void CDocker::RecalcDockChildLayout(CRect& rc)
+    // Reads a binary dock layout from the specified registry value.
+    inline BOOL CDocker::ReadDockLayoutValue(LPCTSTR keyName, LPCTSTR valueName, std::vector<BYTE>& layout)
     {
-        // This function positions the Docker's dock children, the Dockers client area
-        //  and draws the dockbar bars.
+        CRegKey key;
+        if (ERROR_SUCCESS != key.Open(HKEY_CURRENT_USER, keyName, KEY_READ))
+            return FALSE;
 
-        // Notes:
-        // 1) This function is called recursively.
-        // 2) The client area and child dockers are positioned simultaneously with
-        //      DeferWindowPos to avoid drawing errors in complex docker arrangements.
-        // 3) The docker's client area contains the docker's caption (if any) and the docker's view window.
+        ULONG size = 0;
+        if (ERROR_SUCCESS != key.QueryBinaryValue(valueName, NULL, &size) || size == 0)
+            return FALSE;
 
-        // Note: All top level dockers are undocked, including the dock ancestor.
+        layout.resize(size);
+        if (ERROR_SUCCESS != key.QueryBinaryValue(valueName, &layout[0], &size))
+            return FALSE;
 
-        BOOL rtl = FALSE;
-#ifdef WS_EX_LAYOUTRTL
-        rtl = (GetExStyle() & WS_EX_LAYOUTRTL);
-#endif
+        layout.resize(size);
+        return TRUE;
+    }
 
-        if (IsDocked())
-        {
-            rc.OffsetRect(-rc.left, -rc.top);
-        }
+    // Repositions the dock children of a top level docker.
+    inline void CDocker::RecalcDockLayout()
+    {
+        // Dock targets taken before this layout change are out of date,
+        // unless the layout is the one being dragged.
+        if (GetTopmostDocker()->m_dragTopCount < 0)
+            ++GetDockAncestor()->m_layoutCount;
 
-        HDWP hdwp = BeginDeferWindowPos(static_cast<int>(m_dockChildren.size()) +2);
+        // LoadDockLayout positions the dockers once they have all been added.
+        if (GetDockAncestor()->m_isLayoutDeferred)
+            return;
 
-        // Step 1: Calculate the position of each Docker child, DockBar, and Client window.
-        //   The Client area = the docker rect minus the area of dock children and the dock bar (splitter bar).
-        std::vector<CDocker*>::const_iterator iter;
-        for (iter = m_dockChildren.begin(); iter != m_dockChildren.end(); ++iter)
+        if (GetDockAncestor()->IsWindow())
         {
-            CRect rcChild = rc;
-            double dockSize = (*iter)->m_dockStartSize;
-            int minSize = 30;
-
-            // Calculate the size of the Docker children
-            switch ((*iter)->GetDockStyle() & 0xF)
-            {
-            case DS_DOCKED_LEFT:
-                if ((*iter)->GetDockStyle() & DS_NO_FIXED_RESIZE)
-                    dockSize = MIN((*iter)->m_dockSizeRatio*(GetWindowRect().Width()), rcChild.Width());
-
-                if (rtl)
-                {
-                    rcChild.left = rcChild.right - static_cast<int>(dockSize);
-                    rcChild.left = MIN(rcChild.left, rc.right - minSize);
-                    rcChild.left = MAX(rcChild.left, rc.left + minSize);
-                }
-                else
-                {
-                    rcChild.right = rcChild.left + static_cast<int>(dockSize);
-                    rcChild.right = MAX(rcChild.right, rc.left + minSize);
-                    rcChild.right = MIN(rcChild.right, rc.right - minSize);
-                }
-                break;
-            case DS_DOCKED_RIGHT:
-                if ((*iter)->GetDockStyle() & DS_NO_FIXED_RESIZE)
-                    dockSize = MIN((*iter)->m_dockSizeRatio*(GetWindowRect().Width()), rcChild.Width());
-
-                if (rtl)
-                {
-                    rcChild.right = rcChild.left + static_cast<int>(dockSize);
-                    rcChild.right = MAX(rcChild.right, rc.left + minSize);
-                    rcChild.right = MIN(rcChild.right, rc.right - minSize);
-                }
-                else
-                {
-                    rcChild.left = rcChild.right - static_cast<int>(dockSize);
-                    rcChild.left = MIN(rcChild.left, rc.right - minSize);
-                    rcChild.left = MAX(rcChild.left, rc.left + minSize);
-                }
-
-                break;
-            case DS_DOCKED_TOP:
-                if ((*iter)->GetDockStyle() & DS_NO_FIXED_RESIZE)
-                    dockSize = MIN((*iter)->m_dockSizeRatio*(GetWindowRect().Height()), rcChild.Height());
-
-                rcChild.bottom = rcChild.top + static_cast<int>(dockSize);
-                rcChild.bottom = MAX(rcChild.bottom, rc.top + minSize);
-                rcChild.bottom = MIN(rcChild.bottom, rc.bottom - minSize);
-                break;
-            case DS_DOCKED_BOTTOM:
-                if ((*iter)->GetDockStyle() & DS_NO_FIXED_RESIZE)
-                    dockSize = MIN((*iter)->m_dockSizeRatio*(GetWindowRect().Height()), rcChild.Height());
-
-                rcChild.top = rcChild.bottom - static_cast<int>(dockSize);
-                rcChild.top = MIN(rcChild.top, rc.bottom - minSize);
-                rcChild.top = MAX(rcChild.top, rc.top + minSize);
-
-                break;
-            }
-
-            if ((*iter)->IsDocked())
-            {
-                // Position this docker's children.
-                hdwp = (*iter)->DeferWindowPos(hdwp, 0, rcChild, SWP_SHOWWINDOW|SWP_FRAMECHANGED);
-                (*iter)->m_childRect = rcChild;
+            // The geometry of the whole docker tree is calculated first.
+            // Only the windows whose position has changed are then moved.
+            CDocker* pTopDocker = GetTopmostDocker();
+            std::vector<DockLayoutNode> nodes;
+            pTopDocker->GetDockLayoutNodes(nodes);
+            CalcDockLayout(nodes, pTopDocker->GetViewRect());
 
-                rc.SubtractRect(rc, rcChild);
-
-                // Calculate the dimensions of the splitter bar.
-                CRect barRect = rc;
-                DWORD DockSide = (*iter)->GetDockStyle() & 0xF;
-
-                if (DS_DOCKED_LEFT   == DockSide)
-                {
-                    if (rtl) barRect.left   = barRect.right - (*iter)->GetBarWidth();
-                    else     barRect.right  = barRect.left + (*iter)->GetBarWidth();
-                }
-
-                if (DS_DOCKED_RIGHT  == DockSide)
-                {
-                    if (rtl) barRect.right  = barRect.left + (*iter)->GetBarWidth();
-                    else     barRect.left   = barRect.right - (*iter)->GetBarWidth();
-                }
-
-                if (DS_DOCKED_TOP    == DockSide) barRect.bottom = barRect.top + (*iter)->GetBarWidth();
-                if (DS_DOCKED_BOTTOM == DockSide) barRect.top    = barRect.bottom - (*iter)->GetBarWidth();
-
-                // Save the splitter bar position. We will reposition it later.
-                (*iter)->m_barRect = barRect;
-                rc.SubtractRect(rc, barRect);
-            }
+            if (ApplyDockLayout(nodes) > 0)
+                pTopDocker->UpdateWindow();
         }
+    }
 
-        // Step 2: Position the Dock client and dock bar.
-        if (GetDockClient().IsWindow())
-            hdwp = GetDockClient().DeferWindowPos(hdwp, 0, rc, SWP_SHOWWINDOW |SWP_FRAMECHANGED);
-        VERIFY(EndDeferWindowPos(hdwp));
-
-        // Position the dockbar. Only docked dockers have a dock bar.
-        if (IsDocked())
-        {
-            CRect barRect;
-            barRect.IntersectRect(m_barRect, GetDockParent()->GetViewRect());
+    // Takes a snapshot of the windows GetDockUnderDragPoint needs to find the
+    // docker under the drag point. The top level windows related to this
+    // docker are stored first, in Z order, followed by the child windows of
+    // each docker in the snapshot. The snapshot is taken when a drag starts,
+    // and is updated if the dock layout changes.
+    inline void CDocker::SnapshotDragTargets()
+    {
+        m_dragTargets.clear();
 
-            // The SWP_NOCOPYBITS forces a redraw of the dock bar.
-            VERIFY(GetDockBar().SetWindowPos(0, barRect, SWP_SHOWWINDOW|SWP_FRAMECHANGED|SWP_NOCOPYBITS));
-        }
+        // EnumWindows adds the top level windows.
+        EnumWindows(EnumWindowsProc, (LPARAM)this);
+        m_dragTopCount = static_cast<int>(m_dragTargets.size());
 
-        // Step 3: Now recurse through the docker's children. They might have children of their own.
-        for (iter = m_dockChildren.begin(); iter != m_dockChildren.end(); ++iter)
+        // Add the child windows of each docker. The loop also visits the
+        // windows it adds, so the snapshot includes nested dockers.
+        for (size_t i = 0; i < m_dragTargets.size(); ++i)
         {
-            (*iter)->RecalcDockChildLayout((*iter)->m_childRect);
-        }
-    }
+            if (m_dragTargets[i].pDocker == NULL)
+                continue;
 
+            int firstChild = static_cast<int>(m_dragTargets.size());
+            HWND parent = m_dragTargets[i].pDocker->GetHwnd();
+            for (HWND child = ::GetWindow(parent, GW_CHILD); child != 0; child = ::GetWindow(child, GW_HWNDNEXT))
+                AddDragTarget(child);
 
-    // Repositions the dock children of a top level docker.
-    inline void CDocker::RecalcDockLayout()
-    {
-        if (GetDockAncestor()->IsWindow())
-        {
-            CRect rc = GetTopmostDocker()->GetViewRect();
-            GetTopmostDocker()->RecalcDockChildLayout(rc);
-            GetTopmostDocker()->UpdateWindow();
+            m_dragTargets[i].firstChild = firstChild;
+            m_dragTargets[i].childCount = static_cast<int>(m_dragTargets.size()) - firstChild;
         }
+
+        m_dragLayoutCount = GetDockAncestor()->m_layoutCount;
     }
 
     // Returns a vector of sorted dockers, used by SaveRegistrySettings.
@@ -3768,165 +4248,175 @@ namespace Win32xx
         RecalcDockLayout();
     }
 
-    // Stores the docking configuration in the registry.
+    // Writes the docking configuration to the archive as a compact, versioned
+    // binary dock layout. LoadDockLayout recreates the dockers from it.
     // NOTE: This function assumes that each docker has a unique DockID.
-    inline BOOL CDocker::SaveDockRegistrySettings(LPCTSTR registryKeyName)
+    inline BOOL CDocker::SaveDockLayout(CArchive& ar)
     {
+        assert(this == GetDockAncestor());  // Must call SaveDockLayout from the DockAncestor.
+
         std::vector<CDocker*> sortedDockers = SortDockers();
         std::vector<CDocker*>::const_iterator iter;
         std::vector<DockInfo> allDockInfo;
+        std::vector<double> dockSizeRatios;
+        std::vector<int> containerList;     // The parent, active container, tab count and tabs of each container group
 
-        if (registryKeyName)
+        try
         {
-            CRegKey appKey;
-            CRegKey dockKey;
-            const CString appKeyName = _T("Software\\") + CString(registryKeyName);
-            const CString dockKeyName = _T("Dock Settings");
-            try
-            {
-                if (!VerifyDockers())
-                    throw CUserException();
+            if (!VerifyDockers())
+                throw CUserException();
 
-                // Create the App's registry key.
-                if (ERROR_SUCCESS != appKey.Create(HKEY_CURRENT_USER, appKeyName))
-                    throw CUserException();
+            // Fill the DockInfo vector with the docking information.
+            for (iter = sortedDockers.begin(); iter != sortedDockers.end(); ++iter)
+            {
+                // Recalculate the docker size.
+                if ((*iter)->GetDockBar().IsWindow() && (*iter)->m_pDockParent != 0)
+                {
+                    DRAGPOS dp;
+                    ZeroMemory(&dp, sizeof(dp));
+                    dp.dockZone = (*iter)->GetDockStyle();
+                    dp.pDocker = *iter;
+                    CRect rc = (*iter)->GetDockBar().GetWindowRect();
+                    CPoint pt((rc.left + rc.right)/2, (rc.top + rc.bottom)/2);
+                    dp.pos = pt;
+                    ResizeDockers(&dp);
+                }
 
-                if (ERROR_SUCCESS != appKey.Open(HKEY_CURRENT_USER, appKeyName))
+                DockInfo di;
+                ZeroMemory(&di, sizeof(di));
+                if (! (*iter)->IsWindow())
                     throw CUserException();
 
-                // Remove Old Docking info ...
-                appKey.RecurseDeleteKey(dockKeyName);
-
-                // Fill the DockInfo vector with the docking information.
-                for (iter = sortedDockers.begin(); iter != sortedDockers.end(); ++iter)
-                {
-                    // Recalculate the docker size.
-                    if ((*iter)->GetDockBar().IsWindow() && (*iter)->m_pDockParent != 0)
-                    {
-                        DRAGPOS dp;
-                        ZeroMemory(&dp, sizeof(dp));
-                        dp.dockZone = (*iter)->GetDockStyle();
-                        dp.pDocker = *iter;
-                        CRect rc = (*iter)->GetDockBar().GetWindowRect();
-                        CPoint pt((rc.left + rc.right)/2, (rc.top + rc.bottom)/2);
-                        dp.pos = pt;
-                        ResizeDockers(&dp);
-                    }
-
-                    DockInfo di;
-                    ZeroMemory(&di, sizeof(di));
-                    if (! (*iter)->IsWindow())
-                        throw CUserException();
+                di.dockID    = (*iter)->GetDockID();
+                di.dockStyle = (*iter)->GetDockStyle();
+                di.dockSize  = (*iter)->GetDockSize();
+                di.rect      = (*iter)->GetWindowRect();
+                if ((*iter)->GetDockParent())
+                    di.dockParentID = (*iter)->GetDockParent()->GetDockID();
 
-                    di.dockID    = (*iter)->GetDockID();
-                    di.dockStyle = (*iter)->GetDockStyle();
-                    di.dockSize  = (*iter)->GetDockSize();
-                    di.rect      = (*iter)->GetWindowRect();
-                    if ((*iter)->GetDockParent())
-                        di.dockParentID = (*iter)->GetDockParent()->GetDockID();
+                di.isInAncestor = ((*iter)->GetDockParent() == GetDockAncestor());
 
-                    di.isInAncestor = ((*iter)->GetDockParent() == GetDockAncestor());
+                allDockInfo.push_back(di);
+                dockSizeRatios.push_back((*iter)->m_dockSizeRatio);
+            }
 
-                    allDockInfo.push_back(di);
-                }
+            // Fill the container list with the container groups.
+            std::vector<CDockContainer*> containers;
+            if (GetContainer())
+                containers.push_back(GetContainer());
 
-                if (ERROR_SUCCESS != dockKey.Create(appKey, dockKeyName))
-                    throw CUserException();
+            for (iter = sortedDockers.begin(); iter != sortedDockers.end(); ++iter)
+            {
+                CDockContainer* pContainer = (*iter)->GetContainer();
+                if (pContainer && ( !((*iter)->GetDockStyle() & DS_DOCKED_CONTAINER) ))
+                    containers.push_back(pContainer);
+            }
 
-                if (ERROR_SUCCESS != dockKey.Open(appKey, dockKeyName))
+            std::vector<CDockContainer*>::const_iterator it;
+            for (it = containers.begin(); it != containers.end(); ++it)
+            {
+                // Store the container group's parent and active (selected) container.
+                CDocker* pDocker = GetDockFromView(*it);
+                if (pDocker == 0)
                     throw CUserException();
 
-                CString dockChildName;
+                containerList.push_back(pDocker->GetDockID());
+                pDocker = GetDockFromView((*it)->GetActiveContainer());
+                containerList.push_back(pDocker ? pDocker->GetDockID() : 0);
 
-                // Add the dock settings information to the registry.
-                for (UINT u = 0; u < allDockInfo.size(); ++u)
+                // Store the tab order.
+                UINT tabCount = static_cast<UINT>((*it)->GetAllContainers().size());
+                containerList.push_back(static_cast<int>(tabCount));
+                for (UINT tab = 0; tab < tabCount; ++tab)
                 {
-                    DockInfo di = allDockInfo[u];
-                    dockChildName.Format(_T("DockChild%u"), u);
-                    if (ERROR_SUCCESS != dockKey.SetBinaryValue(dockChildName, &di, sizeof(DockInfo)))
+                    CDockContainer* pTab = (*it)->GetContainerFromIndex(tab);
+                    pDocker = pTab ? GetDockFromView(pTab) : 0;
+                    if (pDocker == 0)
                         throw CUserException();
-                }
-
-                // Add dock container info to the registry.
-                UINT container = 0;
-
-                if (GetContainer())
-                    SaveContainerRegistrySettings(dockKey, GetContainer(), container);
-
 
-                for (iter = sortedDockers.begin(); iter != sortedDockers.end(); ++iter)
-                {
-                    CDockContainer* pContainer = (*iter)->GetContainer();
-
-                    if (pContainer && ( !((*iter)->GetDockStyle() & DS_DOCKED_CONTAINER) ))
-                    {
-                        SaveContainerRegistrySettings(dockKey, pContainer, container);
-                    }
+                    containerList.push_back(pDocker->GetDockID());
                 }
             }
+        }
 
-            catch (const CUserException&)
-            {
-                TRACE("*** Failed to save dock settings in registry. ***\n");
+        catch (const CUserException&)
+        {
+            TRACE("*** Failed to save the dock layout. ***\n");
+            return FALSE;
+        }
 
-                // Roll back the registry changes by deleting the subkeys.
-                if (appKey.GetKey())
-                {
-                    appKey.RecurseDeleteKey(dockKeyName);
-                }
+        // Write the dock layout.
+        ar << DOCK_LAYOUT_SIGNATURE;
+        ar << DOCK_LAYOUT_VERSION;
+        ar << static_cast<UINT>(allDockInfo.size());
+        for (size_t i = 0; i < allDockInfo.size(); ++i)
+        {
+            const DockInfo& di = allDockInfo[i];
+            ar << di.dockID;
+            ar << di.dockStyle;
+            ar << di.dockSize;
+            ar << dockSizeRatios[i];
+            ar << di.dockParentID;
+            ar << di.isInAncestor;
+            ar << di.rect;
+        }
 
-                return FALSE;
-            }
+        size_t pos = 0;
+        UINT containerCount = 0;
+        while (pos < containerList.size())
+        {
+            pos += 3 + static_cast<size_t>(containerList[pos + 2]);
+            ++containerCount;
         }
 
+        ar << containerCount;
+        for (pos = 0; pos < containerList.size(); ++pos)
+            ar << containerList[pos];
+
         return TRUE;
     }
 
-    // Stores the docking container configuration in the registry.
-    inline void CDocker::SaveContainerRegistrySettings(CRegKey& dockKey, CDockContainer* pContainer, UINT& container)
+    // Saves the dock layout in the registry as the named preset. Presets
+    // can be switched at any time with LoadDockLayoutPreset.
+    inline BOOL CDocker::SaveDockLayoutPreset(LPCTSTR registryKeyName, LPCTSTR presetName)
     {
-        CRegKey containerKey;
-        CString dockContainerName;
-        dockContainerName.Format(_T("DockContainer%u"), container++);
-        if (ERROR_SUCCESS != dockKey.Create(dockKey, dockContainerName))
-            throw CUserException();
+        assert(registryKeyName);
+        assert(presetName);
 
-        if (ERROR_SUCCESS != containerKey.Open(dockKey, dockContainerName))
-            throw CUserException();
-
-        // Store the container group's parent.
-        CDocker* pDocker = GetDockFromView(pContainer);
-        if (pDocker == 0)
-            throw CUserException();
-        int id = pDocker->GetDockID();
-        if (ERROR_SUCCESS != containerKey.SetDWORDValue(_T("Parent Container"), id))
-            throw CUserException();
-
-        // Store the active (selected) container.
-        pDocker = GetDockFromView(pContainer->GetActiveContainer());
-        if (pDocker == 0)
-            id = 0;
-        else
-            id = pDocker->GetDockID();
+        const CString presetKeyName = _T("Software\\") + CString(registryKeyName) + _T("\\Dock Layouts");
+        std::vector<BYTE> layout;
+        CArchive ar(layout, CArchive::store);
+        if (!SaveDockLayout(ar))
+            return FALSE;
 
-        if (ERROR_SUCCESS != containerKey.SetDWORDValue(_T("Active Container"), id))
-            throw CUserException();
+        return WriteDockLayoutValue(presetKeyName, presetName, layout);
+    }
 
-        // Store the tab order.
-        for (UINT u2 = 0; u2 < pContainer->GetAllContainers().size(); ++u2)
+    // Stores the docking configuration in the registry, as a single binary
+    // dock layout value.
+    // NOTE: This function assumes that each docker has a unique DockID.
+    inline BOOL CDocker::SaveDockRegistrySettings(LPCTSTR registryKeyName)
+    {
+        if (registryKeyName)
         {
-            dockContainerName.Format(_T("Tab%u"), u2);
-            CDockContainer* pTab = pContainer->GetContainerFromIndex(u2);
-            if (pTab == 0)
-                throw CUserException();
-            pDocker = GetDockFromView(pTab);
-            if (pDocker == 0)
-                throw CUserException();
-            int tabID = pDocker->GetDockID();
+            const CString appKeyName = _T("Software\\") + CString(registryKeyName);
+            const CString dockKeyName = _T("Dock Settings");
 
-            if (ERROR_SUCCESS != containerKey.SetDWORDValue(dockContainerName, tabID))
-                throw CUserException();
+            // Remove Old Docking info, including the values stored by earlier versions.
+            CRegKey appKey;
+            if (ERROR_SUCCESS == appKey.Open(HKEY_CURRENT_USER, appKeyName))
+                appKey.RecurseDeleteKey(dockKeyName);
+
+            std::vector<BYTE> layout;
+            CArchive ar(layout, CArchive::store);
+            if (!SaveDockLayout(ar) || !WriteDockLayoutValue(appKeyName + _T("\\") + dockKeyName, _T("Dock Layout"), layout))
+            {
+                TRACE("*** Failed to save dock settings in registry. ***\n");
+                return FALSE;
+            }
         }
+
+        return TRUE;
     }
 
     // Sends a docking notification to the docker below the cursor.
@@ -3988,6 +4478,57 @@ namespace Win32xx
         m_dockStyle = dockStyle;
     }
 
+    // Selects the container of the docker with the specified DockID.
+    // Used when a dock layout is loaded.
+    inline void CDocker::SetActiveContainer(int dockID)
+    {
+        CDocker* pDocker = GetDockFromID(dockID);
+        if (pDocker)
+        {
+            CDockContainer* pContainer = pDocker->GetContainer();
+            if (!pContainer)
+                throw CUserException();
+
+            int page = pContainer->GetContainerIndex(pContainer);
+            if (page >= 0)
+                pContainer->SelectPage(page);
+        }
+    }
+
+    // Arranges the tabs of a container group in the specified order of DockIDs.
+    // Used when a dock layout is loaded.
+    inline void CDocker::SetContainerTabOrder(int parentID, const std::vector<UINT>& tabOrder)
+    {
+        CDocker* pDocker = GetDockFromID(parentID);
+        if (!pDocker)
+            pDocker = this;
+
+        CDockContainer* pParentContainer = pDocker->GetContainer();
+        if (!pParentContainer)
+            throw CUserException();
+
+        for (UINT tab = 0; tab < tabOrder.size(); ++tab)
+        {
+            CDocker* pOldDocker = GetDockFromView(pParentContainer->GetContainerFromIndex(tab));
+            if (!pOldDocker)
+                throw CUserException();
+
+            UINT oldID = pOldDocker->GetDockID();
+
+            std::vector<UINT>::const_iterator it = std::find(tabOrder.begin(), tabOrder.end(), oldID);
+            UINT oldTab = static_cast<UINT>((it - tabOrder.begin()));
+
+            if (tab >= pParentContainer->GetAllContainers().size())
+                throw CUserException();
+
+            if (oldTab >= pParentContainer->GetAllContainers().size())
+                throw CUserException();
+
+            if (tab != oldTab)
+                pParentContainer->SwapTabs(tab, oldTab);
+        }
+    }
+
     // Sets the caption text.
     inline void CDocker::SetCaption(LPCTSTR caption)
     {
@@ -4133,6 +4674,7 @@ namespace Win32xx
         SetStyle(style);
         SetParent(parent);
         GetDockBar().SetParent(parent);
+        m_isFrameChanged = TRUE;
     }
 
     // Change the window to an "undocked" style.
@@ -4367,6 +4909,20 @@ namespace Win32xx
         pDocker->BringWindowToTop();
     }
 
+    // Writes a binary dock layout to the specified registry value. The
+    // registry key is created if required.
+    inline BOOL CDocker::WriteDockLayoutValue(LPCTSTR keyName, LPCTSTR valueName, const std::vector<BYTE>& layout)
+    {
+        CRegKey key;
+        if (layout.empty() || ERROR_SUCCESS != key.Create(HKEY_CURRENT_USER, keyName))
+            return FALSE;
+
+        if (ERROR_SUCCESS != key.Open(HKEY_CURRENT_USER, keyName))
+            return FALSE;
+
+        return (ERROR_SUCCESS == key.SetBinaryValue(valueName, &layout[0], static_cast<ULONG>(layout.size())));
+    }
+
     inline LRESULT CDocker::WndProcDefault(UINT msg, WPARAM wparam, LPARAM lparam)
     {
         switch (msg)
@@ -4398,23 +4954,13 @@ namespace Win32xx
         assert(dynamic_cast<CDocker*>(pThis));
         if (!pThis) return FALSE;
 
-        CPoint pt = pThis->m_dockPoint;
-
         // Update hWndTop if the DockAncestor is a child of the top level window.
         if (::IsChild(top, pThis->GetDockAncestor()->GetHwnd()))
             top = pThis->GetDockAncestor()->GetHwnd();
 
-        // Assign this docker's m_dockUnderPoint.
+        // Add the related windows to this docker's dock targets.
         if (pThis->IsRelated(top) && top != pThis->GetHwnd())
-        {
-            CRect rc;
-            VERIFY(::GetWindowRect(top, &rc));
-            if ( rc.PtInRect(pt) )
-            {
-                pThis->m_dockUnderPoint = top;
-                return FALSE;   // Stop enumerating.
-            }
-        }
+            pThis->AddDragTarget(top);
 
         return TRUE;    // Continue enumerating.
     }
@@ -5099,6 +5645,7 @@ namespace Win32xx
     inline CDockContainer::CViewPage::CViewPage() : m_pContainer(NULL), m_pView(NULL), m_pTab(NULL)
     {
         m_pToolBar = &m_toolBar;
+        EnablePreTranslate(FALSE);
     }
 
 
@@ -63,7 +63,8 @@ namespace Win32xx
             modeRead =          0x0100, // Requests read access only.
             modeWrite =         0x0200, // Requests write access only.
             modeReadWrite =     0x0300, // Requests read and write access.
-            modeNone =          0x0400  // Requests neither read nor write access.
+            modeNone =          0x0400, // Requests neither read nor write access.
+            modeMapView =       0x1000  // Maps a read only view of the file into memory.
         };
 
         CFile();
@@ -86,7 +87,10 @@ namespace Win32xx
         HANDLE GetHandle() const;
         ULONGLONG GetLength() const;
         ULONGLONG GetPosition() const;
+        LPCVOID GetView() const;
+        ULONGLONG GetViewLength() const;
         void LockRange(ULONGLONG pos, ULONGLONG count);
+        LPCVOID MapView();
         void Open(LPCTSTR fileName, UINT openFlags, DWORD attributes = FILE_ATTRIBUTE_NORMAL);
         UINT Read(void* buffer, UINT count);
         void Remove(LPCTSTR fileName);
@@ -97,6 +101,7 @@ namespace Win32xx
         void SetFilePath(LPCTSTR fileName);
         void SetLength(ULONGLONG length);
         void UnlockRange(ULONGLONG pos, ULONGLONG count);
+        void UnmapView();
         void Write(const void* buffer, UINT count);
 
     private:
@@ -106,6 +111,9 @@ namespace Win32xx
         CString m_fileName;
         CString m_filePath;
         HANDLE m_file;
+        HANDLE m_mapping;           // file mapping object for the view
+        LPVOID m_pView;             // read only view of the file
+        ULONGLONG m_viewLength;     // length of the view in bytes
     };
 
 }
@@ -114,11 +122,11 @@ namespace Win32xx
 
 namespace Win32xx
 {
-    inline CFile::CFile() : m_file(INVALID_HANDLE_VALUE)
+    inline CFile::CFile() : m_file(INVALID_HANDLE_VALUE), m_mapping(0), m_pView(0), m_viewLength(0)
     {
     }
 
-    inline CFile::CFile(HANDLE file) : m_file(file)
+    inline CFile::CFile(HANDLE file) : m_file(file), m_mapping(0), m_pView(0), m_viewLength(0)
     {
     }
 
@@ -135,8 +143,10 @@ namespace Win32xx
     //  shareDenyWrite  Denies write access to all others.
     //  shareDenyRead   Denies read access to all others.
     //  shareDenyNone   No sharing restrictions.
+    //  modeMapView     Maps a read only view of the file into memory.
     // Refer to CreateFile in the Windows API documentation for more information.
-    inline CFile::CFile(LPCTSTR fileName, UINT openFlags) : m_file(INVALID_HANDLE_VALUE)
+    inline CFile::CFile(LPCTSTR fileName, UINT openFlags)
+        : m_file(INVALID_HANDLE_VALUE), m_mapping(0), m_pView(0), m_viewLength(0)
     {
         assert(fileName);
         Open(fileName, openFlags);  // Throws CFileException on failure.
@@ -149,7 +159,8 @@ namespace Win32xx
     //   FILE_FLAG_OPEN_NO_RECALL, FILE_FLAG_OPEN_REPARSE_POINT, FILE_FLAG_OVERLAPPED, FILE_FLAG_POSIX_SEMANTICS,
     //   FILE_FLAG_RANDOM_ACCESS, FILE_FLAG_SEQUENTIAL_SCAN, FILE_FLAG_WRITE_THROUGH.
     // Refer to CreateFile in the Windows API documentation for more information.
-    inline CFile::CFile(LPCTSTR fileName, UINT openFlags, DWORD attributes) : m_file(INVALID_HANDLE_VALUE)
+    inline CFile::CFile(LPCTSTR fileName, UINT openFlags, DWORD attributes)
+        : m_file(INVALID_HANDLE_VALUE), m_mapping(0), m_pView(0), m_viewLength(0)
     {
         assert(fileName);
         Open(fileName, openFlags, attributes);  // Throws CFileException on failure.
@@ -157,6 +168,7 @@ namespace Win32xx
 
     inline CFile::~CFile()
     {
+        UnmapView();
         if (m_file != INVALID_HANDLE_VALUE)
             ::CloseHandle(m_file);
     }
@@ -170,6 +182,7 @@ namespace Win32xx
     // Refer to CloseHandle in the Windows API documentation for more information.
     inline void CFile::Close()
     {
+        UnmapView();
         m_fileName.Empty();
         m_filePath.Empty();
 
@@ -294,6 +307,19 @@ namespace Win32xx
         return result;
     }
 
+    // Returns a pointer to the file's mapped view, or NULL if there is no view.
+    // The view is created by MapView, or by opening the file with modeMapView.
+    inline LPCVOID CFile::GetView() const
+    {
+        return m_pView;
+    }
+
+    // Returns the length in bytes of the file's mapped view.
+    inline ULONGLONG CFile::GetViewLength() const
+    {
+        return m_pView ? m_viewLength : 0;
+    }
+
     // Locks a range of bytes in and open file.
     // Refer to LockFile in the Windows API documentation for more information.
     inline void CFile::LockRange(ULONGLONG pos, ULONGLONG count)
@@ -309,6 +335,38 @@ namespace Win32xx
             throw CFileException(GetFilePath(), GetApp()->MsgFileLock());
     }
 
+    // Maps a read only view of the entire file into memory, and returns a
+    // pointer to it. The file's contents can then be read without copying
+    // them. The file must be open with read access. Returns NULL for an empty
+    // file, as these can't be mapped. The view is unmapped when the file is
+    // closed. Throws an exception if the view can't be mapped.
+    // Refer to CreateFileMapping and MapViewOfFile in the Windows API documentation for more information.
+    inline LPCVOID CFile::MapView()
+    {
+        assert(m_file != INVALID_HANDLE_VALUE);
+        UnmapView();
+
+        ULONGLONG length = GetLength();
+        if (length > 0)
+        {
+            m_mapping = ::CreateFileMapping(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (m_mapping == 0)
+                throw CFileException(GetFilePath(), GetApp()->MsgFileMap());
+
+            m_pView = ::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+            if (m_pView == 0)
+            {
+                ::CloseHandle(m_mapping);
+                m_mapping = 0;
+                throw CFileException(GetFilePath(), GetApp()->MsgFileMap());
+            }
+
+            m_viewLength = length;
+        }
+
+        return m_pView;
+    }
+
     // Prepares a file to be written to or read from.
     // Possible openFlag values: CREATE_NEW, CREATE_ALWAYS, OPEN_EXISTING, OPEN_ALWAYS, TRUNCATE_EXISTING
     // Default value: OPEN_EXISTING | modeReadWrite
@@ -323,6 +381,7 @@ namespace Win32xx
     //  shareDenyWrite  Denies write access to all others.
     //  shareDenyRead   Denies read access to all others.
     //  shareDenyNone   No sharing restrictions.
+    //  modeMapView     Maps a read only view of the file into memory.
     // Possible attribute values:
     //   FILE_ATTRIBUTE_ARCHIVE, FILE_ATTRIBUTE_ENCRYPTED, FILE_ATTRIBUTE_HIDDEN, FILE_ATTRIBUTE_NORMAL,
     //   FILE_ATTRIBUTE_NOT_CONTENT_INDEXED, FILE_ATTRIBUTE_OFFLINE, FILE_ATTRIBUTE_READONLY, FILE_ATTRIBUTE_SYSTEM,
@@ -360,6 +419,7 @@ namespace Win32xx
         default:                share = 0; break;
         }
 
+        bool isMapView = (openFlags & modeMapView) != 0;
         DWORD create = openFlags & 0xF;
         if (create & OPEN_ALWAYS) openFlags = OPEN_ALWAYS;
         if (create == 0) create = OPEN_EXISTING;
@@ -374,6 +434,24 @@ namespace Win32xx
         if (m_file != INVALID_HANDLE_VALUE)
         {
             SetFilePath(fileName);
+
+            if (isMapView)
+            {
+                try
+                {
+                    MapView();
+                }
+
+                catch (...)
+                {
+                    // Close the file, so it isn't left open without its view.
+                    ::CloseHandle(m_file);
+                    m_file = INVALID_HANDLE_VALUE;
+                    m_fileName.Empty();
+                    m_filePath.Empty();
+                    throw;  // Rethrow
+                }
+            }
         }
 
     }
@@ -491,6 +569,21 @@ namespace Win32xx
             throw CFileException(GetFilePath(), GetApp()->MsgFileUnlock());
     }
 
+    // Unmaps the file's view created by MapView, if any.
+    // Refer to UnmapViewOfFile in the Windows API documentation for more information.
+    inline void CFile::UnmapView()
+    {
+        if (m_pView != 0)
+            VERIFY(::UnmapViewOfFile(m_pView));
+
+        if (m_mapping != 0)
+            VERIFY(::CloseHandle(m_mapping));
+
+        m_pView = 0;
+        m_mapping = 0;
+        m_viewLength = 0;
+    }
+
     // Writes the specified buffer to the file.
     // Refer to WriteFile in the Windows API documentation for more information.
     inline void CFile::Write(const void* buffer, UINT count)
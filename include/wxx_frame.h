@@ -1136,7 +1136,7 @@ namespace Win32xx
         // Draw a white or black check mark as required.
         // Unfortunately MaskBlt isn't supported on Win95, 98 or ME, so we do it the hard way.
         CMemDC maskDC(drawDC);
-        maskDC.CreateCompatibleBitmap(drawDC, cxCheck, cyCheck);
+        maskDC.CreatePooledBitmap(drawDC, cxCheck, cyCheck);
         maskDC.BitBlt(0, 0, cxCheck, cyCheck, maskDC, 0, 0, WHITENESS);
 
         if ((pDIS->itemState & ODS_SELECTED))
@@ -1256,7 +1256,7 @@ namespace Win32xx
             int rebarWidth = rebarRect.Width();
             int rebarHeight = rebarRect.Height();
             CMemDC memDC(dc);
-            memDC.CreateCompatibleBitmap(dc, rebarWidth, rebarRect.Height());
+            memDC.CreatePooledBitmap(dc, rebarWidth, rebarRect.Height());
 
             // Draw to ReBar background to the memory DC.
             memDC.SolidFill(rt.clrBkgnd2, rebarRect);
@@ -1312,7 +1312,7 @@ namespace Win32xx
 
                             // Fill the Source CDC with the band's background.
                             CMemDC sourceDC(dc);
-                            sourceDC.CreateCompatibleBitmap(dc, rebarWidth, rebarHeight);
+                            sourceDC.CreatePooledBitmap(dc, rebarWidth, rebarHeight);
                             sourceDC.GradientFill(rt.clrBand1, rt.clrBand2, drawRect, isVertical);
 
                             // Set Curve amount for rounded edges.
@@ -1320,7 +1320,7 @@ namespace Win32xx
 
                             // Create our mask for rounded edges using RoundRect.
                             CMemDC maskDC(dc);
-                            maskDC.CreateCompatibleBitmap(dc, rebarWidth, rebarHeight);
+                            maskDC.CreatePooledBitmap(dc, rebarWidth, rebarHeight);
 
                             int left = drawRect.left;
                             int right = drawRect.right;
@@ -166,6 +166,7 @@
 #include "wxx_wincore0.h"
 #include "wxx_exception.h"
 #include "wxx_metafile.h"
+#include "wxx_pixels.h"
 
 // Disable macros from Windowsx.h
 #undef CopyRgn
@@ -393,7 +394,7 @@ namespace Win32xx
     {
         // Constructor
         CDC_Data() : dc(0), count(1L), isManagedHDC(FALSE), wnd(0),
-                     savedDCState(0), isPaintDC(false)
+                     savedDCState(0), isPaintDC(false), pooledBitmap(0), pPool(0)
         {
             ZeroMemory(&ps, sizeof(ps));
         }
@@ -411,6 +412,8 @@ namespace Win32xx
         int     savedDCState;   // The save state of the HDC.
         bool    isPaintDC;
         PAINTSTRUCT ps;
+        HBITMAP pooledBitmap;   // A bitmap borrowed from a back buffer pool
+        BackBufferPool* pPool;  // The pool the bitmap is returned to
     };
 
 
@@ -460,6 +463,7 @@ namespace Win32xx
         void CreateCompatibleBitmap(HDC dc, int cx, int cy);
         void CreateDIBSection(HDC dc, const LPBITMAPINFO pBMI, UINT usage, LPVOID* ppBits,
                                         HANDLE section, DWORD offset);
+        void CreatePooledBitmap(HDC dc, int cx, int cy);
         CBitmap DetachBitmap();
 
         BOOL LoadBitmap(UINT id);
@@ -619,6 +623,8 @@ namespace Win32xx
         int  GetStretchBltMode() const;
         int  SetDIBits(HBITMAP bitmap, UINT startScan, UINT scanLines, LPCVOID pBits,
                         LPBITMAPINFO pBMI, UINT colorUse) const;
+        int  SetDIBitsToDevice(int xDest, int yDest, DWORD width, DWORD height, int xSrc, int ySrc,
+                        UINT startScan, UINT scanLines, LPCVOID pBits, const LPBITMAPINFO pBMI, UINT colorUse) const;
 
         int  SetStretchBltMode(int stretchMode) const;
 #if (WINVER >= 0x0410)
@@ -1272,17 +1278,10 @@ namespace Win32xx
         CWinApp* pApp = CWinApp::SetnGetThis();
         if (pApp != NULL)          // Is the CWinApp object still valid?
         {
-            // Allocate an iterator for our HDC map
-            std::map<HGDIOBJ, CGDI_Data*, CompareGDI>::iterator m;
-
+            // Erase the CGDIObject pointer entry from the map
             CThreadLock mapLock(pApp->m_gdiLock);
-            m = pApp->m_mapCGDIData.find(m_pData->hGDIObject);
-            if (m != pApp->m_mapCGDIData.end())
-            {
-                // Erase the CGDIObject pointer entry from the map
-                pApp->m_mapCGDIData.erase(m);
+            if (pApp->m_mapCGDIData.Erase(m_pData->hGDIObject))
                 success = TRUE;
-            }
 
         }
 
@@ -1424,38 +1423,12 @@ namespace Win32xx
         byte* bits = &vBits.front();
         VERIFY(dc.GetDIBits(*this, 0, data.bmHeight, bits, pbmi, DIB_RGB_COLORS));
 
-        UINT widthBytes = bmiHeader.biSizeImage / bmiHeader.biHeight;
-        int yOffset = 0;
-        int xOffset;
-        size_t index;
-
-        for (int row = 0; row < bmiHeader.biHeight; ++row)
-        {
-            xOffset = 0;
-
-            for (int column = 0; column < bmiHeader.biWidth; ++column)
-            {
-                // Calculate index
-                index = size_t(yOffset) + size_t(xOffset);
-
-                // skip for colors matching the mask
-                if ((bits[index + 0] != GetRValue(mask)) &&
-                    (bits[index + 1] != GetGValue(mask)) &&
-                    (bits[index + 2] != GetBValue(mask)))
-                {
-                    BYTE byGray = BYTE(95 + (bits[index + 2] * 3 + bits[index + 1] * 6 + bits[index + 0]) / 20);
-                    bits[index] = byGray;
-                    bits[index + 1] = byGray;
-                    bits[index + 2] = byGray;
-                }
-
-                // Increment the horizontal offset
-                xOffset += bmiHeader.biBitCount >> 3;
-            }
+        int widthBytes = bmiHeader.biSizeImage / bmiHeader.biHeight;
 
-            // Increment vertical offset
-            yOffset += widthBytes;
-        }
+        // Skip pixels with colors matching the mask. The pixel's blue, green and
+        // red bytes are compared to the mask's red, green and blue values.
+        ConvertToDisabledPixels(bits, bmiHeader.biWidth, bmiHeader.biHeight, widthBytes,
+            bmiHeader.biBitCount >> 3, GetRValue(mask), GetGValue(mask), GetBValue(mask));
 
         VERIFY(dc.SetDIBits(*this, 0, data.bmHeight, bits, pbmi, DIB_RGB_COLORS));
     }
@@ -1613,33 +1586,8 @@ namespace Win32xx
         byte* pByteArray = &vBits[0];
 
         memDC.GetDIBits(*this, 0, bmiHeader.biHeight, pByteArray, pbmi, DIB_RGB_COLORS);
-        UINT widthBytes = bmiHeader.biSizeImage/bmiHeader.biHeight;
-
-        int yOffset = 0;
-        int xOffset;
-        size_t index;
-
-        for (int row=0; row < bmiHeader.biHeight; ++row)
-        {
-            xOffset = 0;
-
-            for (int column=0; column < bmiHeader.biWidth; ++column)
-            {
-                // Calculate index
-                index = size_t(yOffset) + size_t(xOffset);
-
-                BYTE byGray = (BYTE) ((pByteArray[index] + pByteArray[index +1]*6 + pByteArray[index +2] *3)/10);
-                pByteArray[index]   = byGray;
-                pByteArray[index +1] = byGray;
-                pByteArray[index +2] = byGray;
-
-                // Increment the horizontal offset
-                xOffset += bmiHeader.biBitCount >> 3;
-            }
-
-            // Increment vertical offset
-            yOffset += widthBytes;
-        }
+        int widthBytes = bmiHeader.biSizeImage/bmiHeader.biHeight;
+        GrayScalePixels(pByteArray, bmiHeader.biWidth, bmiHeader.biHeight, widthBytes, bmiHeader.biBitCount >> 3);
 
         // Save the modified color back into our source DDB
         VERIFY(SetDIBits(memDC, 0, bmiHeader.biHeight, pByteArray, pbmi, DIB_RGB_COLORS));
@@ -1665,61 +1613,8 @@ namespace Win32xx
         byte* pByteArray = &vBits[0];
 
         VERIFY(GetDIBits(memDC, 0, bmiHeader.biHeight, pByteArray, pbmi, DIB_RGB_COLORS));
-        UINT widthBytes = bmiHeader.biSizeImage/bmiHeader.biHeight;
-
-        // Ensure sane color correction values
-        cBlue  = MIN(cBlue, 255);
-        cBlue  = MAX(cBlue, -255);
-        cRed   = MIN(cRed, 255);
-        cRed   = MAX(cRed, -255);
-        cGreen = MIN(cGreen, 255);
-        cGreen = MAX(cGreen, -255);
-
-        // Pre-calculate the RGB modification values
-        int b1 = 256 - cBlue;
-        int g1 = 256 - cGreen;
-        int r1 = 256 - cRed;
-
-        int b2 = 256 + cBlue;
-        int g2 = 256 + cGreen;
-        int r2 = 256 + cRed;
-
-        // Modify the color
-        int yOffset = 0;
-        int xOffset;
-        size_t index;
-        for (int Row=0; Row < bmiHeader.biHeight; ++Row)
-        {
-            xOffset = 0;
-
-            for (int Column=0; Column < bmiHeader.biWidth; ++Column)
-            {
-                // Calculate index
-                index = size_t(yOffset) + size_t(xOffset);
-
-                // Adjust the color values
-                if (cBlue > 0)
-                    pByteArray[index]   = (BYTE)(cBlue + (((pByteArray[index] *b1)) >>8));
-                else if (cBlue < 0)
-                    pByteArray[index]   = (BYTE)((pByteArray[index] *b2) >>8);
-
-                if (cGreen > 0)
-                    pByteArray[index+1] = (BYTE)(cGreen + (((pByteArray[index+1] *g1)) >>8));
-                else if (cGreen < 0)
-                    pByteArray[index+1] = (BYTE)((pByteArray[index+1] *g2) >>8);
-
-                if (cRed > 0)
-                    pByteArray[index+2] = (BYTE)(cRed + (((pByteArray[index+2] *r1)) >>8));
-                else if (cRed < 0)
-                    pByteArray[index+2] = (BYTE)((pByteArray[index+2] *r2) >>8);
-
-                // Increment the horizontal offset
-                xOffset += bmiHeader.biBitCount >> 3;
-            }
-
-            // Increment vertical offset
-            yOffset += widthBytes;
-        }
+        int widthBytes = bmiHeader.biSizeImage/bmiHeader.biHeight;
+        TintPixels(pByteArray, bmiHeader.biWidth, bmiHeader.biHeight, widthBytes, bmiHeader.biBitCount >> 3, cRed, cGreen, cBlue);
 
         // Save the modified color back into our source DDB
         VERIFY(SetDIBits(memDC, 0, bmiHeader.biHeight, pByteArray, pbmi, DIB_RGB_COLORS));
@@ -2668,12 +2563,44 @@ namespace Win32xx
         BitBlt(x, y, cx, cy, imageDC, 0, 0, SRCINVERT);
     }
 
-    // An efficient color gradient filler compatible with all Windows operating systems
+    // An efficient color gradient filler compatible with all Windows operating systems.
+    // Gradients are drawn with a single blit of a strip cached for the thread.
     inline void CDC::GradientFill(COLORREF color1, COLORREF color2, const RECT& rc, BOOL isVertical) const
     {
+        assert(m_pData->dc != 0);
+
         int Width = rc.right - rc.left;
         int Height = rc.bottom - rc.top;
+        if (Width <= 0 || Height <= 0)
+            return;
+
+        // Stretch a cached one pixel wide gradient strip across the rectangle.
+        TLSData* pTLSData = GetApp()->GetTlsData();
+        HBITMAP strip = 0;
+        if (pTLSData)
+            strip = pTLSData->gradients.GetStrip(color1, color2, isVertical, isVertical ? Width : Height);
 
+        if (strip != 0)
+        {
+            HDC stripDC = ::CreateCompatibleDC(0);
+            if (stripDC != 0)
+            {
+                HGDIOBJ oldBitmap = ::SelectObject(stripDC, strip);
+                int oldMode = ::SetStretchBltMode(m_pData->dc, COLORONCOLOR);
+                BOOL isDrawn = ::StretchBlt(m_pData->dc, rc.left, rc.top, Width, Height, stripDC,
+                                   0, 0, isVertical ? Width : 1, isVertical ? 1 : Height, SRCCOPY);
+
+                if (oldMode != 0)
+                    ::SetStretchBltMode(m_pData->dc, oldMode);
+
+                ::SelectObject(stripDC, oldBitmap);
+                ::DeleteDC(stripDC);
+                if (isDrawn)
+                    return;
+            }
+        }
+
+        // Fall back to filling one solid line per pixel.
         int r1 = GetRValue(color1);
         int g1 = GetGValue(color1);
         int b1 = GetBValue(color1);
@@ -2737,17 +2664,10 @@ namespace Win32xx
         CWinApp* pApp = CWinApp::SetnGetThis();
         if (pApp != NULL)          // Is the CWinApp object still valid?
         {
-            // Allocate an iterator for our Data map
-            std::map<HDC, CDC_Data*, CompareHDC>::iterator m;
-
+            // Erase the CDC data entry from the map
             CThreadLock mapLock(pApp->m_gdiLock);
-            m = pApp->m_mapCDCData.find(m_pData->dc);
-            if (m != pApp->m_mapCDCData.end())
-            {
-                // Erase the CDC data entry from the map
-                pApp->m_mapCDCData.erase(m);
+            if (pApp->m_mapCDCData.Erase(m_pData->dc))
                 success = TRUE;
-            }
 
         }
 
@@ -2924,6 +2844,42 @@ namespace Win32xx
         m_pData->bitmap = newBitmap;
     }
 
+    // Borrows a bitmap of at least the specified size from the thread's back buffer
+    // pool and selects it into the device context. The bitmap is returned to the pool
+    // when the device context is destroyed. Use this instead of CreateCompatibleBitmap
+    // for memory DCs used as back buffers while painting. The bitmap can be larger than
+    // requested, and its contents are undefined. It shouldn't be detached.
+    // A compatible bitmap is created instead if the pool can't be used.
+    inline void CDC::CreatePooledBitmap(HDC dc, int cx, int cy)
+    {
+        assert(m_pData->dc != 0);
+
+        TLSData* pTLSData = GetApp()->GetTlsData();
+        HBITMAP bitmap = 0;
+        if (pTLSData && m_pData->pooledBitmap == 0)
+            bitmap = pTLSData->backBuffers.Borrow(dc, cx, cy);
+
+        if (bitmap == 0)
+        {
+            CreateCompatibleBitmap(dc, cx, cy);
+            return;
+        }
+
+        try
+        {
+            SelectObject(bitmap);
+        }
+
+        catch(...)
+        {
+            pTLSData->backBuffers.Return(bitmap);
+            throw;
+        }
+
+        m_pData->pooledBitmap = bitmap;
+        m_pData->pPool = &pTLSData->backBuffers;
+    }
+
     // Provides a convenient method of detaching a bitmap from a memory device context.
     // Returns the CBitmap detached from the DC.
     // Usage:  CBitmap MyBitmap = MyMemDC.DetachBitmap();
@@ -2968,6 +2924,14 @@ namespace Win32xx
                     ::DeleteDC(m_pData->dc);
             }
 
+            // Return the pooled bitmap, which RestoreDC deselected.
+            if (m_pData->pooledBitmap != 0)
+            {
+                m_pData->pPool->Return(m_pData->pooledBitmap);
+                m_pData->pooledBitmap = 0;
+                m_pData->pPool = 0;
+            }
+
             Initialize();
         }
     }
@@ -4435,6 +4399,16 @@ namespace Win32xx
         return ::SetDIBits(m_pData->dc, bitmap, startScan, scanLines, pBits, pBMI, colorUse);
     }
 
+    // Copies the color data for a rectangle of pixels in a DIB to the device context, without stretching.
+    // A CBitmapInfoPtr object can be used for the LPBITMAPINFO parameter.
+    // Refer to SetDIBitsToDevice in the Windows API documentation for more information.
+    inline int CDC::SetDIBitsToDevice(int xDest, int yDest, DWORD width, DWORD height, int xSrc, int ySrc,
+                   UINT startScan, UINT scanLines, LPCVOID pBits, const LPBITMAPINFO pBMI, UINT colorUse) const
+    {
+        assert(m_pData->dc != 0);
+        return ::SetDIBitsToDevice(m_pData->dc, xDest, yDest, width, height, xSrc, ySrc, startScan, scanLines, pBits, pBMI, colorUse);
+    }
+
     // Retrieves the current stretching mode.
     // Possible modes: BLACKONWHITE, COLORONCOLOR, HALFTONE, STRETCH_ANDSCANS, STRETCH_DELETESCANS,
     //                 STRETCH_HALFTONE, STRETCH_ORSCANS, WHITEONBLACK
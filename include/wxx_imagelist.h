@@ -195,17 +195,10 @@ namespace Win32xx
         CWinApp* pApp = CWinApp::SetnGetThis();
         if (pApp != NULL)          // Is the CWinApp object still valid?
         {
-            // Allocate an iterator for our CImageList data
-            std::map<HIMAGELIST, CIml_Data*, CompareHIMAGELIST>::iterator m;
-
+            // Erase the CImageList data entry from the map
             CThreadLock mapLock(pApp->m_wndLock);
-            m = pApp->m_mapCImlData.find(m_pData->images);
-            if (m != pApp->m_mapCImlData.end())
-            {
-                // Erase the CImageList data entry from the map
-                pApp->m_mapCImlData.erase(m);
+            if (pApp->m_mapCImlData.Erase(m_pData->images))
                 success = TRUE;
-            }
 
         }
 
@@ -282,17 +282,10 @@ namespace Win32xx
 
         if (pApp != NULL)          // Is the CWinApp object still valid?
         {
-            // Allocate an iterator for our HMENU map
-            std::map<HMENU, CMenu_Data*, CompareHMENU>::iterator m;
-
+            // Erase the Menu pointer entry from the map
             CThreadLock mapLock(pApp->m_wndLock);
-            m = pApp->m_mapCMenuData.find(m_pData->menu);
-            if (m != pApp->m_mapCMenuData.end())
-            {
-                // Erase the Menu pointer entry from the map
-                pApp->m_mapCMenuData.erase(m);
+            if (pApp->m_mapCMenuData.Erase(m_pData->menu))
                 success = TRUE;
-            }
 
         }
 
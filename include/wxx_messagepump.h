@@ -43,6 +43,52 @@
 
 namespace Win32xx
 {
+    inline CMessagePump::~CMessagePump()
+    {
+        ThreadTaskNode* pNode = m_pThreadTasks;
+        while (pNode != 0)
+        {
+            ThreadTaskNode* pNext = pNode->pNext;
+            delete pNode;
+            pNode = pNext;
+        }
+    }
+
+    // Makes this the message pump of the current thread, so other threads can
+    // wake it to run their tasks. The wake-up message is posted to the thread's
+    // main window if it has one, so it isn't lost in the modal loops of dialogs
+    // and menus. CFrame, and a dialog created while the thread has no main
+    // window, set themselves as the main window.
+    inline void CMessagePump::AttachThread()
+    {
+        TLSData* pTLSData = GetApp()->GetTlsData();
+        if (pTLSData)
+        {
+            pTLSData->pMessagePump = this;
+            m_taskWnd = pTLSData->mainWnd;
+        }
+
+        InterlockedExchange(reinterpret_cast<volatile LONG*>(&m_threadID), static_cast<LONG>(::GetCurrentThreadId()));
+    }
+
+    // Removes the queued idle task which has the specified coalescing key.
+    inline void CMessagePump::CancelIdleTask(UINT_PTR key)
+    {
+        IdleKeyMap::iterator it = m_idleKeys.find(key);
+        if (it != m_idleKeys.end())
+        {
+            m_idleTasks.erase(it->second);
+            m_idleKeys.erase(it);
+        }
+    }
+
+    // Removes all the queued idle tasks.
+    inline void CMessagePump::ClearIdleTasks()
+    {
+        m_idleTasks.clear();
+        m_idleKeys.clear();
+    }
+
     // InitInstance is called when the thread or application starts.
     // Override this function to perform tasks such as creating a window.
     // Return TRUE to indicate success and run the message loop.
@@ -60,6 +106,10 @@ namespace Win32xx
         int status = 1;
         LONG lCount = 0;
 
+        // Allow other threads to wake this thread to run their tasks.
+        AttachThread();
+        ProcessThreadTasks();
+
         while (status != 0)
         {
             // While idle, perform idle processing until OnIdle returns FALSE
@@ -68,16 +118,27 @@ namespace Win32xx
 
             lCount = 0;
 
+            // Run the idle tasks in time slices until a message is queued.
+            while (!::PeekMessage(&msg, 0, 0, 0, PM_NOREMOVE) && RunIdleTasks())
+            {
+            }
+
+            // Run tasks whose wake-up message was lost in a modal loop before
+            // waiting, as no further wake-up is posted while one is pending.
+            if (m_pThreadTasks != 0)
+                ProcessThreadTasks();
+
             // Now wait until we get a message
             if ((status = ::GetMessage(&msg, NULL, 0, 0)) == -1)
                 return -1;
 
-            if (!PreTranslateMessage(msg))
+            if (msg.hwnd == 0 && msg.message == UWM_RUNTHREADTASKS)
+                ProcessThreadTasks();
+            else if (!PreTranslateMessage(msg))
             {
                 ::TranslateMessage(&msg);
                 ::DispatchMessage(&msg);
             }
-
         }
 
         return LOWORD(msg.wParam);
@@ -92,6 +153,86 @@ namespace Win32xx
         return FALSE;
     }
 
+    // Queues a task to be run by the thread running this message loop. This
+    // function can be called from any thread, and doesn't lock. Only the first
+    // task posted since the thread last processed its tasks posts a wake-up
+    // message, so tasks posted in quick succession are run in a single batch.
+    // A non-zero key coalesces tasks: when a batch contains tasks with the same
+    // key, only the last one posted is run. Tasks posted before the message
+    // loop starts are run when it starts.
+    inline void CMessagePump::PostThreadTask(const IdleTaskPtr& task, UINT_PTR key)
+    {
+        assert(task.get() != NULL);
+        ThreadTaskNode* pNode = new ThreadTaskNode;
+        pNode->pTask = task;
+        pNode->key = key;
+
+        // Push the task onto the front of the list.
+        PVOID pHead;
+        do
+        {
+            pHead = m_pThreadTasks;
+            pNode->pNext = static_cast<ThreadTaskNode*>(pHead);
+        } while (InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(&m_pThreadTasks),
+                                                   pNode, pHead) != pHead);
+
+        InterlockedIncrement(&m_threadStats.posted);
+
+        // Wake the thread unless a wake-up message is already pending.
+        if (InterlockedExchange(&m_isWakePending, 1) == 0)
+        {
+            BOOL isPosted = FALSE;
+            HWND wnd = m_taskWnd;
+            if (wnd != 0)
+                isPosted = ::PostMessage(wnd, UWM_RUNTHREADTASKS, 0, 0);
+
+            if (!isPosted && m_threadID != 0)
+                isPosted = ::PostThreadMessage(m_threadID, UWM_RUNTHREADTASKS, 0, 0);
+
+            if (isPosted)
+                InterlockedIncrement(&m_threadStats.wakeUps);
+            else
+                InterlockedExchange(&m_isWakePending, 0);  // Allow a later task to retry.
+        }
+    }
+
+    // Queues a task to be run when the thread's message queue is empty.
+    // Tasks with a higher priority run first. Tasks with the same priority run
+    // in the order they were posted. A non-zero key coalesces tasks: a task
+    // replaces the queued task with the same key, and runs in its place unless
+    // its priority is higher. Call this from the thread running the message loop.
+    inline void CMessagePump::PostIdleTask(const IdleTaskPtr& task, int priority, UINT_PTR key)
+    {
+        assert(task.get() != NULL);
+        ++m_idleStats.posted;
+
+        if (key != 0)
+        {
+            IdleKeyMap::iterator it = m_idleKeys.find(key);
+            if (it != m_idleKeys.end())
+            {
+                ++m_idleStats.coalesced;
+                if (priority <= it->second->first)
+                {
+                    it->second->second.pTask = task;
+                    return;
+                }
+
+                m_idleTasks.erase(it->second);
+                m_idleKeys.erase(it);
+            }
+        }
+
+        IdleTaskEntry entry;
+        entry.pTask = task;
+        entry.key = key;
+        IdleTaskMap::iterator pos = m_idleTasks.insert(std::make_pair(priority, entry));
+        if (key != 0)
+            m_idleKeys.insert(std::make_pair(key, pos));
+
+        m_idleStats.maxDepth = MAX(m_idleStats.maxDepth, m_idleTasks.size());
+    }
+
     // Override this function if your class requires input messages to be
     // translated before normal processing.
     // Return TRUE if the message is translated.
@@ -108,11 +249,35 @@ namespace Win32xx
                 isProcessed = TRUE;
             else
             {
+                // Search the cached chain of windows which pre-translate messages.
+                CWinApp* pApp = GetApp();
+                HWND target = msg.hwnd;
+                HWND wnd = target;
+                const PreTranslateChain* pChain = pApp->GetPreTranslateChain(target);
+                if (pChain != NULL)
+                {
+                    size_t i = 0;
+                    for ( ; i < pChain->wnds.size(); ++i)
+                    {
+                        wnd = pChain->wnds[i];
+                        isProcessed = pChain->pWnds[i]->PreTranslateMessage(msg);
+                        if (isProcessed || !pApp->IsPreTranslateChainValid(*pChain, target))
+                            break;
+                    }
+
+                    if (isProcessed || i == pChain->wnds.size())
+                        return isProcessed;
+
+                    // Windows were changed by PreTranslateMessage. Search the
+                    // remaining parents directly.
+                    wnd = ::GetParent(wnd);
+                }
+
                 // Search the chain of parents for pretranslated messages.
-                for (HWND wnd = msg.hwnd; wnd != 0; wnd = ::GetParent(wnd))
+                for ( ; wnd != 0; wnd = ::GetParent(wnd))
                 {
-                    CWnd* pWnd = GetApp()->GetCWndFromMap(wnd);
-                    if (pWnd)
+                    CWnd* pWnd = pApp->GetCWndFromMap(wnd);
+                    if (pWnd && pWnd->IsPreTranslateEnabled())
                     {
                         isProcessed = pWnd->PreTranslateMessage(msg);
                         if (isProcessed)
@@ -125,9 +290,112 @@ namespace Win32xx
         return isProcessed;
     }
 
+    // Runs the tasks posted by other threads since they were last processed,
+    // in the order they were posted. Called by the thread running the message loop.
+    inline void CMessagePump::ProcessThreadTasks()
+    {
+        // Clear the pending flag first, so tasks posted from now on send a wake-up message.
+        InterlockedExchange(&m_isWakePending, 0);
+
+        TLSData* pTLSData = GetApp()->GetTlsData();
+        if (pTLSData)
+            m_taskWnd = pTLSData->mainWnd;
+
+        // Take the whole list. The list is most recent first, so reverse it.
+        ThreadTaskNode* pNode = static_cast<ThreadTaskNode*>(InterlockedExchangePointer(
+            reinterpret_cast<PVOID volatile*>(&m_pThreadTasks), NULL));
+
+        if (pNode == 0)
+            return;
+
+        std::vector<IdleTaskPtr> tasks;
+        std::vector<UINT_PTR> keys;
+        while (pNode != 0)
+        {
+            ThreadTaskNode* pNext = pNode->pNext;
+            tasks.push_back(pNode->pTask);
+            keys.push_back(pNode->key);
+            delete pNode;
+            pNode = pNext;
+        }
+
+        std::reverse(tasks.begin(), tasks.end());
+        std::reverse(keys.begin(), keys.end());
+        ++m_threadStats.batches;
+
+        // Find the last task posted for each key.
+        std::map<UINT_PTR, size_t> lastTasks;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            if (keys[i] != 0)
+                lastTasks[keys[i]] = i;
+        }
+
+        for (size_t i = 0; i < tasks.size(); ++i)
+        {
+            if (keys[i] != 0 && lastTasks[keys[i]] != i)
+            {
+                ++m_threadStats.coalesced;
+                continue;
+            }
+
+            ++m_threadStats.run;
+            tasks[i]->Run();
+        }
+    }
+
+    // Runs queued idle tasks for up to the idle slice time. Stops early if a
+    // message is queued, so input isn't delayed. A task which runs past the
+    // end of the slice is counted as an overrun.
+    // Returns TRUE if there are tasks remaining.
+    inline BOOL CMessagePump::RunIdleTasks()
+    {
+        if (m_idleTasks.empty())
+            return FALSE;
+
+        LARGE_INTEGER frequency;
+        LARGE_INTEGER start;
+        LARGE_INTEGER now;
+        ::QueryPerformanceFrequency(&frequency);
+        ::QueryPerformanceCounter(&start);
+        LONGLONG budget = frequency.QuadPart * m_idleSlice / 1000;
+        LONGLONG elapsed = 0;
+        ++m_idleStats.slices;
+
+        while (!m_idleTasks.empty())
+        {
+            // Remove the task before it runs, as it can post or cancel tasks.
+            IdleTaskMap::iterator it = m_idleTasks.begin();
+            IdleTaskPtr pTask = it->second.pTask;
+            if (it->second.key != 0)
+                m_idleKeys.erase(it->second.key);
+
+            m_idleTasks.erase(it);
+            ++m_idleStats.run;
+            pTask->Run();
+
+            ::QueryPerformanceCounter(&now);
+            elapsed = now.QuadPart - start.QuadPart;
+            if (elapsed >= budget || HIWORD(::GetQueueStatus(QS_ALLINPUT)) != 0)
+                break;
+        }
+
+        if (elapsed > budget)
+        {
+            ++m_idleStats.overruns;
+            DWORD overrun = static_cast<DWORD>((elapsed - budget) * 1000000 / frequency.QuadPart);
+            m_idleStats.maxOverrun = MAX(m_idleStats.maxOverrun, overrun);
+        }
+
+        return !m_idleTasks.empty();
+    }
+
     // Calls InitInstance and runs the message loop.
     inline int CMessagePump::Run()
     {
+        // Allow other threads to post tasks to a modal dialog created by InitInstance.
+        AttachThread();
+
         // InitInstance runs the App's initialization code
         if (InitInstance())
         {
@@ -42,17 +42,117 @@
 
 namespace Win32xx
 {
+    // The default time, in milliseconds, spent running idle tasks before
+    // the message loop checks for messages again.
+    const UINT WXX_IDLE_SLICE = 10;
 
+    ///////////////////////////////////////////////////////////////
+    // CIdleTask is the base class for tasks queued with
+    // CMessagePump::PostIdleTask and CMessagePump::PostThreadTask.
+    // Override Run to perform the task.
+    class CIdleTask
+    {
+    public:
+        CIdleTask() {}
+        virtual ~CIdleTask() {}
+        virtual void Run() = 0;
+
+    private:
+        CIdleTask(const CIdleTask&);              // Disable copy construction
+        CIdleTask& operator = (const CIdleTask&); // Disable assignment operator
+    };
+
+    // Runs a function, function object or lambda as an idle task.
+    template <class F>
+    class CIdleTaskT : public CIdleTask
+    {
+    public:
+        CIdleTaskT(const F& func) : m_func(func) {}
+        virtual ~CIdleTaskT() {}
+        virtual void Run() { m_func(); }
+
+    private:
+        F m_func;
+    };
+
+    // Note: Modern C++ compilers can use this typedef instead.
+    // typedef std::shared_ptr<CIdleTask> IdleTaskPtr;
+    typedef Shared_Ptr<CIdleTask> IdleTaskPtr;
+
+    // Counters which describe the idle tasks run by a message pump.
+    struct IdleTaskStats
+    {
+        IdleTaskStats() : posted(0), coalesced(0), run(0), slices(0), overruns(0),
+                          maxDepth(0), maxOverrun(0) {}   // Constructor
+
+        UINT   posted;      // The number of tasks posted
+        UINT   coalesced;   // The number of posted tasks which replaced a queued task
+        UINT   run;         // The number of tasks run
+        UINT   slices;      // The number of time slices used to run tasks
+        UINT   overruns;    // The number of slices which exceeded the idle slice time
+        size_t maxDepth;    // The largest number of tasks queued at once
+        DWORD  maxOverrun;  // The largest slice overrun, in microseconds
+    };
+
+    // Counters which describe the tasks other threads post to a message pump.
+    struct ThreadTaskStats
+    {
+        ThreadTaskStats() : posted(0), wakeUps(0), run(0), coalesced(0), batches(0) {}   // Constructor
+
+        volatile LONG posted;   // The number of tasks posted
+        volatile LONG wakeUps;  // The number of messages posted to wake the thread
+        UINT run;               // The number of tasks run
+        UINT coalesced;         // The number of tasks skipped because a later task had the same key
+        UINT batches;           // The number of times the queued tasks were processed
+    };
+
+    ///////////////////////////////////////////////////////////////
+    // CMessagePump runs the message loop for a thread. It also
+    // runs the idle tasks queued with PostIdleTask while the
+    // thread's message queue is empty, and the tasks other
+    // threads queue with PostThreadTask.
     class CMessagePump : public CObject
     {
+        friend class CDialog;
+        friend class CWinApp;
+        friend class CWnd;
+
     public:
-        CMessagePump() : m_accel(0), m_accelWnd(0) {}
-        virtual ~CMessagePump() {}
+        CMessagePump() : m_accel(0), m_accelWnd(0), m_idleSlice(WXX_IDLE_SLICE),
+                         m_pThreadTasks(0), m_isWakePending(0), m_threadID(0), m_taskWnd(0) {}
+        virtual ~CMessagePump();
 
         HACCEL GetAcceleratorTable() const { return m_accel; }
         HWND   GetAcceleratorsWindow() const { return m_accelWnd; }
         void   SetAccelerators(HACCEL accel, HWND accelWnd);
 
+        // Idle tasks. These are called from the thread running the message loop.
+        void   CancelIdleTask(UINT_PTR key);
+        void   ClearIdleTasks();
+        UINT   GetIdleSlice() const { return m_idleSlice; }
+        size_t GetIdleTaskCount() const { return m_idleTasks.size(); }
+        const IdleTaskStats& GetIdleTaskStats() const { return m_idleStats; }
+        void   PostIdleTask(const IdleTaskPtr& task, int priority = 0, UINT_PTR key = 0);
+        void   SetIdleSlice(UINT milliseconds) { m_idleSlice = milliseconds; }
+
+        // Posts a function, function object or lambda as an idle task.
+        template <class F>
+        void PostIdleTask(F func, int priority = 0, UINT_PTR key = 0)
+        {
+            PostIdleTask(IdleTaskPtr(new CIdleTaskT<F>(func)), priority, key);
+        }
+
+        // Thread tasks. These can be called from any thread.
+        const ThreadTaskStats& GetThreadTaskStats() const { return m_threadStats; }
+        void   PostThreadTask(const IdleTaskPtr& task, UINT_PTR key = 0);
+
+        // Posts a function, function object or lambda as a thread task.
+        template <class F>
+        void PostThreadTask(F func, UINT_PTR key = 0)
+        {
+            PostThreadTask(IdleTaskPtr(new CIdleTaskT<F>(func)), key);
+        }
+
         // Override this function as required.
         virtual int  Run();
 
@@ -63,12 +163,43 @@ namespace Win32xx
         virtual BOOL OnIdle(LONG count);
         virtual BOOL PreTranslateMessage(MSG& msg);
 
+        void AttachThread();
+        void ProcessThreadTasks();
+        BOOL RunIdleTasks();
+
     private:
         CMessagePump(const CMessagePump&);                // Disable copy construction
         CMessagePump& operator = (const CMessagePump&);   // Disable assignment operator
 
+        struct IdleTaskEntry
+        {
+            IdleTaskPtr pTask;
+            UINT_PTR key;
+        };
+
+        // A task in the lock free list of thread tasks.
+        struct ThreadTaskNode
+        {
+            ThreadTaskNode* pNext;
+            IdleTaskPtr pTask;
+            UINT_PTR key;
+        };
+
+        // Idle tasks ordered by descending priority, then by the order they were posted.
+        typedef std::multimap<int, IdleTaskEntry, std::greater<int> > IdleTaskMap;
+        typedef std::map<UINT_PTR, IdleTaskMap::iterator> IdleKeyMap;
+
         HACCEL m_accel;               // handle to the accelerator table
         HWND m_accelWnd;              // handle to the window for accelerator keys
+        IdleTaskMap m_idleTasks;      // the queued idle tasks
+        IdleKeyMap m_idleKeys;        // the queued idle tasks which have a coalescing key
+        IdleTaskStats m_idleStats;    // counters describing the idle tasks
+        UINT m_idleSlice;             // the time in milliseconds to run idle tasks before checking for messages
+        ThreadTaskNode* volatile m_pThreadTasks; // the thread tasks, most recently posted first
+        volatile LONG m_isWakePending;           // non-zero if a wake-up message has been posted
+        volatile DWORD m_threadID;               // the thread running the message loop
+        volatile HWND m_taskWnd;                 // the window posted the wake-up message, or 0
+        ThreadTaskStats m_threadStats;           // counters describing the thread tasks
     };
 
 }
@@ -0,0 +1,537 @@
+// Win32++   Version 9.0
+// Release Date: TBA
+//
+//      David Nash
+//      email: dnash@bigpond.net.au
+//      url: https://sourceforge.net/projects/win32-framework
+//
+//
+// Copyright (c) 2005-2022  David Nash
+//
+// Permission is hereby granted, free of charge, to
+// any person obtaining a copy of this software and
+// associated documentation files (the "Software"),
+// to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify,
+// merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice
+// shall be included in all copies or substantial portions
+// of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+// ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+// TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+// SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////
+
+
+////////////////////////////////////////////////////////
+// wxx_pixels.h
+//  Declaration of the pixel functions used by CBitmap.
+//
+// These functions modify the pixels of a 24 bit or 32 bit image in memory,
+// such as the bits returned by GetDIBits. The pixels of each row are stored
+// in blue, green, red order, followed by an unused byte for 32 bit pixels.
+// The unused byte is not modified. Rows are stride bytes apart.
+//
+// The functions use SSE2 when the compiler targets a processor which supports
+// it, as is always the case for x64. Define WXX_NO_SSE2 to use the portable
+// code instead. Both produce identical results.
+//
+// ScalePixels copies a 32 bit image to another of a different size. Each
+// destination pixel is the average of the source pixels it covers, weighted
+// by the area covered. All four bytes of each pixel are averaged.
+//
+// The functions don't depend on the Windows API, and can be used with any
+// image in memory.
+
+
+#ifndef _WIN32XX_PIXELS_H_
+#define _WIN32XX_PIXELS_H_
+
+#include <cassert>
+#include <vector>
+
+#if !defined(WXX_NO_SSE2) && (defined(_M_X64) || defined(_M_AMD64) || \
+    (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(__SSE2__))
+  #define WXX_SSE2
+  #include <emmintrin.h>
+#endif
+
+
+namespace Win32xx
+{
+    void ConvertToDisabledPixels(unsigned char* bits, int width, int height, int stride,
+                                 int bytesPerPixel, int maskBlue, int maskGreen, int maskRed);
+    void GrayScalePixels(unsigned char* bits, int width, int height, int stride, int bytesPerPixel);
+    void ScalePixels(const unsigned char* source, int sourceWidth, int sourceHeight, int sourceStride,
+                     unsigned char* dest, int destWidth, int destHeight, int destStride);
+    void TintPixels(unsigned char* bits, int width, int height, int stride, int bytesPerPixel,
+                    int red, int green, int blue);
+}
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+namespace Win32xx
+{
+
+#ifdef WXX_SSE2
+
+    // The SSE2 functions process 8 pixels at a time. Each byte of the pixels
+    // is expanded to a 16 bit lane, so 8 pixels occupy bytesPerPixel vectors.
+    // The first lane of each pixel is the pixel's blue lane.
+
+    // Returns the lanes of the pixels, moved n lanes towards the start.
+    // The lanes after the last pixel are zero.
+    inline void PixelsNextLanes(const __m128i* lanes, __m128i* next1, __m128i* next2, int vectors)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        for (int k = 0; k < vectors; ++k)
+        {
+            __m128i following = (k + 1 < vectors) ? lanes[k + 1] : zero;
+            next1[k] = _mm_or_si128(_mm_srli_si128(lanes[k], 2), _mm_slli_si128(following, 14));
+            next2[k] = _mm_or_si128(_mm_srli_si128(lanes[k], 4), _mm_slli_si128(following, 12));
+        }
+    }
+
+    // Sums the blue, green and red lanes of each pixel into its blue lane.
+    // The other lanes are set to zero.
+    inline void PixelsSumToBlue(__m128i* lanes, const __m128i* blueMask, int vectors)
+    {
+        __m128i next1[4];
+        __m128i next2[4];
+        PixelsNextLanes(lanes, next1, next2, vectors);
+        for (int k = 0; k < vectors; ++k)
+        {
+            __m128i sum = _mm_add_epi16(lanes[k], _mm_add_epi16(next1[k], next2[k]));
+            lanes[k] = _mm_and_si128(sum, blueMask[k]);
+        }
+    }
+
+    // Copies the blue lane of each pixel to its green and red lanes.
+    // The other lanes must be zero.
+    inline void PixelsCopyBlue(__m128i* lanes, int vectors)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i previous = zero;
+        for (int k = 0; k < vectors; ++k)
+        {
+            __m128i current = lanes[k];
+            __m128i prev1 = _mm_or_si128(_mm_slli_si128(current, 2), _mm_srli_si128(previous, 14));
+            __m128i prev2 = _mm_or_si128(_mm_slli_si128(current, 4), _mm_srli_si128(previous, 12));
+            lanes[k] = _mm_add_epi16(current, _mm_add_epi16(prev1, prev2));
+            previous = current;
+        }
+    }
+
+    // Loads 8 pixels into 16 bit lanes.
+    inline void PixelsLoad(const unsigned char* pixels, __m128i* lanes, int vectors)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        for (int k = 0; k < vectors; ++k)
+        {
+            __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + 8 * k));
+            lanes[k] = _mm_unpacklo_epi8(bytes, zero);
+        }
+    }
+
+    // Stores the 16 bit lanes of 8 pixels.
+    inline void PixelsStore(unsigned char* pixels, const __m128i* lanes, int vectors)
+    {
+        for (int k = 0; k < vectors; ++k)
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(pixels + 8 * k), _mm_packus_epi16(lanes[k], lanes[k]));
+    }
+
+    // Sets the 16 bit lanes of a vector, repeating the values of a pixel.
+    inline __m128i PixelsPattern(int vector, int bytesPerPixel, const int* values)
+    {
+        short lanes[8];
+        for (int i = 0; i < 8; ++i)
+            lanes[i] = static_cast<short>(values[(8 * vector + i) % bytesPerPixel]);
+
+        return _mm_setr_epi16(lanes[0], lanes[1], lanes[2], lanes[3], lanes[4], lanes[5], lanes[6], lanes[7]);
+    }
+
+    // Computes the weighted sum used for gray scale pixels, blue + 6*green + 3*red,
+    // in the blue lane of each pixel.
+    inline void PixelsGraySum(const __m128i* pixels, __m128i* sums, const __m128i* weights,
+                              const __m128i* blueMask, int vectors)
+    {
+        for (int k = 0; k < vectors; ++k)
+            sums[k] = _mm_mullo_epi16(pixels[k], weights[k]);
+
+        PixelsSumToBlue(sums, blueMask, vectors);
+    }
+
+#endif // WXX_SSE2
+
+
+    // Converts the pixels to pale gray scale pixels suitable for disabled images.
+    // Pixels with a blue, green or red byte matching the mask's byte are not converted.
+    inline void ConvertToDisabledPixels(unsigned char* bits, int width, int height, int stride,
+                                        int bytesPerPixel, int maskBlue, int maskGreen, int maskRed)
+    {
+        assert(bits);
+        assert(bytesPerPixel == 3 || bytesPerPixel == 4);
+
+#ifdef WXX_SSE2
+        const int weightValues[4] = { 1, 6, 3, 0 };
+        const int blueValues[4]   = { 0xFFFF, 0, 0, 0 };
+        const int colorValues[4]  = { 0xFFFF, 0xFFFF, 0xFFFF, 0 };
+        const int maskValues[4]   = { maskBlue, maskGreen, maskRed, -1 };
+        const int oneValues[4]    = { 1, 1, 1, 0 };
+        __m128i weights[4], blueMask[4], colorMask[4], mask[4], ones[4];
+        for (int k = 0; k < bytesPerPixel; ++k)
+        {
+            weights[k]   = PixelsPattern(k, bytesPerPixel, weightValues);
+            blueMask[k]  = PixelsPattern(k, bytesPerPixel, blueValues);
+            colorMask[k] = PixelsPattern(k, bytesPerPixel, colorValues);
+            mask[k]      = PixelsPattern(k, bytesPerPixel, maskValues);
+            ones[k]      = PixelsPattern(k, bytesPerPixel, oneValues);
+        }
+
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i divide = _mm_set1_epi16(3277);    // (sum * 3277) >> 16 == sum / 20 for sum <= 2550
+        const __m128i offset = _mm_set1_epi16(95);
+#endif // WXX_SSE2
+
+        for (int row = 0; row < height; ++row)
+        {
+            unsigned char* pixel = bits + row * stride;
+            int column = 0;
+
+#ifdef WXX_SSE2
+            for ( ; column + 8 <= width; column += 8)
+            {
+                __m128i lanes[4], gray[4], matches[4];
+                PixelsLoad(pixel, lanes, bytesPerPixel);
+                PixelsGraySum(lanes, gray, weights, blueMask, bytesPerPixel);
+                for (int k = 0; k < bytesPerPixel; ++k)
+                {
+                    gray[k] = _mm_and_si128(_mm_add_epi16(_mm_mulhi_epu16(gray[k], divide), offset), blueMask[k]);
+                    matches[k] = _mm_and_si128(_mm_cmpeq_epi16(lanes[k], mask[k]), ones[k]);
+                }
+
+                PixelsCopyBlue(gray, bytesPerPixel);
+                PixelsSumToBlue(matches, blueMask, bytesPerPixel);
+                PixelsCopyBlue(matches, bytesPerPixel);
+                for (int k = 0; k < bytesPerPixel; ++k)
+                {
+                    __m128i convert = _mm_and_si128(_mm_cmpeq_epi16(matches[k], zero), colorMask[k]);
+                    lanes[k] = _mm_or_si128(_mm_and_si128(convert, gray[k]), _mm_andnot_si128(convert, lanes[k]));
+                }
+
+                PixelsStore(pixel, lanes, bytesPerPixel);
+                pixel += 8 * bytesPerPixel;
+            }
+#endif // WXX_SSE2
+
+            for ( ; column < width; ++column)
+            {
+                // Skip pixels with a color matching the mask.
+                if ((pixel[0] != maskBlue) && (pixel[1] != maskGreen) && (pixel[2] != maskRed))
+                {
+                    unsigned char gray = static_cast<unsigned char>(95 + (pixel[2] * 3 + pixel[1] * 6 + pixel[0]) / 20);
+                    pixel[0] = gray;
+                    pixel[1] = gray;
+                    pixel[2] = gray;
+                }
+
+                pixel += bytesPerPixel;
+            }
+        }
+    }
+
+    // Converts the pixels to gray scale.
+    inline void GrayScalePixels(unsigned char* bits, int width, int height, int stride, int bytesPerPixel)
+    {
+        assert(bits);
+        assert(bytesPerPixel == 3 || bytesPerPixel == 4);
+
+#ifdef WXX_SSE2
+        const int weightValues[4] = { 1, 6, 3, 0 };
+        const int blueValues[4]   = { 0xFFFF, 0, 0, 0 };
+        const int colorValues[4]  = { 0xFFFF, 0xFFFF, 0xFFFF, 0 };
+        __m128i weights[4], blueMask[4], colorMask[4];
+        for (int k = 0; k < bytesPerPixel; ++k)
+        {
+            weights[k]   = PixelsPattern(k, bytesPerPixel, weightValues);
+            blueMask[k]  = PixelsPattern(k, bytesPerPixel, blueValues);
+            colorMask[k] = PixelsPattern(k, bytesPerPixel, colorValues);
+        }
+
+        const __m128i divide = _mm_set1_epi16(6554);    // (sum * 6554) >> 16 == sum / 10 for sum <= 2550
+#endif // WXX_SSE2
+
+        for (int row = 0; row < height; ++row)
+        {
+            unsigned char* pixel = bits + row * stride;
+            int column = 0;
+
+#ifdef WXX_SSE2
+            for ( ; column + 8 <= width; column += 8)
+            {
+                __m128i lanes[4], gray[4];
+                PixelsLoad(pixel, lanes, bytesPerPixel);
+                PixelsGraySum(lanes, gray, weights, blueMask, bytesPerPixel);
+                for (int k = 0; k < bytesPerPixel; ++k)
+                    gray[k] = _mm_mulhi_epu16(gray[k], divide);
+
+                PixelsCopyBlue(gray, bytesPerPixel);
+                for (int k = 0; k < bytesPerPixel; ++k)
+                    lanes[k] = _mm_or_si128(_mm_and_si128(colorMask[k], gray[k]), _mm_andnot_si128(colorMask[k], lanes[k]));
+
+                PixelsStore(pixel, lanes, bytesPerPixel);
+                pixel += 8 * bytesPerPixel;
+            }
+#endif // WXX_SSE2
+
+            for ( ; column < width; ++column)
+            {
+                unsigned char gray = static_cast<unsigned char>((pixel[0] + pixel[1] * 6 + pixel[2] * 3) / 10);
+                pixel[0] = gray;
+                pixel[1] = gray;
+                pixel[2] = gray;
+
+                pixel += bytesPerPixel;
+            }
+        }
+    }
+
+    // Calculates the weights of the source pixels covered by each destination
+    // pixel when sourceSize pixels are scaled to destSize pixels. Destination
+    // pixel d covers count[d] source pixels, starting at first[d]. Its weights
+    // sum to 256, and are stored in pairs of 8 lanes, 4 lanes for each source
+    // pixel. The second weight of a pair is zero when count[d] is odd.
+    inline void PixelsScaleWeights(int sourceSize, int destSize, std::vector<int>& first,
+                                   std::vector<int>& count, std::vector<short>& weights)
+    {
+        first.assign(destSize, 0);
+        count.assign(destSize, 0);
+        weights.clear();
+
+        // Positions are measured in units of 1/destSize of a source pixel,
+        // so destination pixel d covers [d * sourceSize, (d + 1) * sourceSize).
+        for (int d = 0; d < destSize; ++d)
+        {
+            int begin = d * sourceSize;
+            int end = begin + sourceSize;
+            int firstPixel = begin / destSize;
+            int lastPixel = (end - 1) / destSize;
+            first[d] = firstPixel;
+            count[d] = lastPixel - firstPixel + 1;
+
+            // Round the running total of the covered area, so the weights
+            // always sum to exactly 256.
+            int covered = 0;
+            int previousWeight = 0;
+            for (int i = firstPixel; i <= lastPixel; ++i)
+            {
+                int pixelBegin = (i * destSize > begin) ? i * destSize : begin;
+                int pixelEnd = ((i + 1) * destSize < end) ? (i + 1) * destSize : end;
+                covered += pixelEnd - pixelBegin;
+                int totalWeight = (covered * 256 + sourceSize / 2) / sourceSize;
+                short weight = static_cast<short>(totalWeight - previousWeight);
+                previousWeight = totalWeight;
+                weights.insert(weights.end(), 4, weight);
+            }
+
+            if (count[d] % 2)
+                weights.insert(weights.end(), 4, static_cast<short>(0));
+        }
+    }
+
+    // Copies the source pixels to the destination pixels, scaling them to fit.
+    // The pixels are 32 bits, and rows are stride bytes apart. The source is
+    // scaled horizontally first, then vertically. Each pass rounds the weighted
+    // sums of 8 bit values to 8 bits.
+    inline void ScalePixels(const unsigned char* source, int sourceWidth, int sourceHeight, int sourceStride,
+                            unsigned char* dest, int destWidth, int destHeight, int destStride)
+    {
+        assert(source);
+        assert(dest);
+        assert(sourceWidth > 0 && sourceHeight > 0 && destWidth > 0 && destHeight > 0);
+
+        std::vector<int> firstColumn, columnCount;
+        std::vector<short> columnWeights;
+        PixelsScaleWeights(sourceWidth, destWidth, firstColumn, columnCount, columnWeights);
+
+        std::vector<int> firstRow, rowCount;
+        std::vector<short> rowWeights;
+        PixelsScaleWeights(sourceHeight, destHeight, firstRow, rowCount, rowWeights);
+
+        // Scale each source row horizontally.
+        const int rowBytes = destWidth * 4;
+        std::vector<unsigned char> rows(sourceHeight * rowBytes);
+        for (int row = 0; row < sourceHeight; ++row)
+        {
+            const unsigned char* sourceRow = source + row * sourceStride;
+            unsigned char* pixel = &rows[row * rowBytes];
+            const short* weight = &columnWeights[0];
+            for (int column = 0; column < destWidth; ++column)
+            {
+                const unsigned char* sourcePixel = sourceRow + 4 * firstColumn[column];
+                int taps = columnCount[column];
+
+#ifdef WXX_SSE2
+                // Two source pixels are weighted at a time.
+                const __m128i zero = _mm_setzero_si128();
+                __m128i sum = zero;
+                int tap = 0;
+                for ( ; tap + 2 <= taps; tap += 2)
+                {
+                    __m128i lanes = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(sourcePixel + 4 * tap)), zero);
+                    __m128i weights = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weight + 4 * tap));
+                    sum = _mm_add_epi16(sum, _mm_mullo_epi16(lanes, weights));
+                }
+
+                if (tap < taps)
+                {
+                    int last = *reinterpret_cast<const int*>(sourcePixel + 4 * tap);
+                    __m128i lanes = _mm_unpacklo_epi8(_mm_cvtsi32_si128(last), zero);
+                    __m128i weights = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weight + 4 * tap));
+                    sum = _mm_add_epi16(sum, _mm_mullo_epi16(lanes, weights));
+                }
+
+                sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+                sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+                *reinterpret_cast<int*>(pixel) = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+#else
+                for (int channel = 0; channel < 4; ++channel)
+                {
+                    int sum = 0;
+                    for (int tap = 0; tap < taps; ++tap)
+                        sum += weight[4 * tap] * sourcePixel[4 * tap + channel];
+
+                    pixel[channel] = static_cast<unsigned char>((sum + 128) >> 8);
+                }
+#endif // WXX_SSE2
+
+                pixel += 4;
+                weight += 4 * (taps + taps % 2);
+            }
+        }
+
+        // Scale the rows vertically.
+        const short* weight = &rowWeights[0];
+        for (int row = 0; row < destHeight; ++row)
+        {
+            const unsigned char* sourceRow = &rows[firstRow[row] * rowBytes];
+            unsigned char* pixel = dest + row * destStride;
+            int taps = rowCount[row];
+            int index = 0;
+
+#ifdef WXX_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i round = _mm_set1_epi16(128);
+            for ( ; index + 16 <= rowBytes; index += 16)
+            {
+                __m128i low = zero;
+                __m128i high = zero;
+                for (int tap = 0; tap < taps; ++tap)
+                {
+                    __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sourceRow + tap * rowBytes + index));
+                    __m128i tapWeight = _mm_set1_epi16(weight[4 * tap]);
+                    low = _mm_add_epi16(low, _mm_mullo_epi16(_mm_unpacklo_epi8(value, zero), tapWeight));
+                    high = _mm_add_epi16(high, _mm_mullo_epi16(_mm_unpackhi_epi8(value, zero), tapWeight));
+                }
+
+                low = _mm_srli_epi16(_mm_add_epi16(low, round), 8);
+                high = _mm_srli_epi16(_mm_add_epi16(high, round), 8);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pixel + index), _mm_packus_epi16(low, high));
+            }
+#endif // WXX_SSE2
+
+            for ( ; index < rowBytes; ++index)
+            {
+                int sum = 0;
+                for (int tap = 0; tap < taps; ++tap)
+                    sum += weight[4 * tap] * sourceRow[tap * rowBytes + index];
+
+                pixel[index] = static_cast<unsigned char>((sum + 128) >> 8);
+            }
+
+            weight += 4 * (taps + taps % 2);
+        }
+    }
+
+    // Modifies the color of the pixels by the color correction values specified.
+    // The correction values can range from -255 to +255.
+    inline void TintPixels(unsigned char* bits, int width, int height, int stride, int bytesPerPixel,
+                           int red, int green, int blue)
+    {
+        assert(bits);
+        assert(bytesPerPixel == 3 || bytesPerPixel == 4);
+
+        // Ensure sane color correction values
+        int correction[3] = { blue, green, red };
+        int add[4] = { 0, 0, 0, 0 };
+        int multiply[4] = { 256, 256, 256, 256 };
+        for (int i = 0; i < 3; ++i)
+        {
+            int value = correction[i];
+            value = (value > 255) ? 255 : value;
+            value = (value < -255) ? -255 : value;
+
+            // Each color becomes add + ((color * multiply) >> 8). A positive
+            // correction moves the color towards 255, and a negative one towards 0.
+            add[i] = (value > 0) ? value : 0;
+            multiply[i] = (value > 0) ? 256 - value : 256 + value;
+        }
+
+#ifdef WXX_SSE2
+        // The pixels are processed 48 bytes at a time, a multiple of 3 and 4 bytes.
+        __m128i addLanes[6], multiplyLanes[6];
+        for (int k = 0; k < 6; ++k)
+        {
+            addLanes[k] = PixelsPattern(k, bytesPerPixel, add);
+            multiplyLanes[k] = PixelsPattern(k, bytesPerPixel, multiply);
+        }
+
+        const __m128i zero = _mm_setzero_si128();
+#endif // WXX_SSE2
+
+        int rowBytes = width * bytesPerPixel;
+        for (int row = 0; row < height; ++row)
+        {
+            unsigned char* pixel = bits + row * stride;
+            int index = 0;
+
+#ifdef WXX_SSE2
+            for ( ; index + 48 <= rowBytes; index += 48)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    __m128i* bytes = reinterpret_cast<__m128i*>(pixel + index + 16 * k);
+                    __m128i value = _mm_loadu_si128(bytes);
+                    __m128i low = _mm_unpacklo_epi8(value, zero);
+                    __m128i high = _mm_unpackhi_epi8(value, zero);
+                    low = _mm_add_epi16(addLanes[2 * k], _mm_srli_epi16(_mm_mullo_epi16(low, multiplyLanes[2 * k]), 8));
+                    high = _mm_add_epi16(addLanes[2 * k + 1], _mm_srli_epi16(_mm_mullo_epi16(high, multiplyLanes[2 * k + 1]), 8));
+                    _mm_storeu_si128(bytes, _mm_packus_epi16(low, high));
+                }
+            }
+#endif // WXX_SSE2
+
+            for ( ; index < rowBytes; ++index)
+            {
+                int channel = index % bytesPerPixel;
+                pixel[index] = static_cast<unsigned char>(add[channel] + ((pixel[index] * multiply[channel]) >> 8));
+            }
+        }
+    }
+
+}
+
+
+#endif // _WIN32XX_PIXELS_H_
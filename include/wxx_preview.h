@@ -75,8 +75,10 @@
 // the specified printer DC. When previewing we supply the memory DC for the
 // printer to the PrintPage function instead.
 
-// After CPrintPreview calls PrintPage, it extracts the bitmap and displays
-// it in CPrintPreview's preview pane.
+// After CPrintPreview calls PrintPage, it extracts the bitmap's pixels once,
+// and displays a copy of them scaled to fit CPrintPreview's preview pane.
+// The pages before and after the previewed page are rendered when the
+// thread's message loop is idle, so moving to them is immediate.
 
 
 namespace Win32xx
@@ -121,6 +123,26 @@ namespace Win32xx
     };
 
 
+    ///////////////////////////////////////////////////////
+    // PreviewImage holds the pixels of a previewed page, and
+    // a copy of them scaled to fit the preview pane.
+    struct PreviewImage
+    {
+        PreviewImage() : width(0), height(0), scaledWidth(0), scaledHeight(0) {}   // Constructor
+
+        std::vector<BYTE> pixels;         // the page's 32 bit pixels, top row first
+        int width;                        // the page's width in pixels
+        int height;                       // the page's height in pixels
+        std::vector<BYTE> scaledPixels;   // the 32 bit pixels scaled to fit the preview pane
+        int scaledWidth;                  // the scaled width in pixels
+        int scaledHeight;                 // the scaled height in pixels
+    };
+
+    // Note: Modern C++ compilers can use this typedef instead.
+    // typedef std::shared_ptr<PreviewImage> PreviewImagePtr;
+    typedef Shared_Ptr<PreviewImage> PreviewImagePtr;
+
+
     //////////////////////////////////////////////
     // CPreviewPane provides the preview pane used
     // by CPrintPreview.
@@ -130,8 +152,14 @@ namespace Win32xx
         CPreviewPane();
         virtual ~CPreviewPane() {}
 
+        const PreviewImagePtr& GetImage() const { return m_pImage; }
+        CRect GetPreviewRect(int pageWidth, int pageHeight) const;
         void Render(CDC& dc);
-        void SetBitmap(CBitmap bitmap) { m_bitmap = bitmap; }
+        void ScaleImage(PreviewImage& image) const;
+        void SetBitmap(CBitmap bitmap) { m_pImage = CreateImage(bitmap); }
+        void SetImage(const PreviewImagePtr& image) { m_pImage = image; }
+
+        static PreviewImagePtr CreateImage(const CBitmap& bitmap);
 
     protected:
         virtual void OnDraw(CDC& dc);
@@ -141,7 +169,7 @@ namespace Win32xx
     private:
         CPreviewPane(const CPreviewPane&);               // Disable copy construction
         CPreviewPane& operator = (const CPreviewPane&);  // Disable assignment operator
-        CBitmap m_bitmap;
+        PreviewImagePtr m_pImage;
     };
 
 
@@ -163,7 +191,9 @@ namespace Win32xx
         virtual BOOL OnPrevButton();
         virtual BOOL OnPrintButton();
         virtual BOOL OnPrintSetup();
+        virtual void PrerenderPage(UINT page);
         virtual void PreviewPage(UINT page);
+        virtual PreviewImagePtr RenderPage(UINT page);
         virtual void SetSource(T& source) { m_pSource = &source; }
         virtual void UpdateButtons();
 
@@ -177,6 +207,8 @@ namespace Win32xx
     private:
         CPrintPreview(const CPrintPreview&);               // Disable copy construction
         CPrintPreview& operator = (const CPrintPreview&);  // Disable assignment operator
+        void CancelPrerender();
+
         CPreviewPane m_previewPane;
         CResizer m_resizer;
         T*      m_pSource;
@@ -188,6 +220,24 @@ namespace Win32xx
         UINT    m_currentPage;
         UINT    m_maxPage;
         HWND    m_ownerWindow;
+        std::map<UINT, PreviewImagePtr> m_pageImages;   // The rendered pages, by page number
+        CMessagePump* m_pPrerenderPump;                 // The message pump running the prerender tasks, or NULL
+    };
+
+
+    ///////////////////////////////////////////////////////////
+    // CPreviewPrerender is the idle task CPrintPreview uses to
+    // render the pages before and after the previewed page.
+    template <typename T>
+    class CPreviewPrerender
+    {
+    public:
+        CPreviewPrerender(CPrintPreview<T>& preview, UINT page) : m_pPreview(&preview), m_page(page) {}
+        void operator()() { m_pPreview->PrerenderPage(m_page); }
+
+    private:
+        CPrintPreview<T>* m_pPreview;
+        UINT m_page;
     };
 
 }
@@ -260,73 +310,133 @@ namespace Win32xx
         return 0;
     }
 
-    // Copies the bitmap (m_Bitmap) to the PreviewPane as a Device
-    // Independent Bitmap (DIB), scaling the image to fit the window.
-    inline void CPreviewPane::Render(CDC& dc)
+    // Extracts the bitmap's pixels as a 32 bit image with the top row first.
+    // The bitmap must not be selected into a device context.
+    inline PreviewImagePtr CPreviewPane::CreateImage(const CBitmap& bitmap)
     {
-        if (m_bitmap.GetHandle())
+        PreviewImagePtr pImage(new PreviewImage);
+        BITMAP bm = bitmap.GetBitmapData();
+        pImage->width = bm.bmWidth;
+        pImage->height = bm.bmHeight;
+
+        BITMAPINFO bmi;
+        ZeroMemory(&bmi, sizeof(bmi));
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = bm.bmWidth;
+        bmi.bmiHeader.biHeight = -bm.bmHeight;   // A negative height puts the top row first.
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+
+        if (bm.bmWidth > 0 && bm.bmHeight > 0)
         {
-            BITMAP bm = m_bitmap.GetBitmapData();
-            int border = 10;
-            CRect rcClient = GetClientRect();
+            pImage->pixels.resize(size_t(bm.bmWidth) * size_t(bm.bmHeight) * 4);
+            CMemDC memDC(0);
+            VERIFY(memDC.GetDIBits(bitmap, 0, bm.bmHeight, &pImage->pixels[0], &bmi, DIB_RGB_COLORS));
+        }
 
-            double ratio = double(bm.bmHeight) / double(bm.bmWidth);
-            int previewWidth;
-            int previewHeight;
+        return pImage;
+    }
 
-            // These borders center the preview with the PreviewPane.
-            int xBorder = border;
-            int yBorder = border;
-            double cxClient = rcClient.Width();
-            double cyClient = rcClient.Height();
+    // Returns the rectangle which displays a page of the specified size.
+    // The page is centered in the PreviewPane, keeping its aspect ratio.
+    inline CRect CPreviewPane::GetPreviewRect(int pageWidth, int pageHeight) const
+    {
+        int border = 10;
+        CRect rcClient = GetClientRect();
 
-            if ((cxClient - 2.0 * border)*ratio < (cyClient - 2.0 * border))
-            {
-                previewWidth = rcClient.Width() - (2 * border);
-                previewHeight = static_cast<int>(previewWidth * ratio);
-                yBorder = (rcClient.Height() - previewHeight) / 2;
-            }
-            else
-            {
-                previewHeight = rcClient.Height() - (2 * border);
-                previewWidth = static_cast<int>(previewHeight / ratio);
-                xBorder = (rcClient.Width() - previewWidth) / 2;
-            }
+        double ratio = double(pageHeight) / double(pageWidth);
+        int previewWidth;
+        int previewHeight;
 
-            // Create the LPBITMAPINFO from the bitmap.
-            CBitmapInfoPtr pbmi(m_bitmap);
-            BITMAPINFOHEADER* pBIH = reinterpret_cast<BITMAPINFOHEADER*>(pbmi.get());
+        // These borders center the preview with the PreviewPane.
+        int xBorder = border;
+        int yBorder = border;
+        double cxClient = rcClient.Width();
+        double cyClient = rcClient.Height();
 
-            // Extract the device independent image data.
-            CMemDC memDC(dc);
-            memDC.GetDIBits(m_bitmap, 0, bm.bmHeight, NULL, pbmi, DIB_RGB_COLORS);
-            std::vector<byte> byteArray(pBIH->biSizeImage, 0);
-            byte* pByteArray = &byteArray.front();
-            memDC.GetDIBits(m_bitmap, 0, bm.bmHeight, pByteArray, pbmi, DIB_RGB_COLORS);
+        if ((cxClient - 2.0 * border)*ratio < (cyClient - 2.0 * border))
+        {
+            previewWidth = rcClient.Width() - (2 * border);
+            previewHeight = static_cast<int>(previewWidth * ratio);
+            yBorder = (rcClient.Height() - previewHeight) / 2;
+        }
+        else
+        {
+            previewHeight = rcClient.Height() - (2 * border);
+            previewWidth = static_cast<int>(previewHeight / ratio);
+            xBorder = (rcClient.Width() - previewWidth) / 2;
+        }
 
-            // Use half tone stretch mode for smoother rendering.
-            dc.SetStretchBltMode(HALFTONE);
-            dc.SetBrushOrgEx(0, 0);
+        return CRect(xBorder, yBorder, xBorder + previewWidth, yBorder + previewHeight);
+    }
 
-            // Copy the DIB bitmap data to the PreviewPane's DC with stretching.
-            dc.StretchDIBits(xBorder, yBorder, previewWidth, previewHeight, 0, 0,
-                   bm.bmWidth, bm.bmHeight, pByteArray, pbmi, DIB_RGB_COLORS, SRCCOPY);
+    // Copies the image's scaled pixels to the PreviewPane as a Device
+    // Independent Bitmap (DIB). The page is only scaled again when the
+    // size of the preview changes.
+    inline void CPreviewPane::Render(CDC& dc)
+    {
+        if (m_pImage.get() && !m_pImage->pixels.empty())
+        {
+            CRect rcClient = GetClientRect();
+            CRect rcPreview = GetPreviewRect(m_pImage->width, m_pImage->height);
+            if (rcPreview.Width() > 0 && rcPreview.Height() > 0)
+            {
+                ScaleImage(*m_pImage);
+
+                BITMAPINFO bmi;
+                ZeroMemory(&bmi, sizeof(bmi));
+                bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+                bmi.bmiHeader.biWidth = m_pImage->scaledWidth;
+                bmi.bmiHeader.biHeight = -m_pImage->scaledHeight;
+                bmi.bmiHeader.biPlanes = 1;
+                bmi.bmiHeader.biBitCount = 32;
+                bmi.bmiHeader.biCompression = BI_RGB;
+
+                // Copy the scaled pixels to the PreviewPane's DC without stretching.
+                dc.SetDIBitsToDevice(rcPreview.left, rcPreview.top, m_pImage->scaledWidth, m_pImage->scaledHeight,
+                    0, 0, 0, m_pImage->scaledHeight, &m_pImage->scaledPixels[0], &bmi, DIB_RGB_COLORS);
+            }
 
             // Draw a gray border around the preview.
-            CRect rcFill(0, 0, xBorder, previewHeight + yBorder);
+            CRect rcFill(0, 0, rcPreview.left, rcPreview.bottom);
             dc.FillRect(rcFill, HBRUSH(::GetStockObject(GRAY_BRUSH)));
 
-            rcFill.SetRect(0, 0, previewWidth + xBorder, yBorder);
+            rcFill.SetRect(0, 0, rcPreview.right, rcPreview.top);
             dc.FillRect(rcFill, HBRUSH(::GetStockObject(GRAY_BRUSH)));
 
-            rcFill.SetRect(previewWidth + xBorder, 0, rcClient.Width(), rcClient.Height());
+            rcFill.SetRect(rcPreview.right, 0, rcClient.Width(), rcClient.Height());
             dc.FillRect(rcFill, HBRUSH(::GetStockObject(GRAY_BRUSH)));
 
-            rcFill.SetRect(0, previewHeight + yBorder, rcClient.Width(), rcClient.Height());
+            rcFill.SetRect(0, rcPreview.bottom, rcClient.Width(), rcClient.Height());
             dc.FillRect(rcFill, HBRUSH(::GetStockObject(GRAY_BRUSH)));
         }
     }
 
+    // Scales the image's pixels to fit the PreviewPane, unless they are
+    // already scaled to its current size. Each scaled pixel is the average
+    // of the page's pixels it covers.
+    inline void CPreviewPane::ScaleImage(PreviewImage& image) const
+    {
+        if (image.pixels.empty())
+            return;
+
+        CRect rcPreview = GetPreviewRect(image.width, image.height);
+        int width = rcPreview.Width();
+        int height = rcPreview.Height();
+        if (width <= 0 || height <= 0)
+            return;
+
+        if (width != image.scaledWidth || height != image.scaledHeight || image.scaledPixels.empty())
+        {
+            image.scaledPixels.resize(size_t(width) * size_t(height) * 4);
+            image.scaledWidth = width;
+            image.scaledHeight = height;
+            ScalePixels(&image.pixels[0], image.width, image.height, image.width * 4,
+                        &image.scaledPixels[0], width, height, width * 4);
+        }
+    }
+
     ///////////////////////////////////////////
     // Definitions for the CPrintPreview class
     //
@@ -334,7 +444,7 @@ namespace Win32xx
     // Constructor.
     template <typename T>
     inline CPrintPreview<T>::CPrintPreview() : CDialog((LPCDLGTEMPLATE)previewTemplate),
-        m_pSource(0), m_currentPage(0), m_maxPage(1), m_ownerWindow(0)
+        m_pSource(0), m_currentPage(0), m_maxPage(1), m_ownerWindow(0), m_pPrerenderPump(0)
     {
     }
 
@@ -342,6 +452,21 @@ namespace Win32xx
     template <typename T>
     inline CPrintPreview<T>::~CPrintPreview()
     {
+        CancelPrerender();
+    }
+
+    // Removes the queued idle tasks which render the pages before and after
+    // the previewed page.
+    template <typename T>
+    inline void CPrintPreview<T>::CancelPrerender()
+    {
+        if (m_pPrerenderPump)
+        {
+            UINT_PTR key = reinterpret_cast<UINT_PTR>(this);
+            m_pPrerenderPump->CancelIdleTask(key);
+            m_pPrerenderPump->CancelIdleTask(key + 1);
+            m_pPrerenderPump = 0;
+        }
     }
 
     // The dialog's window procdure. It handles the dialog's window messages.
@@ -463,17 +588,98 @@ namespace Win32xx
         assert(maxPage >= 1);
         m_maxPage = maxPage;
 
+        // Discard the pages rendered previously. The source or the printer
+        // might have changed.
+        CancelPrerender();
+        m_pageImages.clear();
+
         // Preview the first page;
         m_currentPage = 0;
         PreviewPage(0);
     }
 
+    // Renders the specified page if it is still next to the previewed page,
+    // and hasn't been rendered already. It is called by the idle tasks which
+    // PreviewPage queues.
+    template <typename T>
+    inline void CPrintPreview<T>::PrerenderPage(UINT page)
+    {
+        if (!IsWindow() || !IsWindowVisible() || (page >= m_maxPage))
+            return;
+
+        if ((page + 1 < m_currentPage) || (page > m_currentPage + 1))
+            return;
+
+        if (m_pageImages.find(page) == m_pageImages.end())
+        {
+            try
+            {
+                PreviewImagePtr pImage = RenderPage(page);
+                GetPreviewPane().ScaleImage(*pImage);
+                m_pageImages[page] = pImage;
+            }
+
+            catch (const CException&)
+            {
+                // The page is rendered again if it is previewed.
+                TRACE("*** Failed to render a preview page. ***\n");
+            }
+        }
+    }
+
     // Preview's the specified page.
+    // The page is rendered with RenderPage, unless it was rendered while the
+    // application was idle. The pages before and after it are then queued to
+    // be rendered when the application is next idle.
+    // A CResourceException is thrown if there is no default printer.
+    template <typename T>
+    inline void CPrintPreview<T>::PreviewPage(UINT page)
+    {
+        PreviewImagePtr pImage;
+        std::map<UINT, PreviewImagePtr>::iterator it = m_pageImages.find(page);
+        if (it != m_pageImages.end())
+            pImage = it->second;
+        else
+            pImage = RenderPage(page);
+
+        // Keep only the images of this page and the pages either side of it.
+        std::map<UINT, PreviewImagePtr> pageImages;
+        pageImages[page] = pImage;
+        for (it = m_pageImages.begin(); it != m_pageImages.end(); ++it)
+        {
+            if ((it->first + 1 == page) || (it->first == page + 1))
+                pageImages.insert(*it);
+        }
+
+        m_pageImages.swap(pageImages);
+        GetPreviewPane().SetImage(pImage);
+
+        // Display the print preview
+        UpdateButtons();
+        CDC previewDC = GetPreviewPane().GetDC();
+        GetPreviewPane().Render(previewDC);
+
+        // Render the next and previous pages when the thread's message loop is idle.
+        TLSData* pTLSData = GetApp()->GetTlsData();
+        if (pTLSData && pTLSData->pMessagePump)
+        {
+            CancelPrerender();
+            m_pPrerenderPump = pTLSData->pMessagePump;
+            UINT_PTR key = reinterpret_cast<UINT_PTR>(this);
+            if (page + 1 < m_maxPage && m_pageImages.find(page + 1) == m_pageImages.end())
+                m_pPrerenderPump->PostIdleTask(CPreviewPrerender<T>(*this, page + 1), 1, key);
+
+            if (page > 0 && m_pageImages.find(page - 1) == m_pageImages.end())
+                m_pPrerenderPump->PostIdleTask(CPreviewPrerender<T>(*this, page - 1), 0, key + 1);
+        }
+    }
+
+    // Renders the specified page and returns its pixels.
     // This function calls the view's PrintPage function to render the same
     // information that would be printed on a page.
     // A CResourceException is thrown if there is no default printer.
     template <typename T>
-    inline void CPrintPreview<T>::PreviewPage(UINT page)
+    inline PreviewImagePtr CPrintPreview<T>::RenderPage(UINT page)
     {
         // Get the device context of the default or currently chosen printer
         CPrintDialog printDlg;
@@ -504,14 +710,9 @@ namespace Win32xx
         assert(m_pSource);
         m_pSource->PrintPage(memDC, page);
 
-        // Detach the bitmap from the memory DC and save it
+        // Detach the bitmap from the memory DC and extract its pixels.
         CBitmap bitmap = memDC.DetachBitmap();
-        GetPreviewPane().SetBitmap(bitmap);
-
-        // Display the print preview
-        UpdateButtons();
-        CDC previewDC = GetPreviewPane().GetDC();
-        GetPreviewPane().Render(previewDC);
+        return CPreviewPane::CreateImage(bitmap);
     }
 
     // Enables or disables the page selection buttons.
@@ -48,6 +48,18 @@
 // The default scrolling background is white. Use the SetScrollBkgnd
 // to set a different brush color.
 //
+// By default, OnDraw draws the entire document onto a bitmap the size of
+// the document. Use SetPaintMode to choose a different paint mode for large
+// documents:
+//  paintViewport: OnDraw draws onto a back buffer the size of the client
+//                 area, with the scroll position applied as the viewport
+//                 origin. Only the area being painted is updated.
+//  paintTiles:    The document is drawn onto tiles which are cached. Scrolling
+//                 copies the tiles already drawn, and only draws new tiles.
+//                 Use InvalidateTiles when the document changes.
+// In these modes OnDraw should use GetClipBox to skip drawing that isn't
+// visible, and shouldn't select its own bitmap into the device context.
+//
 /////////////////////////////////////////////////////////
 
 
@@ -80,6 +92,14 @@ namespace Win32xx
     class CScrollView : public CWnd
     {
     public:
+        // The ways OnDraw can be used to paint the view.
+        enum PaintMode
+        {
+            paintDocument,      // Draw the entire document for each paint
+            paintViewport,      // Draw the area being painted onto a back buffer the size of the client area
+            paintTiles          // Draw the document onto cached tiles
+        };
+
         CScrollView();
         virtual ~CScrollView();
 
@@ -88,11 +108,19 @@ namespace Win32xx
         CSize GetLineScrollSize() const  { return m_lineSize;  }
         CSize GetPageScrollSize() const  { return m_pageSize;  }
         CSize GetTotalScrollSize() const { return m_totalSize; }
+        int   GetMaxTiles() const        { return m_maxTiles; }
+        PaintMode GetPaintMode() const   { return m_paintMode; }
+        int   GetTileCount() const       { return static_cast<int>(m_tiles.size()); }
+        CSize GetTileSize() const        { return m_tileSize; }
+        void  InvalidateTiles(const RECT* pDocRect = NULL);
         BOOL IsHScrollVisible() const    { return (GetStyle() &  WS_HSCROLL) != FALSE; }
         BOOL IsVScrollVisible() const    { return (GetStyle() &  WS_VSCROLL) != FALSE; }
         void SetScrollPosition(POINT pt);
         void SetScrollSizes(CSize totalSize = CSize(0,0), CSize pageSize = CSize(0,0), CSize lineSize = CSize(0,0));
-        void SetScrollBkgnd(CBrush bkgndBrush) { m_bkgndBrush = bkgndBrush; }
+        void SetScrollBkgnd(CBrush bkgndBrush);
+        void SetMaxTiles(int maxTiles);
+        void SetPaintMode(PaintMode mode);
+        void SetTileSize(CSize tileSize);
 
     protected:
         virtual void    FillOutsideRect(CDC& dc, HBRUSH brush);
@@ -110,6 +138,21 @@ namespace Win32xx
     private:
         CScrollView(const CScrollView&);               // Disable copy construction
         CScrollView& operator = (const CScrollView&);  // Disable assignment operator
+
+        // A cached tile of the document, used by paintTiles.
+        struct ScrollTile
+        {
+            CBitmap bitmap;
+            UINT lastPaint;     // The last paint which used the tile
+        };
+
+        typedef std::pair<int, int> TileKey;    // The tile's column and row
+        typedef std::map<TileKey, ScrollTile> TileMap;
+
+        void PaintDocument(CDC& dc);
+        void PaintTiles(CDC& dc);
+        void PaintViewport(CDC& dc);
+        void TrimTiles();
         void UpdateBars();
 
         CPoint m_currentPos;
@@ -117,6 +160,13 @@ namespace Win32xx
         CSize m_pageSize;
         CSize m_lineSize;
         CBrush m_bkgndBrush;
+        PaintMode m_paintMode;
+        CBitmap m_backBuffer;       // The back buffer used by paintViewport
+        CSize m_backBufferSize;
+        TileMap m_tiles;            // The tiles used by paintTiles
+        CSize m_tileSize;
+        int m_maxTiles;             // The number of tiles kept when they aren't visible
+        UINT m_paintCount;
     };
 
 }
@@ -132,7 +182,8 @@ namespace Win32xx
     // Definitions for the CScrollView class
     //
 
-    inline CScrollView::CScrollView()
+    inline CScrollView::CScrollView() : m_paintMode(paintDocument), m_tileSize(256, 256),
+                                        m_maxTiles(64), m_paintCount(0)
     {
         m_bkgndBrush.CreateSolidBrush(RGB(255, 255, 255));
     }
@@ -158,6 +209,40 @@ namespace Win32xx
         dc.FillRect(rcBottom, brush);
     }
 
+    // Discards the cached tiles which intersect the specified rectangle in document
+    // co-ordinates, and invalidates the rectangle. Discards all the tiles and
+    // invalidates the view if pDocRect is NULL. Call this when the document changes
+    // while the paint mode is paintTiles.
+    inline void CScrollView::InvalidateTiles(const RECT* pDocRect /*= NULL*/)
+    {
+        if (pDocRect == NULL)
+        {
+            m_tiles.clear();
+            if (IsWindow())
+                Invalidate();
+
+            return;
+        }
+
+        TileMap::iterator it = m_tiles.begin();
+        while (it != m_tiles.end())
+        {
+            CRect tileRect(CPoint(it->first.first * m_tileSize.cx, it->first.second * m_tileSize.cy), m_tileSize);
+            CRect overlap;
+            if (overlap.IntersectRect(tileRect, pDocRect))
+                m_tiles.erase(it++);
+            else
+                ++it;
+        }
+
+        if (IsWindow())
+        {
+            CRect viewRect(*pDocRect);
+            viewRect.OffsetRect(-m_currentPos.x, -m_currentPos.y);
+            InvalidateRect(viewRect);
+        }
+    }
+
     // Called when the background for the window is erased.
     inline BOOL CScrollView::OnEraseBkgnd(CDC&)
     {
@@ -289,24 +374,26 @@ namespace Win32xx
         if (m_totalSize != CSize(0, 0))
         {
             CPaintDC dc(*this);
-            CMemDC memDC(dc);
 
             // negative sizes are not allowed.
             assert(m_totalSize.cx > 0);
             assert(m_totalSize.cy > 0);
 
-            // Create the compatible bitmap for the memory DC
-            memDC.CreateCompatibleBitmap(GetDC(), m_totalSize.cx, m_totalSize.cy);
-
-            // Set the background color
-            CRect rcTotal(CPoint(0, 0), m_totalSize);
-            memDC.FillRect(rcTotal, m_bkgndBrush);
+            ++m_paintCount;
+            switch (m_paintMode)
+            {
+            case paintViewport:
+                PaintViewport(dc);
+                break;
 
-            // Call the overridden OnDraw function
-            OnDraw(memDC);
+            case paintTiles:
+                PaintTiles(dc);
+                break;
 
-            // Copy the modified memory DC to the window's DC with scrolling offsets
-            dc.BitBlt(0, 0, m_totalSize.cx, m_totalSize.cy, memDC, m_currentPos.x, m_currentPos.y, SRCCOPY);
+            default:
+                PaintDocument(dc);
+                break;
+            }
 
             // Set the area outside the scrolling area
             FillOutsideRect(dc, m_bkgndBrush);
@@ -424,6 +511,119 @@ namespace Win32xx
         return FinalWindowProc(msg, wparam, lparam);
     }
 
+    // Draws the entire document onto a bitmap the size of the document,
+    // and copies the visible part to the window.
+    inline void CScrollView::PaintDocument(CDC& dc)
+    {
+        CMemDC memDC(dc);
+
+        // Create the compatible bitmap for the memory DC
+        memDC.CreateCompatibleBitmap(GetDC(), m_totalSize.cx, m_totalSize.cy);
+
+        // Set the background color
+        CRect rcTotal(CPoint(0, 0), m_totalSize);
+        memDC.FillRect(rcTotal, m_bkgndBrush);
+
+        // Call the overridden OnDraw function
+        OnDraw(memDC);
+
+        // Copy the modified memory DC to the window's DC with scrolling offsets
+        dc.BitBlt(0, 0, m_totalSize.cx, m_totalSize.cy, memDC, m_currentPos.x, m_currentPos.y, SRCCOPY);
+    }
+
+    // Copies the cached tiles of the area being painted to the window. Tiles
+    // which aren't cached are drawn first.
+    inline void CScrollView::PaintTiles(CDC& dc)
+    {
+        // The area being painted, in document co-ordinates.
+        CRect paintRect;
+        dc.GetClipBox(paintRect);
+        CRect docRect = paintRect;
+        docRect.OffsetRect(m_currentPos);
+        CRect totalRect(CPoint(0, 0), m_totalSize);
+        if (!docRect.IntersectRect(docRect, totalRect))
+            return;
+
+        {
+            CMemDC tileDC(dc);
+            int firstColumn = docRect.left / m_tileSize.cx;
+            int lastColumn = (docRect.right - 1) / m_tileSize.cx;
+            int firstRow = docRect.top / m_tileSize.cy;
+            int lastRow = (docRect.bottom - 1) / m_tileSize.cy;
+
+            for (int row = firstRow; row <= lastRow; ++row)
+            {
+                for (int column = firstColumn; column <= lastColumn; ++column)
+                {
+                    CRect tileRect(CPoint(column * m_tileSize.cx, row * m_tileSize.cy), m_tileSize);
+                    tileRect.IntersectRect(tileRect, totalRect);
+
+                    TileMap::iterator it = m_tiles.find(TileKey(column, row));
+                    if (it == m_tiles.end())
+                    {
+                        // Draw the new tile.
+                        ScrollTile tile;
+                        tile.bitmap.CreateCompatibleBitmap(dc, tileRect.Width(), tileRect.Height());
+                        tileDC.SelectObject(tile.bitmap);
+                        int savedDC = tileDC.SaveDC();
+                        tileDC.SetViewportOrgEx(-tileRect.left, -tileRect.top);
+                        tileDC.FillRect(tileRect, m_bkgndBrush);
+                        OnDraw(tileDC);
+                        tileDC.RestoreDC(savedDC);
+
+                        it = m_tiles.insert(std::make_pair(TileKey(column, row), tile)).first;
+                    }
+                    else
+                    {
+                        tileDC.SelectObject(it->second.bitmap);
+                    }
+
+                    it->second.lastPaint = m_paintCount;
+                    dc.BitBlt(tileRect.left - m_currentPos.x, tileRect.top - m_currentPos.y,
+                              tileRect.Width(), tileRect.Height(), tileDC, 0, 0, SRCCOPY);
+                }
+            }
+        }
+
+        TrimTiles();
+    }
+
+    // Draws the area being painted onto a back buffer the size of the client area,
+    // and copies it to the window. The back buffer is kept for later paints.
+    inline void CScrollView::PaintViewport(CDC& dc)
+    {
+        CRect clientRect = GetClientRect();
+        if (m_backBuffer.GetHandle() == 0 || clientRect.Width() > m_backBufferSize.cx ||
+            clientRect.Height() > m_backBufferSize.cy)
+        {
+            m_backBufferSize.cx = MAX(m_backBufferSize.cx, MAX(clientRect.Width(), 1));
+            m_backBufferSize.cy = MAX(m_backBufferSize.cy, MAX(clientRect.Height(), 1));
+            CBitmap backBuffer;
+            backBuffer.CreateCompatibleBitmap(dc, m_backBufferSize.cx, m_backBufferSize.cy);
+            m_backBuffer = backBuffer;
+        }
+
+        CRect paintRect;
+        dc.GetClipBox(paintRect);
+        CMemDC memDC(dc);
+        memDC.SelectObject(m_backBuffer);
+
+        // Limit the drawing to the area being painted.
+        CRgn clipRgn;
+        clipRgn.CreateRectRgnIndirect(paintRect);
+        memDC.SelectClipRgn(clipRgn);
+
+        // Draw the document with the scroll position as the viewport origin.
+        memDC.SetViewportOrgEx(-m_currentPos.x, -m_currentPos.y);
+        CRect totalRect(CPoint(0, 0), m_totalSize);
+        memDC.FillRect(totalRect, m_bkgndBrush);
+        OnDraw(memDC);
+        memDC.SetViewportOrgEx(0, 0);
+
+        dc.BitBlt(paintRect.left, paintRect.top, paintRect.Width(), paintRect.Height(),
+                  memDC, paintRect.left, paintRect.top, SRCCOPY);
+    }
+
     inline void CScrollView::PreCreate(CREATESTRUCT& cs)
     {
         // Set the Window Class name
@@ -432,6 +632,33 @@ namespace Win32xx
         cs.style = WS_CHILD | WS_HSCROLL | WS_VSCROLL;
     }
 
+    // Sets the maximum number of tiles kept by paintTiles. The visible tiles
+    // are always kept. The least recently used tiles are discarded first.
+    inline void CScrollView::SetMaxTiles(int maxTiles)
+    {
+        assert(maxTiles >= 0);
+        m_maxTiles = maxTiles;
+        TrimTiles();
+    }
+
+    // Sets the way the view is painted. Refer to PaintMode.
+    inline void CScrollView::SetPaintMode(PaintMode mode)
+    {
+        m_paintMode = mode;
+        m_backBuffer.DeleteObject();
+        m_backBufferSize = CSize(0, 0);
+        m_tiles.clear();
+        if (IsWindow())
+            Invalidate();
+    }
+
+    // Sets the brush used for the scrolling background.
+    inline void CScrollView::SetScrollBkgnd(CBrush bkgndBrush)
+    {
+        m_bkgndBrush = bkgndBrush;
+        m_tiles.clear();
+    }
+
     // Sets the current scroll position.
     inline void CScrollView::SetScrollPosition(POINT pt)
     {
@@ -466,10 +693,43 @@ namespace Win32xx
             m_lineSize.cy = m_pageSize.cy / 10;
 
         m_currentPos = CPoint(0, 0);
+        m_tiles.clear();
 
         UpdateBars();
     }
 
+    // Sets the size of the tiles used by paintTiles.
+    inline void CScrollView::SetTileSize(CSize tileSize)
+    {
+        assert(tileSize.cx > 0 && tileSize.cy > 0);
+        m_tileSize = tileSize;
+        m_tiles.clear();
+        if (IsWindow())
+            Invalidate();
+    }
+
+    // Discards the least recently used tiles which aren't visible, until no
+    // more than the maximum number of tiles remain.
+    inline void CScrollView::TrimTiles()
+    {
+        while (static_cast<int>(m_tiles.size()) > m_maxTiles)
+        {
+            TileMap::iterator oldest = m_tiles.end();
+            for (TileMap::iterator it = m_tiles.begin(); it != m_tiles.end(); ++it)
+            {
+                if (it->second.lastPaint != m_paintCount &&
+                    (oldest == m_tiles.end() || it->second.lastPaint < oldest->second.lastPaint))
+                    oldest = it;
+            }
+
+            // Keep the tiles used by the last paint.
+            if (oldest == m_tiles.end())
+                break;
+
+            m_tiles.erase(oldest);
+        }
+    }
+
     // Updates the display state of the scrollbars and the scrollbar positions.
     // Also scrolls display view as required by window resizing.
     // Note: This function can be called recursively.
@@ -83,6 +83,14 @@
 
 #define _WINSOCK_DEPRECATED_NO_WARNINGS
 
+// Rvalue references and move semantics are supported by C++11 compilers and
+// by Visual Studio 2010 and later. Define WXX_NO_MOVE_SEMANTICS to disable them.
+#ifndef WXX_NO_MOVE_SEMANTICS
+  #if (__cplusplus >= 201103L) || (defined (_MSC_VER) && (_MSC_VER >= 1600))
+    #define WXX_MOVE_SEMANTICS
+  #endif
+#endif
+
 #include "wxx_shared_ptr.h"
 
 #include <WinSock2.h>   // must include before windows.h
@@ -93,6 +101,7 @@
 #include <cassert>
 #include <vector>
 #include <algorithm>
+#include <functional>
 #include <string>
 #include <map>
 #include <sstream>
@@ -101,6 +110,16 @@
 #include <tchar.h>
 #include <process.h>
 
+#ifdef WXX_MOVE_SEMANTICS
+  #include <utility>
+#endif
+
+// va_copy is provided by C99 and C++11. Older compilers for Windows use
+// a pointer for va_list, so it can be copied by assignment.
+#ifndef va_copy
+  #define va_copy(dest, src) ((dest) = (src))
+#endif
+
 // Required by compilers lacking Win64 support.
 #ifndef  GetWindowLongPtr
   #define GetWindowLongPtr   GetWindowLong
@@ -63,6 +63,10 @@
 // Inherit from CSocket and override the following functions to respond
 // to network events: OnAccept; OnAddresListChange; OnDisconnect; OnConnect;
 // OnOutOfBand; OnQualityOfService; OnReceive; OnRoutingChange; OnSend.
+// Servers with many connections can share the threads of a CSocketEngine
+// instead. Call StartEvents with the engine to monitor the socket with one of
+// the engine's threads. Each of these threads monitors up to
+// WXX_SOCKETS_PER_THREAD sockets.
 
 // When using event sockets, users of this class should be aware that functions
 // like OnReceive, OnAccept, etc. are called on a different thread from the one
@@ -111,6 +115,13 @@
 // * Override OnReceive and use Receive to receive data from the server
 // * OnDisconnect can be used to detect when the client is disconnected from the server.
 
+// Scatter/gather IO
+// Send and Receive accept an array of WSABUF buffers. Send can send a header
+// and its payload in one call without copying them into a single buffer.
+// Receive can receive into a CSocketBuffer, a ring buffer which is filled
+// directly by the socket. Messages can be parsed in place with GetData and Peek,
+// and removed from the buffer with Consume.
+
 // Notes regarding IPv6 support
 // * IPv6 is supported on Windows Vista and above. Windows XP with SP2 provides
 //    "experimental" support, which can be enabled by entering "ipv6 install"
@@ -144,14 +155,104 @@ namespace Win32xx
 {
     const int THREAD_TIMEOUT = 100;
 
+    // The maximum number of sockets monitored by each CSocketEngine thread.
+    // Each thread also waits on an event used to wake it.
+    const int WXX_SOCKETS_PER_THREAD = WSA_MAXIMUM_WAIT_EVENTS - 1;
+
     typedef int  WINAPI GETADDRINFO(LPCSTR, LPCSTR, const struct addrinfo*, struct addrinfo**);
     typedef void WINAPI FREEADDRINFO(struct addrinfo*);
 
+    class CSocket;
+
+    /////////////////////////////////////////////////////////////////
+    // CSocketBuffer is a ring buffer for the data received by a socket.
+    // CSocket::Receive fills the buffer's free space directly, and the
+    // data can be parsed in place before it is consumed. The capacity
+    // is fixed, so each message must fit within it.
+    class CSocketBuffer
+    {
+    public:
+        CSocketBuffer(int capacity = 65536);
+        virtual ~CSocketBuffer() {}
+
+        void Clear();
+        void Commit(int bytes);
+        void Consume(int bytes);
+        int  GetCapacity() const { return static_cast<int>(m_buffer.size()); }
+        const char* GetData(int bytes);
+        int  GetDataBuffers(WSABUF* buffers);
+        int  GetFreeBuffers(WSABUF* buffers);
+        int  GetFreeSize() const { return GetCapacity() - m_size; }
+        int  GetSize() const { return m_size; }
+        int  Peek(char* buf, int len) const;
+        int  Read(char* buf, int len);
+
+    private:
+        CSocketBuffer(const CSocketBuffer&);                // Disable copy construction
+        CSocketBuffer& operator = (const CSocketBuffer&);   // Disable assignment operator
+
+        std::vector<char> m_buffer;
+        int m_start;        // The position of the first unread byte
+        int m_size;         // The number of unread bytes
+    };
+
+    /////////////////////////////////////////////////////////////////
+    // CSocketEngine monitors the network events of many event sockets
+    // with a small number of threads. Each thread waits on the events
+    // of up to WXX_SOCKETS_PER_THREAD sockets, and calls the socket's
+    // OnAccept, OnReceive, OnSend, OnDisconnect etc. functions.
+    // Threads are added as sockets are added. Use CSocket::StartEvents
+    // to add a socket to the engine. Sockets must be stopped or
+    // destroyed before the engine is destroyed.
+    class CSocketEngine
+    {
+        friend class CSocket;
+
+    public:
+        CSocketEngine();
+        virtual ~CSocketEngine();
+
+        int GetSocketCount();
+        int GetThreadCount();
+
+    private:
+        // The sockets monitored by one of the engine's threads.
+        struct SocketGroup
+        {
+            SocketGroup() : isStopping(false) {}
+
+            WorkThreadPtr threadPtr;            // The thread monitoring the sockets
+            CEvent wakeEvent;                   // Signalled when the sockets change or the engine stops
+            CCriticalSection groupLock;         // Guards the sockets, events and isStopping
+            CCriticalSection dispatchLock;      // Held while the thread calls a socket's notifications
+            std::vector<CSocket*> sockets;      // The sockets monitored by the thread
+            std::vector<WSAEVENT> events;       // The wake event, followed by the event for each socket
+            std::vector<WSAEVENT> closedEvents; // Events for the thread to close once it stops waiting on them
+            bool isStopping;
+        };
+
+        typedef Shared_Ptr<SocketGroup> GroupPtr;
+
+        CSocketEngine(const CSocketEngine&);                // Disable copy construction
+        CSocketEngine& operator = (const CSocketEngine&);   // Disable assignment operator
+
+        void AddSocket(CSocket& socket);
+        void RemoveSocket(CSocket& socket);
+        static CSocket* FindSocket(SocketGroup& group, WSAEVENT event, WSANETWORKEVENTS& networkEvents);
+        static void RemoveFromGroup(SocketGroup& group, size_t index);
+        static UINT WINAPI GroupThread(LPVOID pGroup);
+
+        std::vector<GroupPtr> m_groups;
+        CCriticalSection m_engineLock;      // Guards m_groups and each socket's engine and group
+    };
+
     /////////////////////////////////////////////////////////////
     // CSocket manages a network socket. It can be used to create
     // network connections, and pass data over those connections.
     class CSocket
     {
+        friend class CSocketEngine;
+
     public:
         CSocket();
         virtual ~CSocket();
@@ -175,13 +276,17 @@ namespace Win32xx
         virtual bool IsIPV6Supported() const;
         virtual int  Listen(int backlog = SOMAXCONN) const;
         virtual int  Receive(char* buf, int len, int flags) const;
+        virtual int  Receive(WSABUF* buffers, DWORD count, int flags) const;
+        virtual int  Receive(CSocketBuffer& buffer, int flags) const;
         virtual int  ReceiveFrom(char* buf, int len, int flags, struct sockaddr* from, int* fromlen) const;
         virtual int  Send(const char* buf, int len, int flags) const;
+        virtual int  Send(const WSABUF* buffers, DWORD count, int flags) const;
         virtual int  SendTo(const char* send, int len, int flags, LPCTSTR addr, UINT port) const;
         virtual int  SendTo(const char* buf, int len, int flags, const struct sockaddr* to, int tolen) const;
 
         virtual int  StartAsync(HWND wnd, UINT message, long events);
         virtual void StartEvents();
+        virtual void StartEvents(CSocketEngine& engine);
         virtual void StopEvents();
 
         // Accessors and mutators
@@ -208,7 +313,9 @@ namespace Win32xx
     private:
         CSocket(const CSocket&);                // Disable copy construction
         CSocket& operator = (const CSocket&);   // Disable assignment operator
+        static long GetNetworkEvents();
         static UINT WINAPI EventThread(LPVOID pThis);
+        void NotifyEvents(const WSANETWORKEVENTS& networkEvents);
 
         SOCKET m_socket;
         HMODULE m_ws2_32;
@@ -217,6 +324,8 @@ namespace Win32xx
 
         GETADDRINFO* m_pfnGetAddrInfo;      // pointer for the getaddrinfo function
         FREEADDRINFO* m_pfnFreeAddrInfo;    // pointer for the freeaddrinfo function
+        CSocketEngine* m_pEngine;           // The engine monitoring the socket's events, if any
+        CSocketEngine::SocketGroup* m_pGroup; // The engine's group holding the socket
     };
 }
 
@@ -225,7 +334,8 @@ namespace Win32xx
 namespace Win32xx
 {
 
-    inline CSocket::CSocket() : m_socket(INVALID_SOCKET), m_stopRequest(FALSE, TRUE)
+    inline CSocket::CSocket() : m_socket(INVALID_SOCKET), m_stopRequest(FALSE, TRUE),
+                                m_pEngine(0), m_pGroup(0)
     {
         // Initialize the Windows Socket services
         WSADATA wsaData;
@@ -246,6 +356,10 @@ namespace Win32xx
 
     inline CSocket::~CSocket()
     {
+        // Stop the engine's notifications before the socket is shut down.
+        if (m_pEngine)
+            m_pEngine->RemoveSocket(*this);
+
         ::shutdown(m_socket, SD_BOTH);
         // Ask the event thread to stop
         m_stopRequest.SetEvent();
@@ -484,12 +598,9 @@ namespace Win32xx
         WSAEVENT allEvents[2];
         allEvents[0] = ::WSACreateEvent();
         allEvents[1] = reinterpret_cast<WSAEVENT>(stopRequestEvent.GetHandle());  // cast supports Borland v5.5
-        long events = FD_READ | FD_WRITE | FD_OOB | FD_ACCEPT | FD_CONNECT | FD_CLOSE;
-        if (GetWinVersion() != 1400) // Win Version != Win95
-            events |= FD_QOS | FD_ROUTING_INTERFACE_CHANGE | FD_ADDRESS_LIST_CHANGE;
 
         // Associate the network events with the client socket.
-        if ( SOCKET_ERROR == WSAEventSelect(clientSocket, allEvents[0], events))
+        if ( SOCKET_ERROR == WSAEventSelect(clientSocket, allEvents[0], GetNetworkEvents()))
         {
             TRACE("Error in Event Select\n");
             ::WSACloseEvent(allEvents[0]);
@@ -527,35 +638,10 @@ namespace Win32xx
                     return 0;
                 }
 
-                if (networkEvents.lNetworkEvents & FD_ACCEPT)
-                    pSocket->OnAccept();
-
-                if (networkEvents.lNetworkEvents & FD_READ)
-                    pSocket->OnReceive();
-
-                if (networkEvents.lNetworkEvents & FD_WRITE)
-                    pSocket->OnSend();
-
-                if (networkEvents.lNetworkEvents & FD_OOB)
-                    pSocket->OnOutOfBand();
-
-                if (networkEvents.lNetworkEvents & FD_QOS)
-                    pSocket->OnQualityOfService();
-
-                if (networkEvents.lNetworkEvents & FD_CONNECT)
-                    pSocket->OnConnect();
-
-                if (networkEvents.lNetworkEvents & FD_ROUTING_INTERFACE_CHANGE)
-                    pSocket->OnRoutingChange();
-
-                if (networkEvents.lNetworkEvents & FD_ADDRESS_LIST_CHANGE)
-                    pSocket->OnAddresListChange();
+                pSocket->NotifyEvents(networkEvents);
 
                 if (networkEvents.lNetworkEvents & FD_CLOSE)
                 {
-                    ::shutdown(clientSocket, SD_BOTH);
-                    ::closesocket(clientSocket);
-                    pSocket->OnDisconnect();
                     ::WSACloseEvent(allEvents[0]);
                     return 0;
                 }
@@ -564,6 +650,53 @@ namespace Win32xx
     }
 
 
+    // Returns the network events monitored by event sockets.
+    inline long CSocket::GetNetworkEvents()
+    {
+        long events = FD_READ | FD_WRITE | FD_OOB | FD_ACCEPT | FD_CONNECT | FD_CLOSE;
+        if (GetWinVersion() != 1400) // Win Version != Win95
+            events |= FD_QOS | FD_ROUTING_INTERFACE_CHANGE | FD_ADDRESS_LIST_CHANGE;
+
+        return events;
+    }
+
+    // Calls the notification functions for the network events that occurred.
+    // The socket is closed when the network events include FD_CLOSE.
+    inline void CSocket::NotifyEvents(const WSANETWORKEVENTS& networkEvents)
+    {
+        if (networkEvents.lNetworkEvents & FD_ACCEPT)
+            OnAccept();
+
+        if (networkEvents.lNetworkEvents & FD_READ)
+            OnReceive();
+
+        if (networkEvents.lNetworkEvents & FD_WRITE)
+            OnSend();
+
+        if (networkEvents.lNetworkEvents & FD_OOB)
+            OnOutOfBand();
+
+        if (networkEvents.lNetworkEvents & FD_QOS)
+            OnQualityOfService();
+
+        if (networkEvents.lNetworkEvents & FD_CONNECT)
+            OnConnect();
+
+        if (networkEvents.lNetworkEvents & FD_ROUTING_INTERFACE_CHANGE)
+            OnRoutingChange();
+
+        if (networkEvents.lNetworkEvents & FD_ADDRESS_LIST_CHANGE)
+            OnAddresListChange();
+
+        if (networkEvents.lNetworkEvents & FD_CLOSE)
+        {
+            ::shutdown(m_socket, SD_BOTH);
+            ::closesocket(m_socket);
+            m_socket = INVALID_SOCKET;
+            OnDisconnect();
+        }
+    }
+
 #ifdef GetAddrInfo
 
     // Frees address resources allocated by the GetAddrInfo function.
@@ -682,6 +815,44 @@ namespace Win32xx
         return result;
     }
 
+    // Receives data from the connected socket into an array of buffers.
+    // Returns the number of bytes received, or SOCKET_ERROR.
+    // Refer to WSARecv in the Windows API documentation for additional information.
+    inline int CSocket::Receive(WSABUF* buffers, DWORD count, int flags) const
+    {
+        DWORD received = 0;
+        DWORD receiveFlags = static_cast<DWORD>(flags);
+        if (SOCKET_ERROR == ::WSARecv(m_socket, buffers, count, &received, &receiveFlags, NULL, NULL))
+        {
+            if (WSAGetLastError() != WSAEWOULDBLOCK)
+                TRACE(_T("Receive failed\n"));
+            return SOCKET_ERROR;
+        }
+
+        return static_cast<int>(received);
+    }
+
+    // Receives data from the connected socket into the free space of the
+    // ring buffer. Returns the number of bytes received, or SOCKET_ERROR.
+    // Fails with WSAENOBUFS if the buffer is full.
+    inline int CSocket::Receive(CSocketBuffer& buffer, int flags) const
+    {
+        WSABUF buffers[2];
+        int count = buffer.GetFreeBuffers(buffers);
+        if (count == 0)
+        {
+            ::WSASetLastError(WSAENOBUFS);
+            TRACE(_T("Receive failed, the buffer is full\n"));
+            return SOCKET_ERROR;
+        }
+
+        int result = Receive(buffers, count, flags);
+        if (result > 0)
+            buffer.Commit(result);
+
+        return result;
+    }
+
     // Receives a datagram and stores the source address.
     // Refer to recvfrom in the Windows API documentation for additional information.
     inline int CSocket::ReceiveFrom(char* buf, int len, int flags, struct sockaddr* from, int* fromlen) const
@@ -703,6 +874,24 @@ namespace Win32xx
         return result;
     }
 
+    // Sends the data in an array of buffers on the connected socket. A header
+    // and its payload can be sent in one call without copying them.
+    // Returns the number of bytes sent, or SOCKET_ERROR.
+    // Refer to WSASend in the Windows API documentation for additional information.
+    inline int CSocket::Send(const WSABUF* buffers, DWORD count, int flags) const
+    {
+        DWORD sent = 0;
+        LPWSABUF sendBuffers = const_cast<LPWSABUF>(buffers);
+        if (SOCKET_ERROR == ::WSASend(m_socket, sendBuffers, count, &sent, static_cast<DWORD>(flags), NULL, NULL))
+        {
+            if (WSAGetLastError() != WSAEWOULDBLOCK)
+                TRACE(_T("Send failed\n"));
+            return SOCKET_ERROR;
+        }
+
+        return static_cast<int>(sent);
+    }
+
     // Sends data to a specific destination.
     // Refer to sendto in the Windows API documentation for additional information.
     inline int CSocket::SendTo(const char* buf, int len, int flags, const struct sockaddr* to, int tolen) const
@@ -842,9 +1031,22 @@ namespace Win32xx
         m_threadPtr->CreateThread();
     }
 
+    // This function monitors the socket for events with one of the engine's
+    // threads, instead of a thread of its own.
+    inline void CSocket::StartEvents(CSocketEngine& engine)
+    {
+        StopEvents();   // Ensure the socket isn't already monitored
+
+        engine.AddSocket(*this);
+    }
+
     // Terminates the event thread gracefully (if possible)
     inline void CSocket::StopEvents()
     {
+        // Remove the socket from its engine.
+        if (m_pEngine)
+            m_pEngine->RemoveSocket(*this);
+
         // Ask the event thread to stop
         m_stopRequest.SetEvent();
 
@@ -860,6 +1062,367 @@ namespace Win32xx
 
         m_stopRequest.ResetEvent();
     }
+
+
+    ///////////////////////////////////////////
+    // Definitions for the CSocketEngine class.
+    //
+
+    inline CSocketEngine::CSocketEngine()
+    {
+    }
+
+    // Stops the engine's threads.
+    inline CSocketEngine::~CSocketEngine()
+    {
+        std::vector<GroupPtr>::iterator it;
+        for (it = m_groups.begin(); it != m_groups.end(); ++it)
+        {
+            SocketGroup& group = *(*it);
+            {
+                CThreadLock lock(group.groupLock);
+                group.isStopping = true;
+            }
+
+            // Wait for the thread to stop.
+            group.wakeEvent.SetEvent();
+            while (WAIT_TIMEOUT == ::WaitForSingleObject(*group.threadPtr, THREAD_TIMEOUT * 10))
+            {
+                // Note: An excessive delay in processing any of the notification functions
+                // can cause us to get here.
+                TRACE("*** Error: Socket Engine Thread won't die ***\n");
+            }
+
+            // Detach any sockets still in the group.
+            CThreadLock lock(m_engineLock);
+            for (size_t i = 0; i < group.sockets.size(); ++i)
+            {
+                ::WSAEventSelect(*group.sockets[i], 0, 0);
+                group.sockets[i]->m_pEngine = 0;
+                group.sockets[i]->m_pGroup = 0;
+                ::WSACloseEvent(group.events[i + 1]);
+            }
+
+            for (size_t j = 0; j < group.closedEvents.size(); ++j)
+                ::WSACloseEvent(group.closedEvents[j]);
+        }
+    }
+
+    // Adds the socket to the first thread with room for it. A new thread is
+    // started if each thread already monitors WXX_SOCKETS_PER_THREAD sockets.
+    inline void CSocketEngine::AddSocket(CSocket& socket)
+    {
+        WSAEVENT event = ::WSACreateEvent();
+
+        // Associate the network events with the socket.
+        if (SOCKET_ERROR == ::WSAEventSelect(socket, event, CSocket::GetNetworkEvents()))
+        {
+            TRACE("Error in Event Select\n");
+            ::WSACloseEvent(event);
+            return;
+        }
+
+        CThreadLock lock(m_engineLock);
+        SocketGroup* pGroup = 0;
+        std::vector<GroupPtr>::iterator it;
+        for (it = m_groups.begin(); it != m_groups.end() && pGroup == 0; ++it)
+        {
+            CThreadLock groupLock((*it)->groupLock);
+            if (static_cast<int>((*it)->sockets.size()) < WXX_SOCKETS_PER_THREAD)
+                pGroup = (*it).get();
+        }
+
+        if (pGroup == 0)
+        {
+            GroupPtr groupPtr(new SocketGroup);
+            groupPtr->events.push_back(reinterpret_cast<WSAEVENT>(groupPtr->wakeEvent.GetHandle()));
+            groupPtr->threadPtr = WorkThreadPtr(new CWorkThread(GroupThread, groupPtr.get()));
+            m_groups.push_back(groupPtr);
+            pGroup = groupPtr.get();
+            pGroup->threadPtr->CreateThread();
+        }
+
+        {
+            CThreadLock groupLock(pGroup->groupLock);
+            pGroup->sockets.push_back(&socket);
+            pGroup->events.push_back(event);
+        }
+
+        socket.m_pEngine = this;
+        socket.m_pGroup = pGroup;
+        pGroup->wakeEvent.SetEvent();
+    }
+
+    // Returns the group's socket for the event, and retrieves its network
+    // events. Returns NULL if the socket has been removed from the group.
+    inline CSocket* CSocketEngine::FindSocket(SocketGroup& group, WSAEVENT event, WSANETWORKEVENTS& networkEvents)
+    {
+        CThreadLock lock(group.groupLock);
+        for (size_t i = 1; i < group.events.size(); ++i)
+        {
+            if (group.events[i] == event)
+            {
+                CSocket* pSocket = group.sockets[i - 1];
+                if (SOCKET_ERROR == ::WSAEnumNetworkEvents(*pSocket, event, &networkEvents))
+                {
+                    TRACE("WSAEnumNetworkEvents failed\n");
+                    return 0;
+                }
+
+                // A closed socket is no longer monitored.
+                if (networkEvents.lNetworkEvents & FD_CLOSE)
+                    RemoveFromGroup(group, i - 1);
+
+                return pSocket;
+            }
+        }
+
+        return 0;
+    }
+
+    // Returns the number of sockets monitored by the engine.
+    inline int CSocketEngine::GetSocketCount()
+    {
+        CThreadLock lock(m_engineLock);
+        size_t count = 0;
+        std::vector<GroupPtr>::const_iterator it;
+        for (it = m_groups.begin(); it != m_groups.end(); ++it)
+        {
+            CThreadLock groupLock((*it)->groupLock);
+            count += (*it)->sockets.size();
+        }
+
+        return static_cast<int>(count);
+    }
+
+    // Returns the number of threads used by the engine.
+    inline int CSocketEngine::GetThreadCount()
+    {
+        CThreadLock lock(m_engineLock);
+        return static_cast<int>(m_groups.size());
+    }
+
+    // Monitors the network events for a group of sockets.
+    inline UINT WINAPI CSocketEngine::GroupThread(LPVOID pGroup)
+    {
+        SocketGroup& group = *reinterpret_cast<SocketGroup*>(pGroup);
+        std::vector<WSAEVENT> events;
+
+        for (;;)
+        {
+            {
+                CThreadLock lock(group.groupLock);
+                if (group.isStopping)
+                    return 0;
+
+                // Close the events of removed sockets. We're no longer waiting on them.
+                for (size_t i = 0; i < group.closedEvents.size(); ++i)
+                    ::WSACloseEvent(group.closedEvents[i]);
+
+                group.closedEvents.clear();
+                events = group.events;
+            }
+
+            // Wait for a network event, or a change to the group's sockets.
+            DWORD count = static_cast<DWORD>(events.size());
+            DWORD result = ::WSAWaitForMultipleEvents(count, &events[0], FALSE, WSA_INFINITE, FALSE);
+            if (result == WSA_WAIT_FAILED)
+            {
+                TRACE("WSAWaitForMultipleEvents failed\n");
+                return 0;
+            }
+
+            // Handle each signalled event. The events after the first signalled
+            // one are checked too, so sockets later in the group aren't starved.
+            DWORD index = result - WSA_WAIT_EVENT_0;
+            while (index < count)
+            {
+                // Event 0 is the wake event.
+                if (index > 0)
+                {
+                    CThreadLock dispatchLock(group.dispatchLock);
+                    WSANETWORKEVENTS networkEvents;
+                    CSocket* pSocket = FindSocket(group, events[index], networkEvents);
+                    if (pSocket)
+                        pSocket->NotifyEvents(networkEvents);
+                }
+
+                // Find the next signalled event, without waiting.
+                if (++index < count)
+                {
+                    result = ::WSAWaitForMultipleEvents(count - index, &events[index], FALSE, 0, FALSE);
+                    if (result == WSA_WAIT_TIMEOUT || result == WSA_WAIT_FAILED)
+                        break;
+
+                    index += result - WSA_WAIT_EVENT_0;
+                }
+            }
+        }
+    }
+
+    // Stops monitoring the socket. Waits for the socket's notifications to
+    // finish if they are running on another thread.
+    inline void CSocketEngine::RemoveSocket(CSocket& socket)
+    {
+        SocketGroup* pGroup = 0;
+        {
+            CThreadLock lock(m_engineLock);
+            pGroup = socket.m_pGroup;
+            socket.m_pEngine = 0;
+            socket.m_pGroup = 0;
+        }
+
+        if (pGroup)
+        {
+            CThreadLock dispatchLock(pGroup->dispatchLock);
+            CThreadLock groupLock(pGroup->groupLock);
+            std::vector<CSocket*>& sockets = pGroup->sockets;
+            for (size_t i = 0; i < sockets.size(); ++i)
+            {
+                if (sockets[i] == &socket)
+                {
+                    ::WSAEventSelect(socket, 0, 0);
+                    RemoveFromGroup(*pGroup, i);
+                    pGroup->wakeEvent.SetEvent();
+                    break;
+                }
+            }
+        }
+    }
+
+    // Removes the socket at the specified index from the group. The socket's
+    // event is closed by the group's thread once it stops waiting on it.
+    inline void CSocketEngine::RemoveFromGroup(SocketGroup& group, size_t index)
+    {
+        group.closedEvents.push_back(group.events[index + 1]);
+        group.sockets[index] = group.sockets.back();
+        group.sockets.pop_back();
+        group.events[index + 1] = group.events.back();
+        group.events.pop_back();
+    }
+
+
+    ///////////////////////////////////////////
+    // Definitions for the CSocketBuffer class
+    //
+
+    inline CSocketBuffer::CSocketBuffer(int capacity) : m_buffer(capacity), m_start(0), m_size(0)
+    {
+        assert(capacity > 0);
+    }
+
+    // Discards the unread data.
+    inline void CSocketBuffer::Clear()
+    {
+        m_start = 0;
+        m_size = 0;
+    }
+
+    // Adds the specified number of bytes, written to the buffers returned by
+    // GetFreeBuffers, to the unread data.
+    inline void CSocketBuffer::Commit(int bytes)
+    {
+        assert(bytes >= 0 && bytes <= GetFreeSize());
+        m_size += bytes;
+    }
+
+    // Removes the specified number of bytes from the start of the unread data.
+    inline void CSocketBuffer::Consume(int bytes)
+    {
+        assert(bytes >= 0 && bytes <= m_size);
+        m_size -= bytes;
+
+        // Start from the beginning when the buffer is empty to keep the data contiguous.
+        m_start = (m_size == 0) ? 0 : (m_start + bytes) % GetCapacity();
+    }
+
+    // Returns a pointer to the specified number of unread bytes, stored
+    // contiguously. Returns NULL if fewer bytes are available. The data is
+    // moved to the start of the buffer if it wraps around the end.
+    inline const char* CSocketBuffer::GetData(int bytes)
+    {
+        if (bytes > m_size)
+            return NULL;
+
+        if (m_start + bytes > GetCapacity())
+        {
+            std::rotate(m_buffer.begin(), m_buffer.begin() + m_start, m_buffer.end());
+            m_start = 0;
+        }
+
+        return &m_buffer[m_start];
+    }
+
+    // Fills the array with up to two buffers holding the unread data.
+    // Returns the number of buffers.
+    inline int CSocketBuffer::GetDataBuffers(WSABUF* buffers)
+    {
+        assert(buffers);
+        int first = MIN(m_size, GetCapacity() - m_start);
+        int count = 0;
+        if (first > 0)
+        {
+            buffers[count].buf = &m_buffer[m_start];
+            buffers[count++].len = static_cast<u_long>(first);
+        }
+
+        if (m_size > first)
+        {
+            buffers[count].buf = &m_buffer[0];
+            buffers[count++].len = static_cast<u_long>(m_size - first);
+        }
+
+        return count;
+    }
+
+    // Fills the array with up to two buffers for the free space.
+    // Returns the number of buffers.
+    inline int CSocketBuffer::GetFreeBuffers(WSABUF* buffers)
+    {
+        assert(buffers);
+        int end = (m_start + m_size) % GetCapacity();
+        int free = GetFreeSize();
+        int first = MIN(free, GetCapacity() - end);
+        int count = 0;
+        if (first > 0)
+        {
+            buffers[count].buf = &m_buffer[end];
+            buffers[count++].len = static_cast<u_long>(first);
+        }
+
+        if (free > first)
+        {
+            buffers[count].buf = &m_buffer[0];
+            buffers[count++].len = static_cast<u_long>(free - first);
+        }
+
+        return count;
+    }
+
+    // Copies up to len bytes of the unread data without removing them.
+    // Returns the number of bytes copied.
+    inline int CSocketBuffer::Peek(char* buf, int len) const
+    {
+        assert(buf);
+        int bytes = MIN(len, m_size);
+        int first = MIN(bytes, GetCapacity() - m_start);
+        if (first > 0)
+            memcpy(buf, &m_buffer[m_start], first);
+
+        if (bytes > first)
+            memcpy(buf + first, &m_buffer[0], bytes - first);
+
+        return bytes;
+    }
+
+    // Copies up to len bytes of the unread data and removes them.
+    // Returns the number of bytes copied.
+    inline int CSocketBuffer::Read(char* buf, int len)
+    {
+        int bytes = Peek(buf, len);
+        Consume(bytes);
+        return bytes;
+    }
 }
 
 
@@ -46,10 +46,14 @@
 #include "wxx_dialog.h"
 #include "wxx_gdi.h"
 #include "wxx_regkey.h"
+#include "wxx_archive.h"
 #include "default_resource.h"
 
 namespace Win32xx
 {
+    // The signature and version at the start of a binary MDI layout.
+    const DWORD MDI_LAYOUT_SIGNATURE = 0x4C4D5857;  // "WXML"
+    const UINT  MDI_LAYOUT_VERSION   = 1;
 
     // This struct holds the information for each tab page.
     struct TabPageInfo
@@ -244,7 +248,9 @@ namespace Win32xx
         virtual void  CloseAllMDIChildren();
         virtual void  CloseMDIChild(int tab);
         virtual HWND  Create(HWND hWndParent);
+        virtual BOOL  LoadMDILayout(CArchive& ar);
         virtual BOOL  LoadRegistrySettings(LPCTSTR keyName);
+        virtual BOOL  SaveMDILayout(CArchive& ar);
         virtual BOOL  SaveRegistrySettings(LPCTSTR keyName);
         virtual void  ShowListDialog() { GetTab().ShowListDialog(); }
 
@@ -1114,7 +1120,7 @@ namespace Win32xx
         CClientDC dcView(*this);
         CMemDC memDC(dcView);
         CRect rcClient = GetClientRect();
-        memDC.CreateCompatibleBitmap(dcView, rcClient.Width(), rcClient.Height());
+        memDC.CreatePooledBitmap(dcView, rcClient.Width(), rcClient.Height());
 
         if (GetItemCount() == 0)
         {
@@ -1891,6 +1897,93 @@ namespace Win32xx
         return GetTab().GetTabPageInfo(tab).TabText;
     }
 
+    // Recreates the MDI children from a binary MDI layout written by
+    // SaveMDILayout. Any existing MDI children are closed first. The layout is
+    // read before any children are created, and redraw is suspended while
+    // they are added.
+    inline BOOL CTabbedMDI::LoadMDILayout(CArchive& ar)
+    {
+        std::vector<int> childIDs;
+        std::vector<CString> tabTexts;
+        int activeTab = 0;
+
+        try
+        {
+            DWORD signature = 0;
+            UINT version = 0;
+            ar >> signature;
+            ar >> version;
+            if ((signature != MDI_LAYOUT_SIGNATURE) || (version != MDI_LAYOUT_VERSION))
+                throw CUserException();
+
+            UINT childCount = 0;
+            ar >> childCount;
+            for (UINT u = 0; u < childCount; ++u)
+            {
+                int childID = 0;
+                CString tabText;
+                ar >> childID;
+                ar >> tabText;
+                childIDs.push_back(childID);
+                tabTexts.push_back(tabText);
+            }
+
+            ar >> activeTab;
+        }
+
+        catch (const CException&)
+        {
+            TRACE("*** The MDI layout isn't valid. ***\n");
+            return FALSE;
+        }
+
+        BOOL isLoaded = !childIDs.empty();
+        if (IsWindow())
+            SetRedraw(FALSE);
+
+        try
+        {
+            CloseAllMDIChildren();
+            for (size_t i = 0; i < childIDs.size(); ++i)
+            {
+                CWnd* pWnd = NewMDIChildFromID(childIDs[i]);
+                if (!pWnd)
+                {
+                    TRACE("Failed to get TabbedMDI info from the MDI layout");
+                    isLoaded = FALSE;
+                    break;
+                }
+
+                AddMDIChild(pWnd, tabTexts[i], childIDs[i]);
+            }
+        }
+
+        catch (...)
+        {
+            // Restore redraw before passing on the exception.
+            CloseAllMDIChildren();
+            if (IsWindow())
+            {
+                SetRedraw(TRUE);
+                RedrawWindow(RDW_INVALIDATE|RDW_UPDATENOW|RDW_ERASE|RDW_ALLCHILDREN);
+            }
+            throw;  // Rethrow
+        }
+
+        if (isLoaded)
+            SetActiveMDITab((activeTab >= 0 && activeTab < GetMDIChildCount()) ? activeTab : 0);
+        else
+            CloseAllMDIChildren();
+
+        if (IsWindow())
+        {
+            SetRedraw(TRUE);
+            RedrawWindow(RDW_INVALIDATE|RDW_UPDATENOW|RDW_ERASE|RDW_ALLCHILDREN);
+        }
+
+        return isLoaded;
+    }
+
     // Load the MDI children layout from the registry.
     inline BOOL CTabbedMDI::LoadRegistrySettings(LPCTSTR keyName)
     {
@@ -1900,8 +1993,30 @@ namespace Win32xx
         {
             const CString mdiKeyName = _T("Software\\") + CString(keyName) + _T("\\MDI Children");
             CRegKey mdiChildKey;
-            if (ERROR_SUCCESS == mdiChildKey.Open(HKEY_CURRENT_USER, mdiKeyName))
+            ULONG layoutSize = 0;
+            if ((ERROR_SUCCESS == mdiChildKey.Open(HKEY_CURRENT_USER, mdiKeyName, KEY_READ)) &&
+                (ERROR_SUCCESS == mdiChildKey.QueryBinaryValue(_T("MDI Layout"), NULL, &layoutSize)) && (layoutSize > 0))
             {
+                // The MDI children are stored as a single MDI layout value.
+                std::vector<BYTE> layout(layoutSize);
+                if (ERROR_SUCCESS == mdiChildKey.QueryBinaryValue(_T("MDI Layout"), &layout[0], &layoutSize))
+                {
+                    layout.resize(layoutSize);
+                    CArchive ar(layout, CArchive::load);
+                    isLoaded = LoadMDILayout(ar);
+                }
+
+                if (!isLoaded)
+                {
+                    // Delete the bad value from the registry.
+                    CRegKey badKey;
+                    if (ERROR_SUCCESS == badKey.Open(HKEY_CURRENT_USER, mdiKeyName))
+                        badKey.DeleteValue(_T("MDI Layout"));
+                }
+            }
+            else if (ERROR_SUCCESS == mdiChildKey.Open(HKEY_CURRENT_USER, mdiKeyName))
+            {
+                // MDI children stored by earlier versions have values for each child.
                 DWORD dwIDTab;
                 int i = 0;
                 CString tabKeyName;
@@ -2074,6 +2189,24 @@ namespace Win32xx
         }
     }
 
+    // Writes the MDI children's IDs and tab text, and the active tab, to the
+    // archive as a binary MDI layout. LoadMDILayout recreates the MDI children.
+    inline BOOL CTabbedMDI::SaveMDILayout(CArchive& ar)
+    {
+        ar << MDI_LAYOUT_SIGNATURE;
+        ar << MDI_LAYOUT_VERSION;
+        ar << static_cast<UINT>(GetMDIChildCount());
+        for (int i = 0; i < GetMDIChildCount(); ++i)
+        {
+            TabPageInfo pdi = GetTab().GetTabPageInfo(i);
+            ar << pdi.idTab;
+            ar << CString(pdi.TabText);
+        }
+
+        ar << GetActiveMDITab();
+        return TRUE;
+    }
+
     // Saves the MDI children layout in the registry.
     inline BOOL CTabbedMDI::SaveRegistrySettings(LPCTSTR keyName)
     {
@@ -2096,25 +2229,13 @@ namespace Win32xx
                 if (ERROR_SUCCESS != mdiChildKey.Open(appKey, mdiChildrenName))
                     throw CUserException();
 
-                for (int i = 0; i < GetMDIChildCount(); ++i)
-                {
-                    CString tabKeyName;
-                    TabPageInfo pdi = GetTab().GetTabPageInfo(i);
-
-                    tabKeyName.Format(_T("ID%d"), i);
-                    if (ERROR_SUCCESS != mdiChildKey.SetDWORDValue(tabKeyName, pdi.idTab))
-                        throw CUserException();
-
-                    tabKeyName.Format(_T("Text%d"), i);
-                    CString TabText = GetTab().GetTabPageInfo(i).TabText;
-                    if (ERROR_SUCCESS != mdiChildKey.SetStringValue(tabKeyName, TabText))
-                        throw CUserException();
-                }
+                // Add the MDI children to the registry as a single MDI layout value.
+                std::vector<BYTE> layout;
+                CArchive ar(layout, CArchive::store);
+                if (!SaveMDILayout(ar))
+                    throw CUserException();
 
-                // Add Active Tab to the registry.
-                CString tabKeyName = _T("Active MDI Tab");
-                int tab = GetActiveMDITab();
-                if (ERROR_SUCCESS != mdiChildKey.SetDWORDValue(tabKeyName, tab))
+                if (ERROR_SUCCESS != mdiChildKey.SetBinaryValue(_T("MDI Layout"), &layout[0], static_cast<ULONG>(layout.size())))
                     throw CUserException();
             }
             catch (const CUserException&)
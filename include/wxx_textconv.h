@@ -115,32 +115,48 @@ namespace Win32xx
     typedef WtoT  OLEtoT;
     typedef CWtoW OLEtoW;
 
+    // The size of the buffer CAtoW and CWtoA hold on the stack, in characters.
+    // Longer conversions use a buffer allocated on the heap.
+    const int WXX_TEXTCONV_BUFFER_SIZE = 256;
+
+    // Converts ANSI or UTF-8 text to wide characters. 7-bit ASCII text and
+    // valid UTF-8 text are converted without calling the operating system.
     class CAtoW
     {
     public:
         CAtoW(LPCSTR str, UINT codePage = CP_ACP, int charCount = -1);
-        ~CAtoW();
-        operator LPCWSTR() { return m_str? &m_wideArray[0] : NULL; }
-        operator LPOLESTR() { return m_str? (LPOLESTR)&m_wideArray[0] : (LPOLESTR)NULL; }
+        operator LPCWSTR() { return m_str? m_wide : NULL; }
+        operator LPOLESTR() { return m_str? (LPOLESTR)m_wide : (LPOLESTR)NULL; }
 
     private:
         CAtoW(const CAtoW&);
         CAtoW& operator= (const CAtoW&);
+        bool DecodeUTF8(int length, int& wideLength);
+        wchar_t* Reserve(int size);
+
+        wchar_t m_buffer[WXX_TEXTCONV_BUFFER_SIZE];
         std::vector<wchar_t> m_wideArray;
+        wchar_t* m_wide;
         LPCSTR m_str;
     };
 
+    // Converts wide characters to ANSI or UTF-8 text. 7-bit ASCII text and
+    // text converted to UTF-8 are converted without calling the operating system.
     class CWtoA
     {
     public:
         CWtoA(LPCWSTR str, UINT codePage = CP_ACP, int charCount = -1);
-        ~CWtoA();
-        operator LPCSTR() { return m_str? &m_ansiArray[0] : NULL; }
+        operator LPCSTR() { return m_str? m_ansi : NULL; }
 
     private:
         CWtoA(const CWtoA&);
         CWtoA& operator= (const CWtoA&);
+        bool EncodeUTF8(int length, int& ansiLength);
+        char* Reserve(int size);
+
+        char m_buffer[WXX_TEXTCONV_BUFFER_SIZE];
         std::vector<char> m_ansiArray;
+        char* m_ansi;
         LPCWSTR m_str;
     };
 
@@ -204,49 +220,261 @@ namespace Win32xx
 namespace Win32xx
 {
 
-    inline CAtoW::CAtoW(LPCSTR str, UINT codePage /*= CP_ACP*/, int charCount /*= -1*/) : m_str(str)
+    // Returns true if the code page maps 7-bit ASCII characters to the same
+    // Unicode values.
+    inline bool IsAsciiCodePage(UINT codePage)
+    {
+        return (codePage == CP_ACP || codePage == CP_THREAD_ACP || codePage == CP_UTF8);
+    }
+
+    ///////////////////////////////////
+    // CAtoW function definitions
+    //
+
+    // Usage:
+    //   CAtoW wideString("Some Text");
+    //   CAtoW wideString(utf8Text, CP_UTF8);
+    //
+    // or
+    //   SetWindowTextW( AtoW("Some Text") ); The Unicode version of SetWindowText
+    inline CAtoW::CAtoW(LPCSTR str, UINT codePage /*= CP_ACP*/, int charCount /*= -1*/) : m_wide(m_buffer), m_str(str)
     {
+        m_buffer[0] = L'\0';
         if (str)
         {
-            // Resize the vector and assign null WCHAR to each element.
-            int charBytes = (charCount == -1) ? -1 : sizeof(CHAR) * charCount;
-            int length = MultiByteToWideChar(codePage, 0, str, charBytes, NULL, 0) + 1;
-            m_wideArray.assign(length, L'\0');
+            // Measure the text and check for characters outside 7-bit ASCII in one pass.
+            int length = 0;
+            unsigned char combined = 0;
+            if (charCount == -1)
+            {
+                for (; str[length] != '\0'; ++length)
+                    combined |= static_cast<unsigned char>(str[length]);
+            }
+            else
+            {
+                length = charCount;
+                for (int i = 0; i < length; ++i)
+                    combined |= static_cast<unsigned char>(str[i]);
+            }
+
+            // Each character of the source produces no more than one wide character.
+            wchar_t* wide = Reserve(length + 1);
+            int wideLength = 0;
+
+            if (combined < 0x80 && IsAsciiCodePage(codePage))
+            {
+                // Widen 7-bit ASCII text. This loop is suitable for vectorization.
+                for (int i = 0; i < length; ++i)
+                    wide[i] = static_cast<unsigned char>(str[i]);
+
+                wideLength = length;
+            }
+            else if (codePage != CP_UTF8 || !DecodeUTF8(length, wideLength))
+            {
+                wideLength = (length > 0) ? MultiByteToWideChar(codePage, 0, str, length, wide, length) : 0;
+                if (wideLength == 0 && length > 0)
+                {
+                    // Measure the result if it didn't fit.
+                    wideLength = MultiByteToWideChar(codePage, 0, str, length, NULL, 0);
+                    wide = Reserve(wideLength + 1);
+                    wideLength = MultiByteToWideChar(codePage, 0, str, length, wide, wideLength);
+                }
+            }
+
+            m_wide[wideLength] = L'\0';
+        }
+    }
 
-            // Fill our vector with the converted WCHAR array.
-            MultiByteToWideChar(codePage, 0, str, charBytes, &m_wideArray[0], length);
+    // Decodes UTF-8 text to UTF-16. Returns false if the text contains a
+    // sequence that isn't valid UTF-8, which the operating system then converts.
+    inline bool CAtoW::DecodeUTF8(int length, int& wideLength)
+    {
+        const unsigned char* in = reinterpret_cast<const unsigned char*>(m_str);
+        const unsigned char* end = in + length;
+        wchar_t* out = m_wide;
+
+        while (in < end)
+        {
+            unsigned int ch = *in++;
+            if (ch < 0x80)
+            {
+                *out++ = static_cast<wchar_t>(ch);
+                continue;
+            }
+
+            int trailing;
+            unsigned int minimum;
+            if      (ch >= 0xC2 && ch <= 0xDF)  { trailing = 1; minimum = 0x80;    ch &= 0x1F; }
+            else if (ch >= 0xE0 && ch <= 0xEF)  { trailing = 2; minimum = 0x800;   ch &= 0x0F; }
+            else if (ch >= 0xF0 && ch <= 0xF4)  { trailing = 3; minimum = 0x10000; ch &= 0x07; }
+            else return false;
+
+            if (end - in < trailing)
+                return false;
+
+            for (int i = 0; i < trailing; ++i)
+            {
+                unsigned int next = *in++;
+                if ((next & 0xC0) != 0x80)
+                    return false;
+
+                ch = (ch << 6) | (next & 0x3F);
+            }
+
+            // Reject overlong forms, surrogates and values beyond Unicode.
+            if (ch < minimum || (ch >= 0xD800 && ch <= 0xDFFF) || ch > 0x10FFFF)
+                return false;
+
+            if (ch >= 0x10000)
+            {
+                ch -= 0x10000;
+                *out++ = static_cast<wchar_t>(0xD800 + (ch >> 10));
+                *out++ = static_cast<wchar_t>(0xDC00 + (ch & 0x3FF));
+            }
+            else
+                *out++ = static_cast<wchar_t>(ch);
         }
+
+        wideLength = static_cast<int>(out - m_wide);
+        return true;
     }
 
-    inline CAtoW::~CAtoW()
+    // Returns a buffer that holds at least size characters.
+    inline wchar_t* CAtoW::Reserve(int size)
     {
-        // Clear the array.
-        std::fill(m_wideArray.begin(), m_wideArray.end(), L'\0');
+        if (size > WXX_TEXTCONV_BUFFER_SIZE)
+        {
+            m_wideArray.resize(size);
+            m_wide = &m_wideArray[0];
+        }
+        else
+            m_wide = m_buffer;
+
+        return m_wide;
     }
 
+    ///////////////////////////////////
+    // CWtoA function definitions
+    //
+
     // Usage:
     //   CWtoA ansiString(L"Some Text");
     //   CWtoA utf8String(L"Some Text", CP_UTF8);
     //
     // or
     //   SetWindowTextA( WtoA(L"Some Text") ); The ANSI version of SetWindowText
-    inline CWtoA::CWtoA(LPCWSTR str, UINT codePage /*= CP_ACP*/, int charCount /*= -1*/) : m_str(str)
+    inline CWtoA::CWtoA(LPCWSTR str, UINT codePage /*= CP_ACP*/, int charCount /*= -1*/) : m_ansi(m_buffer), m_str(str)
+    {
+        m_buffer[0] = '\0';
+        if (str)
+        {
+            // Measure the text and check for characters outside 7-bit ASCII in one pass.
+            int length = 0;
+            unsigned int combined = 0;
+            if (charCount == -1)
+            {
+                for (; str[length] != L'\0'; ++length)
+                    combined |= str[length];
+            }
+            else
+            {
+                length = charCount;
+                for (int i = 0; i < length; ++i)
+                    combined |= str[i];
+            }
+
+            int ansiLength = 0;
+            if (combined < 0x80 && IsAsciiCodePage(codePage))
+            {
+                // Narrow 7-bit ASCII text. This loop is suitable for vectorization.
+                char* ansi = Reserve(length + 1);
+                for (int i = 0; i < length; ++i)
+                    ansi[i] = static_cast<char>(str[i]);
+
+                ansiLength = length;
+            }
+            else if (codePage != CP_UTF8 || !EncodeUTF8(length, ansiLength))
+            {
+                // Most code pages use no more than two bytes per character.
+                int size = 2 * length;
+                char* ansi = Reserve(size + 1);
+                ansiLength = (length > 0) ? WideCharToMultiByte(codePage, 0, str, length, ansi, size, NULL, NULL) : 0;
+                if (ansiLength == 0 && length > 0)
+                {
+                    // Measure the result if it didn't fit.
+                    size = WideCharToMultiByte(codePage, 0, str, length, NULL, 0, NULL, NULL);
+                    ansi = Reserve(size + 1);
+                    ansiLength = WideCharToMultiByte(codePage, 0, str, length, ansi, size, NULL, NULL);
+                }
+            }
+
+            m_ansi[ansiLength] = '\0';
+        }
+    }
+
+    // Encodes UTF-16 text as UTF-8. Returns false if the text contains an
+    // unpaired surrogate, which the operating system then converts.
+    inline bool CWtoA::EncodeUTF8(int length, int& ansiLength)
     {
-        // Resize the vector and assign null char to each element
-        int charBytes = (charCount == -1) ? -1 : sizeof(WCHAR) * charCount;
-        int length = WideCharToMultiByte(codePage, 0, str, charBytes, NULL, 0, NULL, NULL) + 1;
-        m_ansiArray.assign(length, '\0');
+        // Each character produces no more than three bytes.
+        char* out = Reserve(3 * length + 1);
+        const wchar_t* in = m_str;
+        const wchar_t* end = in + length;
 
-        // Fill our vector with the converted char array
-        WideCharToMultiByte(codePage, 0, str, charCount, &m_ansiArray[0], length, NULL, NULL);
+        while (in < end)
+        {
+            unsigned int ch = *in++;
+            if (ch < 0x80)
+            {
+                *out++ = static_cast<char>(ch);
+            }
+            else if (ch < 0x800)
+            {
+                *out++ = static_cast<char>(0xC0 | (ch >> 6));
+                *out++ = static_cast<char>(0x80 | (ch & 0x3F));
+            }
+            else if (ch >= 0xD800 && ch <= 0xDFFF)
+            {
+                // A high surrogate must be followed by a low surrogate.
+                if (ch > 0xDBFF || in == end || *in < 0xDC00 || *in > 0xDFFF)
+                    return false;
+
+                ch = 0x10000 + ((ch - 0xD800) << 10) + (*in++ - 0xDC00);
+                *out++ = static_cast<char>(0xF0 | (ch >> 18));
+                *out++ = static_cast<char>(0x80 | ((ch >> 12) & 0x3F));
+                *out++ = static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+                *out++ = static_cast<char>(0x80 | (ch & 0x3F));
+            }
+            else
+            {
+                *out++ = static_cast<char>(0xE0 | (ch >> 12));
+                *out++ = static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+                *out++ = static_cast<char>(0x80 | (ch & 0x3F));
+            }
+        }
+
+        ansiLength = static_cast<int>(out - m_ansi);
+        return true;
     }
 
-    inline CWtoA::~CWtoA()
+    // Returns a buffer that holds at least size characters.
+    inline char* CWtoA::Reserve(int size)
     {
-        // Clear the array.
-        std::fill(m_ansiArray.begin(), m_ansiArray.end(), '\0');
+        if (size > WXX_TEXTCONV_BUFFER_SIZE)
+        {
+            m_ansiArray.resize(size);
+            m_ansi = &m_ansiArray[0];
+        }
+        else
+            m_ansi = m_buffer;
+
+        return m_ansi;
     }
 
+    ///////////////////////////////////
+    // CWtoW and CAtoA function definitions
+    //
+
     inline CWtoW::CWtoW(LPCWSTR pWStr, UINT /*codePage = CP_ACP*/, int /*charCount = -1*/) : m_pWStr(pWStr)
     {
     }
@@ -275,6 +275,9 @@ namespace Win32xx
             // Set the thread's TLS Data.
             GetApp()->SetTlsData();
 
+            // Allow other threads to post tasks to a modal dialog created by InitInstance.
+            pThread->AttachThread();
+
             // Run the thread's message loop if InitInstance returns TRUE.
             if (pThread->InitInstance())
             {
@@ -0,0 +1,763 @@
+// Win32++   Version 9.0
+// Release Date: TBA
+//
+//      David Nash
+//      email: dnash@bigpond.net.au
+//      url: https://sourceforge.net/projects/win32-framework
+//
+//
+// Copyright (c) 2005-2022  David Nash
+//
+// Permission is hereby granted, free of charge, to
+// any person obtaining a copy of this software and
+// associated documentation files (the "Software"),
+// to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify,
+// merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice
+// shall be included in all copies or substantial portions
+// of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+// ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+// TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+// PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+// SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+// ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+// OR OTHER DEALINGS IN THE SOFTWARE.
+//
+////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////
+// wxx_threadpool.h
+//  Declaration of the CPoolTask and CThreadPool classes
+//
+// CThreadPool runs tasks on a fixed set of worker threads. By default it
+// starts one worker thread for each processor. Each worker thread is a
+// CWorkThread with its own queue of tasks. A worker runs the most recently
+// queued task from its own queue first. When its queue is empty it steals
+// the oldest task from the queue of another worker, so the work is spread
+// across the threads without a single shared queue.
+//
+// Tasks inherit from CPoolTask and override Run, or are functions, function
+// objects or lambdas passed to Submit. Submit returns a PoolTaskPtr which
+// can be used like a future: Wait waits for the task to finish, and Cancel
+// prevents a queued task from running. A running task can check IsCancelled
+// to end early. Tasks submitted by a running task are queued on the same
+// worker thread.
+//
+// Override CPoolTask::OnComplete to respond when the task has finished or
+// was cancelled. OnComplete is called on the worker thread, or on the thread
+// of the CMessagePump (such as a CWinThread or the CWinApp) specified when
+// the task is submitted. This allows tasks to safely update windows when
+// they complete. A task with a completion message pump is done before its
+// OnComplete is called, so Wait doesn't wait for OnComplete. WaitAll waits
+// until the OnComplete of every task has returned. Exceptions thrown by Run,
+// or by an OnComplete called on a worker thread, are caught and reported
+// with TRACE.
+//
+// A task can Wait for another task of the same pool. A queued task is then
+// run by the waiting worker, so the pool doesn't deadlock when all its
+// workers are waiting. A task which is already running on another worker is
+// waited for, so tasks must not wait for each other in a cycle.
+
+
+#ifndef _WIN32XX_THREADPOOL_H_
+#define _WIN32XX_THREADPOOL_H_
+
+// CThreadPool requires features from the Win32++ framework.
+#include "wxx_wincore.h"
+#include "wxx_thread.h"
+#include "wxx_mutex.h"
+#include <deque>
+
+
+namespace Win32xx
+{
+    class CThreadPool;
+
+    ///////////////////////////////////////////////////////////////
+    // CPoolTask is the base class for the tasks run by CThreadPool.
+    // Override Run to perform the task.
+    class CPoolTask
+    {
+        friend class CPoolCompletion;
+        friend class CThreadPool;
+
+    public:
+        CPoolTask();
+        virtual ~CPoolTask();
+
+        BOOL Cancel();
+        BOOL IsCancelled() const { return m_isCancelled != 0; }
+        BOOL IsDone() const      { return m_isDone != 0; }
+        BOOL Wait(DWORD milliseconds = INFINITE);
+
+    protected:
+        // Override these functions as required.
+        virtual void OnComplete() {}
+        virtual void Run() = 0;
+
+    private:
+        CPoolTask(const CPoolTask&);              // Disable copy construction
+        CPoolTask& operator = (const CPoolTask&); // Disable assignment operator
+
+        void SetDone();
+
+        enum State { statePending, stateRunning, stateFinished };
+
+        volatile LONG m_state;          // Pending, running or finished
+        volatile LONG m_isCancelled;    // Non-zero if Cancel was called
+        volatile LONG m_isDone;         // Non-zero when the task has finished or was cancelled
+        HANDLE volatile m_doneEvent;    // Created by Wait, and set when the task is done
+        CMessagePump* m_pCompletionPump; // The message pump which calls OnComplete, or NULL
+        CThreadPool* m_pPool;           // The thread pool the task was submitted to, or NULL
+    };
+
+    // Runs a function, function object or lambda as a thread pool task.
+    template <class F>
+    class CPoolTaskT : public CPoolTask
+    {
+    public:
+        CPoolTaskT(const F& func) : m_func(func) {}
+        virtual ~CPoolTaskT() {}
+
+    protected:
+        virtual void Run() { m_func(); }
+
+    private:
+        F m_func;
+    };
+
+    // Note: Modern C++ compilers can use this typedef instead.
+    // typedef std::shared_ptr<CPoolTask> PoolTaskPtr;
+    typedef Shared_Ptr<CPoolTask> PoolTaskPtr;
+
+    // Counts the tasks of a thread pool which are queued, running, or
+    // waiting for OnComplete to be called. It is shared with the completions
+    // posted to message pumps, as these can run after the pool is destroyed.
+    class CPoolPending
+    {
+    public:
+        CPoolPending() : m_allDoneEvent(TRUE, TRUE), m_count(0) {}
+        void Add();
+        void Remove();
+        HANDLE GetAllDoneEvent() const { return m_allDoneEvent; }
+
+    private:
+        CPoolPending(const CPoolPending&);              // Disable copy construction
+        CPoolPending& operator = (const CPoolPending&); // Disable assignment operator
+
+        CEvent m_allDoneEvent;          // Set when the count is zero
+        CCriticalSection m_lock;        // Serializes changes to m_allDoneEvent
+        volatile LONG m_count;
+    };
+
+    typedef Shared_Ptr<CPoolPending> PoolPendingPtr;
+
+    // Calls a task's OnComplete when it is run as a thread task.
+    class CPoolCompletion
+    {
+    public:
+        CPoolCompletion(const PoolTaskPtr& task, const PoolPendingPtr& pending)
+            : m_task(task), m_pending(pending) {}
+        void operator()() const;
+
+    private:
+        PoolTaskPtr m_task;
+        PoolPendingPtr m_pending;
+    };
+
+    // Counters which describe the tasks run by a CThreadPool.
+    struct ThreadPoolStats
+    {
+        ThreadPoolStats() : submitted(0), run(0), stolen(0), cancelled(0) {}   // Constructor
+
+        LONG submitted;     // The number of tasks submitted
+        LONG run;           // The number of tasks run
+        LONG stolen;        // The number of tasks run by a worker other than the one they were queued on
+        LONG cancelled;     // The number of tasks cancelled before they ran
+    };
+
+    ///////////////////////////////////////////////////////////////
+    // CThreadPool runs tasks on a set of worker threads, using a
+    // queue for each worker and work stealing.
+    class CThreadPool
+    {
+        friend class CPoolTask;
+
+    public:
+        CThreadPool();
+        virtual ~CThreadPool();
+
+        void CancelAll();
+        int  GetThreadCount() const { return static_cast<int>(m_workers.size()); }
+        ThreadPoolStats GetStats() const;
+        BOOL IsRunning() const { return !m_workers.empty(); }
+        void Start(int threads = 0);
+        void Stop();
+        PoolTaskPtr Submit(const PoolTaskPtr& task, CMessagePump* pCompletionPump = NULL);
+        void WaitAll();
+
+        // Submits a function, function object or lambda as a task.
+        template <class F>
+        PoolTaskPtr Submit(F func, CMessagePump* pCompletionPump = NULL)
+        {
+            return Submit(PoolTaskPtr(new CPoolTaskT<F>(func)), pCompletionPump);
+        }
+
+        static int GetProcessorCount();
+
+    private:
+        CThreadPool(const CThreadPool&);              // Disable copy construction
+        CThreadPool& operator = (const CThreadPool&); // Disable assignment operator
+
+        // A worker thread and its queue of tasks.
+        struct Worker
+        {
+            Worker() : pPool(0), threadID(0), run(0), stolen(0), cancelled(0) {}
+
+            CThreadPool* pPool;
+            Shared_Ptr<CWorkThread> pThread;
+            DWORD threadID;
+            std::deque<PoolTaskPtr> tasks;  // Owner takes from the back, thieves from the front
+            CCriticalSection lock;          // Protects tasks
+            LONG run;                       // Counters updated by the worker thread
+            LONG stolen;
+            LONG cancelled;
+        };
+
+        typedef Shared_Ptr<Worker> WorkerPtr;
+
+        void FinishTask(Worker& worker, const PoolTaskPtr& task, bool hasRun);
+        int  GetCurrentWorker() const;
+        bool PopTask(Worker& worker, PoolTaskPtr& task);
+        void RunTask(Worker& worker, const PoolTaskPtr& task, bool isStolen);
+        void RunWorker(Worker& worker);
+        bool StealTask(size_t thief, PoolTaskPtr& task);
+        int  TakeTask(const CPoolTask* pTask, PoolTaskPtr& task);
+        void UnregisterSleep();
+        void WakeWorker();
+        static UINT WINAPI StaticThreadProc(LPVOID pWorker);
+
+        std::vector<WorkerPtr> m_workers;
+        CSemaphore m_workSemaphore;     // Released to wake sleeping workers
+        PoolPendingPtr m_pPending;      // The tasks which aren't done or whose OnComplete hasn't returned
+        volatile LONG m_sleeping;       // The number of workers waiting for work, less those already woken
+        volatile LONG m_isStopping;     // Non-zero while the workers are being stopped
+        volatile LONG m_nextWorker;     // Used to spread submitted tasks across the workers
+        volatile LONG m_submitted;
+    };
+
+}
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+namespace Win32xx
+{
+
+    ////////////////////////////////////////
+    // Definitions for the CPoolTask class
+    //
+
+    inline CPoolTask::CPoolTask() : m_state(statePending), m_isCancelled(0), m_isDone(0),
+                                    m_doneEvent(0), m_pCompletionPump(NULL), m_pPool(NULL)
+    {
+    }
+
+    inline CPoolTask::~CPoolTask()
+    {
+        if (m_doneEvent != 0)
+            ::CloseHandle(m_doneEvent);
+    }
+
+    // Prevents the task from running if it hasn't started. A running task
+    // can check IsCancelled to end early. Waiting threads are released when
+    // a queued task is cancelled, and OnComplete is called when the thread
+    // pool discards the task. Returns TRUE if the task hadn't started.
+    inline BOOL CPoolTask::Cancel()
+    {
+        InterlockedExchange(&m_isCancelled, 1);
+        if (InterlockedCompareExchange(&m_state, stateFinished, statePending) == statePending)
+        {
+            SetDone();
+            return TRUE;
+        }
+
+        return FALSE;
+    }
+
+    // Marks the task as done and releases any waiting threads.
+    inline void CPoolTask::SetDone()
+    {
+        InterlockedExchange(&m_isDone, 1);
+        HANDLE event = m_doneEvent;
+        if (event != 0)
+            ::SetEvent(event);
+    }
+
+    // Waits for the task to finish running, or to be cancelled. For a task
+    // submitted with a completion message pump, this doesn't wait for
+    // OnComplete, which is called later on the pump's thread. The pump's
+    // thread can therefore wait for the task. When called by a worker thread
+    // of the task's pool, a task which is still queued is run on the calling
+    // thread, whatever the timeout. A task running on another worker is
+    // waited for.
+    // Returns TRUE if the task is done, or FALSE if the wait timed out.
+    inline BOOL CPoolTask::Wait(DWORD milliseconds /* = INFINITE */)
+    {
+        if (IsDone())
+            return TRUE;
+
+        // A worker waiting for a queued task runs it, as the other workers
+        // may also be waiting.
+        int current = (m_pPool != NULL) ? m_pPool->GetCurrentWorker() : -1;
+        if (current >= 0)
+        {
+            PoolTaskPtr task;
+            int queue = m_pPool->TakeTask(this, task);
+            if (queue >= 0)
+                m_pPool->RunTask(*m_pPool->m_workers[current], task, queue != current);
+
+            if (IsDone())
+                return TRUE;
+        }
+
+        // Create the event on first use, as most tasks are never waited for.
+        if (m_doneEvent == 0)
+        {
+            HANDLE event = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+            if (event == 0)
+                throw CResourceException(GetApp()->MsgMtxEvent());
+
+            if (InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(&m_doneEvent), event, 0) != 0)
+                ::CloseHandle(event);
+        }
+
+        // The task may have finished before the event was available.
+        if (IsDone())
+            return TRUE;
+
+        return (::WaitForSingleObject(m_doneEvent, milliseconds) == WAIT_OBJECT_0);
+    }
+
+
+    ////////////////////////////////////////////
+    // Definitions for the CPoolCompletion class
+    //
+
+    inline void CPoolCompletion::operator()() const
+    {
+        try
+        {
+            m_task->OnComplete();
+        }
+
+        catch (...)
+        {
+            m_pending->Remove();    // Cleanup
+            throw;                  // Rethrow
+        }
+
+        m_pending->Remove();
+    }
+
+
+    /////////////////////////////////////////
+    // Definitions for the CPoolPending class
+    //
+
+    // Adds a task to the count.
+    inline void CPoolPending::Add()
+    {
+        if (InterlockedIncrement(&m_count) == 1)
+        {
+            CThreadLock lock(m_lock);
+            if (m_count != 0)
+                m_allDoneEvent.ResetEvent();
+        }
+    }
+
+    // Removes a task from the count. The all done event is set when the
+    // count reaches zero.
+    inline void CPoolPending::Remove()
+    {
+        if (InterlockedDecrement(&m_count) == 0)
+        {
+            CThreadLock lock(m_lock);
+            if (m_count == 0)
+                m_allDoneEvent.SetEvent();
+        }
+    }
+
+
+    ////////////////////////////////////////
+    // Definitions for the CThreadPool class
+    //
+
+    inline CThreadPool::CThreadPool() : m_workSemaphore(0, LONG_MAX, NULL, NULL), m_pPending(new CPoolPending),
+                                        m_sleeping(0), m_isStopping(0), m_nextWorker(0), m_submitted(0)
+    {
+    }
+
+    inline CThreadPool::~CThreadPool()
+    {
+        Stop();
+    }
+
+    // Cancels all the queued tasks. Tasks which are running aren't affected.
+    inline void CThreadPool::CancelAll()
+    {
+        for (size_t i = 0; i < m_workers.size(); ++i)
+        {
+            CThreadLock lock(m_workers[i]->lock);
+            std::deque<PoolTaskPtr>::iterator it;
+            for (it = m_workers[i]->tasks.begin(); it != m_workers[i]->tasks.end(); ++it)
+                (*it)->Cancel();
+        }
+    }
+
+    // Called when a task has run, or when a cancelled task is removed from a queue.
+    inline void CThreadPool::FinishTask(Worker& worker, const PoolTaskPtr& task, bool hasRun)
+    {
+        if (hasRun)
+            ++worker.run;
+        else
+            ++worker.cancelled;
+
+        // Call OnComplete on the completion thread, or on this thread. A task
+        // with a completion thread is done before OnComplete is called, so the
+        // completion thread can wait for it. Other tasks are done after
+        // OnComplete returns. The task remains pending until OnComplete returns.
+        if (task->m_pCompletionPump)
+        {
+            task->SetDone();
+            task->m_pCompletionPump->PostThreadTask(CPoolCompletion(task, m_pPending));
+        }
+        else
+        {
+            try
+            {
+                task->OnComplete();
+            }
+
+            catch (...)
+            {
+                TRACE("*** Warning *** A thread pool task's OnComplete threw an exception\n");
+            }
+
+            task->SetDone();
+            m_pPending->Remove();
+        }
+    }
+
+    // Returns the index of the worker running on this thread, or -1.
+    inline int CThreadPool::GetCurrentWorker() const
+    {
+        DWORD threadID = ::GetCurrentThreadId();
+        for (size_t i = 0; i < m_workers.size(); ++i)
+        {
+            if (m_workers[i]->threadID == threadID)
+                return static_cast<int>(i);
+        }
+
+        return -1;
+    }
+
+    // Returns the number of processors available to this process.
+    inline int CThreadPool::GetProcessorCount()
+    {
+        SYSTEM_INFO info;
+        ZeroMemory(&info, sizeof(info));
+        ::GetSystemInfo(&info);
+        return MAX(1, static_cast<int>(info.dwNumberOfProcessors));
+    }
+
+    // Retrieves the counters of tasks submitted, run, stolen and cancelled.
+    // The counters of running workers are approximate.
+    inline ThreadPoolStats CThreadPool::GetStats() const
+    {
+        ThreadPoolStats stats;
+        stats.submitted = m_submitted;
+        for (size_t i = 0; i < m_workers.size(); ++i)
+        {
+            stats.run += m_workers[i]->run;
+            stats.stolen += m_workers[i]->stolen;
+            stats.cancelled += m_workers[i]->cancelled;
+        }
+
+        return stats;
+    }
+
+    // Takes the most recently queued task from the worker's own queue.
+    inline bool CThreadPool::PopTask(Worker& worker, PoolTaskPtr& task)
+    {
+        CThreadLock lock(worker.lock);
+        if (worker.tasks.empty())
+            return false;
+
+        task = worker.tasks.back();
+        worker.tasks.pop_back();
+        return true;
+    }
+
+    // Runs a task taken from a queue on the worker's thread, unless it was
+    // cancelled, and then finishes it.
+    inline void CThreadPool::RunTask(Worker& worker, const PoolTaskPtr& task, bool isStolen)
+    {
+        bool hasRun = false;
+        if (InterlockedCompareExchange(&task->m_state, CPoolTask::stateRunning,
+                                       CPoolTask::statePending) == CPoolTask::statePending)
+        {
+            if (isStolen)
+                ++worker.stolen;
+
+            try
+            {
+                task->Run();
+            }
+
+            catch (...)
+            {
+                TRACE("*** Warning *** A thread pool task threw an exception\n");
+            }
+
+            InterlockedExchange(&task->m_state, CPoolTask::stateFinished);
+            hasRun = true;
+        }
+
+        FinishTask(worker, task, hasRun);
+    }
+
+    // Runs tasks on the worker thread until the pool is stopped.
+    inline void CThreadPool::RunWorker(Worker& worker)
+    {
+        size_t index = 0;
+        while (m_workers[index].get() != &worker)
+            ++index;
+
+        for (;;)
+        {
+            PoolTaskPtr task;
+            bool isStolen = false;
+            if (!PopTask(worker, task))
+            {
+                isStolen = StealTask(index, task);
+                if (!isStolen)
+                {
+                    // Check the queues again after announcing that this worker
+                    // is going to sleep, so a task submitted meanwhile isn't missed.
+                    InterlockedIncrement(&m_sleeping);
+                    bool isFound = PopTask(worker, task) || (isStolen = StealTask(index, task));
+                    if (!isFound)
+                    {
+                        if (m_isStopping)
+                        {
+                            UnregisterSleep();
+                            return;
+                        }
+
+                        // The thread which releases the semaphore has already
+                        // removed this worker from the sleeping count.
+                        ::WaitForSingleObject(m_workSemaphore, INFINITE);
+                        continue;
+                    }
+
+                    UnregisterSleep();
+                }
+            }
+
+            RunTask(worker, task, isStolen);
+        }
+    }
+
+    // Starts the worker threads. The number of threads defaults to the number
+    // of processors. Has no effect if the pool is already running.
+    inline void CThreadPool::Start(int threads /* = 0 */)
+    {
+        if (IsRunning())
+            return;
+
+        if (threads <= 0)
+            threads = GetProcessorCount();
+
+        m_isStopping = 0;
+        for (int i = 0; i < threads; ++i)
+        {
+            WorkerPtr pWorker(new Worker);
+            pWorker->pPool = this;
+            pWorker->pThread = Shared_Ptr<CWorkThread>(new CWorkThread(StaticThreadProc, pWorker.get()));
+            m_workers.push_back(pWorker);
+        }
+
+        // Start the threads once all the workers exist, as they steal from each other.
+        for (size_t w = 0; w < m_workers.size(); ++w)
+        {
+            m_workers[w]->pThread->CreateThread(CREATE_SUSPENDED);
+            m_workers[w]->threadID = static_cast<DWORD>(m_workers[w]->pThread->GetThreadID());
+            m_workers[w]->pThread->ResumeThread();
+        }
+    }
+
+    // A worker thread's callback function.
+    inline UINT WINAPI CThreadPool::StaticThreadProc(LPVOID pWorker)
+    {
+        Worker* pThisWorker = static_cast<Worker*>(pWorker);
+        pThisWorker->pPool->RunWorker(*pThisWorker);
+        return 0;
+    }
+
+    // Takes the oldest queued task from the queue of another worker.
+    inline bool CThreadPool::StealTask(size_t thief, PoolTaskPtr& task)
+    {
+        size_t count = m_workers.size();
+        for (size_t i = 1; i <= count; ++i)
+        {
+            Worker& victim = *m_workers[(thief + i) % count];
+            if (&victim == m_workers[thief].get())
+                continue;
+
+            CThreadLock lock(victim.lock);
+            if (!victim.tasks.empty())
+            {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Cancels the queued tasks, waits for the running tasks to finish, and
+    // ends the worker threads. The OnComplete of tasks with a completion
+    // message pump may be called after Stop returns.
+    inline void CThreadPool::Stop()
+    {
+        if (!IsRunning())
+            return;
+
+        CancelAll();
+
+        // The workers end when they find their queues and the queues of the
+        // other workers empty, so the cancelled tasks are finished first.
+        InterlockedExchange(&m_isStopping, 1);
+        LONG sleeping = InterlockedExchange(&m_sleeping, 0);
+        if (sleeping > 0)
+            m_workSemaphore.ReleaseSemaphore(sleeping);
+
+        for (size_t i = 0; i < m_workers.size(); ++i)
+            ::WaitForSingleObject(*m_workers[i]->pThread, INFINITE);
+
+        m_workers.clear();
+    }
+
+    // Queues a task to be run by one of the worker threads. Tasks submitted by
+    // a worker thread are queued on that worker. Other tasks are spread across
+    // the workers. OnComplete is called on the thread of the completion message
+    // pump if one is specified. Returns the task, which can be used to wait for
+    // it or cancel it.
+    inline PoolTaskPtr CThreadPool::Submit(const PoolTaskPtr& task, CMessagePump* pCompletionPump /* = NULL */)
+    {
+        assert(task.get() != NULL);
+        assert(IsRunning());    // Call Start before submitting tasks.
+        assert(task->m_state == CPoolTask::statePending);
+        task->m_pCompletionPump = pCompletionPump;
+        task->m_pPool = this;
+        m_pPending->Add();
+        InterlockedIncrement(&m_submitted);
+        int current = GetCurrentWorker();
+        size_t index = (current >= 0) ? static_cast<size_t>(current) :
+            static_cast<size_t>(static_cast<ULONG>(InterlockedIncrement(&m_nextWorker))) % m_workers.size();
+
+        {
+            CThreadLock lock(m_workers[index]->lock);
+            m_workers[index]->tasks.push_back(task);
+        }
+
+        WakeWorker();
+        return task;
+    }
+
+    // Removes the specified task from the queue it is in, so a worker waiting
+    // for it can run it. Returns the index of the worker whose queue held the
+    // task, or -1 if the task isn't queued.
+    inline int CThreadPool::TakeTask(const CPoolTask* pTask, PoolTaskPtr& task)
+    {
+        for (size_t i = 0; i < m_workers.size(); ++i)
+        {
+            CThreadLock lock(m_workers[i]->lock);
+            std::deque<PoolTaskPtr>& tasks = m_workers[i]->tasks;
+            std::deque<PoolTaskPtr>::iterator it;
+            for (it = tasks.begin(); it != tasks.end(); ++it)
+            {
+                if (it->get() == pTask)
+                {
+                    task = *it;
+                    tasks.erase(it);
+                    return static_cast<int>(i);
+                }
+            }
+        }
+
+        return -1;
+    }
+
+    // Called by a worker which added itself to the sleeping count, but found a
+    // task or is stopping. Removes the worker from the count. If another
+    // thread has already removed it, the semaphore was released for this
+    // worker, so the release is consumed.
+    inline void CThreadPool::UnregisterSleep()
+    {
+        LONG sleeping = m_sleeping;
+        while (sleeping > 0)
+        {
+            LONG previous = InterlockedCompareExchange(&m_sleeping, sleeping - 1, sleeping);
+            if (previous == sleeping)
+                return;
+
+            sleeping = previous;
+        }
+
+        ::WaitForSingleObject(m_workSemaphore, INFINITE);
+    }
+
+    // Waits until all the submitted tasks have finished or have been cancelled,
+    // and their OnComplete has returned. Don't call this from a worker thread,
+    // or from the thread of a completion message pump with tasks outstanding,
+    // as their OnComplete can't be called while this thread waits.
+    inline void CThreadPool::WaitAll()
+    {
+        assert(GetCurrentWorker() < 0);
+        ::WaitForSingleObject(m_pPending->GetAllDoneEvent(), INFINITE);
+    }
+
+    // Wakes a sleeping worker, if there is one. The worker is removed from
+    // the sleeping count before the semaphore is released, so the semaphore
+    // is only released once for each sleeping worker.
+    inline void CThreadPool::WakeWorker()
+    {
+        LONG sleeping = m_sleeping;
+        while (sleeping > 0)
+        {
+            LONG previous = InterlockedCompareExchange(&m_sleeping, sleeping - 1, sleeping);
+            if (previous == sleeping)
+            {
+                m_workSemaphore.ReleaseSemaphore(1);
+                return;
+            }
+
+            sleeping = previous;
+        }
+    }
+
+}
+
+
+#endif // _WIN32XX_THREADPOOL_H_
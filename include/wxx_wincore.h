@@ -107,12 +107,14 @@ namespace Win32xx
     // Definitions for the CWnd class
     //
 
-    inline CWnd::CWnd() : m_wnd(0), m_prevWindowProc(NULL)
+    inline CWnd::CWnd() : m_wnd(0), m_prevWindowProc(NULL), m_mappedWnd(0),
+                          m_isPreTranslateEnabled(TRUE)
     {
         // Note: m_wnd is set in CWnd::CreateEx(...)
     }
 
-    inline CWnd::CWnd(HWND wnd) : m_prevWindowProc(NULL)
+    inline CWnd::CWnd(HWND wnd) : m_prevWindowProc(NULL), m_mappedWnd(0),
+                                  m_isPreTranslateEnabled(TRUE)
     {
         // A private constructor, used internally.
 
@@ -143,9 +145,17 @@ namespace Win32xx
         // Remove any old map entry for this CWnd (required when the CWnd is reused).
         RemoveFromMap();
 
-        // Add the (HWND, CWnd*) pair to the map
-        CThreadLock mapLock(GetApp()->m_wndLock);
-        GetApp()->m_mapHWND.insert(std::make_pair(GetHwnd(), this));
+        // Add the (HWND, CWnd*) pair to the map and this thread's window cache.
+        CWinApp* pApp = GetApp();
+        CThreadLock mapLock(pApp->m_wndLock);
+        if (pApp->m_mapHWND.Insert(GetHwnd(), this))
+        {
+            m_mappedWnd = GetHwnd();
+            pApp->AddToWndCache(GetHwnd(), this);
+
+            // Invalidate the pre-translate chain of every thread.
+            InterlockedIncrement(&pApp->m_wndChainGeneration);
+        }
     }
 
     // Attaches a CWnd object to an existing window and calls the OnAttach virtual function.
@@ -487,6 +497,19 @@ namespace Win32xx
         // dx.DDX_Check(IDC_CHECK_C,        m_checkC);
     }
 
+    // Specifies whether PreTranslateMessage is called for this window's input
+    // messages, and those of its child windows. Windows which don't override
+    // PreTranslateMessage can disable it, so the message loop skips them.
+    inline void CWnd::EnablePreTranslate(BOOL enable /* = TRUE */)
+    {
+        m_isPreTranslateEnabled = enable;
+
+        // Invalidate the pre-translate chain of every thread.
+        CWinApp* pApp = CWinApp::SetnGetThis();
+        if (pApp != NULL)
+            InterlockedIncrement(&pApp->m_wndChainGeneration);
+    }
+
     // Pass messages on to the appropriate default window procedure
     // CMDIChild and CMDIFrame override this function.
     inline LRESULT CWnd::FinalWindowProc(UINT msg, WPARAM wparam, LPARAM lparam)
@@ -882,23 +905,24 @@ namespace Win32xx
     {
         BOOL success = FALSE;
 
-        // Allocate an iterator for our HWND map
-        std::map<HWND, CWnd*, CompareHWND>::iterator m;
-
         CWinApp* pApp = CWinApp::SetnGetThis();
-        if (pApp != NULL)          // Is the CWinApp object still valid?
+        if (pApp != NULL && m_mappedWnd != 0)   // Is the CWinApp object still valid?
         {
             // Erase the CWnd pointer entry from the map.
+            // m_mappedWnd is the key this CWnd was added with, which
+            // can differ from m_wnd when the CWnd is reused.
             CThreadLock mapLock(pApp->m_wndLock);
-            for (m = pApp->m_mapHWND.begin(); m != pApp->m_mapHWND.end(); ++m)
+            if (pApp->m_mapHWND.Find(m_mappedWnd) == this)
             {
-                if (this == m->second)
-                {
-                    pApp->m_mapHWND.erase(m);
-                    success = TRUE;
-                    break;
-                }
+                pApp->m_mapHWND.Erase(m_mappedWnd);
+
+                // Invalidate the window cache and pre-translate chain of every thread.
+                InterlockedIncrement(&pApp->m_wndMapGeneration);
+                InterlockedIncrement(&pApp->m_wndChainGeneration);
+                success = TRUE;
             }
+
+            m_mappedWnd = 0;
         }
 
         return success;
@@ -1161,6 +1185,16 @@ namespace Win32xx
                 return reinterpret_cast<LRESULT>(this);
             }
 
+        case UWM_RUNTHREADTASKS:
+            {
+                // Run the tasks other threads posted to this thread's message pump.
+                TLSData* pTLSData = GetApp()->GetTlsData();
+                if (pTLSData && pTLSData->pMessagePump)
+                    pTLSData->pMessagePump->ProcessThreadTasks();
+
+                return 0;
+            }
+
         } // switch (msg)
 
         // Now hand all messages to the default procedure.
@@ -1922,7 +1956,11 @@ namespace Win32xx
     inline HWND CWnd::SetParent(HWND parent) const
     {
         assert(IsWindow());
-        return ::SetParent(*this, parent);
+        HWND oldParent = ::SetParent(*this, parent);
+
+        // Invalidate the pre-translate chain of every thread.
+        InterlockedIncrement(&GetApp()->m_wndChainGeneration);
+        return oldParent;
     }
 
     // This function allows changes in that window to be redrawn or prevents changes
@@ -1958,7 +1996,13 @@ namespace Win32xx
     inline LONG_PTR CWnd::SetWindowLongPtr(int index, LONG_PTR newLong) const
     {
         assert(IsWindow());
-        return ::SetWindowLongPtr(*this, index, newLong);
+        LONG_PTR oldLong = ::SetWindowLongPtr(*this, index, newLong);
+
+        // Changing the owner invalidates the pre-translate chain of every thread.
+        if (index == GWLP_HWNDPARENT)
+            InterlockedIncrement(&GetApp()->m_wndChainGeneration);
+
+        return oldLong;
     }
 
     // The SetWindowPos function changes the size, position, and Z order of a child, pop-up,
@@ -2438,7 +2482,7 @@ namespace Win32xx
             str2.FormatV(str1.c_str(), args);
             va_end(args);
 
-            m_str.append(str2);
+            m_str.append(str2.m_str);
         }
     }
 
@@ -76,6 +76,7 @@
 #define UWM_TBRESIZE          (WM_APP + 0x3F16) // Message - sent by toolbar to parent. Used by the rebar.
 #define UWM_TBWINPOSCHANGING  (WM_APP + 0x3F17) // Message - sent to parent. Toolbar is resizing.
 #define UWM_UPDATECOMMAND     (WM_APP + 0x3F18) // Message - sent before a menu is displayed. Used by OnMenuUpdate.
+#define UWM_RUNTHREADTASKS    (WM_APP + 0x3F19) // Message - posted to wake a thread to run the tasks other threads posted to it.
 
 #define UWN_BARSTART          (WM_APP + 0x3F20) // Notification - sent by CDocker when the docker bar selected for move.
 #define UWN_BARMOVE           (WM_APP + 0x3F21) // Notification - sent by CDocker when the docker bar is moved.
@@ -151,6 +152,8 @@ namespace Win32xx
         // Accessors
         HWND GetHwnd() const                { return m_wnd; }
         WNDPROC GetPrevWindowProc() const   { return m_prevWindowProc; }
+        BOOL IsPreTranslateEnabled() const  { return m_isPreTranslateEnabled; }
+        void EnablePreTranslate(BOOL enable = TRUE);
 
         // Wrappers for Win32 API functions.
         // These functions aren't virtual, and shouldn't be overridden.
@@ -338,6 +341,8 @@ namespace Win32xx
 
         HWND m_wnd;                    // handle to this object's window
         WNDPROC m_prevWindowProc;
+        HWND m_mappedWnd;              // the handle used as this object's key in the HWND map
+        BOOL m_isPreTranslateEnabled;  // FALSE if PreTranslateMessage isn't called for this window
     }; // class CWnd
 
 } // namespace Win32xx
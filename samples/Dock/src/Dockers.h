@@ -63,5 +63,21 @@ private:
 };
 
 
+///////////////////////////////////////////////////////////
+// CDockProbe is the undocked docker used by the drag
+// benchmark. It performs the lookup a docker makes to find
+// the dock target under the cursor while it is dragged.
+class CDockProbe : public CDockSimple
+{
+public:
+    CDockProbe() {}
+    virtual ~CDockProbe() {}
+
+    void EndDrag()      { ClearDragTargets(); }
+    CDocker* FindDockUnderPoint(POINT pt) { return GetDockUnderDragPoint(pt); }
+    void StartDrag()    { SnapshotDragTargets(); }
+};
+
+
 #endif // DOCKABLES_H
 
@@ -20,6 +20,21 @@ BOOL CDockingApp::InitInstance()
     //Create the Window
     m_MainFrame.Create();   // throws a CWinException on failure
 
+    // Run the dock drag, dock layout and layout load benchmarks instead if the
+    // /benchmark command line argument is specified.
+    std::vector<CString> args = GetCommandLineArgs();
+    if (std::find(args.begin(), args.end(), CString(_T("/benchmark"))) != args.end())
+    {
+        CString report = m_MainFrame.RunDragBenchmark();
+        report += _T("\n");
+        report += m_MainFrame.RunLayoutBenchmark();
+        report += _T("\n");
+        report += m_MainFrame.RunLoadBenchmark();
+        ::MessageBox(NULL, report, _T("Dock Benchmark"), MB_OK);
+        m_MainFrame.Destroy();
+        return FALSE;
+    }
+
     return TRUE;
 }
 
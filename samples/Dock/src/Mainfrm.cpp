@@ -7,6 +7,97 @@
 #include "resource.h"
 
 
+///////////////////////////////////////////////////////
+// The dock target lookup CDocker performed before it
+// took a snapshot of the dock targets. It is used as the
+// baseline for the drag benchmark.
+//
+struct LegacyLookup
+{
+    CDocker* pDockDrag;
+    POINT pt;
+    HWND dockUnderPoint;
+};
+
+// Finds the top level docker under the point.
+static BOOL CALLBACK LegacyEnumWindowsProc(HWND top, LPARAM lparam)
+{
+    LegacyLookup* pLookup = reinterpret_cast<LegacyLookup*>(lparam);
+    HWND ancestor = pLookup->pDockDrag->GetDockAncestor()->GetHwnd();
+    if (::IsChild(top, ancestor))
+        top = ancestor;
+
+    if (pLookup->pDockDrag->IsRelated(top) && top != pLookup->pDockDrag->GetHwnd())
+    {
+        CRect rc;
+        VERIFY(::GetWindowRect(top, &rc));
+        if (rc.PtInRect(pLookup->pt))
+        {
+            pLookup->dockUnderPoint = top;
+            return FALSE;   // Stop enumerating.
+        }
+    }
+
+    return TRUE;    // Continue enumerating.
+}
+
+// Returns the docker whose view window contains the point.
+static CDocker* LegacyDockUnderDragPoint(CDocker* pDockDrag, POINT pt)
+{
+    LegacyLookup lookup = { pDockDrag, pt, 0 };
+    ::EnumWindows(LegacyEnumWindowsProc, reinterpret_cast<LPARAM>(&lookup));
+    if (lookup.dockUnderPoint == 0)
+        return NULL;
+
+    HWND dockTest = lookup.dockUnderPoint;
+    HWND dockParent = lookup.dockUnderPoint;
+    while (pDockDrag->IsRelated(dockTest))
+    {
+        dockParent = dockTest;
+        CPoint ptLocal = pt;
+        VERIFY(::ScreenToClient(dockParent, &ptLocal));
+        dockTest = ::ChildWindowFromPoint(dockParent, ptLocal);
+        if (dockTest == dockParent) break;
+    }
+
+    CDocker* pDockParent = reinterpret_cast<CDocker*>(::SendMessage(dockParent, UWM_GETCDOCKER, 0, 0));
+    if (pDockParent && pDockParent->GetDockClient().GetWindowRect().PtInRect(pt))
+        return pDockParent;
+
+    return NULL;
+}
+
+// Positions every docker, DockClient and dock bar and recalculates their
+// frames, as RecalcDockLayout did before it moved only the windows whose
+// position changed. It is used as the baseline for the layout benchmark.
+static void LegacyApplyDockLayout(const std::vector<DockLayoutNode>& nodes)
+{
+    for (size_t n = 0; n < nodes.size(); ++n)
+    {
+        const DockLayoutNode& node = nodes[n];
+        HDWP hdwp = ::BeginDeferWindowPos(node.childCount + 1);
+        for (int i = node.firstChild; i < node.firstChild + node.childCount; ++i)
+        {
+            if (nodes[i].isDocked)
+                hdwp = nodes[i].pDocker->DeferWindowPos(hdwp, 0, nodes[i].childRect, SWP_SHOWWINDOW|SWP_FRAMECHANGED);
+        }
+
+        CWnd& client = node.pDocker->GetDockClient();
+        if (client.IsWindow())
+            hdwp = client.DeferWindowPos(hdwp, 0, node.clientRect, SWP_SHOWWINDOW|SWP_FRAMECHANGED);
+
+        VERIFY(::EndDeferWindowPos(hdwp));
+
+        if (node.isDocked)
+        {
+            CRect barRect;
+            barRect.IntersectRect(node.barRect, node.pDocker->GetDockParent()->GetViewRect());
+            VERIFY(node.pDocker->GetDockBar().SetWindowPos(0, barRect, SWP_SHOWWINDOW|SWP_FRAMECHANGED|SWP_NOCOPYBITS));
+        }
+    }
+}
+
+
 //////////////////////////////////
 // CMainFrame function definitions
 //
@@ -41,6 +132,21 @@ HWND CMainFrame::Create(HWND parent)
     return CDockFrame::Create(parent);
 }
 
+// Docks the specified number of dockers for the drag benchmark. Each
+// docker has up to four dockers docked in it, one on each side.
+void CMainFrame::AddBenchmarkDockers(int count)
+{
+    const DWORD sides[] = { DS_DOCKED_LEFT, DS_DOCKED_TOP, DS_DOCKED_RIGHT, DS_DOCKED_BOTTOM };
+    std::vector<CDocker*> dockers;
+    dockers.push_back(this);
+
+    for (int i = 0; i < count; ++i)
+    {
+        CDocker* pDockParent = dockers[i / 4];
+        dockers.push_back(pDockParent->AddDockedChild(new CDockSimple, sides[i % 4] | DS_CLIENTEDGE, 40, ID_DOCK_BENCHMARK + i));
+    }
+}
+
 // Loads a default configuration of dockers.
 void CMainFrame::LoadDefaultDockers()
 {
@@ -91,7 +197,10 @@ CDocker* CMainFrame::NewDockerFromID(int id)
         pDock = new CDockText;
         break;
     default:
-        TRACE("Unknown Dock ID\n");
+        if (id >= ID_DOCK_BENCHMARK)
+            pDock = new CDockSimple;
+        else
+            TRACE("Unknown Dock ID\n");
         break;
     }
 
@@ -122,6 +231,10 @@ BOOL CMainFrame::OnCommand(WPARAM wparam, LPARAM)
     case IDM_NO_DOCK_LR:        return OnNoDockLR();
     case IDM_NO_DOCK_CLOSE:     return OnNoDockClose();
     case IDM_DYNAMIC_RESIZE:    return OnDynamicResize();
+    case IDM_LAYOUT_SAVE1:      return OnLayoutSave(_T("Layout 1"));
+    case IDM_LAYOUT_SAVE2:      return OnLayoutSave(_T("Layout 2"));
+    case IDM_LAYOUT_LOAD1:      return OnLayoutLoad(_T("Layout 1"));
+    case IDM_LAYOUT_LOAD2:      return OnLayoutLoad(_T("Layout 2"));
     case IDW_VIEW_STATUSBAR:    return OnViewStatusBar();
     case IDW_VIEW_TOOLBAR:      return OnViewToolBar();
     case IDM_HELP_ABOUT:        return OnHelp();
@@ -188,6 +301,26 @@ BOOL CMainFrame::OnFileExit()
     return TRUE;
 }
 
+// Restores the dock layout saved with the specified preset name.
+BOOL CMainFrame::OnLayoutLoad(LPCTSTR presetName)
+{
+    if (LoadDockLayoutPreset(GetRegistryKeyName(), presetName))
+        SetDockStyles();
+    else
+        MessageBox(_T("This layout hasn't been saved yet."), presetName, MB_ICONINFORMATION);
+
+    return TRUE;
+}
+
+// Saves the dock layout with the specified preset name.
+BOOL CMainFrame::OnLayoutSave(LPCTSTR presetName)
+{
+    if (!SaveDockLayoutPreset(GetRegistryKeyName(), presetName))
+        MessageBox(_T("Failed to save the layout."), presetName, MB_ICONWARNING);
+
+    return TRUE;
+}
+
 // Called after the window is created.
 void CMainFrame::OnInitialUpdate()
 {
@@ -286,6 +419,212 @@ void CMainFrame::PreCreate(CREATESTRUCT& cs)
     cs.style &= ~WS_VISIBLE;
 }
 
+// Measures the time a dragged docker takes to find the dock target under
+// the cursor, for an increasing number of dockers. The snapshot of dock
+// targets CDocker takes when a drag starts is compared with the window
+// enumeration it replaced.
+CString CMainFrame::RunDragBenchmark()
+{
+    const int dockerCounts[] = { 8, 25, 50, 100, 200 };
+    const int moves = 1000;
+
+    // Each drag move looks up the dock target once to send the move
+    // notification, and once more for each of the five dock targets.
+    const int lookupsPerMove = 6;
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    CRect frameRect = GetWindowRect();
+
+    CString report;
+    report.Format(_T("Microseconds per drag move, %d moves\n\n"), moves);
+    report += _T("Dockers\tEnumWindows\tSnapshot\tMismatches\n");
+
+    for (size_t c = 0; c < sizeof(dockerCounts) / sizeof(dockerCounts[0]); ++c)
+    {
+        CloseAllDockers();
+        AddBenchmarkDockers(dockerCounts[c]);
+
+        // The probe is the docker being dragged.
+        CDockProbe* pProbe = static_cast<CDockProbe*>(AddUndockedChild(new CDockProbe,
+            DS_CLIENTEDGE, 100, CRect(0, 0, 100, 100)));
+
+        // Both lookups use the same pseudo random points over the frame.
+        std::vector<CPoint> points(moves);
+        UINT seed = 12345;
+        for (int i = 0; i < moves; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            points[i].x = frameRect.left + static_cast<int>((seed >> 8) % frameRect.Width());
+            seed = seed * 1103515245 + 12345;
+            points[i].y = frameRect.top + static_cast<int>((seed >> 8) % frameRect.Height());
+        }
+
+        std::vector<CDocker*> legacyTargets(moves);
+        LARGE_INTEGER start;
+        QueryPerformanceCounter(&start);
+        for (int i = 0; i < moves; ++i)
+        {
+            for (int j = 0; j < lookupsPerMove; ++j)
+                legacyTargets[i] = LegacyDockUnderDragPoint(pProbe, points[i]);
+        }
+
+        LARGE_INTEGER middle;
+        QueryPerformanceCounter(&middle);
+        int mismatches = 0;
+        pProbe->StartDrag();
+        for (int i = 0; i < moves; ++i)
+        {
+            CDocker* pDockTarget = NULL;
+            for (int j = 0; j < lookupsPerMove; ++j)
+                pDockTarget = pProbe->FindDockUnderPoint(points[i]);
+
+            if (pDockTarget != legacyTargets[i])
+                ++mismatches;
+        }
+        pProbe->EndDrag();
+
+        LARGE_INTEGER end;
+        QueryPerformanceCounter(&end);
+
+        double legacyTime = double(middle.QuadPart - start.QuadPart) * 1.0e6 / double(frequency.QuadPart) / moves;
+        double snapshotTime = double(end.QuadPart - middle.QuadPart) * 1.0e6 / double(frequency.QuadPart) / moves;
+        CString line;
+        line.Format(_T("%d\t%.1f\t\t%.2f\t\t%d\n"), dockerCounts[c], legacyTime, snapshotTime, mismatches);
+        report += line;
+    }
+
+    CloseAllDockers();
+    return report;
+}
+
+// Measures the time taken to lay out 100 docked dockers. The geometry pass
+// is timed on its own. A layout that repositions every window is compared
+// with RecalcDockLayout when no docker has moved, and when a splitter bar
+// moves.
+CString CMainFrame::RunLayoutBenchmark()
+{
+    const int dockerCount = 100;
+    const int layouts = 200;
+
+    CloseAllDockers();
+    AddBenchmarkDockers(dockerCount);
+    RecalcDockLayout();
+
+    std::vector<DockLayoutNode> nodes;
+    GetDockLayoutNodes(nodes);
+    CRect viewRect = GetViewRect();
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER times[5];
+
+    QueryPerformanceCounter(&times[0]);
+    for (int i = 0; i < layouts; ++i)
+        CalcDockLayout(nodes, viewRect);
+
+    QueryPerformanceCounter(&times[1]);
+    for (int i = 0; i < layouts; ++i)
+    {
+        CalcDockLayout(nodes, viewRect);
+        LegacyApplyDockLayout(nodes);
+        UpdateWindow();
+    }
+
+    QueryPerformanceCounter(&times[2]);
+    for (int i = 0; i < layouts; ++i)
+        RecalcDockLayout();
+
+    // Move the splitter bar of the first dock child back and forth.
+    QueryPerformanceCounter(&times[3]);
+    CDocker* pDocker = GetDockChildren().front();
+    int dockSize = pDocker->GetDockSize();
+    for (int i = 0; i < layouts; ++i)
+        pDocker->SetDockSize(dockSize + (i % 2) * 10);
+
+    QueryPerformanceCounter(&times[4]);
+
+    LPCTSTR names[] = { _T("Geometry pass"), _T("Reposition all"), _T("No change"), _T("Splitter move") };
+    CString report;
+    report.Format(_T("Microseconds per layout, %d dockers, %d layouts\n\n"), dockerCount, layouts);
+    for (int t = 0; t < 4; ++t)
+    {
+        double elapsed = double(times[t + 1].QuadPart - times[t].QuadPart) * 1.0e6 / double(frequency.QuadPart) / layouts;
+        CString line;
+        line.Format(_T("%s\t%.1f\n"), names[t], elapsed);
+        report += line;
+    }
+
+    CloseAllDockers();
+    return report;
+}
+
+// Measures the time taken to restore 100 docked dockers. Adding the dockers
+// one at a time is compared with loading a binary dock layout, which adds
+// them with a single layout pass. Switching between two saved layouts is
+// also timed.
+CString CMainFrame::RunLoadBenchmark()
+{
+    const int dockerCount = 100;
+    const int loads = 20;
+
+    // Save the benchmark dockers and the default dockers as two layouts.
+    std::vector<BYTE> layouts[2];
+    CloseAllDockers();
+    AddBenchmarkDockers(dockerCount);
+    CArchive benchmarkArchive(layouts[0], CArchive::store);
+    SaveDockLayout(benchmarkArchive);
+
+    CloseAllDockers();
+    LoadDefaultDockers();
+    CArchive defaultArchive(layouts[1], CArchive::store);
+    SaveDockLayout(defaultArchive);
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER times[4];
+
+    QueryPerformanceCounter(&times[0]);
+    for (int i = 0; i < loads; ++i)
+    {
+        SetRedraw(FALSE);
+        CloseAllDockers();
+        AddBenchmarkDockers(dockerCount);
+        SetRedraw(TRUE);
+        RedrawWindow(RDW_INVALIDATE|RDW_UPDATENOW|RDW_ERASE|RDW_ALLCHILDREN);
+    }
+
+    QueryPerformanceCounter(&times[1]);
+    for (int i = 0; i < loads; ++i)
+    {
+        CArchive ar(layouts[0], CArchive::load);
+        LoadDockLayout(ar);
+    }
+
+    QueryPerformanceCounter(&times[2]);
+    for (int i = 0; i < loads; ++i)
+    {
+        CArchive ar(layouts[i % 2], CArchive::load);
+        LoadDockLayout(ar);
+    }
+
+    QueryPerformanceCounter(&times[3]);
+
+    LPCTSTR names[] = { _T("Add each docker"), _T("Load layout"), _T("Switch layouts") };
+    CString report;
+    report.Format(_T("Milliseconds per restore, %d dockers, %d restores\n\n"), dockerCount, loads);
+    for (int t = 0; t < 3; ++t)
+    {
+        double elapsed = double(times[t + 1].QuadPart - times[t].QuadPart) * 1.0e3 / double(frequency.QuadPart) / loads;
+        CString line;
+        line.Format(_T("%s\t%.2f\n"), names[t], elapsed);
+        report += line;
+    }
+
+    CloseAllDockers();
+    return report;
+}
+
 // Save the docking configuration in the registry.
 BOOL CMainFrame::SaveRegistrySettings()
 {
@@ -18,6 +18,9 @@ const int ID_DOCK_SIMPLE2 = 6;
 const int ID_DOCK_TEXT1 = 7;
 const int ID_DOCK_TEXT2 = 8;
 
+// The first dock ID of the dockers added by the benchmarks
+const int ID_DOCK_BENCHMARK = 100;
+
 
 ///////////////////////////////////////////////////////////
 // CMainFrame manages the application's main window.
@@ -29,6 +32,9 @@ public:
     CMainFrame();
     virtual ~CMainFrame();
     virtual HWND Create(HWND parent = 0);
+    CString RunDragBenchmark();
+    CString RunLayoutBenchmark();
+    CString RunLoadBenchmark();
 
 protected:
     // Virtual functions overriding base class functions
@@ -49,12 +55,15 @@ private:
     BOOL OnDockDefault();
     BOOL OnDynamicResize();
     BOOL OnFileExit();
+    BOOL OnLayoutLoad(LPCTSTR presetName);
+    BOOL OnLayoutSave(LPCTSTR presetName);
     BOOL OnPropResize();
     BOOL OnNoUndocking();
     BOOL OnNoResize();
     BOOL OnNoDockLR();
     BOOL OnNoDockClose();
 
+    void AddBenchmarkDockers(int count);
     void LoadDefaultDockers();
     void SetDockStyles();
 
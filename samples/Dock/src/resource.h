@@ -48,6 +48,10 @@
 #define IDM_DYNAMIC_RESIZE              166
 #define IDM_DOCK_DEFAULT                167
 #define IDM_DOCK_CLOSEALL               168
+#define IDM_LAYOUT_SAVE1                169
+#define IDM_LAYOUT_SAVE2                170
+#define IDM_LAYOUT_LOAD1                171
+#define IDM_LAYOUT_LOAD2                172
 
 // Next default values for new objects
 //
@@ -24,6 +24,7 @@
 #endif
 
 // Rarely modified header files should be included here
+#include <algorithm>            // Add support for std::find
 #include <vector>               // Add support for std::vector
 #include <map>                  // Add support for std::map
 #include <string>               // Add support for std::string
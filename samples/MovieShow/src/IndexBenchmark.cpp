@@ -0,0 +1,245 @@
+/////////////////////////////
+// IndexBenchmark.cpp
+//
+
+#include "stdafx.h"
+#include "IndexBenchmark.h"
+#include "MovieIndex.h"
+
+namespace
+{
+    const LPCTSTR words[] = { L"alien", L"battle", L"city", L"dark", L"empire",
+        L"fire", L"ghost", L"heart", L"island", L"journey", L"king", L"legend",
+        L"moon", L"night", L"ocean", L"planet", L"queen", L"river", L"storm",
+        L"time", L"universe", L"valley", L"war", L"winter", L"year", L"zero" };
+
+    const LPCTSTR names[] = { L"Adams", L"Brown", L"Clark", L"Davis", L"Evans",
+        L"Foster", L"Garcia", L"Harris", L"Irwin", L"Jones", L"Kelly", L"Lopez",
+        L"Miller", L"Nolan", L"Owens", L"Parker", L"Quinn", L"Reed", L"Smith",
+        L"Taylor", L"Usher", L"Vance", L"Walker", L"Young" };
+
+    const LPCTSTR genres[] = { L"Action", L"Adventure", L"Animation", L"Comedy",
+        L"Crime", L"Documentary", L"Drama", L"Family", L"Fantasy", L"History",
+        L"Horror", L"Music", L"Romance", L"Science Fiction", L"Thriller",
+        L"War", L"Western" };
+
+    const int wordCount  = sizeof(words) / sizeof(words[0]);
+    const int nameCount  = sizeof(names) / sizeof(names[0]);
+    const int genreCount = sizeof(genres) / sizeof(genres[0]);
+
+    // The number of times each query is repeated.
+    const int repeats = 20;
+
+    // A simple repeatable random number generator.
+    class CRandom
+    {
+    public:
+        CRandom() : m_seed(12345) {}
+        UINT Next(UINT range)
+        {
+            m_seed = m_seed * 1103515245 + 12345;
+            return (m_seed >> 16) % range;
+        }
+
+    private:
+        UINT m_seed;
+    };
+
+    // Returns the time in milliseconds since the start count.
+    double GetElapsedMS(const LARGE_INTEGER& start)
+    {
+        LARGE_INTEGER end;
+        LARGE_INTEGER frequency;
+        ::QueryPerformanceCounter(&end);
+        ::QueryPerformanceFrequency(&frequency);
+        return 1000.0 * static_cast<double>(end.QuadPart - start.QuadPart) / static_cast<double>(frequency.QuadPart);
+    }
+
+    // Fills the library with movies built from the lists of words.
+    void FillLibrary(MoviesData& library, UINT titles)
+    {
+        CRandom random;
+        for (UINT i = 0; i < titles; ++i)
+        {
+            MovieInfo mi;
+            mi.fileName.Format(L"C:\\Movies\\Movie%u.mp4", i);
+            mi.movieName.Format(L"%s %s %u", words[random.Next(wordCount)], words[random.Next(wordCount)], i);
+            mi.releaseDate.Format(L"%u-01-01", 1920 + random.Next(105));
+            mi.videoType = (random.Next(10) == 0) ? L"Live Performances" : L"Movies";
+            mi.genre.Format(L"%s, %s", genres[random.Next(genreCount)], genres[random.Next(genreCount)]);
+
+            for (int actor = 0; actor < 4; ++actor)
+            {
+                CString name;
+                name.Format(L"%s%u %s, ", names[random.Next(nameCount)], random.Next(500), names[random.Next(nameCount)]);
+                mi.actors += name;
+            }
+
+            for (int word = 0; word < 30; ++word)
+            {
+                mi.description += words[random.Next(wordCount)];
+                mi.description += L' ';
+            }
+
+            if (random.Next(20) == 0)
+                mi.boxset.Format(L"Box Set %u", random.Next(100));
+
+            library.push_back(mi);
+        }
+    }
+
+    // Adds a line to the report comparing the index time with the linear search time.
+    void Report(CString& report, LPCTSTR query, double indexMS, double linearMS, size_t found)
+    {
+        CString line;
+        line.Format(L"%-16s %10.3f ms %10.3f ms %8.0fx %8u\n", query, indexMS / repeats,
+            linearMS / repeats, linearMS / MAX(indexMS, 0.001), static_cast<UINT>(found));
+        report += line;
+    }
+}
+
+// Measures the query latency of CMovieIndex against a linear search
+// of a synthetic library with the specified number of titles.
+CString RunIndexBenchmark(UINT titles)
+{
+    MoviesData library;
+    FillLibrary(library, titles);
+
+    CString report;
+    report.Format(L"Movie index benchmark, %u titles\n\n", titles);
+
+    LARGE_INTEGER start;
+    ::QueryPerformanceCounter(&start);
+    CMovieIndex index;
+    MoviesData::const_iterator it;
+    for (it = library.begin(); it != library.end(); ++it)
+        index.Add(*it);
+
+    CString line;
+    line.Format(L"Index built in %.1f ms\n\n", GetElapsedMS(start));
+    report += line;
+    report += L"Query            Index            Linear             Speedup    Found\n";
+
+    MovieResults results;
+    double indexMS;
+
+    // Title word.
+    ::QueryPerformanceCounter(&start);
+    for (int i = 0; i < repeats; ++i)
+    {
+        results.clear();
+        index.FindWord(CMovieIndex::title, words[i % wordCount], results);
+    }
+    indexMS = GetElapsedMS(start);
+
+    ::QueryPerformanceCounter(&start);
+    for (int i = 0; i < repeats; ++i)
+    {
+        results.clear();
+        for (it = library.begin(); it != library.end(); ++it)
+            if (CMovieIndex::IsWordInString((*it).movieName, words[i % wordCount]))
+                results.push_back(&(*it));
+    }
+    Report(report, L"Title word", indexMS, GetElapsedMS(start), results.size());
+
+    // Actor word.
+    ::QueryPerformanceCounter(&start);
+    for (int i = 0; i < repeats; ++i)
+    {
+        results.clear();
+        index.FindWord(CMovieIndex::actors, names[i % nameCount], results);
+    }
+    indexMS = GetElapsedMS(start);
+
+    ::QueryPerformanceCounter(&start);
+    for (int i = 0; i < repeats; ++i)
+    {
+        results.clear();
+        for (it = library.begin(); it != library.end(); ++it)
+            if (CMovieIndex::IsWordInString((*it).actors, names[i % nameCount]))
+                results.push_back(&(*it));
+    }
+    Report(report, L"Actor word", indexMS, GetElapsedMS(start), results.size());
+
+    // Description word.
+    ::QueryPerformanceCounter(&start);
+    for (int i = 0; i < repeats; ++i)
+    {
+        results.clear();
+        index.FindWord(CMovieIndex::description, words[i % wordCount], results);
+    }
+    indexMS = GetElapsedMS(start);
+
+    ::QueryPerformanceCounter(&start);
+    for (int i = 0; i < repeats; ++i)
+    {
+        results.clear();
+        for (it = library.begin(); it != library.end(); ++it)
+            if (CMovieIndex::IsWordInString((*it).description, words[i % wordCount]))
+                results.push_back(&(*it));
+    }
+    Report(report, L"Description word", indexMS, GetElapsedMS(start), results.size());
+
+    // Genre.
+    ::QueryPerformanceCounter(&start);
+    for (int i = 0; i < repeats; ++i)
+    {
+        results.clear();
+        index.FindGenre(genres[i % genreCount], results);
+    }
+    indexMS = GetElapsedMS(start);
+
+    ::QueryPerformanceCounter(&start);
+    for (int i = 0; i < repeats; ++i)
+    {
+        results.clear();
+        for (it = library.begin(); it != library.end(); ++it)
+            if (((*it).genre.Find(genres[i % genreCount], 0) >= 0) && (*it).videoType == L"Movies")
+                results.push_back(&(*it));
+    }
+    Report(report, L"Genre", indexMS, GetElapsedMS(start), results.size());
+
+    // Decade.
+    ::QueryPerformanceCounter(&start);
+    for (int i = 0; i < repeats; ++i)
+    {
+        results.clear();
+        index.FindDateRange(L"1980", L"1989", results);
+    }
+    indexMS = GetElapsedMS(start);
+
+    ::QueryPerformanceCounter(&start);
+    for (int i = 0; i < repeats; ++i)
+    {
+        results.clear();
+        for (it = library.begin(); it != library.end(); ++it)
+        {
+            CString year = (*it).releaseDate.Left(4);
+            if (year >= L"1980" && year <= L"1989" && (*it).videoType == L"Movies")
+                results.push_back(&(*it));
+        }
+    }
+    Report(report, L"Decade", indexMS, GetElapsedMS(start), results.size());
+
+    // Box set.
+    ::QueryPerformanceCounter(&start);
+    for (int i = 0; i < repeats; ++i)
+    {
+        results.clear();
+        index.FindBoxSet(L"Box Set 42", results);
+    }
+    indexMS = GetElapsedMS(start);
+
+    ::QueryPerformanceCounter(&start);
+    for (int i = 0; i < repeats; ++i)
+    {
+        results.clear();
+        for (it = library.begin(); it != library.end(); ++it)
+            if ((*it).boxset == L"Box Set 42")
+                results.push_back(&(*it));
+    }
+    Report(report, L"Box set", indexMS, GetElapsedMS(start), results.size());
+
+    report += L"\nTimes are per query.";
+    return report;
+}
@@ -0,0 +1,13 @@
+/////////////////////////////
+// IndexBenchmark.h
+//
+
+#ifndef _INDEXBENCHMARK_H_
+#define _INDEXBENCHMARK_H_
+
+// Measures the query latency of CMovieIndex against a linear search
+// of a synthetic library with the specified number of titles.
+// Returns a report of the results.
+CString RunIndexBenchmark(UINT titles);
+
+#endif // _INDEXBENCHMARK_H_
@@ -25,37 +25,31 @@ CViewList::~CViewList()
     if (IsWindow()) DeleteAllItems();
 }
 
-// Adds an item to the list view.
+// Adds an item to the list view if it isn't already in the list view.
 void CViewList::AddItem(const MovieInfo& mi)
 {
-    bool isFound = false;
-    for (int i = 0; i < GetItemCount(); i++)
-        if (GetItemData(i) == (DWORD_PTR)&mi)
-            isFound = true;
+    // Search for the item with the list view's own search, as this is much
+    // faster than sending a message for each item.
+    LVFINDINFO findInfo;
+    ZeroMemory(&findInfo, sizeof(findInfo));
+    findInfo.flags = LVFI_PARAM;
+    findInfo.lParam = reinterpret_cast<LPARAM>(&mi);
+    bool isFound = (FindItem(findInfo) != -1);
 
     if (!isFound)
-    {
-        int nImage = 0;
-        if (mi.videoType == L"Live Performances")
-            nImage = 1;
-        if (!mi.boxset.IsEmpty())
-            nImage = 2;
-        if (mi.flags & 0x0001)
-            nImage = 3;
-        if (mi.flags & 0x0002)
-            nImage = 4;
-        int item = GetItemCount();
+        InsertMovie(mi);
+}
 
-        UINT mask = LVIF_TEXT | LVIF_IMAGE | LVIF_PARAM;
-        LPTSTR text = const_cast<LPTSTR>(mi.movieName.c_str());
-        LPARAM lparam = reinterpret_cast<LPARAM>(&mi);
-        InsertItem(mask, item, text, 0, 0, nImage, lparam);
+// Adds the movies to the list view in a single pass. The movies must
+// not already be in the list view.
+void CViewList::AddItems(const std::vector<const MovieInfo*>& movies)
+{
+    // Allocate memory for all the items before adding them.
+    SetItemCount(GetItemCount() + static_cast<int>(movies.size()));
 
-        SetItemText(item, 1, mi.releaseDate);
-        SetItemText(item, 2, mi.genre);
-        SetItemText(item, 3, mi.fileName);
-        SetItemText(item, 4, GetFileTime(mi.lastModifiedTime));
-    }
+    std::vector<const MovieInfo*>::const_iterator it;
+    for (it = movies.begin(); it != movies.end(); ++it)
+        InsertMovie(**it);
 }
 
 // Compares lp1 and lp2. Used for sorting.
@@ -153,6 +147,31 @@ CString CViewList::GetFileTime(FILETIME fileTime)
     return str;
 }
 
+// Inserts an item for the movie at the end of the list view.
+void CViewList::InsertMovie(const MovieInfo& mi)
+{
+    int nImage = 0;
+    if (mi.videoType == L"Live Performances")
+        nImage = 1;
+    if (!mi.boxset.IsEmpty())
+        nImage = 2;
+    if (mi.flags & 0x0001)
+        nImage = 3;
+    if (mi.flags & 0x0002)
+        nImage = 4;
+    int item = GetItemCount();
+
+    UINT mask = LVIF_TEXT | LVIF_IMAGE | LVIF_PARAM;
+    LPTSTR text = const_cast<LPTSTR>(mi.movieName.c_str());
+    LPARAM lparam = reinterpret_cast<LPARAM>(&mi);
+    InsertItem(mask, item, text, 0, 0, nImage, lparam);
+
+    SetItemText(item, 1, mi.releaseDate);
+    SetItemText(item, 2, mi.genre);
+    SetItemText(item, 3, mi.fileName);
+    SetItemText(item, 4, GetFileTime(mi.lastModifiedTime));
+}
+
 // Called when the listview window is attached to CViewList during Create.
 void CViewList::OnAttach()
 {
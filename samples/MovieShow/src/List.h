@@ -33,6 +33,7 @@ public:
     virtual ~CViewList();
 
     void    AddItem(const MovieInfo& mi);
+    void    AddItems(const std::vector<const MovieInfo*>& movies);
     void    SetLastColumnWidth();
     void    SortColumn(int column, bool isSortDown);
     void    UpdateItemImage(int item);
@@ -58,6 +59,7 @@ private:
     LRESULT OnRClick();
 
     CString GetFileTime(FILETIME fileTime);
+    void    InsertMovie(const MovieInfo& mi);
     void    SetColumn();
     BOOL    SetHeaderSortImage(int  columnIndex, int showArrow);
 
@@ -32,6 +32,11 @@
 using namespace MediaInfoDLL;
 using namespace Gdiplus;
 
+// The number of movies the load thread passes to the main thread at a time.
+// The first chunk is small so the list view displays some movies quickly.
+const UINT FIRST_LOAD_CHUNK = 64;
+const UINT LOAD_CHUNK = 512;
+
 ///////////////////////////////
 // Global function declarations
 //
@@ -77,9 +82,10 @@ int GetEncoderClsid(const WCHAR* format, CLSID* pClsid)
 //
 
 // Constructor.
-CMainFrame::CMainFrame() : m_thread(ThreadProc, this), m_searchItem(0), m_pDockTree(0),
-                           m_pDockDialog(0), m_isDirty(false), m_boxSetsItem(0),
-                           m_dialogWidth(0), m_treeHeight(0)
+CMainFrame::CMainFrame() : m_thread(ThreadProc, this), m_loadThread(LoadThreadProc, this),
+                           m_searchItem(0), m_pDockTree(0), m_pDockDialog(0),
+                           m_stopLoadRequest(FALSE, TRUE), m_isDirty(false), m_isLoading(false),
+                           m_isLoadFailed(false), m_boxSetsItem(0), m_dialogWidth(0), m_treeHeight(0)
 {
 }
 
@@ -198,81 +204,44 @@ void CMainFrame::FillImageData(const CString& source, std::vector<BYTE>& dest)
 // Fills the list view with all movies.
 void CMainFrame::FillList()
 {
-    GetViewList().SetRedraw(FALSE);
-    m_splashThread.GetSplash()->ShowText(L"Updating List", this);
-    ClearList();
-
     // Lock this function for thread safety
     CThreadLock lock(m_cs);
 
+    MovieResults results;
     std::list<MovieInfo>::const_iterator iter;
     for (iter = m_moviesData.begin(); iter != m_moviesData.end(); ++iter)
     {
-        GetViewList().AddItem(*iter);
+        results.push_back(&(*iter));
     }
 
-    m_splashThread.GetSplash()->Hide();
-    GetViewList().SetRedraw(TRUE);
-    GetViewList().SetLastColumnWidth();
-    if (GetViewList().GetItemCount() == 0)
-        ClearDisplay();
+    FillListFromResults(results);
 }
 
 // Fills the list view with movies belonging to all boxsets.
 void CMainFrame::FillListFromAllBoxSets()
 {
-    GetViewList().SetRedraw(FALSE);
-    m_splashThread.GetSplash()->ShowText(L"Updating List", this);
-    ClearList();
-
     // Lock this function for thread safety
     CThreadLock lock(m_cs);
 
-    std::list<MovieInfo>::const_iterator iter;
-    for (iter = m_moviesData.begin(); iter != m_moviesData.end(); ++iter)
-    {
-        if ((*iter).boxset != L"")
-            GetViewList().AddItem(*iter);
-    }
-
-    m_splashThread.GetSplash()->Hide();
-    GetViewList().SetRedraw(TRUE);
-    GetViewList().SetLastColumnWidth();
-    if (GetViewList().GetItemCount() == 0)
-        ClearDisplay();
+    MovieResults results;
+    m_index.FindAllBoxSets(results);
+    FillListFromResults(results);
 }
 
 // Fills the list view with movies belonging to the specified boxset.
 void CMainFrame::FillListFromBoxSet(LPCTSTR boxset)
 {
-    GetViewList().SetRedraw(FALSE);
-    m_splashThread.GetSplash()->ShowText(L"Updating List", this);
-    ClearList();
-
     // Lock this function for thread safety
     CThreadLock lock(m_cs);
 
-    std::list<MovieInfo>::const_iterator iter;
-    for (iter = m_moviesData.begin(); iter != m_moviesData.end(); ++iter)
-    {
-        if ((*iter).boxset == boxset)
-            GetViewList().AddItem(*iter);
-    }
-
-    m_splashThread.GetSplash()->Hide();
-    GetViewList().SetRedraw(TRUE);
-    GetViewList().SetLastColumnWidth();
-    if (GetViewList().GetItemCount() == 0)
-        ClearDisplay();
+    MovieResults results;
+    m_index.FindBoxSet(boxset, results);
+    FillListFromResults(results);
 }
 
 // Fills the list view with movies within the specified date range.
 void CMainFrame::FillListFromDateRange(LPCTSTR dateRange)
 {
-    GetViewList().SetRedraw(FALSE);
-    m_splashThread.GetSplash()->ShowText(L"Updating List", this);
-    ClearList();
-
     // Lock this function for thread safety
     CThreadLock lock(m_cs);
 
@@ -280,80 +249,71 @@ void CMainFrame::FillListFromDateRange(LPCTSTR dateRange)
     CString Year1 = str.Left(4);
     CString Year2 = str.Right(4);
 
-    std::list<MovieInfo>::const_iterator iter;
-    for (iter = m_moviesData.begin(); iter != m_moviesData.end(); ++iter)
-    {
-        CString year = (*iter).releaseDate.Left(4);
-        if (((year >= Year1) && (year <= Year2)) && (*iter).videoType == L"Movies")
-            GetViewList().AddItem(*iter);
-    }
-
-    m_splashThread.GetSplash()->Hide();
-    GetViewList().SetRedraw(TRUE);
-    GetViewList().SetLastColumnWidth();
-    if (GetViewList().GetItemCount() == 0)
-        ClearDisplay();
+    MovieResults results;
+    m_index.FindDateRange(Year1, Year2, results);
+    FillListFromResults(results);
 }
 
 // Fills the list view with movies matching the specified mask.
 void CMainFrame::FillListFromFlags(DWORD mask)
 {
-    GetViewList().SetRedraw(FALSE);
-    m_splashThread.GetSplash()->ShowText(L"Updating List", this);
-    ClearList();
-
     // Lock this function for thread safety
     CThreadLock lock(m_cs);
 
+    // The flags change often, so they aren't indexed.
+    MovieResults results;
     std::list<MovieInfo>::const_iterator iter;
     for (iter = m_moviesData.begin(); iter != m_moviesData.end(); ++iter)
     {
         if ((*iter).flags & mask)
-            GetViewList().AddItem(*iter);
-    }
-
-    m_splashThread.GetSplash()->Hide();
-    GetViewList().SetRedraw(TRUE);
-    GetViewList().SetLastColumnWidth();
-    if (GetViewList().GetItemCount() == 0)
-        ClearDisplay();
-}
-
-// Fills the list view with movies matching the specified genre.
-void CMainFrame::FillListFromGenre(LPCTSTR genre)
-{
-    // Lock this function for thread safety
-    CThreadLock lock(m_cs);
-
-    std::list<MovieInfo>::const_iterator iter;
-    for (iter = m_moviesData.begin(); iter != m_moviesData.end(); ++iter)
-    {
-        if (((*iter).genre.Find(genre, 0) >= 0) && (*iter).videoType == L"Movies")
-            GetViewList().AddItem(*iter);
+            results.push_back(&(*iter));
     }
 
-    GetViewList().SetLastColumnWidth();
+    FillListFromResults(results);
 }
 
 // Fills the list view with movies from all genres.
 void CMainFrame::FillListFromGenres(LPCTSTR genreList)
 {
-    GetViewList().SetRedraw(FALSE);
-    m_splashThread.GetSplash()->ShowText(L"Updating List", this);
-    ClearList();
+    // Lock this function for thread safety
+    CThreadLock lock(m_cs);
 
     CString str = genreList;
     CString resToken;
     int curPos = 0;
+    MovieResults results;
 
     resToken = str.Tokenize(L",", curPos);
     while (resToken != L"")
     {
         resToken.TrimLeft();
-        FillListFromGenre(resToken);
+        m_index.FindGenre(resToken, results);
         resToken = str.Tokenize(L",", curPos);
     }
 
+    FillListFromResults(results);
+}
+
+// Fills the list view with the movies found. Movies found more than once
+// are added once, in the order they were first found.
+void CMainFrame::FillListFromResults(MovieResults& results)
+{
+    std::set<const MovieInfo*> added;
+    MovieResults::iterator last = results.begin();
+    for (MovieResults::iterator it = results.begin(); it != results.end(); ++it)
+    {
+        if (added.insert(*it).second)
+            *last++ = *it;
+    }
+
+    results.erase(last, results.end());
+
+    GetViewList().SetRedraw(FALSE);
+    m_splashThread.GetSplash()->ShowText(L"Updating List", this);
+    ClearList();
+
+    GetViewList().AddItems(results);
+
     m_splashThread.GetSplash()->Hide();
     GetViewList().SetRedraw(TRUE);
     GetViewList().SetLastColumnWidth();
@@ -364,52 +324,29 @@ void CMainFrame::FillListFromGenres(LPCTSTR genreList)
 // Fill the listview with movies found while searching.
 void CMainFrame::FillListFromSearch()
 {
-    GetViewList().SetRedraw(FALSE);
-    m_splashThread.GetSplash()->ShowText(L"Updating List", this);
-    ClearList();
+    // Lock this function for thread safety
+    CThreadLock lock(m_cs);
 
+    // Skip the movies removed from the library since the search.
+    MovieResults results;
     for (UINT i = 0; i < m_foundMovies.size(); ++i)
     {
-        MoviesData::iterator it;
-        for (it = m_moviesData.begin(); it != m_moviesData.end(); ++it)
-        {
-            if (&(*it) == m_foundMovies[i])
-            {
-                GetViewList().AddItem(*it);
-                break;
-            }
-        }
+        if (m_index.Contains(m_foundMovies[i]))
+            results.push_back(m_foundMovies[i]);
     }
 
-    m_splashThread.GetSplash()->Hide();
-    GetViewList().SetRedraw(TRUE);
-    GetViewList().SetLastColumnWidth();
-    if (GetViewList().GetItemCount() == 0)
-        ClearDisplay();
+    FillListFromResults(results);
 }
 
 // Fills the list view with movies matching the specified type.
 void CMainFrame::FillListFromType(LPCTSTR videoType)
 {
-    GetViewList().SetRedraw(FALSE);
-    m_splashThread.GetSplash()->ShowText(L"Updating List", this);
-    ClearList();
-
     // Lock this function for thread safety
     CThreadLock lock(m_cs);
 
-    std::list<MovieInfo>::const_iterator iter;
-    for (iter = m_moviesData.begin(); iter != m_moviesData.end(); ++iter)
-    {
-        if ((*iter).videoType.Find(videoType, 0) >= 0)
-            GetViewList().AddItem(*iter);
-    }
-
-    m_splashThread.GetSplash()->Hide();
-    GetViewList().SetRedraw(TRUE);
-    GetViewList().SetLastColumnWidth();
-    if (GetViewList().GetItemCount() == 0)
-        ClearDisplay();
+    MovieResults results;
+    m_index.FindType(videoType, results);
+    FillListFromResults(results);
 }
 
 // Fills the tree view.
@@ -526,35 +463,6 @@ bool CMainFrame::IsVideoFile(const CString& filename) const
     return (ext == L"m4v" || ext == L"mp4" || ext == L"mov");
 }
 
-// Performs a case-insensitive search for a word in sentence.
-// Returns true if a matching word is found.
-bool CMainFrame::IsWordInString(const CString& sentence, const CString& word) const
-{
-    int pos = 0;
-    CString sentenceLow = sentence;
-    sentenceLow.MakeLower();
-
-    CString wordLow = word;
-    wordLow.MakeLower();
-
-    // find each substring in sentence that matches word
-    while ((pos = sentenceLow.Find(wordLow, pos)) >= 0)
-    {
-        // words are bound by non-isalpha characters or begin/end of word.
-        int nNextChar = pos + wordLow.GetLength();
-        bool isWordStart = (pos == 0) || !(iswalpha(sentenceLow[pos - 1]));
-        bool isWordEnd = (nNextChar == sentenceLow.GetLength()) || !(iswalpha(sentenceLow[nNextChar]));
-
-        // return true if the substring found is a word
-        if (isWordStart && isWordEnd)
-            return true;
-
-        pos++;
-    }
-
-    return false;
-}
-
 // Loads the meta data info from the specified movie file.
 // Stores the information in the specified MovieInfo struct.
 void CMainFrame::LoadMovieInfoFromFile(const FoundFileInfo& ffi, MovieInfo& movie)
@@ -582,12 +490,11 @@ void CMainFrame::LoadMovieInfoFromFile(const FoundFileInfo& ffi, MovieInfo& movi
     MI.Close();
 }
 
-// Loads the movie data information from the archive
+// Opens the library file, and starts the thread which loads the movies.
+// The box sets are loaded before this function returns. The movies are
+// added to the library by OnMoviesLoaded as they are loaded.
 void CMainFrame::LoadMovies()
 {
-    //Information about MediaInfo
-    MediaInfo MI;
-
     CString DataPath = GetDataPath();
     CString DataFile = GetDataPath() + L"\\" + L"MovieData.bin";
     SHCreateDirectoryEx(0, DataPath.c_str(), NULL);
@@ -596,68 +503,86 @@ void CMainFrame::LoadMovies()
     {
         try
         {
-            // Display the splash screen.
-            m_splashThread.GetSplash()->ShowText(L"Loading Library", this);
-
-            CArchive ar(DataFile, CArchive::load);
-            std::vector<MovieInfo>::iterator it;
+            TRACE("Loading Movies Data\n");
+            m_library.Open(DataFile);
 
             // Lock this code for thread safety
             CThreadLock lock(m_cs);
 
             m_moviesData.clear();
-            TRACE("Loading Movies Data\n");
+            m_loadedMovies.clear();
+            m_index.Clear();
+            const std::vector<CString>& boxSets = m_library.GetBoxSets();
+            m_boxSets.assign(boxSets.begin(), boxSets.end());
 
-            UINT nBoxSets;
-            ar >> nBoxSets;
-            for (UINT i = 0; i < nBoxSets; ++i)
-            {
-                CString str;
-                ar >> str;
-                m_boxSets.push_back(str);
-            }
-
-            UINT size;
-            ar >> size;
-            for (UINT i = 0; i < size; ++i)
-            {
-                MovieInfo mi;
-
-                ar >> mi.fileName;
-                ArchiveObject ao(&mi.lastModifiedTime, sizeof(FILETIME));
-                ar >> ao;
-                ar >> mi.movieName;
-                ar >> mi.duration;
-                ar >> mi.releaseDate;
-                ar >> mi.description;
-                ar >> mi.genre;
-                ar >> mi.actors;
-                ar >> mi.videoType;
-                ar >> mi.boxset;
-                ar >> mi.flags;
-
-                UINT ImageDataSize = 0;
-                ar >> ImageDataSize;
-                if (ImageDataSize > 0)
-                {
-                    mi.imageData.resize(ImageDataSize);
-                    ar.Read(&mi.imageData[0], ImageDataSize);
-                }
+            // Library files without an index are saved in the new format.
+            if (!m_library.IsIndexed())
+                m_isDirty = true;
 
-                m_moviesData.push_back(mi);
-            }
+            m_isLoading = true;
+            m_isLoadFailed = false;
+            m_stopLoadRequest.ResetEvent();
+            m_loadThread.CreateThread();
         }
         catch (const CFileException& e)
         {
-            m_splashThread.GetSplash()->Hide();
             Trace(e.GetErrorString()); Trace("\n");
             ::MessageBox(0, L"Failed to load Movie Library", L"Error", MB_OK);
+            m_library.Close();
             m_moviesData.clear();
             m_boxSets.clear();
         }
     }
+}
 
+// This function runs in a separate thread, and reads the movies from the
+// library file. The movies are passed to the main thread in chunks, so the
+// list view can display them before the whole library is loaded.
+UINT WINAPI CMainFrame::LoadThreadProc(void* pVoid)
+{
+    CMainFrame* pFrame = reinterpret_cast<CMainFrame*>(pVoid);
+    UINT chunkSize = FIRST_LOAD_CHUNK;
+
+    try
+    {
+        bool isMore = true;
+        while (isMore)
+        {
+            // The stop request is set if the app is closing.
+            if (::WaitForSingleObject(pFrame->m_stopLoadRequest, 0) != WAIT_TIMEOUT)
+                break;
+
+            MoviesData chunk;
+            for (UINT i = 0; isMore && i < chunkSize; ++i)
+            {
+                chunk.push_back(MovieInfo());
+                isMore = pFrame->m_library.ReadNext(chunk.back());
+                if (!isMore)
+                    chunk.pop_back();
+            }
+
+            if (!chunk.empty())
+            {
+                // Lock this code for thread safety
+                CThreadLock lock(pFrame->m_cs);
+                pFrame->m_loadedMovies.splice(pFrame->m_loadedMovies.end(), chunk);
+                pFrame->PostMessage(UWM_MOVIESLOADED, FALSE, 0);
+            }
+
+            chunkSize = LOAD_CHUNK;
+        }
+    }
+    catch (const CFileException& e)
+    {
+        Trace(e.GetErrorString()); Trace("\n");
+        pFrame->m_isLoadFailed = true;
+    }
+
+    pFrame->m_library.Close();
+    pFrame->PostMessage(UWM_MOVIESLOADED, TRUE, 0);
     TRACE("Load Movies data complete \n ");
+
+    return 0;
 }
 
 // Loads settings from the registry.
@@ -703,6 +628,25 @@ BOOL CMainFrame::LoadRegistrySettings(LPCTSTR szKeyName)
     return FALSE;
 }
 
+// Adds the movies loaded by the load thread to the library.
+// Returns an iterator to the first movie added.
+MoviesData::iterator CMainFrame::MoveLoadedMovies()
+{
+    // Lock this function for thread safety
+    CThreadLock lock(m_cs);
+
+    long count = static_cast<long>(m_loadedMovies.size());
+    m_moviesData.splice(m_moviesData.end(), m_loadedMovies);
+    MoviesData::iterator first = m_moviesData.end();
+    std::advance(first, -count);
+
+    MoviesData::const_iterator it;
+    for (it = first; it != m_moviesData.end(); ++it)
+        m_index.Add(*it);
+
+    return first;
+}
+
 // Called in response to the add box set from the context menu on the list view.
 BOOL CMainFrame::OnAddBoxSet()
 {
@@ -719,6 +663,10 @@ BOOL CMainFrame::OnAddBoxSet()
 // Called when the Add Folder toolbar button is pressed.
 BOOL CMainFrame::OnAddFolder()
 {
+    // The library must be loaded before it's updated.
+    if (m_isLoading)
+        return TRUE;
+
     if (::WaitForSingleObject(m_thread, 0) != WAIT_TIMEOUT) // if thread is not running
     {
         CFolderDialog fd;
@@ -740,6 +688,7 @@ BOOL CMainFrame::OnAddFolder()
                     if (!::PathFileExists((*it).fileName))
                     {
                         TRACE((*it).fileName); TRACE("  removed from library\n");
+                        m_index.Remove(*it);
                         it = m_moviesData.erase(it);
                     }
                     else
@@ -801,6 +750,10 @@ BOOL CMainFrame::OnBoxSet(UINT nID)
         MovieInfo* pmi = (MovieInfo*)GetViewList().GetItemData(item);
         pmi->boxset = (index < 0) ? CString("") : boxsets[index];
         GetViewList().UpdateItemImage(item);
+
+        // Lock this code for thread safety
+        CThreadLock lock(m_cs);
+        m_index.Update(*pmi);
     }
 
     HTREEITEM treeItem = GetViewTree().GetSelection();
@@ -815,18 +768,30 @@ BOOL CMainFrame::OnBoxSet(UINT nID)
     if (itemText == L"Box Sets")
         FillListFromAllBoxSets();
 
-    CString str;
-    int listItemsCount = GetViewList().GetItemCount();
-    if (listItemsCount == 1)
-        str.Format(L":  %d video", listItemsCount);
-    else
-        str.Format(L":  %d videos", listItemsCount);
-
-    str = itemText + str;
-    SetStatusText(str);
+    UpdateStatusText(itemText);
     return TRUE;
 }
 
+// Called when a box set is renamed in the tree view.
+// Renames the box set of the movies in the box set.
+LRESULT CMainFrame::OnBoxSetRenamed(const CString& oldName, const CString& newName)
+{
+    // Lock this function for thread safety
+    CThreadLock lock(m_cs);
+
+    MovieResults results;
+    m_index.FindBoxSet(oldName, results);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        MovieInfo* pmi = const_cast<MovieInfo*>(results[i]);
+        pmi->boxset = newName;
+        m_index.Update(*pmi);
+    }
+
+    m_isDirty = true;
+    return 0;
+}
+
 // Called when the frame application is closed (before the window is destroyed).
 // Stores the movie data in an archive if it has changed.
 void CMainFrame::OnClose()
@@ -836,6 +801,21 @@ void CMainFrame::OnClose()
     if (::WaitForSingleObject(m_thread, 1000) == WAIT_TIMEOUT)
         Trace("Splash Thread failed to end cleanly\n");
 
+    // Finish loading the library if it's to be saved, otherwise stop loading it.
+    if (m_isLoading)
+    {
+        if (!m_isDirty)
+            m_stopLoadRequest.SetEvent();
+
+        ::WaitForSingleObject(m_loadThread, INFINITE);
+        MoveLoadedMovies();
+        m_isLoading = false;
+
+        // Don't replace a library which couldn't be read.
+        if (m_isLoadFailed)
+            m_isDirty = false;
+    }
+
     ShowWindow(SW_HIDE);
 
     if (m_isDirty)
@@ -853,37 +833,7 @@ void CMainFrame::OnClose()
 
         try
         {
-            CArchive ar(DataFile, CArchive::store);
-            std::list<MovieInfo>::iterator it;
-
-            std::vector<CString> boxSets = GetBoxSets();
-            ar << UINT(boxSets.size());
-            for (size_t i = 0; i < boxSets.size(); ++i)
-            {
-                ar << boxSets[i];
-            }
-
-            ar << UINT(m_moviesData.size());
-            for (it = m_moviesData.begin(); it != m_moviesData.end(); ++it)
-            {
-                ar << (*it).fileName;
-                ArchiveObject ao(&(*it).lastModifiedTime, sizeof(FILETIME));
-                ar << ao;
-                ar << (*it).movieName;
-                ar << (*it).duration;
-                ar << (*it).releaseDate;
-                ar << (*it).description;
-                ar << (*it).genre;
-                ar << (*it).actors;
-                ar << (*it).videoType;
-                ar << (*it).boxset;
-                ar << (*it).flags;
-
-                UINT ImageDataSize = UINT((*it).imageData.size());
-                ar << ImageDataSize;
-                if (ImageDataSize > 0)
-                    ar.Write(&(*it).imageData[0], ImageDataSize);
-            }
+            CMovieLibrary::Save(DataFile, GetBoxSets(), m_moviesData);
             TRACE("\nSave Movies data complete \n ");
         }
 
@@ -1087,6 +1037,69 @@ BOOL CMainFrame::OnMoveUp()
     return TRUE;
 }
 
+// Called when the load thread has loaded a chunk of movies, or has finished.
+LRESULT CMainFrame::OnMoviesLoaded(WPARAM wparam, LPARAM)
+{
+    bool isComplete = (wparam != 0);
+    MoviesData::iterator first = MoveLoadedMovies();
+
+    if (isComplete)
+    {
+        ::WaitForSingleObject(m_loadThread, INFINITE);
+        m_isLoading = false;
+
+        if (m_isLoadFailed)
+        {
+            ::MessageBox(0, L"Failed to load Movie Library", L"Error", MB_OK);
+
+            {
+                // Lock this code for thread safety
+                CThreadLock lock(m_cs);
+                m_moviesData.clear();
+                m_index.Clear();
+                m_boxSets.clear();
+            }
+
+            ClearDisplay();
+            FillTreeItems();
+            return 0;
+        }
+    }
+
+    HTREEITEM item = GetViewTree().GetSelection();
+    CString itemText = GetViewTree().GetItemText(item);
+    if (itemText == L"Video Library")
+    {
+        GetViewList().SetRedraw(FALSE);
+
+        // Lock this code for thread safety
+        CThreadLock lock(m_cs);
+
+        MovieResults movies;
+        MoviesData::const_iterator it;
+        for (it = first; it != m_moviesData.end(); ++it)
+        {
+            movies.push_back(&(*it));
+        }
+
+        GetViewList().AddItems(movies);
+
+        if (isComplete)
+            GetViewList().SortColumn(0, false);
+
+        GetViewList().SetRedraw(TRUE);
+        GetViewList().SetLastColumnWidth();
+        UpdateStatusText(itemText);
+    }
+    else if (isComplete)
+    {
+        // Update the list view now the whole library is loaded.
+        OnSelectTreeItem();
+    }
+
+    return 0;
+}
+
 // Process notification messages (WM_NOTIFY) from child windows.
 LRESULT CMainFrame::OnNotify(WPARAM wparam, LPARAM lparam)
 {
@@ -1191,11 +1204,13 @@ BOOL CMainFrame::OnRemoveBoxSet()
     // Lock this function for thread safety
     CThreadLock lock(m_cs);
 
-    std::list<MovieInfo>::iterator it;
-    for (it = m_moviesData.begin(); it != m_moviesData.end(); ++it)
+    MovieResults results;
+    m_index.FindBoxSet(str, results);
+    for (size_t i = 0; i < results.size(); ++i)
     {
-        if ((*it).boxset == str)
-            (*it).boxset = L"";
+        MovieInfo* pmi = const_cast<MovieInfo*>(results[i]);
+        pmi->boxset = L"";
+        m_index.Update(*pmi);
     }
 
     GetViewTree().DeleteItem(item);
@@ -1227,6 +1242,7 @@ BOOL CMainFrame::OnRemoveFile()
             if ((*it).fileName == filenames[i])
             {
                 TRACE(filenames[i]); TRACE(" removed from library\n");
+                m_index.Remove(*it);
                 m_moviesData.erase(it);
                 m_isDirty = true;
                 break;
@@ -1262,21 +1278,12 @@ BOOL CMainFrame::OnSearch()
         // Lock this code for thread safety
         CThreadLock lock(m_cs);
 
-        std::list<MovieInfo>::const_iterator iter;
-
         // Find movies matching each title word.
         if (!dlg.GetTitleString().IsEmpty())
         {
             std::vector<CString> words = GetWords(dlg.GetTitleString());
-
             for (UINT i = 0; i < words.size(); ++i)
-            {
-                for (iter = m_moviesData.begin(); iter != m_moviesData.end(); ++iter)
-                {
-                    if (IsWordInString((*iter).movieName, words[i]))
-                        m_foundMovies.push_back(&(*iter));
-                }
-            }
+                m_index.FindWord(CMovieIndex::title, words[i], m_foundMovies);
         }
 
         // Find movies matching each actor word.
@@ -1284,13 +1291,7 @@ BOOL CMainFrame::OnSearch()
         {
             std::vector<CString> words = GetWords(dlg.GetActorsString());
             for (UINT i = 0; i < words.size(); ++i)
-            {
-                for (iter = m_moviesData.begin(); iter != m_moviesData.end(); ++iter)
-                {
-                    if (IsWordInString((*iter).actors, words[i]))
-                        m_foundMovies.push_back(&(*iter));
-                }
-            }
+                m_index.FindWord(CMovieIndex::actors, words[i], m_foundMovies);
         }
 
         // Find movies matching each description word.
@@ -1298,13 +1299,7 @@ BOOL CMainFrame::OnSearch()
         {
             std::vector<CString> words = GetWords(dlg.GetInfoString());
             for (UINT i = 0; i < words.size(); ++i)
-            {
-                for (iter = m_moviesData.begin(); iter != m_moviesData.end(); ++iter)
-                {
-                    if (IsWordInString((*iter).description, words[i]))
-                        m_foundMovies.push_back(&(*iter));
-                }
-            }
+                m_index.FindWord(CMovieIndex::description, words[i], m_foundMovies);
         }
 
         // Select the treeview search item to fill the listview
@@ -1406,16 +1401,7 @@ LRESULT CMainFrame::OnSelectTreeItem()
         ClearList();
 
     GetViewList().SortColumn(0, false);
-
-    CString str;
-    int listItemsCount = GetViewList().GetItemCount();
-    if (listItemsCount == 1)
-        str.Format(L":  %d video", listItemsCount);
-    else
-        str.Format(L":  %d videos", listItemsCount);
-
-    str = itemText + str;
-    SetStatusText(str);
+    UpdateStatusText(itemText);
 
     return 0;
 }
@@ -1443,6 +1429,10 @@ BOOL CMainFrame::OnVideoType(LPCTSTR videoType)
         MovieInfo* pmi = (MovieInfo*)GetViewList().GetItemData(item);
         pmi->videoType = videoType;
         GetViewList().UpdateItemImage(item);
+
+        // Lock this code for thread safety
+        CThreadLock lock(m_cs);
+        m_index.Update(*pmi);
     }
 
     return TRUE;
@@ -1603,7 +1593,8 @@ void CMainFrame::SetupToolBar()
 }
 
 // This function runs in a separate thread because loading the meta data from
-// files can be time consuming. This thread modifies m_moviesData, so all
+// files can be time consuming. The meta data is loaded by a thread pool, so
+// several files are loaded at once. This thread modifies m_moviesData, so all
 // access to m_moviesData should be protected by a CThreadLock.
 UINT WINAPI CMainFrame::ThreadProc(void* pVoid)
 {
@@ -1621,68 +1612,92 @@ UINT WINAPI CMainFrame::ThreadProc(void* pVoid)
 
         pFrame->GetToolBar().CheckButton(IDM_ADD_FOLDER, TRUE);
         splash->ShowText(L"Updating Library", pFrame);
-        splash->GetBar().ShowWindow(SW_SHOW);
-        splash->GetBar().SetRange(0, (short)pFrame->m_filesToAdd.size());
 
-        unsigned short barPos = 0;
-        for (size_t i = 0; i < pFrame->m_filesToAdd.size(); i++)
+        // Find the files to add to the library.
+        std::vector<const FoundFileInfo*> newFiles;
         {
-            // The stop request is set if the app is trying to close,
-            // or when the 'Add Folder' button toggled.
-            if (::WaitForSingleObject(pFrame->m_stopRequest, 0) != WAIT_TIMEOUT)
+            // Lock this code for thread safety
+            CThreadLock lock(pFrame->m_cs);
+
+            std::map<CString, MoviesData::iterator> library;
+            MoviesData::iterator it;
+            for (it = pFrame->m_moviesData.begin(); it != pFrame->m_moviesData.end(); ++it)
+                library[(*it).fileName] = it;
+
+            for (size_t i = 0; i < pFrame->m_filesToAdd.size(); i++)
             {
-                // Break out of the loop and end the thread.
-                break;
+                const FoundFileInfo& ffi = pFrame->m_filesToAdd[i];
+                std::map<CString, MoviesData::iterator>::iterator found = library.find(ffi.fileName);
+                if (found != library.end())
+                {
+                    CTime t1(ffi.lastModifiedTime);
+                    CTime t2((*found->second).lastModifiedTime);
+                    if (t1 == t2)
+                        continue;   // Only add files not already in the library
+
+                    // remove the modified file from the library
+                    TRACE(ffi.fileName); TRACE(" removed modified file from library\n");
+                    pFrame->m_index.Remove(*found->second);
+                    pFrame->m_moviesData.erase(found->second);
+                    library.erase(found);
+                }
+
+                newFiles.push_back(&ffi);
             }
+        }
 
-            barPos++;
+        // Load the meta data from the new files using a thread for each processor.
+        // The thread pool is declared after newMovies, so it stops before
+        // newMovies is destroyed.
+        MoviesData newMovies;
+        std::vector<PoolTaskPtr> tasks;
+        CThreadPool pool;
+        pool.Start();
+        for (size_t i = 0; i < newFiles.size(); i++)
+        {
+            newMovies.push_back(MovieInfo());
+            tasks.push_back(pool.Submit(CLoadMovieInfo(*newFiles[i], newMovies.back())));
+        }
 
-            // Update the splash screen's progress bar
-            splash->GetBar().SetPos(barPos);
+        splash->GetBar().ShowWindow(SW_SHOW);
+        splash->GetBar().SetRange(0, (short)tasks.size());
 
-            CString fullName = pFrame->m_filesToAdd[i].fileName;
-            bool isFileInLibrary = false;
-            std::list<MovieInfo>::iterator it = pFrame->m_moviesData.begin();
-            while (it != pFrame->m_moviesData.end())
+        // Add the movies to the library in the order the files were found.
+        MoviesData::iterator movie = newMovies.begin();
+        bool isStopped = false;
+        for (size_t i = 0; i < tasks.size() && !isStopped; i++)
+        {
+            while (!tasks[i]->Wait(100))
             {
-                if ((*it).fileName == fullName)
+                // The stop request is set if the app is trying to close,
+                // or when the 'Add Folder' button toggled.
+                if (::WaitForSingleObject(pFrame->m_stopRequest, 0) != WAIT_TIMEOUT)
                 {
-                    CFileFind ff;
-                    ff.FindFirstFile(fullName);
-                    CTime t1(ff.GetLastWriteTime());
-                    CTime t2((*it).lastModifiedTime);
-                    if (t1 != t2)
-                    {
-                        // Lock this code for thread safety
-                        CThreadLock lock(pFrame->m_cs);
-
-                        // remove the modified file from the library
-                        TRACE(fullName); TRACE(" removed modified file from library\n");
-                        pFrame->m_moviesData.erase(it);
-                    }
-                    else
-                        isFileInLibrary = true;
-
-                    // No need to check further
+                    // Cancel the remaining files and end the thread.
+                    pool.CancelAll();
+                    isStopped = true;
                     break;
                 }
-
-                ++it;
             }
 
-            // Only add files not already in the library
-            if (!isFileInLibrary)
-            {
-                pFrame->m_isDirty = true;
-                MovieInfo mi;
-                pFrame->LoadMovieInfoFromFile(pFrame->m_filesToAdd[i], mi);
+            if (isStopped)
+                break;
+
+            // Update the splash screen's progress bar
+            splash->GetBar().SetPos((short)(i + 1));
 
+            MoviesData::iterator next = movie;
+            ++next;
+            {
                 // Lock this code for thread safety
                 CThreadLock lock(pFrame->m_cs);
-                pFrame->m_moviesData.push_back(mi);
-
-                TRACE(fullName); TRACE(" added to library\n");
+                pFrame->m_moviesData.splice(pFrame->m_moviesData.end(), newMovies, movie);
+                pFrame->m_index.Add(*movie);
+                pFrame->m_isDirty = true;
             }
+
+            TRACE(newFiles[i]->fileName); TRACE(" added to library\n");
+            movie = next;
         }
     }
     else
@@ -1691,14 +1706,26 @@ UINT WINAPI CMainFrame::ThreadProc(void* pVoid)
         ::MessageBox(0, MI.Inform().c_str(), L"Error", MB_OK);
     }
 
-
-
     pFrame->OnFilesLoaded();
     pFrame->GetToolBar().CheckButton(IDM_ADD_FOLDER, FALSE);
 
     return 0;
 }
 
+// Updates the status bar with the number of videos displayed in the list view.
+void CMainFrame::UpdateStatusText(const CString& itemText)
+{
+    CString str;
+    int listItemsCount = GetViewList().GetItemCount();
+    if (listItemsCount == 1)
+        str.Format(L":  %d video", listItemsCount);
+    else
+        str.Format(L":  %d videos", listItemsCount);
+
+    str = itemText + str;
+    SetStatusText(str);
+}
+
 LRESULT CMainFrame::OnDPIChanged()
 {
     // Dialogs handle DPI changes rather badly. The easiest
@@ -1731,8 +1758,11 @@ LRESULT CMainFrame::WndProc(UINT msg, WPARAM wparam, LPARAM lparam)
         case WM_SYSCOMMAND:                 return OnSysCommand(msg, wparam, lparam);
         case WM_DPICHANGED:                 return OnDPIChanged();
 
+        // User Messages posted by the load thread
+        case UWM_MOVIESLOADED:              return OnMoviesLoaded(wparam, lparam);
+
         // User Messages called by CTreeList
-        case UWM_GETMOVIESDATA:             return (LRESULT)GetMoviesData();
+        case UWM_BOXSETRENAMED:             return OnBoxSetRenamed(*(const CString*)wparam, *(const CString*)lparam);
         case UWM_ONSELECTTREEITEM:          return OnSelectTreeItem();
         case UWM_ONRCLICKTREEITEM:          return OnRClickTreeItem();
 
@@ -10,6 +10,8 @@
 #include "CoverImage.h"
 #include "SplashThread.h"
 #include "MovieInfo.h"
+#include "MovieLibrary.h"
+#include "MovieIndex.h"
 
 // Support older compilers.
 #ifndef WM_DPICHANGED
@@ -51,44 +53,59 @@ protected:
     virtual LRESULT WndProc(UINT msg, WPARAM wparam, LPARAM lparam);
 
 private:
+    // CLoadMovieInfo is the function object run by the thread
+    // pool to load the meta data from a movie file.
+    class CLoadMovieInfo
+    {
+    public:
+        CLoadMovieInfo(const FoundFileInfo& ffi, MovieInfo& movie) : m_pFileInfo(&ffi), m_pMovie(&movie) {}
+        void operator()() const { LoadMovieInfoFromFile(*m_pFileInfo, *m_pMovie); }
+
+    private:
+        const FoundFileInfo* m_pFileInfo;
+        MovieInfo* m_pMovie;
+    };
 
+    static UINT WINAPI LoadThreadProc(void* pVoid);
     static UINT WINAPI ThreadProc(void* pVoid);
 
     // Accessors
     std::vector<CString> GetBoxSets();
     CString GetDataPath() const;
-    std::list<MovieInfo>* GetMoviesData() { return &m_moviesData; }
     CViewDialog& GetViewDialog()          { return m_pDockDialog->GetViewDialog(); }
     CViewList& GetViewList()              { return m_viewList; }
     CViewTree& GetViewTree()              { return m_pDockTree->GetViewTree(); }
     std::vector<CString> GetWords(const CString& str) const;
 
     // State functions
-    bool IsWordInString(const CString& sentence, const CString& word) const;
     bool IsVideoFile(const CString& filename) const;
 
     void ClearDisplay();
     void ClearList();
-    void FillImageData(const CString& source, std::vector<BYTE>& dest);
+    static void FillImageData(const CString& source, std::vector<BYTE>& dest);
     void FillList();
     void FillListFromAllBoxSets();
     void FillListFromBoxSet(LPCTSTR boxset);
     void FillListFromDateRange(LPCTSTR dateRange);
     void FillListFromFlags(DWORD dwMask);
-    void FillListFromGenre(LPCTSTR genre);
     void FillListFromGenres(LPCTSTR genreList);
+    void FillListFromResults(MovieResults& results);
     void FillListFromSearch();
     void FillListFromType(LPCTSTR videoType);
     void FillTreeItems();
     void ForceToForeground();
-    void LoadMovieInfoFromFile(const FoundFileInfo& ffi, MovieInfo& movie);
+    static void LoadMovieInfoFromFile(const FoundFileInfo& ffi, MovieInfo& movie);
     void LoadMovies();
+    MoviesData::iterator MoveLoadedMovies();
     void OnFilesLoaded();
+    void UpdateStatusText(const CString& itemText);
 
     // Message handlers
     LRESULT PlayMovie(LPCTSTR path);
     LRESULT OnBarEnd(LPDRAGPOS pDragPos);
+    LRESULT OnBoxSetRenamed(const CString& oldName, const CString& newName);
     LRESULT OnDPIChanged();
+    LRESULT OnMoviesLoaded(WPARAM wparam, LPARAM lparam);
     LRESULT OnRClickListItem();
     LRESULT OnRClickTreeItem();
     LRESULT OnSelectListItem(const MovieInfo* pmi);
@@ -115,9 +132,11 @@ private:
     CCriticalSection m_cs;
     CViewList        m_viewList;
     CWorkThread      m_thread;
+    CWorkThread      m_loadThread;
+    CMovieLibrary    m_library;
     CSplashThread    m_splashThread;
     std::vector<FoundFileInfo> m_filesToAdd;
-    std::vector<const MovieInfo*> m_foundMovies;
+    MovieResults     m_foundMovies;
     HTREEITEM        m_searchItem;
 
     // Use lists because pointers to members of a list are always valid.
@@ -126,6 +145,8 @@ private:
     std::list<CString> m_genres;
 
     MoviesData   m_moviesData;
+    CMovieIndex  m_index;           // Indexes m_moviesData
+    MoviesData   m_loadedMovies;    // Movies loaded, but not yet added to m_moviesData
     CImageList   m_toolbarImages;
     CMenu        m_boxSetMenu;
     CMenu        m_popupMenu;
@@ -133,7 +154,10 @@ private:
     CDockTree*   m_pDockTree;
     CDockDialog* m_pDockDialog;
     CEvent       m_stopRequest;     // An event to signal the event thread should stop
+    CEvent       m_stopLoadRequest; // An event to signal the load thread should stop
     bool         m_isDirty;         // Has m_MoviesData has been modified?
+    bool         m_isLoading;       // Is the load thread loading the library?
+    bool         m_isLoadFailed;    // Did the load thread fail to read the library?
     HTREEITEM    m_boxSetsItem;
     int          m_dialogWidth;
     int          m_treeHeight;
@@ -0,0 +1,337 @@
+/////////////////////////////
+// MovieIndex.cpp
+//
+
+#include "stdafx.h"
+#include "MovieIndex.h"
+
+// Each term is stored with a prefix which identifies the kind of term.
+// Terms of the same kind are adjacent in the sorted map of terms.
+const TCHAR PREFIX_ACTORS      = _T('a');
+const TCHAR PREFIX_BOXSET      = _T('b');
+const TCHAR PREFIX_DESCRIPTION = _T('d');
+const TCHAR PREFIX_GENRE       = _T('g');
+const TCHAR PREFIX_TITLE       = _T('t');
+const TCHAR PREFIX_TYPE        = _T('v');
+const TCHAR PREFIX_YEAR        = _T('y');
+
+////////////////////////////////////
+// CMovieIndex function definitions
+//
+
+// Constructor.
+CMovieIndex::CMovieIndex()
+{
+}
+
+// Destructor.
+CMovieIndex::~CMovieIndex()
+{
+}
+
+// Adds a movie to the index.
+void CMovieIndex::Add(const MovieInfo& movie)
+{
+    assert(m_ids.find(&movie) == m_ids.end());
+
+    // Ids are allocated in ascending order, so adding a movie's id
+    // to the end of a term's list keeps the list sorted.
+    UINT id = static_cast<UINT>(m_entries.size());
+    m_entries.push_back(Entry());
+    m_entries.back().pMovie = &movie;
+    m_ids.insert(std::make_pair(&movie, id));
+
+    AddWords(id, PREFIX_TITLE, movie.movieName);
+    AddWords(id, PREFIX_ACTORS, movie.actors);
+    AddWords(id, PREFIX_DESCRIPTION, movie.description);
+    AddTerm(id, PREFIX_GENRE, movie.genre);
+    AddTerm(id, PREFIX_TYPE, movie.videoType);
+    AddTerm(id, PREFIX_BOXSET, movie.boxset);
+    AddTerm(id, PREFIX_YEAR, movie.releaseDate.Left(4));
+}
+
+// Adds a term to the movie with the specified id. Empty terms are ignored.
+void CMovieIndex::AddTerm(UINT id, TCHAR prefix, const CString& value)
+{
+    if (value.IsEmpty())
+        return;
+
+    CString key(prefix);
+    key += value;
+
+    UINT term;
+    std::map<CString, UINT>::iterator it = m_terms.find(key);
+    if (it == m_terms.end())
+    {
+        term = static_cast<UINT>(m_postings.size());
+        m_terms.insert(std::make_pair(key, term));
+        m_postings.push_back(std::vector<UINT>());
+    }
+    else
+        term = it->second;
+
+    // Words which occur more than once are only added once.
+    std::vector<UINT>& postings = m_postings[term];
+    if (postings.empty() || postings.back() != id)
+    {
+        postings.push_back(id);
+        m_entries[id].terms.push_back(term);
+    }
+}
+
+// Adds each word in the text to the movie with the specified id.
+void CMovieIndex::AddWords(UINT id, TCHAR prefix, const CString& text)
+{
+    std::vector<CString> words = GetLetterRuns(text);
+    for (size_t i = 0; i < words.size(); ++i)
+        AddTerm(id, prefix, words[i]);
+}
+
+// Appends the movies with the specified term to the results.
+void CMovieIndex::AppendMovies(UINT term, MovieResults& results) const
+{
+    const std::vector<UINT>& postings = m_postings[term];
+    for (size_t i = 0; i < postings.size(); ++i)
+        results.push_back(m_entries[postings[i]].pMovie);
+}
+
+// Removes all movies from the index.
+void CMovieIndex::Clear()
+{
+    m_ids.clear();
+    m_entries.clear();
+    m_terms.clear();
+    m_postings.clear();
+}
+
+// Returns true if the movie is in the index.
+bool CMovieIndex::Contains(const MovieInfo* pMovie) const
+{
+    return (m_ids.find(pMovie) != m_ids.end());
+}
+
+// Finds the movies which belong to any box set.
+void CMovieIndex::FindAllBoxSets(MovieResults& results) const
+{
+    TermIterator it = m_terms.lower_bound(CString(PREFIX_BOXSET));
+    for ( ; it != m_terms.end() && it->first[0] == PREFIX_BOXSET; ++it)
+        AppendMovies(it->second, results);
+}
+
+// Finds the movies which belong to the specified box set.
+void CMovieIndex::FindBoxSet(const CString& boxSet, MovieResults& results) const
+{
+    CString key(PREFIX_BOXSET);
+    key += boxSet;
+
+    TermIterator it = m_terms.find(key);
+    if (it != m_terms.end())
+        AppendMovies(it->second, results);
+}
+
+// Finds the movies released from the first year to the last year inclusive.
+// The years are strings of four digits. Live performances are excluded.
+void CMovieIndex::FindDateRange(const CString& firstYear, const CString& lastYear, MovieResults& results) const
+{
+    CString first(PREFIX_YEAR);
+    first += firstYear;
+    CString last(PREFIX_YEAR);
+    last += lastYear;
+
+    TermIterator it = m_terms.lower_bound(first);
+    TermIterator end = m_terms.upper_bound(last);
+    for ( ; it != end; ++it)
+    {
+        const std::vector<UINT>& postings = m_postings[it->second];
+        for (size_t i = 0; i < postings.size(); ++i)
+        {
+            const MovieInfo* pMovie = m_entries[postings[i]].pMovie;
+            if (pMovie->videoType == L"Movies")
+                results.push_back(pMovie);
+        }
+    }
+}
+
+// Finds the movies whose genre contains the specified genre.
+// Live performances are excluded.
+void CMovieIndex::FindGenre(const CString& genre, MovieResults& results) const
+{
+    // There are few distinct genres, so each one is searched.
+    TermIterator it = m_terms.lower_bound(CString(PREFIX_GENRE));
+    for ( ; it != m_terms.end() && it->first[0] == PREFIX_GENRE; ++it)
+    {
+        if (it->first.Find(genre, 1) < 0)
+            continue;
+
+        const std::vector<UINT>& postings = m_postings[it->second];
+        for (size_t i = 0; i < postings.size(); ++i)
+        {
+            const MovieInfo* pMovie = m_entries[postings[i]].pMovie;
+            if (pMovie->videoType == L"Movies")
+                results.push_back(pMovie);
+        }
+    }
+}
+
+// Finds the movies whose video type contains the specified type.
+void CMovieIndex::FindType(const CString& videoType, MovieResults& results) const
+{
+    TermIterator it = m_terms.lower_bound(CString(PREFIX_TYPE));
+    for ( ; it != m_terms.end() && it->first[0] == PREFIX_TYPE; ++it)
+    {
+        if (it->first.Find(videoType, 1) >= 0)
+            AppendMovies(it->second, results);
+    }
+}
+
+// Finds the movies with the specified word in the title, actors or
+// description. Matches words the same way as IsWordInString.
+void CMovieIndex::FindWord(Field field, const CString& word, MovieResults& results) const
+{
+    CString wordLow = word;
+    wordLow.MakeLower();
+    std::vector<CString> runs = GetLetterRuns(wordLow);
+
+    if (runs.empty())
+    {
+        // Words without letters aren't indexed, so check each movie.
+        for (size_t i = 0; i < m_entries.size(); ++i)
+        {
+            const MovieInfo* pMovie = m_entries[i].pMovie;
+            if (pMovie && IsWordInString(GetField(*pMovie, field), word))
+                results.push_back(pMovie);
+        }
+
+        return;
+    }
+
+    // Each run of letters in the word is a whole word in the movies which
+    // match, so the movies with the least common run are the candidates.
+    const std::vector<UINT>* pCandidates = 0;
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        CString key(GetPrefix(field));
+        key += runs[i];
+        TermIterator it = m_terms.find(key);
+        if (it == m_terms.end())
+            return;
+
+        const std::vector<UINT>& postings = m_postings[it->second];
+        if (pCandidates == 0 || postings.size() < pCandidates->size())
+            pCandidates = &postings;
+    }
+
+    // A word of only letters matches every candidate.
+    bool isLettersOnly = (runs.size() == 1 && runs[0] == wordLow);
+    for (size_t i = 0; i < pCandidates->size(); ++i)
+    {
+        const MovieInfo* pMovie = m_entries[(*pCandidates)[i]].pMovie;
+        if (isLettersOnly || IsWordInString(GetField(*pMovie, field), word))
+            results.push_back(pMovie);
+    }
+}
+
+// Returns the movie information searched for words.
+const CString& CMovieIndex::GetField(const MovieInfo& movie, Field field)
+{
+    switch (field)
+    {
+    case title:         return movie.movieName;
+    case actors:        return movie.actors;
+    default:            return movie.description;
+    }
+}
+
+// Returns the runs of letters in the lower case text.
+std::vector<CString> CMovieIndex::GetLetterRuns(const CString& text)
+{
+    CString textLow = text;
+    textLow.MakeLower();
+
+    std::vector<CString> runs;
+    int length = textLow.GetLength();
+    int start = -1;
+    for (int i = 0; i <= length; ++i)
+    {
+        bool isLetter = (i < length) && iswalpha(textLow[i]);
+        if (isLetter && start < 0)
+            start = i;
+        else if (!isLetter && start >= 0)
+        {
+            runs.push_back(textLow.Mid(start, i - start));
+            start = -1;
+        }
+    }
+
+    return runs;
+}
+
+// Returns the prefix of the words indexed for the field.
+TCHAR CMovieIndex::GetPrefix(Field field)
+{
+    switch (field)
+    {
+    case title:         return PREFIX_TITLE;
+    case actors:        return PREFIX_ACTORS;
+    default:            return PREFIX_DESCRIPTION;
+    }
+}
+
+// Performs a case-insensitive search for a word in sentence.
+// Returns true if a matching word is found.
+bool CMovieIndex::IsWordInString(const CString& sentence, const CString& word)
+{
+    int pos = 0;
+    CString sentenceLow = sentence;
+    sentenceLow.MakeLower();
+
+    CString wordLow = word;
+    wordLow.MakeLower();
+
+    // find each substring in sentence that matches word
+    while ((pos = sentenceLow.Find(wordLow, pos)) >= 0)
+    {
+        // words are bound by non-isalpha characters or begin/end of word.
+        int nNextChar = pos + wordLow.GetLength();
+        bool isWordStart = (pos == 0) || !(iswalpha(sentenceLow[pos - 1]));
+        bool isWordEnd = (nNextChar == sentenceLow.GetLength()) || !(iswalpha(sentenceLow[nNextChar]));
+
+        // return true if the substring found is a word
+        if (isWordStart && isWordEnd)
+            return true;
+
+        pos++;
+    }
+
+    return false;
+}
+
+// Removes a movie from the index.
+void CMovieIndex::Remove(const MovieInfo& movie)
+{
+    std::map<const MovieInfo*, UINT>::iterator it = m_ids.find(&movie);
+    if (it == m_ids.end())
+        return;
+
+    UINT id = it->second;
+    Entry& entry = m_entries[id];
+    for (size_t i = 0; i < entry.terms.size(); ++i)
+    {
+        std::vector<UINT>& postings = m_postings[entry.terms[i]];
+        std::vector<UINT>::iterator pos = std::lower_bound(postings.begin(), postings.end(), id);
+        if (pos != postings.end() && *pos == id)
+            postings.erase(pos);
+    }
+
+    // Release the entry's memory. The id isn't reused.
+    std::vector<UINT>().swap(entry.terms);
+    entry.pMovie = 0;
+    m_ids.erase(it);
+}
+
+// Updates the index after a movie is modified.
+void CMovieIndex::Update(const MovieInfo& movie)
+{
+    Remove(movie);
+    Add(movie);
+}
@@ -0,0 +1,75 @@
+/////////////////////////////
+// MovieIndex.h
+//
+
+#ifndef _MOVIEINDEX_H_
+#define _MOVIEINDEX_H_
+
+#include "MovieInfo.h"
+
+typedef std::vector<const MovieInfo*> MovieResults;
+
+
+////////////////////////////////////////////////////////////
+// CMovieIndex indexes the movies in the library, so movies
+// can be found without comparing every movie in the library.
+// The words in the title, actors and description are indexed,
+// along with the genre, video type, box set and release year.
+// Each indexed term has a list of the movies with that term.
+// Call Add when a movie is added to the library, Remove before
+// a movie is removed, and Update after a movie is modified.
+class CMovieIndex
+{
+public:
+    // The movie information searched for words.
+    enum Field { title, actors, description };
+
+    CMovieIndex();
+    virtual ~CMovieIndex();
+
+    void Add(const MovieInfo& movie);
+    void Clear();
+    bool Contains(const MovieInfo* pMovie) const;
+    size_t GetCount() const { return m_ids.size(); }
+    void Remove(const MovieInfo& movie);
+    void Update(const MovieInfo& movie);
+
+    // These functions append the movies found to the results.
+    void FindAllBoxSets(MovieResults& results) const;
+    void FindBoxSet(const CString& boxSet, MovieResults& results) const;
+    void FindDateRange(const CString& firstYear, const CString& lastYear, MovieResults& results) const;
+    void FindGenre(const CString& genre, MovieResults& results) const;
+    void FindType(const CString& videoType, MovieResults& results) const;
+    void FindWord(Field field, const CString& word, MovieResults& results) const;
+
+    static bool IsWordInString(const CString& sentence, const CString& word);
+
+private:
+    CMovieIndex(const CMovieIndex&);              // Disable copy construction
+    CMovieIndex& operator=(const CMovieIndex&);   // Disable assignment operator
+
+    // The movie and its terms, indexed by the movie's id.
+    struct Entry
+    {
+        Entry() : pMovie(0) {}
+
+        const MovieInfo* pMovie;    // NULL if the movie was removed
+        std::vector<UINT> terms;
+    };
+
+    typedef std::map<CString, UINT>::const_iterator TermIterator;
+
+    void AddTerm(UINT id, TCHAR prefix, const CString& value);
+    void AddWords(UINT id, TCHAR prefix, const CString& text);
+    void AppendMovies(UINT term, MovieResults& results) const;
+    static const CString& GetField(const MovieInfo& movie, Field field);
+    static std::vector<CString> GetLetterRuns(const CString& text);
+    static TCHAR GetPrefix(Field field);
+
+    std::map<const MovieInfo*, UINT> m_ids;     // The id of each movie
+    std::vector<Entry> m_entries;               // The movies, indexed by id
+    std::map<CString, UINT> m_terms;            // The prefixed term strings, and their term numbers
+    std::vector<std::vector<UINT> > m_postings; // The ids of the movies with each term, in ascending order
+};
+
+#endif // _MOVIEINDEX_H_
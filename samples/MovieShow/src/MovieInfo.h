@@ -9,6 +9,9 @@ struct MovieInfo
     {
         ZeroMemory(&lastModifiedTime, sizeof(lastModifiedTime));
         flags = 0;
+        recordOffset = 0;
+        recordSize = 0;
+        recordHash = 0;
     }
 
     std::vector<BYTE> imageData;
@@ -24,6 +27,11 @@ struct MovieInfo
     CString videoType;  // Movie; Live Performance
     CString boxset;
     DWORD   flags;    // for favourites etc.
+
+    // The movie's record in the library file. Used by CMovieLibrary.
+    ULONGLONG recordOffset; // position of the record in the file
+    UINT    recordSize;     // size of the record, or 0 if not saved
+    UINT    recordHash;     // hash of the movie info when it was saved
 };
 
 typedef std::list<MovieInfo> MoviesData;
@@ -0,0 +1,310 @@
+/////////////////////////////
+// MovieLibrary.cpp
+//
+
+#include "stdafx.h"
+#include "MovieLibrary.h"
+
+// The library file's header is:
+//  UINT      LIBRARY_MAGIC
+//  UINT      LIBRARY_VERSION
+//  UINT      number of records
+//  ULONGLONG position of the index
+const UINT LIBRARY_MAGIC = 0x4C564F4D;      // "MOVL"
+const UINT LIBRARY_VERSION = 2;
+const ULONGLONG LIBRARY_HEADER_SIZE = 20;
+
+/////////////////////////////////////
+// CMovieLibrary function definitions
+//
+
+// Constructor.
+CMovieLibrary::CMovieLibrary() : m_position(0), m_recordCount(0), m_nextRecord(0),
+                                 m_isIndexed(false)
+{
+}
+
+// Destructor.
+CMovieLibrary::~CMovieLibrary()
+{
+    Close();
+}
+
+// Closes the library file.
+void CMovieLibrary::Close()
+{
+    // The archive closes the file when it's destroyed.
+    m_pArchive = Shared_Ptr<CArchive>();
+    if (m_file.GetHandle() != INVALID_HANDLE_VALUE)
+        m_file.Close();
+
+    m_boxSets.clear();
+    m_index.clear();
+    m_position = 0;
+    m_recordCount = 0;
+    m_nextRecord = 0;
+    m_isIndexed = false;
+}
+
+// Returns a hash of the movie information stored in the movie's record.
+// The hash identifies the records which have changed since they were saved.
+UINT CMovieLibrary::GetRecordHash(const MovieInfo& movie)
+{
+    const CString* strings[] = { &movie.fileName, &movie.movieName, &movie.duration,
+                                 &movie.releaseDate, &movie.description, &movie.genre,
+                                 &movie.actors, &movie.videoType, &movie.boxset };
+
+    // Use the FNV-1a hash.
+    UINT hash = 2166136261U;
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); ++i)
+    {
+        const BYTE* bytes = reinterpret_cast<const BYTE*>(strings[i]->c_str());
+        size_t length = strings[i]->GetLength() * sizeof(TCHAR);
+        for (size_t b = 0; b < length; ++b)
+            hash = (hash ^ bytes[b]) * 16777619U;
+
+        // Separate the strings.
+        hash = (hash ^ 0xFF) * 16777619U;
+    }
+
+    ULONGLONG values[] = { movie.lastModifiedTime.dwLowDateTime, movie.lastModifiedTime.dwHighDateTime,
+                           movie.flags, movie.imageData.size() };
+    const BYTE* bytes = reinterpret_cast<const BYTE*>(values);
+    for (size_t b = 0; b < sizeof(values); ++b)
+        hash = (hash ^ bytes[b]) * 16777619U;
+
+    // Include the cover image, so a changed image of the same size is saved.
+    for (size_t b = 0; b < movie.imageData.size(); ++b)
+        hash = (hash ^ movie.imageData[b]) * 16777619U;
+
+    return hash;
+}
+
+// Opens the library file, and reads the box sets and the index.
+// The records are then read in order by ReadNext.
+// Throws a CFileException on failure.
+void CMovieLibrary::Open(LPCTSTR fileName)
+{
+    Close();
+    m_file.Open(fileName, CFile::modeRead | CFile::shareDenyWrite);
+    m_pArchive = Shared_Ptr<CArchive>(new CArchive(m_file, CArchive::load));
+    CArchive& ar = *m_pArchive;
+
+    UINT magic;
+    ar >> magic;
+    if (magic == LIBRARY_MAGIC)
+    {
+        UINT version;
+        ULONGLONG indexOffset;
+        ar >> version >> m_recordCount >> indexOffset;
+        if (version != LIBRARY_VERSION || indexOffset < LIBRARY_HEADER_SIZE)
+            throw CFileException(fileName, _T("Unsupported library file"));
+
+        ar.Flush();
+        m_file.Seek(static_cast<LONGLONG>(indexOffset), FILE_BEGIN);
+
+        UINT boxSets;
+        ar >> boxSets;
+        for (UINT i = 0; i < boxSets; ++i)
+        {
+            CString str;
+            ar >> str;
+            m_boxSets.push_back(str);
+        }
+
+        m_index.resize(m_recordCount);
+        for (UINT i = 0; i < m_recordCount; ++i)
+        {
+            ar >> m_index[i].offset;
+            ar >> m_index[i].size;
+        }
+
+        // Force a seek to the first record.
+        m_position = 0;
+        m_isIndexed = true;
+    }
+    else
+    {
+        // Older library files start with the box sets, followed
+        // by the records.
+        UINT boxSets = magic;
+        for (UINT i = 0; i < boxSets; ++i)
+        {
+            CString str;
+            ar >> str;
+            m_boxSets.push_back(str);
+        }
+
+        ar >> m_recordCount;
+        m_isIndexed = false;
+    }
+}
+
+// Reads the next record from the library file.
+// Returns false if there are no more records.
+// Throws a CFileException on failure.
+bool CMovieLibrary::ReadNext(MovieInfo& movie)
+{
+    assert(m_pArchive.get());
+    if (m_nextRecord >= m_recordCount)
+        return false;
+
+    if (m_isIndexed)
+    {
+        // The records are in file order, except for those
+        // appended when they were modified.
+        const RecordIndex& record = m_index[m_nextRecord];
+        if (record.offset != m_position)
+        {
+            m_pArchive->Flush();
+            m_file.Seek(static_cast<LONGLONG>(record.offset), FILE_BEGIN);
+        }
+
+        ReadRecord(*m_pArchive, movie);
+        movie.recordOffset = record.offset;
+        movie.recordSize = record.size;
+        m_position = record.offset + record.size;
+    }
+    else
+    {
+        ReadRecord(*m_pArchive, movie);
+    }
+
+    movie.recordHash = GetRecordHash(movie);
+    ++m_nextRecord;
+    return true;
+}
+
+// Reads the movie information from the archive.
+void CMovieLibrary::ReadRecord(CArchive& ar, MovieInfo& movie)
+{
+    ar >> movie.fileName;
+    ArchiveObject ao(&movie.lastModifiedTime, sizeof(FILETIME));
+    ar >> ao;
+    ar >> movie.movieName;
+    ar >> movie.duration;
+    ar >> movie.releaseDate;
+    ar >> movie.description;
+    ar >> movie.genre;
+    ar >> movie.actors;
+    ar >> movie.videoType;
+    ar >> movie.boxset;
+    ar >> movie.flags;
+
+    UINT imageDataSize = 0;
+    ar >> imageDataSize;
+    movie.imageData.resize(imageDataSize);
+    if (imageDataSize > 0)
+        ar.Read(&movie.imageData[0], imageDataSize);
+}
+
+// Saves the box sets and movies to the library file.
+// The new and modified movies are appended to an existing library file,
+// followed by a new index. A new library file is written when more than
+// half of the existing file would be unused, or it has no index.
+// Throws a CFileException on failure.
+void CMovieLibrary::Save(LPCTSTR fileName, const std::vector<CString>& boxSets, MoviesData& movies)
+{
+    // Count the bytes used by the unchanged records.
+    ULONGLONG usedBytes = LIBRARY_HEADER_SIZE;
+    MoviesData::iterator it;
+    for (it = movies.begin(); it != movies.end(); ++it)
+    {
+        if ((*it).recordSize != 0 && (*it).recordHash == GetRecordHash(*it))
+            usedBytes += (*it).recordSize;
+    }
+
+    if (::PathFileExists(fileName))
+    {
+        CFile file(fileName, CFile::modeReadWrite | CFile::shareExclusive);
+        UINT header[2] = { 0, 0 };
+        UINT bytesRead = file.Read(header, sizeof(header));
+        ULONGLONG length = file.GetLength();
+        if (bytesRead == sizeof(header) && header[0] == LIBRARY_MAGIC &&
+            header[1] == LIBRARY_VERSION && length - usedBytes <= usedBytes)
+        {
+            file.Seek(0, FILE_END);
+            WriteLibrary(file, boxSets, movies);
+            return;
+        }
+    }
+
+    // Write every record to a new file, then replace the library file.
+    for (it = movies.begin(); it != movies.end(); ++it)
+        (*it).recordSize = 0;
+
+    CString tempName = CString(fileName) + _T(".tmp");
+    {
+        CFile file(tempName, CFile::modeCreate | CFile::modeWrite);
+        WriteLibrary(file, boxSets, movies);
+    }
+
+    if (!::MoveFileEx(tempName, fileName, MOVEFILE_REPLACE_EXISTING))
+        throw CFileException(fileName, GetApp()->MsgFileOpen());
+}
+
+// Writes the new and modified records, followed by the index, from
+// the current position of the file. The header is written last, so
+// the previous index remains valid until the new one is complete.
+void CMovieLibrary::WriteLibrary(CFile& file, const std::vector<CString>& boxSets, MoviesData& movies)
+{
+    CArchive ar(file, CArchive::store);
+    if (file.GetPosition() == 0)
+        ar << LIBRARY_MAGIC << LIBRARY_VERSION << UINT(0) << ULONGLONG(0);
+
+    MoviesData::iterator it;
+    for (it = movies.begin(); it != movies.end(); ++it)
+    {
+        UINT hash = GetRecordHash(*it);
+        if ((*it).recordSize == 0 || (*it).recordHash != hash)
+        {
+            ar.Flush();
+            ULONGLONG offset = file.GetPosition();
+            WriteRecord(ar, *it);
+            ar.Flush();
+
+            (*it).recordOffset = offset;
+            (*it).recordSize = UINT(file.GetPosition() - offset);
+            (*it).recordHash = hash;
+        }
+    }
+
+    ar.Flush();
+    ULONGLONG indexOffset = file.GetPosition();
+    ar << UINT(boxSets.size());
+    for (size_t i = 0; i < boxSets.size(); ++i)
+        ar << boxSets[i];
+
+    for (it = movies.begin(); it != movies.end(); ++it)
+    {
+        ar << (*it).recordOffset;
+        ar << (*it).recordSize;
+    }
+
+    ar.Flush();
+    file.Flush();
+    file.Seek(0, FILE_BEGIN);
+    ar << LIBRARY_MAGIC << LIBRARY_VERSION << UINT(movies.size()) << indexOffset;
+}
+
+// Writes the movie information to the archive.
+void CMovieLibrary::WriteRecord(CArchive& ar, const MovieInfo& movie)
+{
+    ar << movie.fileName;
+    ArchiveObject ao(const_cast<FILETIME*>(&movie.lastModifiedTime), sizeof(FILETIME));
+    ar << ao;
+    ar << movie.movieName;
+    ar << movie.duration;
+    ar << movie.releaseDate;
+    ar << movie.description;
+    ar << movie.genre;
+    ar << movie.actors;
+    ar << movie.videoType;
+    ar << movie.boxset;
+    ar << movie.flags;
+
+    UINT imageDataSize = UINT(movie.imageData.size());
+    ar << imageDataSize;
+    if (imageDataSize > 0)
+        ar.Write(&movie.imageData[0], imageDataSize);
+}
@@ -0,0 +1,62 @@
+/////////////////////////////
+// MovieLibrary.h
+//
+
+#ifndef _MOVIELIBRARY_H_
+#define _MOVIELIBRARY_H_
+
+#include "MovieInfo.h"
+
+
+////////////////////////////////////////////////////////////
+// CMovieLibrary reads and writes the video library file.
+// The file has a header, a record for each movie, and an
+// index. The index holds the box sets and the position of
+// each record, and the header holds the index's position.
+// Saving appends the new and modified records followed by
+// a new index, so unchanged records aren't rewritten. The
+// file is rewritten when more than half of it is unused.
+// Library files without an index, saved by older versions
+// of MovieShow, can also be read.
+class CMovieLibrary
+{
+public:
+    CMovieLibrary();
+    virtual ~CMovieLibrary();
+
+    void Close();
+    const std::vector<CString>& GetBoxSets() const { return m_boxSets; }
+    UINT GetRecordCount() const { return m_recordCount; }
+    bool IsIndexed() const      { return m_isIndexed; }
+    void Open(LPCTSTR fileName);
+    bool ReadNext(MovieInfo& movie);
+
+    static UINT GetRecordHash(const MovieInfo& movie);
+    static void Save(LPCTSTR fileName, const std::vector<CString>& boxSets, MoviesData& movies);
+
+private:
+    CMovieLibrary(const CMovieLibrary&);              // Disable copy construction
+    CMovieLibrary& operator=(const CMovieLibrary&);   // Disable assignment operator
+
+    // The position and size of a record in the library file.
+    struct RecordIndex
+    {
+        ULONGLONG offset;
+        UINT size;
+    };
+
+    static void ReadRecord(CArchive& ar, MovieInfo& movie);
+    static void WriteLibrary(CFile& file, const std::vector<CString>& boxSets, MoviesData& movies);
+    static void WriteRecord(CArchive& ar, const MovieInfo& movie);
+
+    CFile m_file;
+    Shared_Ptr<CArchive> m_pArchive;    // Reads from m_file
+    std::vector<CString> m_boxSets;
+    std::vector<RecordIndex> m_index;
+    ULONGLONG m_position;               // File position of the archive's next byte
+    UINT m_recordCount;
+    UINT m_nextRecord;
+    bool m_isIndexed;
+};
+
+#endif // _MOVIELIBRARY_H_
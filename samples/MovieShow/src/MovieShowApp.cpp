@@ -4,6 +4,7 @@
 
 #include "stdafx.h"
 #include "MovieShowApp.h"
+#include "IndexBenchmark.h"
 
 //////////////////////////////////////
 // CMovieShowApp function definitions
@@ -22,6 +23,16 @@ CMovieShowApp::~CMovieShowApp()
 // Called when the application starts.
 BOOL CMovieShowApp::InitInstance()
 {
+    // Run the movie index benchmark instead if the /benchmark
+    // command line argument is specified.
+    std::vector<CString> args = GetCommandLineArgs();
+    if (std::find(args.begin(), args.end(), CString(L"/benchmark")) != args.end())
+    {
+        CString report = RunIndexBenchmark(100000);
+        ::MessageBox(NULL, report, L"Movie Index Benchmark", MB_OK);
+        return FALSE;
+    }
+
     // Create the frame window
     m_frame.Create();   // throws a CWinException on failure
 
@@ -107,14 +107,8 @@ BOOL CViewTree::OnEndLabelEdit(LPARAM lparam)
 
     if (oldText != m_itemText)
     {
-        std::list<MovieInfo>::iterator it;
-        std::list<MovieInfo>* data;
-        data = (std::list<MovieInfo>*)GetAncestor().SendMessage(UWM_GETMOVIESDATA, 0, 0);
-        for (it = data->begin(); it != data->end(); ++it)
-        {
-            if ((*it).boxset == oldText)
-                (*it).boxset = m_itemText;
-        }
+        // Rename the box set of the movies in the box set.
+        GetAncestor().SendMessage(UWM_BOXSETRENAMED, (WPARAM)&oldText, (LPARAM)&m_itemText);
     }
 
     return TRUE;
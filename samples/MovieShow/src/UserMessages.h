@@ -13,8 +13,11 @@
 
 // Messages called by CTreeList
 #define UWM_ONSELECTTREEITEM          (WM_APP + 0x0004)
-#define UWM_GETMOVIESDATA             (WM_APP + 0x0005)
+#define UWM_BOXSETRENAMED             (WM_APP + 0x0005)
 #define UWM_ONRCLICKTREEITEM          (WM_APP + 0x0006)
 
+// Messages posted by the thread which loads the library
+#define UWM_MOVIESLOADED              (WM_APP + 0x0007)
+
 #endif  // _USER_MESSAGES_H_
 
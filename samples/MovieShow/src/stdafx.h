@@ -24,9 +24,11 @@
 #endif
 
 // Rarely modified header files should be included here
+#include <algorithm>            // Add support for std::lower_bound
 #include <vector>               // Add support for std::vector
 #include <list>                 // Add support for std::list
 #include <map>                  // Add support for std::map
+#include <set>                  // Add support for std::set
 #include <string>               // Add support for std::string
 #include <sstream>              // Add support for stringstream
 #include <cassert>              // Add support for the assert macro
@@ -73,6 +75,7 @@
 #include <wxx_textconv.h>       // Add AtoT, AtoW, TtoA, TtoW, WtoA, WtoT etc.
 #include <wxx_themes.h>         // Add MenuTheme, ReBarTheme, StatusBarTheme, ToolBarTheme
 #include <wxx_thread.h>         // Add CWinThread
+#include <wxx_threadpool.h>     // Add CPoolTask, CThreadPool
 #include <wxx_time.h>           // Add CTime
 #include <wxx_toolbar.h>        // Add CToolBar
 #include <wxx_treeview.h>       // Add CTreeView
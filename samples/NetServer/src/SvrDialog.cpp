@@ -357,7 +357,7 @@ BOOL CSvrDialog::OnSocketAccept()
         return FALSE;
     }
 
-    pClient->StartEvents();
+    pClient->StartEvents(m_socketEngine);
 
     // Create the new chat dialog.
     TCPClientDlgPtr pDialog(new CTCPClientDlg(IDD_CHAT));
@@ -506,7 +506,7 @@ BOOL CSvrDialog::StartServer()
         }
     }
 
-    m_mainSocket.StartEvents();
+    m_mainSocket.StartEvents(m_socketEngine);
 
     return TRUE;
 }
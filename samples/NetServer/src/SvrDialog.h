@@ -101,6 +101,7 @@ private:
     void StopServer();
 
     // Member variables
+    CSocketEngine m_socketEngine;   // Monitors the network events of all the sockets
     CServerSocket m_mainSocket;
     std::map<ServerSocketPtr, TCPClientDlgPtr> m_connectedClients;// Stores TCP client sockets and TCP client dialogs
     bool m_isServerStarted;
@@ -5,6 +5,7 @@
 #include "stdafx.h"
 #include "MainWnd.h"
 #include "MyDialog.h"
+#include "PixelCheck.h"
 #include "PerfApp.h"
 #include "resource.h"
 
@@ -51,6 +52,119 @@ void CMainWindow::CreateTestWindows(int windows)
     }
 }
 
+// Measures the time to store and load an archive of many small values,
+// with and without the archive's buffer. The records resemble those
+// stored by the MovieShow sample.
+void CMainWindow::ArchiveTest() const
+{
+    SendText(_T("Archive test (store / load times)"));
+
+    TCHAR tempPath[MAX_PATH];
+    TCHAR fileName[MAX_PATH];
+    VERIFY(::GetTempPath(MAX_PATH, tempPath));
+    VERIFY(::GetTempFileName(tempPath, _T("arc"), 0, fileName));
+
+    const UINT records = 20000;
+    const UINT bufferSizes[] = { 0, WXX_ARCHIVE_BUFFER_SIZE };
+    const CString title = _T("A movie title");
+    const CString description = _T("A longer description of the movie, with a few more words in it.");
+
+    try
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            UINT bufferSize = bufferSizes[i];
+
+            // Store the records.
+            LONGLONG start = GetCounter();
+            {
+                CArchive ar(fileName, CArchive::store, bufferSize);
+                ar << records;
+                for (UINT n = 0; n < records; ++n)
+                {
+                    ar << title << description;
+                    ar << n << static_cast<double>(n) << true;
+                }
+            }
+
+            // Load the records.
+            LONGLONG stored = GetCounter();
+            {
+                CArchive ar(fileName, CArchive::load, bufferSize);
+                UINT count = 0;
+                ar >> count;
+                CString str;
+                UINT u;
+                double d;
+                bool b;
+                for (UINT n = 0; n < count; ++n)
+                {
+                    ar >> str >> str;
+                    ar >> u >> d >> b;
+                }
+            }
+
+            LONGLONG loaded = GetCounter();
+            CString str;
+            str.Format(_T("%u records, buffer %6u bytes: %8.2f ms / %8.2f ms"), records, bufferSize,
+                1000.0 * (stored - start) / m_frequency, 1000.0 * (loaded - stored) / m_frequency);
+            SendText(str);
+        }
+    }
+
+    catch (const CFileException& e)
+    {
+        SendText(e.GetText());
+    }
+
+    ::DeleteFile(fileName);
+}
+
+// Measures the rate at which CString::Format produces short and long results.
+// Short results fit in FormatV's stack buffer. Long results don't.
+void CMainWindow::FormatTest() const
+{
+    SendText(_T("Format test"));
+
+    const int iterations = 200000;
+    const CString longText(_T('x'), 2 * WXX_FORMAT_BUFFER_SIZE);
+    CString str;
+
+    // Short results, like those used for TRACE and status bar updates.
+    LONGLONG start = GetCounter();
+    for (int n = 0; n < iterations; ++n)
+        str.Format(_T("Item %d of %d: %.2f%%"), n, iterations, 100.0 * n / iterations);
+
+    LONGLONG end = GetCounter();
+    double shortRate = 1e-6 * iterations * m_frequency / (end - start);
+
+    // Long results.
+    start = GetCounter();
+    for (int n = 0; n < iterations; ++n)
+        str.Format(_T("Item %d: %s"), n, longText.c_str());
+
+    end = GetCounter();
+    double longRate = 1e-6 * iterations * m_frequency / (end - start);
+
+    // Appended results.
+    str.Empty();
+    start = GetCounter();
+    for (int n = 0; n < iterations; ++n)
+    {
+        if ((n & 255) == 0)
+            str.Empty();
+
+        str.AppendFormat(_T("%d, "), n);
+    }
+
+    end = GetCounter();
+    double appendRate = 1e-6 * iterations * m_frequency / (end - start);
+
+    str.Format(_T("Format: short %.2f, long %.2f, append %.2f million/sec"),
+        shortRate, longRate, appendRate);
+    SendText(str);
+}
+
 // Retrieves the current performance counter.
 LONGLONG CMainWindow::GetCounter() const
 {
@@ -117,6 +231,23 @@ void CMainWindow::OnAllWindowsCreated()
     if (result != IDOK) return;
 
     PerformanceTest();
+    HandleMapTest();
+    ArchiveTest();
+    StringTest();
+    FormatTest();
+    TextConversionTest();
+    SocketTest();
+    ScatterGatherTest();
+    PixelCheck();
+    PixelTest();
+    ScrollViewTest();
+    BackBufferTest();
+    GradientTest();
+    PreTranslateTest();
+    IdleTaskTest();
+    ThreadTaskTest();
+    ThreadPoolCheck();
+    ThreadPoolTest();
 
     // Loop the performance test
     result = IDYES;
@@ -126,6 +257,23 @@ void CMainWindow::OnAllWindowsCreated()
         if (result != IDYES) break;
 
         PerformanceTest();
+        HandleMapTest();
+        ArchiveTest();
+        StringTest();
+        FormatTest();
+        TextConversionTest();
+        SocketTest();
+        ScatterGatherTest();
+        PixelCheck();
+        PixelTest();
+        ScrollViewTest();
+        BackBufferTest();
+        GradientTest();
+        PreTranslateTest();
+        IdleTaskTest();
+        ThreadTaskTest();
+        ThreadPoolCheck();
+        ThreadPoolTest();
     }
     SendText(_T("Testing complete"));
 }
@@ -157,6 +305,13 @@ void CMainWindow::PerformanceTest() const
     // Display the results
     str.Format(_T("%.2f milliseconds to process %d messages"), mSeconds, m_testMessages);
     SendText(str);
+    if (mSeconds > 0)
+    {
+        str.Format(_T("%.0f messages per second"), 1000.0 * m_testMessages / mSeconds);
+        SendText(str);
+    }
+
+    LookupTest(hWnd);
 
     str.Format(_T("%d total messages sent\n"), result);
     TRACE(str);
@@ -164,6 +319,175 @@ void CMainWindow::PerformanceTest() const
     MessageBox(str, _T("Info"), MB_OK);
 }
 
+// Measures the time to create and destroy increasing numbers of windows,
+// brushes and memory DCs. Each of these is added to and removed from one
+// of the handle maps maintained by CWinApp.
+void CMainWindow::HandleMapTest() const
+{
+    SendText(_T("Handle map test (create / destroy times)"));
+
+    // Note: Windows limits a process to 10000 USER and GDI handles.
+    const int counts[] = { 250, 500, 1000, 2000 };
+    const int tests = sizeof(counts) / sizeof(counts[0]);
+
+    for (int i = 0; i < tests; ++i)
+    {
+        int count = counts[i];
+        CString str;
+
+        // Windows
+        std::vector<WndPtr> windows;
+        LONGLONG start = GetCounter();
+        for (int n = 0; n < count; ++n)
+        {
+            WndPtr pWnd(new CWnd);
+            pWnd->CreateEx(0, _T("Static"), NULL, WS_CHILD, 0, 0, 0, 0, *this, 0);
+            windows.push_back(pWnd);
+        }
+
+        LONGLONG created = GetCounter();
+        windows.clear();    // Destroys the windows in the order they were created.
+        LONGLONG end = GetCounter();
+        str.Format(_T("%5d windows: %8.2f ms / %8.2f ms"), count,
+            1000.0 * (created - start) / m_frequency, 1000.0 * (end - created) / m_frequency);
+        SendText(str);
+
+        // Brushes
+        std::vector<BrushPtr> brushes;
+        start = GetCounter();
+        for (int n = 0; n < count; ++n)
+            brushes.push_back(BrushPtr(new CBrush(RGB(n % 256, 0, 0))));
+
+        created = GetCounter();
+        brushes.clear();
+        end = GetCounter();
+        str.Format(_T("%5d brushes: %8.2f ms / %8.2f ms"), count,
+            1000.0 * (created - start) / m_frequency, 1000.0 * (end - created) / m_frequency);
+        SendText(str);
+
+        // Memory DCs
+        std::vector<DCPtr> dcs;
+        start = GetCounter();
+        for (int n = 0; n < count; ++n)
+            dcs.push_back(DCPtr(new CMemDC(NULL)));
+
+        created = GetCounter();
+        dcs.clear();
+        end = GetCounter();
+        str.Format(_T("%5d DCs:     %8.2f ms / %8.2f ms"), count,
+            1000.0 * (created - start) / m_frequency, 1000.0 * (end - created) / m_frequency);
+        SendText(str);
+    }
+}
+
+// The worker thread used by the thread task test. It sends events to the
+// event window as posted messages or as thread tasks.
+UINT WINAPI CMainWindow::EventThreadProc(LPVOID pParam)
+{
+    EventThreadParams* pParams = static_cast<EventThreadParams*>(pParam);
+    for (int event = 1; event <= pParams->events; ++event)
+    {
+        if (pParams->pPump)
+            pParams->pPump->PostThreadTask(CEventTask(*pParams->pWindow, event), pParams->key);
+        else
+        {
+            // Retry while the message queue is full.
+            while (!::PostMessage(*pParams->pWindow, WM_TESTEVENT, event, 0))
+                ::Sleep(0);
+        }
+    }
+
+    return 0;
+}
+
+// Posts idle tasks, half of which are coalesced by key, and runs them in the
+// time slices used by the message loop. Reports the rate tasks are posted
+// and run, and the slices used to run them.
+void CMainWindow::IdleTaskTest() const
+{
+    SendText(_T("Idle task test (posting and running idle tasks)"));
+
+    const int tasks = 100000;
+    const int keys = 1000;
+    CPerformanceApp* pApp = GetPerfApp();
+    IdleTaskStats before = pApp->GetIdleTaskStats();
+    int count = 0;
+
+    LONGLONG start = GetCounter();
+    for (int n = 0; n < tasks; ++n)
+    {
+        UINT_PTR key = (n % 2) ? static_cast<UINT_PTR>(n % keys) + 1 : 0;
+        pApp->PostIdleTask(CIdleCounter(count), n % 3, key);
+    }
+    LONGLONG posted = GetCounter();
+    size_t depth = pApp->GetIdleTaskCount();
+
+    while (pApp->RunIdle())
+    {
+    }
+    LONGLONG end = GetCounter();
+
+    // Display the results.
+    const IdleTaskStats& after = pApp->GetIdleTaskStats();
+    double thousands = 1e-3 * m_frequency;
+    CString str;
+    str.Format(_T("Posted %.0f thousand tasks/sec. Ran %d of %d tasks at %.0f thousand tasks/sec"),
+        thousands * tasks / (posted - start), count, tasks, thousands * count / (end - posted));
+    SendText(str);
+    str.Format(_T("Queue depth %d, %d coalesced, %d slices, %d overruns, longest overrun %d us"),
+        static_cast<int>(depth), after.coalesced - before.coalesced, after.slices - before.slices,
+        after.overruns - before.overruns, after.maxOverrun);
+    SendText(str);
+}
+
+// Compares the cost of the window lookup performed for each message.
+// The old path locks a critical section and searches a std::map.
+// The new path uses the thread's window cache.
+void CMainWindow::LookupTest(HWND hWnd) const
+{
+    // Build a map equivalent to the one previously used by CWinApp.
+    std::map<HWND, CWnd*> windowMap;
+    std::vector<TestWindowPtr>::const_iterator it;
+    for (it = m_pTestWindows.begin(); it != m_pTestWindows.end(); ++it)
+        windowMap.insert(std::make_pair((*it)->GetHwnd(), (*it).get()));
+
+    CCriticalSection mapLock;
+    CWnd* pWnd = 0;
+    int lookups = 0;
+
+    // Time the old path.
+    LONGLONG start = GetCounter();
+    while (lookups++ < m_testMessages)
+    {
+        CThreadLock lock(mapLock);
+        std::map<HWND, CWnd*>::const_iterator m = windowMap.find(hWnd);
+        pWnd = (m != windowMap.end()) ? m->second : 0;
+    }
+
+    LONGLONG end = GetCounter();
+    double oldSeconds = static_cast<double>(end - start) / m_frequency;
+
+    // Time the new path.
+    lookups = 0;
+    start = GetCounter();
+    while (lookups++ < m_testMessages)
+        pWnd = GetApp()->GetCWndFromMap(hWnd);
+
+    end = GetCounter();
+    double newSeconds = static_cast<double>(end - start) / m_frequency;
+    if (pWnd == 0)
+        return;
+
+    // Display the results as the message rate the lookup alone would allow.
+    CString str;
+    if (oldSeconds > 0 && newSeconds > 0)
+    {
+        str.Format(_T("Window lookups per second: %.0f (locked map), %.0f (thread cache)"),
+            m_testMessages / oldSeconds, m_testMessages / newSeconds);
+        SendText(str);
+    }
+}
+
 // Send text to the edit window.
 void CMainWindow::SendText(LPCTSTR str) const
 {
@@ -174,6 +498,995 @@ void CMainWindow::SendText(LPCTSTR str) const
     TRACE("\n");
 }
 
+// Measures the time the message loop spends pre-translating a mouse message
+// sent to a window nested inside several levels of parent windows. Compares
+// searching the parents for each message with using the cached chain, both
+// with the parents' PreTranslateMessage enabled and disabled.
+void CMainWindow::PreTranslateTest() const
+{
+    SendText(_T("PreTranslateMessage test (WM_MOUSEMOVE at several nesting depths)"));
+
+    const int depths[] = { 1, 4, 16, 32 };
+    const int tests = sizeof(depths) / sizeof(depths[0]);
+    const int messages = 100000;
+
+    for (int i = 0; i < tests; ++i)
+    {
+        // Create the nested windows.
+        std::vector<Shared_Ptr<CWnd> > windows;
+        HWND parent = *this;
+        for (int level = 0; level < depths[i]; ++level)
+        {
+            Shared_Ptr<CWnd> pWnd(new CWnd);
+            pWnd->Create(parent);
+            parent = *pWnd;
+            windows.push_back(pWnd);
+        }
+
+        MSG msg;
+        ZeroMemory(&msg, sizeof(msg));
+        msg.hwnd = windows.back()->GetHwnd();
+        msg.message = WM_MOUSEMOVE;
+        CPerformanceApp* pApp = GetPerfApp();
+
+        // Search the parents for each message.
+        LONGLONG start = GetCounter();
+        for (int n = 0; n < messages; ++n)
+        {
+            windows.back()->EnablePreTranslate();   // Invalidates the cached chain
+            pApp->PreTranslate(msg);
+        }
+        LONGLONG searched = GetCounter();
+
+        // Use the cached chain.
+        for (int n = 0; n < messages; ++n)
+            pApp->PreTranslate(msg);
+
+        LONGLONG cached = GetCounter();
+
+        // Use the cached chain, skipping the nested windows.
+        for (size_t w = 0; w < windows.size(); ++w)
+            windows[w]->EnablePreTranslate(FALSE);
+
+        LONGLONG skipStart = GetCounter();
+        for (int n = 0; n < messages; ++n)
+            pApp->PreTranslate(msg);
+
+        LONGLONG end = GetCounter();
+
+        // Display the results.
+        double nsPerMessage = 1e9 / (static_cast<double>(messages) * m_frequency);
+        CString str;
+        str.Format(_T("Depth %d: searched %.0f ns, cached %.0f ns, cached and skipped %.0f ns per message"),
+            depths[i], nsPerMessage * (searched - start), nsPerMessage * (cached - searched),
+            nsPerMessage * (end - skipStart));
+        SendText(str);
+
+        // Destroy the windows, innermost first.
+        while (!windows.empty())
+        {
+            windows.back()->Destroy();
+            windows.pop_back();
+        }
+    }
+}
+
+// Simulates the back buffers used to paint a window while it is resized.
+// Compares creating a compatible bitmap for each paint with borrowing one
+// from the thread's back buffer pool.
+void CMainWindow::BackBufferTest() const
+{
+    SendText(_T("Back buffer test (painting while resizing)"));
+
+    const int paints = 2000;
+    CClientDC dc(*this);
+
+    LONGLONG start = GetCounter();
+    for (int n = 0; n < paints; ++n)
+    {
+        CRect rc(0, 0, 400 + n % 200, 30 + n % 20);
+        CMemDC memDC(dc);
+        memDC.CreateCompatibleBitmap(dc, rc.Width(), rc.Height());
+        memDC.SolidFill(RGB(200, 220, 240), rc);
+    }
+    LONGLONG created = GetCounter();
+
+    BackBufferPool& pool = GetApp()->GetTlsData()->backBuffers;
+    UINT hits = pool.hits;
+    UINT misses = pool.misses;
+    for (int n = 0; n < paints; ++n)
+    {
+        CRect rc(0, 0, 400 + n % 200, 30 + n % 20);
+        CMemDC memDC(dc);
+        memDC.CreatePooledBitmap(dc, rc.Width(), rc.Height());
+        memDC.SolidFill(RGB(200, 220, 240), rc);
+    }
+    LONGLONG end = GetCounter();
+
+    // Display the results.
+    hits = pool.hits - hits;
+    misses = pool.misses - misses;
+    double thousands = 1e-3 * paints * m_frequency;
+    CString str;
+    str.Format(_T("Created: %.1f thousand paints/sec. Pooled: %.1f thousand paints/sec"),
+        thousands / (created - start), thousands / (end - created));
+    SendText(str);
+    str.Format(_T("Pool hit rate %.1f%%, %d bitmaps retaining %.1f KB"),
+        100.0 * hits / (hits + misses), static_cast<int>(pool.bitmaps.size()), pool.bytesRetained / 1024.0);
+    SendText(str);
+}
+
+// Fills rebar band sized gradients, as a themed frame does while it is
+// resized. Compares filling one solid line per pixel with CDC::GradientFill,
+// both with and without the gradient strip already cached.
+void CMainWindow::GradientTest() const
+{
+    SendText(_T("Gradient test (1920 x 32 gradients)"));
+
+    const int width = 1920;
+    const int height = 32;
+    const int fills = 200;
+    const COLORREF color1 = RGB(150, 190, 245);
+    const COLORREF color2 = RGB(196, 215, 250);
+
+    CClientDC dc(*this);
+    CMemDC memDC(dc);
+    memDC.CreateCompatibleBitmap(dc, width, height);
+
+    // Fill one solid line per pixel column.
+    LONGLONG start = GetCounter();
+    for (int n = 0; n < fills; ++n)
+    {
+        for (int i = 0; i < width; ++i)
+        {
+            int r = GetRValue(color1) + (i * (GetRValue(color2) - GetRValue(color1)) / width);
+            int g = GetGValue(color1) + (i * (GetGValue(color2) - GetGValue(color1)) / width);
+            int b = GetBValue(color1) + (i * (GetBValue(color2) - GetBValue(color1)) / width);
+            memDC.SetBkColor(RGB(r, g, b));
+            CRect line(i, 0, i + 1, height);
+            memDC.ExtTextOut(0, 0, ETO_OPAQUE, line, NULL, 0, 0);
+        }
+    }
+    LONGLONG lines = GetCounter();
+
+    // Create a new strip for each fill.
+    GradientCache& cache = GetApp()->GetTlsData()->gradients;
+    for (int n = 0; n < fills; ++n)
+    {
+        cache.Clear();
+        memDC.GradientFill(color1, color2, CRect(0, 0, width, height), TRUE);
+    }
+    LONGLONG uncached = GetCounter();
+
+    // Reuse the cached strip.
+    for (int n = 0; n < fills; ++n)
+        memDC.GradientFill(color1, color2, CRect(0, 0, width, height), TRUE);
+
+    LONGLONG end = GetCounter();
+
+    // Display the results.
+    double rate = static_cast<double>(fills) * m_frequency;
+    CString str;
+    str.Format(_T("Lines: %.0f fills/sec. Uncached strip: %.0f fills/sec. Cached strip: %.0f fills/sec"),
+        rate / (lines - start), rate / (uncached - lines), rate / (end - uncached));
+    SendText(str);
+}
+
+// Measures the rate at which the pixel functions used by CBitmap's
+// GrayScaleBitmap, TintBitmap and ConvertToDisabled modify 24 bit and
+// 32 bit images.
+void CMainWindow::PixelTest() const
+{
+    SendText(_T("Pixel test (1024 x 1024 images)"));
+
+    const int width = 1024;
+    const int height = 1024;
+    const int iterations = 20;
+    std::vector<unsigned char> image(width * height * 4);
+    for (size_t i = 0; i < image.size(); ++i)
+        image[i] = static_cast<unsigned char>(i * 7 + i / 1024);
+
+    for (int bytesPerPixel = 3; bytesPerPixel <= 4; ++bytesPerPixel)
+    {
+        int stride = (width * bytesPerPixel + 3) & ~3;
+
+        LONGLONG start = GetCounter();
+        for (int n = 0; n < iterations; ++n)
+            GrayScalePixels(&image[0], width, height, stride, bytesPerPixel);
+        LONGLONG grayed = GetCounter();
+
+        for (int n = 0; n < iterations; ++n)
+            TintPixels(&image[0], width, height, stride, bytesPerPixel, -64, -24, 128);
+        LONGLONG tinted = GetCounter();
+
+        for (int n = 0; n < iterations; ++n)
+            ConvertToDisabledPixels(&image[0], width, height, stride, bytesPerPixel, 255, 0, 255);
+        LONGLONG end = GetCounter();
+
+        // Display the results.
+        double megapixels = 1e-6 * width * height * iterations * m_frequency;
+        CString str;
+        str.Format(_T("%d bit pixels: gray scale %.0f, tint %.0f, disabled %.0f megapixels/sec"),
+            bytesPerPixel * 8, megapixels / (grayed - start), megapixels / (tinted - grayed),
+            megapixels / (end - tinted));
+        SendText(str);
+    }
+}
+
+// Checks the pixel functions produce the same pixels as the loops CBitmap
+// used before them. Random 24 bit and 32 bit images of various widths and
+// strides are checked with the SSE2 code, if used, and the portable code.
+// The SSE2 and portable code of ScalePixels are checked against each other.
+void CMainWindow::PixelCheck() const
+{
+    SendText(_T("Pixel check (pixel functions compared with the original loops)"));
+
+    const int images = 200;
+    UINT random = 12345;
+    int differences = 0;
+
+    for (int image = 0; image < images; ++image)
+    {
+        random = random * 1664525 + 1013904223;
+        int width = (image < images / 2) ? 1 + (random >> 8) % 40 : 1 + (random >> 8) % 600;
+        int height = 1 + (random >> 20) % 8;
+        int bytesPerPixel = 3 + (image & 1);
+        int stride = ((width * bytesPerPixel + 3) & ~3) + 4 * ((random >> 28) & 3);
+
+        // Fill the image with random bytes. Some bytes are set to match
+        // the mask used by ConvertToDisabledPixels.
+        random = random * 1664525 + 1013904223;
+        int mask[3] = { static_cast<int>((random >> 8) & 0xFF), static_cast<int>((random >> 16) & 0xFF),
+                         static_cast<int>(random >> 24) };
+        std::vector<BYTE> source(stride * height);
+        for (size_t i = 0; i < source.size(); ++i)
+        {
+            random = random * 1664525 + 1013904223;
+            source[i] = static_cast<BYTE>(random >> 24);
+            if (((random >> 8) & 7) == 0)
+                source[i] = static_cast<BYTE>(mask[(i % bytesPerPixel) % 3]);
+        }
+
+        // Tint values from -300 to 300, with each color left unchanged by
+        // some of the images.
+        random = random * 1664525 + 1013904223;
+        int tint[3];
+        for (int i = 0; i < 3; ++i)
+            tint[i] = static_cast<int>((random >> (8 * i)) % 601) - 300;
+
+        if (image % 10 == 0)
+            tint[image / 10 % 3] = 0;
+
+        for (int test = 0; test < 3; ++test)
+        {
+            std::vector<BYTE> legacy(source);
+            std::vector<BYTE> current(source);
+            std::vector<BYTE> portable(source);
+            if (test == 0)
+            {
+                LegacyPixels::GrayScalePixels(&legacy[0], width, height, stride, bytesPerPixel);
+                Win32xx::GrayScalePixels(&current[0], width, height, stride, bytesPerPixel);
+                PortablePixels::GrayScalePixels(&portable[0], width, height, stride, bytesPerPixel);
+            }
+            else if (test == 1)
+            {
+                LegacyPixels::TintPixels(&legacy[0], width, height, stride, bytesPerPixel, tint[2], tint[1], tint[0]);
+                Win32xx::TintPixels(&current[0], width, height, stride, bytesPerPixel, tint[2], tint[1], tint[0]);
+                PortablePixels::TintPixels(&portable[0], width, height, stride, bytesPerPixel, tint[2], tint[1], tint[0]);
+            }
+            else
+            {
+                LegacyPixels::ConvertToDisabledPixels(&legacy[0], width, height, stride, bytesPerPixel, mask[0], mask[1], mask[2]);
+                Win32xx::ConvertToDisabledPixels(&current[0], width, height, stride, bytesPerPixel, mask[0], mask[1], mask[2]);
+                PortablePixels::ConvertToDisabledPixels(&portable[0], width, height, stride, bytesPerPixel, mask[0], mask[1], mask[2]);
+            }
+
+            if (current != legacy || portable != legacy)
+            {
+                const LPCTSTR names[] = { _T("GrayScalePixels"), _T("TintPixels"), _T("ConvertToDisabledPixels") };
+                CString str;
+                str.Format(_T("%s differs: %d bit, %d x %d, stride %d"), names[test],
+                    bytesPerPixel * 8, width, height, stride);
+                SendText(str);
+                ++differences;
+            }
+        }
+    }
+
+    // ScalePixels has no original loop to compare with. When SSE2 is used,
+    // the SSE2 code is compared with the portable code.
+    const int scaledImages = 200;
+    int scaleDifferences = 0;
+    for (int image = 0; image < scaledImages; ++image)
+    {
+        random = random * 1664525 + 1013904223;
+        int sourceWidth = 1 + (random >> 8) % 300;
+        int sourceHeight = 1 + (random >> 20) % 30;
+        int sourceStride = 4 * (sourceWidth + ((random >> 28) & 3));
+        random = random * 1664525 + 1013904223;
+        int destWidth = 1 + (random >> 8) % 300;
+        int destHeight = 1 + (random >> 20) % 30;
+        int destStride = 4 * (destWidth + ((random >> 28) & 3));
+
+        std::vector<BYTE> source(sourceStride * sourceHeight);
+        for (size_t i = 0; i < source.size(); ++i)
+        {
+            random = random * 1664525 + 1013904223;
+            source[i] = static_cast<BYTE>(random >> 24);
+        }
+
+        std::vector<BYTE> current(destStride * destHeight);
+        std::vector<BYTE> portable(destStride * destHeight);
+        Win32xx::ScalePixels(&source[0], sourceWidth, sourceHeight, sourceStride,
+            &current[0], destWidth, destHeight, destStride);
+        PortablePixels::ScalePixels(&source[0], sourceWidth, sourceHeight, sourceStride,
+            &portable[0], destWidth, destHeight, destStride);
+
+        if (current != portable)
+        {
+            CString str;
+            str.Format(_T("ScalePixels differs: %d x %d to %d x %d"), sourceWidth, sourceHeight,
+                destWidth, destHeight);
+            SendText(str);
+            ++scaleDifferences;
+        }
+    }
+
+    // Display the results.
+#ifdef WXX_SSE2
+    LPCTSTR code = _T("SSE2 and portable code");
+#else
+    LPCTSTR code = _T("portable code");
+#endif
+
+    CString str;
+    str.Format(_T("%d images checked with the %s, %d differences"), images, code, differences);
+    SendText(str);
+    str.Format(_T("%d scaled images checked with the %s, %d differences"), scaledImages, code, scaleDifferences);
+    SendText(str);
+}
+
+// Receives exactly len bytes from a blocking socket.
+bool CMainWindow::ReceiveAll(const CSocket& socket, char* buf, int len) const
+{
+    while (len > 0)
+    {
+        int bytes = socket.Receive(buf, len, 0);
+        if (bytes <= 0)
+            return false;
+
+        buf += bytes;
+        len -= bytes;
+    }
+
+    return true;
+}
+
+// Receives data from a blocking socket into the ring buffer until it
+// holds a complete message. A message is an int length followed by the payload.
+bool CMainWindow::ReceiveMessage(const CSocket& socket, CSocketBuffer& buffer) const
+{
+    int header = static_cast<int>(sizeof(int));
+    for (;;)
+    {
+        int length = 0;
+        if (buffer.Peek(reinterpret_cast<char*>(&length), header) == header &&
+            buffer.GetSize() >= header + length)
+            return true;
+
+        if (socket.Receive(buffer, 0) <= 0)
+            return false;
+    }
+}
+
+// Compares two ways of sending a message with a header on the loopback
+// address. The first copies the header and payload into a new buffer to
+// send it, and receives into new buffers. The second sends the header
+// and payload with one scatter/gather call, and receives into a
+// CSocketBuffer which is parsed in place.
+void CMainWindow::ScatterGatherTest() const
+{
+    SendText(_T("Scatter/gather test (loopback echo round trips)"));
+
+    // Connect a client to a server on the loopback address.
+    CSocket server;
+    CSocket client;
+    CSocket echo;
+    sockaddr_in address;
+    ZeroMemory(&address, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int length = sizeof(address);
+    if (!server.Create(AF_INET, SOCK_STREAM) ||
+        server.Bind(reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+        server.Listen() != 0 ||
+        server.GetSockName(reinterpret_cast<sockaddr*>(&address), &length) != 0 ||
+        !client.Create(AF_INET, SOCK_STREAM) ||
+        client.Connect(reinterpret_cast<sockaddr*>(&address), length) != 0)
+    {
+        SendText(server.GetErrorString());
+        return;
+    }
+
+    server.Accept(echo, NULL, NULL);
+
+    // Send small messages without delay.
+    BOOL noDelay = TRUE;
+    client.SetSockOpt(IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+    echo.SetSockOpt(IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+    const int sizes[] = { 16, 256, 4096, 16384 };
+    const int iterations = 5000;
+    std::vector<char> payload(16384, 'x');
+    CSocketBuffer clientBuffer;
+    CSocketBuffer echoBuffer;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        int size = sizes[i];
+        int header = static_cast<int>(sizeof(size));
+        bool succeeded = true;
+
+        // Copy the header and payload into a new buffer for each send.
+        LONGLONG start = GetCounter();
+        for (int n = 0; succeeded && n < iterations; ++n)
+        {
+            std::vector<char> message(header + size);
+            memcpy(&message[0], &size, header);
+            memcpy(&message[header], &payload[0], size);
+            client.Send(&message[0], header + size, 0);
+
+            int received = 0;
+            succeeded = ReceiveAll(echo, reinterpret_cast<char*>(&received), header);
+            std::vector<char> data(received);
+            succeeded = succeeded && ReceiveAll(echo, &data[0], received);
+
+            std::vector<char> reply(header + received);
+            memcpy(&reply[0], &received, header);
+            memcpy(&reply[header], &data[0], received);
+            echo.Send(&reply[0], header + received, 0);
+
+            succeeded = succeeded && ReceiveAll(client, reinterpret_cast<char*>(&received), header);
+            std::vector<char> result(received);
+            succeeded = succeeded && ReceiveAll(client, &result[0], received);
+        }
+        LONGLONG copied = GetCounter();
+
+        // Send the header and payload with one call, and parse the replies in place.
+        for (int n = 0; succeeded && n < iterations; ++n)
+        {
+            WSABUF buffers[2];
+            buffers[0].buf = reinterpret_cast<char*>(&size);
+            buffers[0].len = header;
+            buffers[1].buf = &payload[0];
+            buffers[1].len = size;
+            client.Send(buffers, 2, 0);
+
+            succeeded = ReceiveMessage(echo, echoBuffer);
+            if (succeeded)
+            {
+                echo.Send(echoBuffer.GetData(header + size), header + size, 0);
+                echoBuffer.Consume(header + size);
+            }
+
+            succeeded = succeeded && ReceiveMessage(client, clientBuffer);
+            if (succeeded)
+                clientBuffer.Consume(header + size);
+        }
+        LONGLONG end = GetCounter();
+
+        if (!succeeded)
+        {
+            SendText(_T("Scatter/gather test failed"));
+            return;
+        }
+
+        // Display the results.
+        double thousands = 1e-3 * iterations * m_frequency;
+        CString str;
+        str.Format(_T("%5d byte messages: copied %.1f thousand round trips/sec, scatter/gather %.1f thousand round trips/sec"),
+            size, thousands / (copied - start), thousands / (end - copied));
+        SendText(str);
+    }
+}
+
+// Measures the time taken to paint and scroll a CScrollView with each of
+// its paint modes, for several document sizes. The memory reported is the
+// memory used by the paint mode's bitmaps at 32 bits per pixel.
+void CMainWindow::ScrollViewTest() const
+{
+    SendText(_T("Scroll view test (640 x 480 view)"));
+
+    const int sizes[] = { 2000, 5000, 20000 };
+    const CScrollView::PaintMode modes[] = { CScrollView::paintDocument,
+        CScrollView::paintViewport, CScrollView::paintTiles };
+    const LPCTSTR names[] = { _T("Document"), _T("Viewport"), _T("Tiles   ") };
+    const int paints = 20;
+    const int scrolls = 100;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        int size = sizes[i];
+        for (int m = 0; m < 3; ++m)
+        {
+            CString str;
+            double documentMB = 4.0 * size * size / (1024 * 1024);
+            if (modes[m] == CScrollView::paintDocument && documentMB > 256)
+            {
+                str.Format(_T("%5d x %d %s: skipped, requires a %.0f MB bitmap for each paint"),
+                    size, size, names[m], documentMB);
+                SendText(str);
+                continue;
+            }
+
+            CTestScrollView view;
+            view.Create();
+            view.SetPaintMode(modes[m]);
+            view.SetScrollSizes(CSize(size, size), CSize(400, 400), CSize(20, 20));
+            view.UpdateWindow();
+
+            // Repaint the entire view.
+            LONGLONG start = GetCounter();
+            for (int n = 0; n < paints; ++n)
+            {
+                view.Invalidate();
+                view.UpdateWindow();
+            }
+            LONGLONG painted = GetCounter();
+
+            // Scroll down a line at a time.
+            int maxTiles = view.GetTileCount();
+            for (int n = 0; n < scrolls; ++n)
+            {
+                view.SendMessage(WM_VSCROLL, SB_LINEDOWN, 0);
+                view.UpdateWindow();
+                maxTiles = MAX(maxTiles, view.GetTileCount());
+            }
+            LONGLONG end = GetCounter();
+
+            double memoryMB = documentMB;
+            CRect clientRect = view.GetClientRect();
+            if (modes[m] == CScrollView::paintViewport)
+                memoryMB = 4.0 * clientRect.Width() * clientRect.Height() / (1024 * 1024);
+            else if (modes[m] == CScrollView::paintTiles)
+                memoryMB = 4.0 * maxTiles * view.GetTileSize().cx * view.GetTileSize().cy / (1024 * 1024);
+
+            // Display the results.
+            str.Format(_T("%5d x %d %s: paint %.2f ms, scroll %.2f ms, bitmap memory %.1f MB"),
+                size, size, names[m], 1000.0 * (painted - start) / (paints * m_frequency),
+                1000.0 * (end - painted) / (scrolls * m_frequency), memoryMB);
+            SendText(str);
+
+            view.Destroy();
+        }
+    }
+}
+
+// A load test for sockets on the loopback address. Measures the rate
+// at which the server accepts connections, and the time taken for each
+// client's message to be echoed. The test is run with a thread for each
+// socket, and with the sockets sharing the threads of a CSocketEngine.
+void CMainWindow::SocketTest() const
+{
+    SendText(_T("Socket test (loopback connections and echo latency)"));
+
+    const int clients = 500;
+    const LPCTSTR names[] = { _T("Thread per socket"), _T("Socket engine    ") };
+
+    for (int i = 0; i < 2; ++i)
+    {
+        // The engine is declared first so the sockets are destroyed before it.
+        CSocketEngine engine;
+        CSocketEngine* pEngine = (i == 1) ? &engine : NULL;
+        CTestServer server(pEngine);
+        std::vector<TestClientPtr> testClients;
+        volatile LONG received = 0;
+
+        // Listen on the loopback address, with a port chosen by the system.
+        sockaddr_in address;
+        ZeroMemory(&address, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int length = sizeof(address);
+        if (!server.Create(AF_INET, SOCK_STREAM) ||
+            server.Bind(reinterpret_cast<sockaddr*>(&address), length) != 0 ||
+            server.Listen() != 0 ||
+            server.GetSockName(reinterpret_cast<sockaddr*>(&address), &length) != 0)
+        {
+            SendText(server.GetErrorString());
+            return;
+        }
+
+        if (pEngine)
+            server.StartEvents(*pEngine);
+        else
+            server.StartEvents();
+
+        // Connect the clients, and wait for the server to accept them.
+        LONGLONG start = GetCounter();
+        for (int n = 0; n < clients; ++n)
+        {
+            TestClientPtr pClient(new CTestClient(received));
+            if (!pClient->Create(AF_INET, SOCK_STREAM) ||
+                pClient->Connect(reinterpret_cast<sockaddr*>(&address), length) != 0)
+            {
+                SendText(pClient->GetErrorString());
+                return;
+            }
+
+            if (pEngine)
+                pClient->StartEvents(*pEngine);
+            else
+                pClient->StartEvents();
+
+            testClients.push_back(pClient);
+        }
+
+        while (server.GetAccepted() < clients && GetCounter() - start < 10 * m_frequency)
+            ::Sleep(1);
+
+        LONGLONG connected = GetCounter();
+
+        // Send a message from each client, and wait for the replies.
+        for (int n = 0; n < clients; ++n)
+            testClients[n]->SendTestMessage();
+
+        while (received < clients && GetCounter() - connected < 10 * m_frequency)
+            ::Sleep(1);
+
+        LONGLONG totalLatency = 0;
+        LONGLONG maxLatency = 0;
+        for (int n = 0; n < clients; ++n)
+        {
+            LONGLONG latency = testClients[n]->GetLatency();
+            totalLatency += latency;
+            maxLatency = MAX(maxLatency, latency);
+        }
+
+        // Display the results.
+        int threads = pEngine ? pEngine->GetThreadCount() : 2 * clients + 1;
+        double seconds = static_cast<double>(connected - start) / m_frequency;
+        CString str;
+        str.Format(_T("%s: %ld of %d connections, %.0f connections/sec, %d threads"),
+            names[i], server.GetAccepted(), clients, server.GetAccepted() / seconds, threads);
+        SendText(str);
+        str.Format(_T("%s: %ld replies, latency average %.3f ms, maximum %.3f ms"), names[i],
+            received, 1000.0 * totalLatency / (clients * m_frequency), 1000.0 * maxLatency / m_frequency);
+        SendText(str);
+
+        // Disconnect the clients before the server.
+        testClients.clear();
+    }
+}
+
+// Measures the throughput of copying, moving, appending and concatenating
+// CStrings, and the time to fill a string through GetBuffer.
+void CMainWindow::StringTest() const
+{
+    CString str;
+    str.Format(_T("String test (sizeof(CString) is %d bytes)"), static_cast<int>(sizeof(CString)));
+    SendText(str);
+
+    const int iterations = 1000000;
+    const CString shortText = _T("Short");
+    const CString longText = _T("A longer string which won't fit in the small string buffer.");
+    const CString* texts[] = { &shortText, &longText };
+    const LPCTSTR names[] = { _T("short"), _T("long ") };
+    std::vector<CString> strings(64);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        const CString& text = *texts[i];
+
+        // Copy
+        LONGLONG start = GetCounter();
+        for (int n = 0; n < iterations; ++n)
+            strings[n & 63] = text;
+
+        LONGLONG copied = GetCounter();
+
+        // Move. Without move semantics this is a copy.
+        for (int n = 0; n < iterations; ++n)
+        {
+            CString temp(text);
+#ifdef WXX_MOVE_SEMANTICS
+            strings[n & 63] = std::move(temp);
+#else
+            strings[n & 63] = temp;
+#endif
+        }
+
+        LONGLONG moved = GetCounter();
+
+        // Append
+        CString appended;
+        for (int n = 0; n < iterations; ++n)
+        {
+            if ((n & 1023) == 0)
+                appended.Empty();
+
+            appended += text;
+        }
+
+        LONGLONG appendDone = GetCounter();
+
+        // Concatenate
+        for (int n = 0; n < iterations; ++n)
+            strings[n & 63] = text + text;
+
+        LONGLONG concatenated = GetCounter();
+
+        // GetBuffer / ReleaseBuffer
+        for (int n = 0; n < iterations; ++n)
+        {
+            CString& buffer = strings[n & 63];
+            lstrcpyn(buffer.GetBuffer(text.GetLength()), text, text.GetLength() + 1);
+            buffer.ReleaseBuffer();
+        }
+
+        LONGLONG end = GetCounter();
+
+        // Display the results in millions of operations per second.
+        double millions = 1e-6 * iterations * m_frequency;
+        str.Format(_T("%s: copy %.1f, move %.1f, append %.1f, concat %.1f, buffer %.1f million/sec"), names[i],
+            millions / (copied - start), millions / (moved - copied), millions / (appendDone - moved),
+            millions / (concatenated - appendDone), millions / (end - concatenated));
+        SendText(str);
+    }
+}
+
+// Measures the rate of text conversions with CAtoW and CWtoA, compared to
+// measuring and converting with two calls to the Windows API. The corpus
+// mixes short and long ASCII text with text containing non-ASCII characters.
+void CMainWindow::TextConversionTest() const
+{
+    SendText(_T("Text conversion test"));
+
+    std::vector<std::wstring> wideCorpus;
+    wideCorpus.push_back(L"OK");
+    wideCorpus.push_back(L"C:\\Program Files\\Win32++\\samples\\Performance\\Release\\Performance.exe");
+    wideCorpus.push_back(L"Caf\x00e9 cr\x00e8me br\x00fbl\x00e9e");
+    wideCorpus.push_back(L"\x0393\x03b5\x03b9\x03ac \x03c3\x03bf\x03c5 \x039a\x03cc\x03c3\x03bc\x03b5");
+    wideCorpus.push_back(std::wstring(1000, L'a'));
+    wideCorpus.push_back(std::wstring(1000, L'\x00e9'));
+
+    const UINT codePages[] = { CP_ACP, CP_UTF8 };
+    const LPCTSTR names[] = { _T("ANSI "), _T("UTF-8") };
+    const int iterations = 100000;
+    const size_t corpusSize = wideCorpus.size();
+
+    for (int i = 0; i < 2; ++i)
+    {
+        UINT codePage = codePages[i];
+        std::vector<std::string> ansiCorpus;
+        for (size_t n = 0; n < corpusSize; ++n)
+            ansiCorpus.push_back(std::string(WtoA(wideCorpus[n].c_str(), codePage)));
+
+        size_t total = 0;
+
+        // CWtoA and CAtoW.
+        LONGLONG start = GetCounter();
+        for (int n = 0; n < iterations; ++n)
+        {
+            const std::wstring& wide = wideCorpus[n % corpusSize];
+            const std::string& ansi = ansiCorpus[n % corpusSize];
+            total += lstrlenA(WtoA(wide.c_str(), codePage));
+            total += lstrlenW(AtoW(ansi.c_str(), codePage));
+        }
+
+        LONGLONG end = GetCounter();
+        double newRate = 1e-6 * iterations * m_frequency / (end - start);
+
+        // Two calls to the Windows API for each conversion.
+        std::vector<char> ansiBuffer;
+        std::vector<wchar_t> wideBuffer;
+        start = GetCounter();
+        for (int n = 0; n < iterations; ++n)
+        {
+            const std::wstring& wide = wideCorpus[n % corpusSize];
+            const std::string& ansi = ansiCorpus[n % corpusSize];
+
+            int length = ::WideCharToMultiByte(codePage, 0, wide.c_str(), -1, NULL, 0, NULL, NULL);
+            ansiBuffer.assign(length, '\0');
+            ::WideCharToMultiByte(codePage, 0, wide.c_str(), -1, &ansiBuffer[0], length, NULL, NULL);
+            total += lstrlenA(&ansiBuffer[0]);
+
+            length = ::MultiByteToWideChar(codePage, 0, ansi.c_str(), -1, NULL, 0);
+            wideBuffer.assign(length, L'\0');
+            ::MultiByteToWideChar(codePage, 0, ansi.c_str(), -1, &wideBuffer[0], length);
+            total += lstrlenW(&wideBuffer[0]);
+        }
+
+        end = GetCounter();
+        double oldRate = 1e-6 * iterations * m_frequency / (end - start);
+
+        CString str;
+        str.Format(_T("%s: %.2f million pairs/sec (two API calls: %.2f million pairs/sec), %d chars"),
+            names[i], newRate, oldRate, static_cast<int>(total));
+        SendText(str);
+    }
+}
+
+// Checks Wait and Cancel for thread pool tasks which call OnComplete on this
+// thread. This thread must be able to wait for the tasks before it runs their
+// OnComplete, and WaitAll must not return until every OnComplete has run.
+void CMainWindow::ThreadPoolCheck() const
+{
+    SendText(_T("Thread pool check (Wait and Cancel with OnComplete on this thread)"));
+
+    CPerformanceApp* pApp = GetPerfApp();
+    CEvent started(FALSE, TRUE);
+    CEvent gate(FALSE, TRUE);
+    int completions = 0;
+    CString failure;
+
+    CThreadPool pool;
+    pool.Start(1);
+
+    // The first task holds the only worker, so the next tasks stay queued.
+    PoolTaskPtr first = pool.Submit(PoolTaskPtr(new CCompletionTask(started, gate, completions)), pApp);
+    ::WaitForSingleObject(started, INFINITE);
+    PoolTaskPtr cancelled = pool.Submit(PoolTaskPtr(new CCompletionTask(started, gate, completions)), pApp);
+    PoolTaskPtr last = pool.Submit(PoolTaskPtr(new CCompletionTask(started, gate, completions)), pApp);
+
+    if (!cancelled->Cancel() || !cancelled->IsDone() || !cancelled->Wait(0))
+        failure = _T("a queued task wasn't cancelled");
+
+    gate.SetEvent();
+    if (!first->Wait(5000) || !last->Wait(5000))
+        failure = _T("Wait timed out");
+    else if (completions != 0)
+        failure = _T("OnComplete was called on the worker thread");
+
+    // Run the thread tasks which call OnComplete.
+    MSG msg;
+    while (completions < 3 && ::GetMessage(&msg, 0, 0, 0) > 0)
+    {
+        if (msg.hwnd == 0 && msg.message == UWM_RUNTHREADTASKS)
+            pApp->RunThreadTasks();
+        else
+        {
+            ::TranslateMessage(&msg);
+            ::DispatchMessage(&msg);
+        }
+    }
+
+    pool.WaitAll();
+    ThreadPoolStats stats = pool.GetStats();
+    const CCompletionTask* pTasks[] = { static_cast<const CCompletionTask*>(first.get()),
+        static_cast<const CCompletionTask*>(cancelled.get()), static_cast<const CCompletionTask*>(last.get()) };
+    for (int i = 0; i < 3; ++i)
+    {
+        if (pTasks[i]->GetCompletionThread() != ::GetCurrentThreadId())
+            failure = _T("OnComplete wasn't called on this thread");
+    }
+
+    if (stats.run != 2 || stats.cancelled != 1)
+        failure = _T("the thread pool's statistics are wrong");
+
+    // Display the results.
+    CString str;
+    if (failure.IsEmpty())
+        str = _T("Wait, Cancel and WaitAll with OnComplete on this thread passed");
+    else
+        str = _T("Thread pool check failed: ") + failure;
+
+    SendText(str);
+}
+
+// Runs fine grained and coarse grained tasks on thread pools with 1 thread
+// up to one thread per processor. Reports the tasks per second, the speedup
+// over a single thread, and the number of tasks stolen by idle workers.
+void CMainWindow::ThreadPoolTest() const
+{
+    SendText(_T("Thread pool test"));
+
+    const int taskCounts[] = { 100000, 2000 };
+    const int iterations[] = { 100, 200000 };
+    const LPCTSTR names[] = { _T("Fine"), _T("Coarse") };
+    const int processors = CThreadPool::GetProcessorCount();
+
+    for (int test = 0; test < 2; ++test)
+    {
+        double singleRate = 0;
+        int threads = 1;
+        for (;;)
+        {
+            CThreadPool pool;
+            pool.Start(threads);
+
+            LONGLONG start = GetCounter();
+            for (int n = 0; n < taskCounts[test]; ++n)
+                pool.Submit(CSpinTask(iterations[test]));
+
+            pool.WaitAll();
+            LONGLONG end = GetCounter();
+
+            // Display the results.
+            ThreadPoolStats stats = pool.GetStats();
+            double rate = static_cast<double>(taskCounts[test]) * m_frequency / (end - start);
+            if (threads == 1)
+                singleRate = rate;
+
+            CString str;
+            str.Format(_T("%s tasks, %2d threads: %10.0f tasks/sec, speedup %5.2f, %d run, %d stolen"),
+                names[test], threads, rate, rate / singleRate, stats.run, stats.stolen);
+            SendText(str);
+
+            if (threads == processors)
+                break;
+
+            threads = MIN(threads * 2, processors);
+        }
+    }
+}
+
+// Sends events from a worker thread to a window on this thread. Compares
+// posting a message for each event with posting thread tasks, which are run
+// in batches, both without and with coalescing. Reports the events per second
+// and the CPU time used by this thread.
+void CMainWindow::ThreadTaskTest() const
+{
+    SendText(_T("Thread task test (events sent from a worker thread)"));
+
+    const int events = 50000;
+    const LPCTSTR names[] = { _T("Messages"), _T("Tasks"), _T("Coalesced tasks") };
+    CPerformanceApp* pApp = GetPerfApp();
+
+    for (int test = 0; test < 3; ++test)
+    {
+        CEventWindow window;
+        window.Create(*this);
+
+        EventThreadParams params;
+        params.pWindow = &window;
+        params.pPump = (test == 0) ? NULL : pApp;
+        params.key = (test == 2) ? 1 : 0;
+        params.events = events;
+
+        ThreadTaskStats before = pApp->GetThreadTaskStats();
+        FILETIME creation, exit, kernelStart, userStart, kernelEnd, userEnd;
+        ::GetThreadTimes(::GetCurrentThread(), &creation, &exit, &kernelStart, &userStart);
+        LONGLONG start = GetCounter();
+
+        CWorkThread thread(EventThreadProc, &params);
+        thread.CreateThread();
+
+        // Run a message loop until the last event arrives.
+        MSG msg;
+        while (window.GetLastEvent() < events && ::GetMessage(&msg, 0, 0, 0) > 0)
+        {
+            if (msg.hwnd == 0 && msg.message == UWM_RUNTHREADTASKS)
+                pApp->RunThreadTasks();
+            else
+            {
+                ::TranslateMessage(&msg);
+                ::DispatchMessage(&msg);
+            }
+        }
+
+        LONGLONG end = GetCounter();
+        ::GetThreadTimes(::GetCurrentThread(), &creation, &exit, &kernelEnd, &userEnd);
+        ::WaitForSingleObject(thread, INFINITE);
+
+        // Display the results.
+        ULARGE_INTEGER k0, k1, u0, u1;
+        k0.LowPart = kernelStart.dwLowDateTime;  k0.HighPart = kernelStart.dwHighDateTime;
+        k1.LowPart = kernelEnd.dwLowDateTime;    k1.HighPart = kernelEnd.dwHighDateTime;
+        u0.LowPart = userStart.dwLowDateTime;    u0.HighPart = userStart.dwHighDateTime;
+        u1.LowPart = userEnd.dwLowDateTime;      u1.HighPart = userEnd.dwHighDateTime;
+        double cpuMilliseconds = static_cast<double>((k1.QuadPart - k0.QuadPart) + (u1.QuadPart - u0.QuadPart)) / 10000.0;
+
+        const ThreadTaskStats& after = pApp->GetThreadTaskStats();
+        CString str;
+        str.Format(_T("%s: %.0f thousand events/sec, %.0f ms UI thread CPU, %d handled, %d wake-ups"),
+            names[test], 1e-3 * events * m_frequency / (end - start), cpuMilliseconds,
+            window.GetEvents(), (test == 0) ? events : static_cast<int>(after.wakeUps - before.wakeUps));
+        SendText(str);
+        window.Destroy();
+    }
+}
+
 // Process the main window's messages.
 LRESULT CMainWindow::WndProc(UINT msg, WPARAM wparam, LPARAM lparam)
 {
@@ -12,12 +12,286 @@
 
 #define WM_WINDOWCREATED WM_USER + 1   // the message sent when window is created
 #define WM_TESTMESSAGE   WM_USER + 2   // the test message
+#define WM_TESTEVENT     WM_USER + 3   // the event posted by the thread task test
 
 
 // Note: Modern C++ compilers can use this typedef instead.
 // typedef std::shared_ptr<CTestWindow> TestWindowPtr;
 typedef Shared_Ptr<CTestWindow> TestWindowPtr;
 
+
+////////////////////////////////////////////////////////////
+// CEchoSocket is a socket accepted by the socket test's
+// server. It sends back the data it receives.
+class CEchoSocket : public CSocket
+{
+public:
+    CEchoSocket() {}
+    virtual ~CEchoSocket() {}
+
+protected:
+    virtual void OnReceive()
+    {
+        char buffer[64];
+        int bytes = Receive(buffer, sizeof(buffer), 0);
+        if (bytes > 0)
+            Send(buffer, bytes, 0);
+    }
+};
+
+typedef Shared_Ptr<CEchoSocket> EchoSocketPtr;
+
+////////////////////////////////////////////////////////////
+// CTestServer is the socket test's listening socket. It
+// accepts connections on CEchoSockets. The echo sockets use
+// the engine if one is specified, or threads of their own.
+class CTestServer : public CSocket
+{
+public:
+    CTestServer(CSocketEngine* pEngine) : m_pEngine(pEngine), m_accepted(0) {}
+    virtual ~CTestServer() {}
+    LONG GetAccepted() const { return m_accepted; }
+
+protected:
+    virtual void OnAccept()
+    {
+        EchoSocketPtr pSocket(new CEchoSocket);
+        Accept(*pSocket, NULL, NULL);
+        if (m_pEngine)
+            pSocket->StartEvents(*m_pEngine);
+        else
+            pSocket->StartEvents();
+
+        CThreadLock lock(m_socketsLock);
+        m_sockets.push_back(pSocket);
+        InterlockedIncrement(&m_accepted);
+    }
+
+private:
+    std::vector<EchoSocketPtr> m_sockets;
+    CCriticalSection m_socketsLock;
+    CSocketEngine* m_pEngine;
+    volatile LONG m_accepted;
+};
+
+////////////////////////////////////////////////////////////
+// CTestClient is a client socket for the socket test. It
+// measures the time taken for its message to be echoed.
+class CTestClient : public CSocket
+{
+public:
+    CTestClient(volatile LONG& received) : m_received(received), m_sent(0), m_latency(0) {}
+    virtual ~CTestClient() {}
+    LONGLONG GetLatency() const { return m_latency; }
+
+    void SendTestMessage()
+    {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        m_sent = counter.QuadPart;
+        Send("ping", 4, 0);
+    }
+
+protected:
+    virtual void OnReceive()
+    {
+        char buffer[64];
+        if (Receive(buffer, sizeof(buffer), 0) > 0)
+        {
+            LARGE_INTEGER counter;
+            QueryPerformanceCounter(&counter);
+            m_latency = counter.QuadPart - m_sent;
+            InterlockedIncrement(&m_received);
+        }
+    }
+
+private:
+    volatile LONG& m_received;
+    LONGLONG m_sent;
+    LONGLONG m_latency;
+};
+
+typedef Shared_Ptr<CTestClient> TestClientPtr;
+
+////////////////////////////////////////////////////////////
+// CEventWindow receives the events sent by the thread task
+// test's worker thread, as messages or as thread tasks.
+class CEventWindow : public CWnd
+{
+public:
+    CEventWindow() : m_events(0), m_lastEvent(0) {}
+    virtual ~CEventWindow() {}
+    int  GetEvents() const { return m_events; }
+    int  GetLastEvent() const { return m_lastEvent; }
+    void OnEvent(int event) { ++m_events; m_lastEvent = event; }
+
+protected:
+    virtual LRESULT WndProc(UINT msg, WPARAM wparam, LPARAM lparam)
+    {
+        if (msg == WM_TESTEVENT)
+        {
+            OnEvent(static_cast<int>(wparam));
+            return 0;
+        }
+
+        return WndProcDefault(msg, wparam, lparam);
+    }
+
+private:
+    int m_events;
+    int m_lastEvent;
+};
+
+
+////////////////////////////////////////////////////////////
+// CEventTask is the function object the thread task test's
+// worker thread posts as a thread task.
+class CEventTask
+{
+public:
+    CEventTask(CEventWindow& window, int event) : m_pWindow(&window), m_event(event) {}
+    void operator()() const { m_pWindow->OnEvent(m_event); }
+
+private:
+    CEventWindow* m_pWindow;
+    int m_event;
+};
+
+
+// The parameters of the thread task test's worker thread.
+struct EventThreadParams
+{
+    CEventWindow* pWindow;   // The window which receives the events
+    CMessagePump* pPump;     // The message pump to post thread tasks to, or NULL to post messages
+    UINT_PTR key;            // The key used to coalesce the thread tasks
+    int events;              // The number of events to send
+};
+
+
+////////////////////////////////////////////////////////////
+// CIdleCounter is the function object posted as an idle task
+// by the idle task test. It increments a counter.
+class CIdleCounter
+{
+public:
+    CIdleCounter(int& count) : m_pCount(&count) {}
+    void operator()() const { ++*m_pCount; }
+
+private:
+    int* m_pCount;
+};
+
+
+////////////////////////////////////////////////////////////
+// CSpinTask is the function object submitted to the thread
+// pool by the thread pool test. It performs a fixed amount
+// of arithmetic.
+class CSpinTask
+{
+public:
+    CSpinTask(int iterations) : m_iterations(iterations) {}
+    void operator()() const
+    {
+        UINT value = static_cast<UINT>(m_iterations);
+        for (int i = 0; i < m_iterations; ++i)
+            value = value * 1664525 + 1013904223;
+
+        m_result = value;
+    }
+
+private:
+    int m_iterations;
+    mutable volatile UINT m_result;   // Prevents the loop being optimized away
+};
+
+
+////////////////////////////////////////////////////////////
+// CCompletionTask is the task used by the thread pool check.
+// It waits for the gate event, and records the thread which
+// calls its OnComplete.
+class CCompletionTask : public CPoolTask
+{
+public:
+    CCompletionTask(HANDLE started, HANDLE gate, int& completions)
+        : m_started(started), m_gate(gate), m_pCompletions(&completions), m_completionThread(0) {}
+    virtual ~CCompletionTask() {}
+    DWORD GetCompletionThread() const { return m_completionThread; }
+
+protected:
+    virtual void OnComplete()
+    {
+        m_completionThread = ::GetCurrentThreadId();
+        ++*m_pCompletions;
+    }
+
+    virtual void Run()
+    {
+        ::SetEvent(m_started);
+        ::WaitForSingleObject(m_gate, INFINITE);
+    }
+
+private:
+    HANDLE m_started;
+    HANDLE m_gate;
+    int* m_pCompletions;
+    DWORD m_completionThread;
+};
+
+
+////////////////////////////////////////////////////////////
+// CTestScrollView is the view used by the scroll view test.
+// It draws a grid with labelled cells, skipping the parts
+// outside the clip box.
+class CTestScrollView : public CScrollView
+{
+public:
+    CTestScrollView() {}
+    virtual ~CTestScrollView() {}
+
+protected:
+    virtual void OnDraw(CDC& dc)
+    {
+        CRect clipRect;
+        dc.GetClipBox(clipRect);
+        CSize total = GetTotalScrollSize();
+        int right = MIN(clipRect.right, total.cx);
+        int bottom = MIN(clipRect.bottom, total.cy);
+        const int grid = 50;
+
+        for (int x = clipRect.left - clipRect.left % grid; x <= right; x += grid)
+        {
+            dc.MoveTo(x, clipRect.top);
+            dc.LineTo(x, bottom);
+        }
+
+        for (int y = clipRect.top - clipRect.top % grid; y <= bottom; y += grid)
+        {
+            dc.MoveTo(clipRect.left, y);
+            dc.LineTo(right, y);
+        }
+
+        for (int y = clipRect.top - clipRect.top % (4 * grid); y < bottom; y += 4 * grid)
+        {
+            for (int x = clipRect.left - clipRect.left % (4 * grid); x < right; x += 4 * grid)
+            {
+                CString label;
+                label.Format(_T("%d, %d"), x, y);
+                dc.TextOut(x + 4, y + 4, label);
+            }
+        }
+    }
+
+    virtual void PreCreate(CREATESTRUCT& cs)
+    {
+        CScrollView::PreCreate(cs);
+        cs.style = WS_POPUP | WS_VISIBLE | WS_BORDER | WS_HSCROLL | WS_VSCROLL;
+        cs.x = 420;
+        cs.y = 50;
+        cs.cx = 640;
+        cs.cy = 480;
+    }
+};
+
 ///////////////////////////////////////////////////////////
 // CMainWindow manages the main window for the application.
 class CMainWindow : public CWnd
@@ -41,10 +315,32 @@ private:
     virtual LRESULT OnSize();
     virtual LRESULT OnWindowCreated();
 
+    void ArchiveTest() const;
+    void BackBufferTest() const;
+    void FormatTest() const;
+    void GradientTest() const;
     LONGLONG GetCounter() const;
+    void HandleMapTest() const;
+    void IdleTaskTest() const;
+    void LookupTest(HWND hWnd) const;
     void OnAllWindowsCreated();
     void PerformanceTest() const;
+    void PixelCheck() const;
+    void PixelTest() const;
+    void PreTranslateTest() const;
+    bool ReceiveAll(const CSocket& socket, char* buf, int len) const;
+    bool ReceiveMessage(const CSocket& socket, CSocketBuffer& buffer) const;
+    void ScatterGatherTest() const;
+    void ScrollViewTest() const;
     void SendText(LPCTSTR str) const;
+    void SocketTest() const;
+    void StringTest() const;
+    void TextConversionTest() const;
+    void ThreadPoolCheck() const;
+    void ThreadPoolTest() const;
+    void ThreadTaskTest() const;
+
+    static UINT WINAPI EventThreadProc(LPVOID pParam);
 
     // Member variables
     std::vector<TestWindowPtr> m_pTestWindows; // A vector CTestWindow smart pointers
@@ -18,6 +18,9 @@ public:
     CPerformanceApp();
     virtual ~CPerformanceApp();
     CMainWindow& GetMainWnd() {return m_mainWnd;}
+    BOOL PreTranslate(MSG& msg) { return PreTranslateMessage(msg); }
+    BOOL RunIdle() { return RunIdleTasks(); }
+    void RunThreadTasks() { ProcessThreadTasks(); }
 
 protected:
     // Virtual functions that override base class functions
@@ -0,0 +1,168 @@
+/////////////////////////////
+// PixelCheck.h
+//
+
+#ifndef PIXELCHECK_H
+#define PIXELCHECK_H
+
+
+// The pixel check compares the pixel functions with the loops CBitmap used
+// before them. The functions are included a second time in the PortablePixels
+// namespace with WXX_NO_SSE2 defined, so the SSE2 code and the portable code
+// can be checked in the same build.
+#ifdef WXX_SSE2
+  #define PIXELCHECK_SSE2
+  #undef WXX_SSE2
+#endif
+
+#ifndef WXX_NO_SSE2
+  #define PIXELCHECK_NO_SSE2
+  #define WXX_NO_SSE2
+#endif
+
+#undef _WIN32XX_PIXELS_H_
+#define Win32xx PortablePixels
+#include <wxx_pixels.h>
+#undef Win32xx
+
+#ifdef PIXELCHECK_NO_SSE2
+  #undef WXX_NO_SSE2
+  #undef PIXELCHECK_NO_SSE2
+#endif
+
+#ifdef PIXELCHECK_SSE2
+  #define WXX_SSE2
+  #undef PIXELCHECK_SSE2
+#endif
+
+
+// The loops used by CBitmap's ConvertToDisabled, GrayScaleBitmap and
+// TintBitmap before the pixel functions were added.
+namespace LegacyPixels
+{
+    inline void ConvertToDisabledPixels(BYTE* bits, int width, int height, int stride,
+                                        int bytesPerPixel, int maskBlue, int maskGreen, int maskRed)
+    {
+        int yOffset = 0;
+        int xOffset;
+        size_t index;
+
+        for (int row = 0; row < height; ++row)
+        {
+            xOffset = 0;
+
+            for (int column = 0; column < width; ++column)
+            {
+                // Calculate index
+                index = size_t(yOffset) + size_t(xOffset);
+
+                // skip for colors matching the mask
+                if ((bits[index + 0] != maskBlue) &&
+                    (bits[index + 1] != maskGreen) &&
+                    (bits[index + 2] != maskRed))
+                {
+                    BYTE byGray = BYTE(95 + (bits[index + 2] * 3 + bits[index + 1] * 6 + bits[index + 0]) / 20);
+                    bits[index] = byGray;
+                    bits[index + 1] = byGray;
+                    bits[index + 2] = byGray;
+                }
+
+                // Increment the horizontal offset
+                xOffset += bytesPerPixel;
+            }
+
+            // Increment vertical offset
+            yOffset += stride;
+        }
+    }
+
+    inline void GrayScalePixels(BYTE* pByteArray, int width, int height, int stride, int bytesPerPixel)
+    {
+        int yOffset = 0;
+        int xOffset;
+        size_t index;
+
+        for (int row=0; row < height; ++row)
+        {
+            xOffset = 0;
+
+            for (int column=0; column < width; ++column)
+            {
+                // Calculate index
+                index = size_t(yOffset) + size_t(xOffset);
+
+                BYTE byGray = (BYTE) ((pByteArray[index] + pByteArray[index +1]*6 + pByteArray[index +2] *3)/10);
+                pByteArray[index]   = byGray;
+                pByteArray[index +1] = byGray;
+                pByteArray[index +2] = byGray;
+
+                // Increment the horizontal offset
+                xOffset += bytesPerPixel;
+            }
+
+            // Increment vertical offset
+            yOffset += stride;
+        }
+    }
+
+    inline void TintPixels(BYTE* pByteArray, int width, int height, int stride, int bytesPerPixel,
+                           int cRed, int cGreen, int cBlue)
+    {
+        // Ensure sane color correction values
+        cBlue  = MIN(cBlue, 255);
+        cBlue  = MAX(cBlue, -255);
+        cRed   = MIN(cRed, 255);
+        cRed   = MAX(cRed, -255);
+        cGreen = MIN(cGreen, 255);
+        cGreen = MAX(cGreen, -255);
+
+        // Pre-calculate the RGB modification values
+        int b1 = 256 - cBlue;
+        int g1 = 256 - cGreen;
+        int r1 = 256 - cRed;
+
+        int b2 = 256 + cBlue;
+        int g2 = 256 + cGreen;
+        int r2 = 256 + cRed;
+
+        // Modify the color
+        int yOffset = 0;
+        int xOffset;
+        size_t index;
+        for (int Row=0; Row < height; ++Row)
+        {
+            xOffset = 0;
+
+            for (int Column=0; Column < width; ++Column)
+            {
+                // Calculate index
+                index = size_t(yOffset) + size_t(xOffset);
+
+                // Adjust the color values
+                if (cBlue > 0)
+                    pByteArray[index]   = (BYTE)(cBlue + (((pByteArray[index] *b1)) >>8));
+                else if (cBlue < 0)
+                    pByteArray[index]   = (BYTE)((pByteArray[index] *b2) >>8);
+
+                if (cGreen > 0)
+                    pByteArray[index+1] = (BYTE)(cGreen + (((pByteArray[index+1] *g1)) >>8));
+                else if (cGreen < 0)
+                    pByteArray[index+1] = (BYTE)((pByteArray[index+1] *g2) >>8);
+
+                if (cRed > 0)
+                    pByteArray[index+2] = (BYTE)(cRed + (((pByteArray[index+2] *r1)) >>8));
+                else if (cRed < 0)
+                    pByteArray[index+2] = (BYTE)((pByteArray[index+2] *r2) >>8);
+
+                // Increment the horizontal offset
+                xOffset += bytesPerPixel;
+            }
+
+            // Increment vertical offset
+            yOffset += stride;
+        }
+    }
+}
+
+
+#endif  // PIXELCHECK_H
@@ -57,6 +57,7 @@
 #include <wxx_menubar.h>        // Add CMenuBar
 #include <wxx_metafile.h>       // Add CMetaFile, CEnhMetaFile
 #include <wxx_mutex.h>          // Add CEvent, CMutex, CSemaphore
+#include <wxx_pixels.h>         // Add ConvertToDisabledPixels, GrayScalePixels, TintPixels
 #include <wxx_propertysheet.h>  // Add CPropertyPage, CPropertySheet
 #include <wxx_rebar.h>          // Add CRebar
 #include <wxx_rect.h>           // Add CPoint, CRect, CSize
@@ -72,6 +73,7 @@
 #include <wxx_textconv.h>       // Add AtoT, AtoW, TtoA, TtoW, WtoA, WtoT etc.
 #include <wxx_themes.h>         // Add MenuTheme, ReBarTheme, StatusBarTheme, ToolBarTheme
 #include <wxx_thread.h>         // Add CWinThread
+#include <wxx_threadpool.h>     // Add CPoolTask, CThreadPool
 #include <wxx_time.h>           // Add CTime
 #include <wxx_toolbar.h>        // Add CToolBar
 #include <wxx_treeview.h>       // Add CTreeView
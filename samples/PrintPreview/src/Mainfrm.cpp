@@ -10,6 +10,35 @@
   #define SF_USECODEPAGE    0x0020
 #endif
 
+
+////////////////////////////////////////////////////////
+// Renders the page bitmap as CPreviewPane::Render did
+// before it cached the page's pixels. The DIB is
+// extracted from the bitmap and stretched with every
+// paint. It is used as the baseline for the benchmark.
+//
+static void LegacyRenderPreview(CPreviewPane& pane, CBitmap& bitmap, CDC& dc)
+{
+    BITMAP bm = bitmap.GetBitmapData();
+    CRect rcPreview = pane.GetPreviewRect(bm.bmWidth, bm.bmHeight);
+
+    // Extract the device independent image data.
+    CBitmapInfoPtr pbmi(bitmap);
+    BITMAPINFOHEADER* pBIH = reinterpret_cast<BITMAPINFOHEADER*>(pbmi.get());
+    CMemDC memDC(dc);
+    memDC.GetDIBits(bitmap, 0, bm.bmHeight, NULL, pbmi, DIB_RGB_COLORS);
+    std::vector<byte> byteArray(pBIH->biSizeImage, 0);
+    byte* pByteArray = &byteArray.front();
+    memDC.GetDIBits(bitmap, 0, bm.bmHeight, pByteArray, pbmi, DIB_RGB_COLORS);
+
+    // Copy the DIB bitmap data to the DC with half tone stretching.
+    dc.SetStretchBltMode(HALFTONE);
+    dc.SetBrushOrgEx(0, 0);
+    dc.StretchDIBits(rcPreview.left, rcPreview.top, rcPreview.Width(), rcPreview.Height(), 0, 0,
+           bm.bmWidth, bm.bmHeight, pByteArray, pbmi, DIB_RGB_COLORS, SRCCOPY);
+}
+
+
 //////////////////////////////////
 // CMainFrame function definitions
 //
@@ -616,6 +645,74 @@ BOOL CMainFrame::ReadFile(LPCTSTR szFileName)
     return TRUE;
 }
 
+// Measures the time taken to paint the print preview. The page is an A4
+// page of text at 600 dpi, reduced by 4 as CPrintPreview does. Extracting
+// and stretching the page with every paint is compared with painting the
+// cached scaled pixels, and with a new page or size, which is scaled again.
+// A printer isn't required.
+CString CMainFrame::RunPreviewBenchmark()
+{
+    const int paints = 50;
+    const int pageWidth = 4960 / 4;
+    const int pageHeight = 7016 / 4;
+
+    // Draw a page of text.
+    CClientDC desktopDC(HWND_DESKTOP);
+    CMemDC pageDC(desktopDC);
+    pageDC.CreateCompatibleBitmap(desktopDC, pageWidth, pageHeight);
+    pageDC.FillRect(CRect(0, 0, pageWidth, pageHeight), (HBRUSH)::GetStockObject(WHITE_BRUSH));
+    for (int line = 0; line < 100; ++line)
+    {
+        CString text;
+        text.Format(_T("Line %d of the print preview benchmark. The quick brown fox jumps over the lazy dog."), line + 1);
+        pageDC.TextOut(60, 60 + line * 16, text, text.GetLength());
+    }
+
+    CBitmap bitmap = pageDC.DetachBitmap();
+
+    // Display the preview.
+    SetView(m_preview);
+    CPreviewPane& pane = m_preview.GetPreviewPane();
+    pane.SetBitmap(bitmap);
+    CClientDC dc(pane);
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER times[4];
+
+    QueryPerformanceCounter(&times[0]);
+    for (int i = 0; i < paints; ++i)
+        LegacyRenderPreview(pane, bitmap, dc);
+
+    QueryPerformanceCounter(&times[1]);
+    for (int i = 0; i < paints; ++i)
+        pane.Render(dc);
+
+    QueryPerformanceCounter(&times[2]);
+    for (int i = 0; i < paints; ++i)
+    {
+        PreviewImagePtr pImage = pane.GetImage();
+        pImage->scaledWidth = 0;    // Force the page to be scaled again.
+        pane.Render(dc);
+    }
+
+    QueryPerformanceCounter(&times[3]);
+
+    LPCTSTR names[] = { _T("Extract and stretch"), _T("Cached pixels"), _T("New page or size") };
+    CString report;
+    report.Format(_T("Milliseconds per paint, %d x %d page, %d paints\n\n"), pageWidth, pageHeight, paints);
+    for (int t = 0; t < 3; ++t)
+    {
+        double elapsed = double(times[t + 1].QuadPart - times[t].QuadPart) * 1.0e3 / double(frequency.QuadPart) / paints;
+        CString line;
+        line.Format(_T("%s\t%.2f\n"), names[t], elapsed);
+        report += line;
+    }
+
+    SetView(m_richView);
+    return report;
+}
+
 // Asks to save the file if the text has been modified.
 void CMainFrame::SaveModifiedText()
 {
@@ -19,6 +19,7 @@ public:
     virtual ~CMainFrame();
     virtual HWND Create(HWND parent = 0);
     void OnToolbarUpdate();
+    CString RunPreviewBenchmark();
 
 protected:
     // Virtual functions that override base class functions
@@ -21,6 +21,17 @@ BOOL CTextApp::InitInstance()
     //Create the Frame Window
     m_frame.Create();   // throws a CWinException on failure
 
+    // Run the preview benchmark instead if the /benchmark command line
+    // argument is specified.
+    std::vector<CString> args = GetCommandLineArgs();
+    if (std::find(args.begin(), args.end(), CString(_T("/benchmark"))) != args.end())
+    {
+        CString report = m_frame.RunPreviewBenchmark();
+        ::MessageBox(NULL, report, _T("Preview Benchmark"), MB_OK);
+        m_frame.Destroy();
+        return FALSE;
+    }
+
     return TRUE;
 }
 
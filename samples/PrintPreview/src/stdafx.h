@@ -25,6 +25,7 @@
 
 // Rarely modified header files should be included here
 #include <vector>               // Add support for std::vector
+#include <algorithm>            // Add support for std::find
 #include <map>                  // Add support for std::map
 #include <string>               // Add support for std::string
 #include <sstream>              // Add support for stringstream
@@ -8,10 +8,18 @@
     Contents Description: Implementation of the CDoc class for this sample
     program using the Win32++ Windows interface classes.
 
-    The embodiment of a document in this class is in the form of a vector of
-    UTF-16 Little Endean Unicode strings, one for each line of the document,
-    whether compiled in ANSI or Unicode mode. It therefore requires a CView
-    class capable of displaying this encoding.
+    The embodiment of a document in this class is a mapping of the file,
+    together with an index of where its lines start. The file is read
+    through views of up to INDEX_CHUNK_BYTES, mapped when they are needed,
+    so files larger than the address space of a 32 bit process can be read.
+    Lines are decoded into UTF-16 Little Endean Unicode strings when they
+    are requested, whether compiled in ANSI or Unicode mode. It therefore
+    requires a CView class capable of displaying this encoding.
+
+    Only the start of a large file is indexed before OpenDoc returns. The
+    rest is indexed by a separate thread, so that files of several
+    gigabytes can be opened and scrolled without waiting for them to be
+    read.
 
     Programming Notes: The programming standards roughly follow those
     established by the 1997-1999 Jet Propulsion Laboratory Network Planning
@@ -26,38 +34,152 @@
 #pragma warning ( disable : 26812 ) // allow unscoped enum types
 #endif
 
+  // the number of lines between the entries of the line index
+static const UINT LINES_PER_CHECKPOINT = 32;
+  // the number of decoded lines kept in the cache
+static const UINT CACHE_LINES = 512;
+  // the number of bytes indexed before OpenDoc returns
+static const ULONGLONG FIRST_INDEX_BYTES = 1024 * 1024;
+  // the number of bytes the indexing thread indexes at a time
+static const ULONGLONG INDEX_CHUNK_BYTES = 16 * 1024 * 1024;
+  // the minimum time, in milliseconds, between UWM_DOCINDEXED messages
+static const DWORD NOTIFY_INTERVAL = 250;
+  // the tab stops used when lines are decoded
+static const int TAB_WIDTH = 8;
+  // the number of bytes of a line that are decoded. Longer lines are
+  // truncated, so the view of a line stays small.
+static const ULONGLONG MAX_LINE_BYTES = 1024 * 1024;
+
+/*============================================================================*/
+    CFileWindow::
+CFileWindow()                                                               /*
+
+    Constructor. Views are aligned to the system's allocation granularity.
+*-----------------------------------------------------------------------------*/
+    :   m_mapping(0), m_fileLength(0), m_pView(NULL), m_viewStart(0),
+        m_viewEnd(0), m_granularity(0)
+{
+    SYSTEM_INFO info;
+    ::GetSystemInfo(&info);
+    m_granularity = info.dwAllocationGranularity;
+}
+
+/*============================================================================*/
+    CFileWindow::
+~CFileWindow()                                                              /*
+
+    Destructor.
+*-----------------------------------------------------------------------------*/
+{
+    Unmap();
+}
+
+/*============================================================================*/
+    const char* CFileWindow::
+Map(ULONGLONG start, ULONGLONG end)                                         /*
+
+    Return a pointer to the byte at the start offset of the file, which
+    remains valid, along with the bytes up to the end offset, until the
+    next call to Map. The view is only moved if these bytes are outside it.
+    A new view starts at the aligned offset before start, and is at least
+    INDEX_CHUNK_BYTES long, unless the file ends first. Return NULL if
+    start equals end. Throw a CFileException if the view can't be mapped.
+*-----------------------------------------------------------------------------*/
+{
+    assert(start <= end && end <= m_fileLength);
+    if (start == end)
+        return NULL;
+
+    if (m_pView == NULL || start < m_viewStart || end > m_viewEnd)
+    {
+        Unmap();
+        ULONGLONG viewStart = start - start % m_granularity;
+        ULONGLONG viewEnd   = MIN(MAX(end, viewStart + INDEX_CHUNK_BYTES),
+            m_fileLength);
+        m_pView = static_cast<const char*>(::MapViewOfFile(m_mapping,
+            FILE_MAP_READ, static_cast<DWORD>(viewStart >> 32),
+            static_cast<DWORD>(viewStart & 0xffffffff),
+            static_cast<SIZE_T>(viewEnd - viewStart)));
+        if (m_pView == NULL)
+            throw CFileException(_T("Reading the file failed."));
+
+        m_viewStart = viewStart;
+        m_viewEnd   = viewEnd;
+    }
+    return m_pView + (start - m_viewStart);
+}
+
+/*============================================================================*/
+    void CFileWindow::
+SetMapping(HANDLE mapping, ULONGLONG fileLength)                            /*
+
+    Set the file mapping object the views are mapped from, and the length
+    of its file. Any current view is unmapped.
+*-----------------------------------------------------------------------------*/
+{
+    Unmap();
+    m_mapping    = mapping;
+    m_fileLength = fileLength;
+}
+
+/*============================================================================*/
+    void CFileWindow::
+Unmap()                                                                     /*
+
+    Unmap the current view, if there is one.
+*-----------------------------------------------------------------------------*/
+{
+    if (m_pView != NULL)
+        VERIFY(::UnmapViewOfFile(m_pView));
+
+    m_pView = NULL;
+    m_viewStart = m_viewEnd = 0;
+}
+
 /*============================================================================*/
     CDoc::
 CDoc()                                                                      /*
 
     Constructor.
 *-----------------------------------------------------------------------------*/
-    :   m_isOpen(FALSE), m_width(0)
+    :   m_mapping(0), m_isOpen(FALSE), m_width(0), m_notifyWnd(0),
+        m_lineCount(0), m_indexed(0), m_docEnd(0), m_encoding(unknown),
+        m_docStart(0), m_scanned(0), m_indexThread(IndexThreadProc, this),
+        m_stopIndexing(0), m_notifyTime(0)
 {
 }
 
 /*============================================================================*/
-    void CDoc::
-AddRecord(const CStringW& entry)                                            /*
+    CDoc::
+~CDoc()                                                                     /*
 
-    Enter the entry record into the m_doclines list. Expand tab characters
-    with spaces to conform with tabwidth spacing.
+    Destructor. Stop the indexing thread before the file is unmapped.
 *-----------------------------------------------------------------------------*/
 {
-    int tabwidth    = 8;
-    CStringW final  = entry;
-    int tab         = 0;
-    CStringW spaces = L"                            "; // tabs <= 28
-    CStringW tabbing;
-    while ((tab = final.Find(L'\t')) != -1)
+    StopIndexing();
+    m_indexWindow.Unmap();
+    m_lineWindow.Unmap();
+    if (m_mapping != 0)
+        ::CloseHandle(m_mapping);
+}
+
+/*============================================================================*/
+    CStringW& CDoc::
+AddToCache(UINT line)                                                       /*
+
+    Add an empty entry for the given line to the front of the cache of
+    decoded lines, discarding the least recently used line if the cache is
+    full. Return the entry's string for the line to be decoded into.
+*-----------------------------------------------------------------------------*/
+{
+    if (m_cacheIndex.size() >= CACHE_LINES)
     {
-        final.Delete(tab, 1);
-        int nspaces = tabwidth - (tab % tabwidth);
-        tabbing = (nspaces == 0 ?
-            spaces.Left(tabwidth) : spaces.Left(nspaces));
-        final.Insert(tab, tabbing);
+        m_cacheIndex.erase(m_cache.back().first);
+        m_cache.pop_back();
     }
-    m_doclines.push_back(final);
+    m_cache.push_front(std::make_pair(line, CStringW()));
+    m_cacheIndex[line] = m_cache.begin();
+    return m_cache.front().second;
 }
 
 /*============================================================================*/
@@ -69,18 +191,74 @@ CloseDoc()                                                                  /*
     Serialize() member.
 *-----------------------------------------------------------------------------*/
 {
-    m_isOpen = FALSE;
-    m_width  = 0;
-    m_doclines.clear();
+    StopIndexing();
+    m_indexWindow.SetMapping(0, 0);
+    m_lineWindow.SetMapping(0, 0);
+    if (m_mapping != 0)
+        ::CloseHandle(m_mapping);
+
+    m_mapping   = 0;
+    m_file.Close();
+    m_isOpen    = FALSE;
+    m_width     = 0;
+    m_checkpoints.clear();
+    m_lineCount = 0;
+    m_indexed   = m_docEnd = m_docStart = m_scanned = 0;
+    m_cache.clear();
+    m_cacheIndex.clear();
     return TRUE;
 }
 
+/*============================================================================*/
+    void CDoc::
+DecodeLine(ULONGLONG start, ULONGLONG end, CStringW& text)                  /*
+
+    Decode the characters of the file image from the start offset to the
+    end offset into the text string, removing carriage returns and expanding
+    tab characters. Only the first MAX_LINE_BYTES of a line are decoded.
+*-----------------------------------------------------------------------------*/
+{
+    if (end - start > MAX_LINE_BYTES)
+        end = start + MAX_LINE_BYTES;
+
+    const char* pLine = m_lineWindow.Map(start, end);
+    int length = static_cast<int>(end - start);
+    if (GetCharSize() == 1)
+    {
+          // determine the text conversion code page to use
+        UINT CPage = (m_encoding == ANSI ? CP_ACP : CP_UTF8);
+        int widelen = (length == 0 ? 0 : ::MultiByteToWideChar(CPage, 0,
+            pLine, length, NULL, 0));
+        std::vector<WCHAR> wideArray(size_t(widelen) + 1, L'\0');
+        if (widelen > 0)
+            ::MultiByteToWideChar(CPage, 0, pLine, length, &wideArray[0],
+                widelen);
+        ExpandTabs(&wideArray[0], widelen, text);
+    }
+    else
+    {
+        const WCHAR* pWStr = reinterpret_cast<const WCHAR*>(pLine);
+        int size = length / 2;
+        if (m_encoding == UTF16BE)
+        {
+              // reverse the bytes of each character
+            std::vector<WCHAR> wideArray(size_t(size) + 1, L'\0');
+            for (int i = 0; i < size; i++)
+                wideArray[i] = ByteReverse(pWStr[i]);
+
+            ExpandTabs(&wideArray[0], size, text);
+        }
+        else
+            ExpandTabs(pWStr, size, text);
+    }
+}
+
 /*============================================================================*/
     Encoding    CDoc::
-DetermineEncoding(UINT testlen, UINT& offset)                               /*
+DetermineEncoding(const char* buffer, UINT testlen, UINT& offset)           /*
 
     Try to determine the file encoding using the first testlen bytes in the
-    file image m_buffer. Return the presumed encoding and the BOM offset,
+    file image buffer. Return the presumed encoding and the BOM offset,
     if any.
 *----------------------------------------------------------------------------*/
 {
@@ -89,7 +267,6 @@ DetermineEncoding(UINT testlen, UINT& offset)                               /*
         return UTF8noBOM;
 
     Encoding encoding = ANSI;
-    char* buffer = &m_buffer[0];
       // look for a Byte Order Mark (BOM)
     unsigned char b0 = buffer[0], b1 = buffer[1], b2 = buffer[2];
     if (b0 == 0xfe && b1 == 0xff)
@@ -118,14 +295,161 @@ DetermineEncoding(UINT testlen, UINT& offset)                               /*
     return encoding;
 }
 
+/*============================================================================*/
+    void CDoc::
+ExpandTabs(const WCHAR* source, int length, CStringW& text)                 /*
+
+    Copy the length characters of source to text, skipping carriage returns
+    and expanding tab characters with spaces to conform with the tabwidth
+    spacing.
+*-----------------------------------------------------------------------------*/
+{
+    int tabs = 0;
+    for (int i = 0; i < length; i++)
+    {
+        if (source[i] == L'\t')
+            ++tabs;
+    }
+
+    WCHAR* dest = text.GetBuffer(length + tabs * (TAB_WIDTH - 1) + 1);
+    int col = 0;
+    for (int i = 0; i < length; i++)
+    {
+        WCHAR w = source[i];
+        if (w == L'\t')
+        {
+            int nspaces = TAB_WIDTH - (col % TAB_WIDTH);
+            while (nspaces-- > 0)
+                dest[col++] = L' ';
+        }
+        else if (w != L'\r')
+            dest[col++] = w;
+    }
+    text.ReleaseBuffer(col);
+}
+
+/*============================================================================*/
+    ULONGLONG CDoc::
+FindLineEnd(CFileWindow& window, ULONGLONG start, ULONGLONG end) const      /*
+
+    Return the offset of the first end-of-line character at or after start,
+    or end if there is none before end. In wide character files, a null
+    character also ends a line. The file is scanned through the window, up
+    to INDEX_CHUNK_BYTES at a time.
+*-----------------------------------------------------------------------------*/
+{
+    WCHAR newline = (m_encoding == UTF16BE ? 0x0a00 : 0x000a);
+    while (start < end)
+    {
+        ULONGLONG pieceEnd = MIN(end, start + INDEX_CHUNK_BYTES);
+        const char* pStart = window.Map(start, pieceEnd);
+        size_t bytes = static_cast<size_t>(pieceEnd - start);
+        if (GetCharSize() == 1)
+        {
+              // memchr is optimized by the run time library to test many
+              // bytes at a time, which makes this scan several times faster
+              // than a loop testing one character at a time.
+            const void* p = memchr(pStart, '\n', bytes);
+            if (p != NULL)
+                return start + (static_cast<const char*>(p) - pStart);
+        }
+        else
+        {
+            const WCHAR* p    = reinterpret_cast<const WCHAR*>(pStart);
+            const WCHAR* last = p + bytes / 2;
+            while (p < last && *p != newline && *p != 0)
+                ++p;
+
+            if (p < last)
+                return start + (reinterpret_cast<const char*>(p) - pStart);
+        }
+        start = pieceEnd;
+    }
+    return end;
+}
+
+/*============================================================================*/
+    WCHAR CDoc::
+GetCharAt(CFileWindow& window, ULONGLONG offset) const                      /*
+
+    Return the character at the given offset in the file image, read through
+    the window. Byte encoded characters are not decoded.
+*-----------------------------------------------------------------------------*/
+{
+    const char* p = window.Map(offset, offset + GetCharSize());
+    if (GetCharSize() == 1)
+        return static_cast<unsigned char>(*p);
+
+    WCHAR w = *reinterpret_cast<const WCHAR*>(p);
+    return (m_encoding == UTF16BE ? ByteReverse(w) : w);
+}
+
+/*============================================================================*/
+    UINT CDoc::
+GetCharSize() const                                                         /*
+
+    Return the size, in bytes, of the file's character units.
+*-----------------------------------------------------------------------------*/
+{
+    return (m_encoding == UTF16LE || m_encoding == UTF16BE ? 2 : 1);
+}
+
 /*============================================================================*/
     UINT CDoc::
 GetLength()                                                                 /*
 
-    Return the document length, in records.
+    Return the document length, in records. This grows while the document
+    is being indexed.
 *----------------------------------------------------------------------------*/
 {
-      return static_cast<UINT>(m_doclines.size());
+    CThreadLock lock(m_indexLock);
+    return m_lineCount;
+}
+
+/*============================================================================*/
+    const CStringW& CDoc::
+GetLine(UINT rcd)                                                           /*
+
+    Return the decoded text of the document rcd record. The reference
+    remains valid until the next call to GetLine or GetRecord. An empty
+    line is returned if the file can't be read.
+*-----------------------------------------------------------------------------*/
+{
+    if (!m_isOpen || rcd >= GetLength())
+        return m_emptyLine;
+
+      // use the cached line, if there is one, and make it the most
+      // recently used
+    std::map<UINT, LineCache::iterator>::iterator it = m_cacheIndex.find(rcd);
+    if (it != m_cacheIndex.end())
+    {
+        m_cache.splice(m_cache.begin(), m_cache, it->second);
+        return it->second->second;
+    }
+
+      // find the line from the nearest indexed line before it
+    ULONGLONG start;
+    ULONGLONG docEnd;
+    {
+        CThreadLock lock(m_indexLock);
+        start  = m_checkpoints[rcd / LINES_PER_CHECKPOINT];
+        docEnd = m_docEnd;
+    }
+    try
+    {
+        for (UINT i = rcd % LINES_PER_CHECKPOINT; i > 0; i--)
+            start = FindLineEnd(m_lineWindow, start, docEnd) + GetCharSize();
+
+        ULONGLONG end = FindLineEnd(m_lineWindow, start, docEnd);
+        CStringW& text = AddToCache(rcd);
+        DecodeLine(start, end, text);
+        return text;
+    }
+    catch (const CFileException& e)
+    {
+        TRACE(e.GetText()); TRACE("\n");
+        return m_emptyLine;
+    }
 }
 
 /*============================================================================*/
@@ -139,7 +463,7 @@ GetRecord(UINT rcd, UINT left /* = 0 */, UINT length /* = MAX_STRING_SIZE */) /*
     if (!m_isOpen || GetLength() == 0)
         return L"";
 
-    CStringW rtn = m_doclines[rcd];
+    const CStringW& rtn = GetLine(rcd);
     UINT rtnlen =  rtn.GetLength();
     long maxlen = (long)rtnlen - (long)left;
     if (maxlen <= 0 || left > rtnlen)
@@ -155,15 +479,133 @@ GetRecord(UINT rcd, UINT left /* = 0 */, UINT length /* = MAX_STRING_SIZE */) /*
     UINT CDoc::
 GetWidth()                                                                  /*
 
-    Return the document width, in characters
+    Return the document width, in characters. This grows while the document
+    is being indexed.
 *-----------------------------------------------------------------------------*/
 {
     if (!m_isOpen)
-        m_width = 0;
+        return 0;
 
+    CThreadLock lock(m_indexLock);
     return m_width;
 }
 
+/*============================================================================*/
+    BOOL CDoc::
+IndexLines(ULONGLONG end)                                                   /*
+
+    Extend the line index with the lines that end before the end offset.
+    Return TRUE if the whole document has been indexed. Only one thread
+    at a time indexes the document.
+*-----------------------------------------------------------------------------*/
+{
+    UINT charSize    = GetCharSize();
+    ULONGLONG docEnd = m_docEnd;
+    if (end > docEnd)
+        end = docEnd;
+
+      // byte encoded text ends at the first null character
+    if (charSize == 1 && end > m_scanned)
+    {
+        const char* pScan = m_indexWindow.Map(m_scanned, end);
+        const void* p = memchr(pScan, '\0',
+            static_cast<size_t>(end - m_scanned));
+        if (p != NULL)
+            end = docEnd = m_scanned + (static_cast<const char*>(p) - pScan);
+    }
+
+      // scan for the ends of lines, recording the start of every
+      // LINES_PER_CHECKPOINT line, and the longest line
+    std::vector<ULONGLONG> checkpoints;
+    UINT lineCount      = m_lineCount;
+    UINT width          = m_width;
+    ULONGLONG lineStart = m_indexed;
+    ULONGLONG lineEnd;
+    while ((lineEnd = FindLineEnd(m_indexWindow, MAX(lineStart, m_scanned),
+        end)) < end)
+    {
+        if (lineCount % LINES_PER_CHECKPOINT == 0)
+            checkpoints.push_back(lineStart);
+
+        ++lineCount;
+        width = MeasureLine(m_indexWindow, lineStart, lineEnd, width);
+        lineStart = lineEnd + charSize;
+    }
+
+      // if there is a partial line at the end of the document, add it,
+      // unless it contains only carriage returns
+    BOOL isComplete = (end == docEnd);
+    if (isComplete)
+    {
+        for (ULONGLONG p = lineStart; p < end; p += charSize)
+        {
+            if (GetCharAt(m_indexWindow, p) != L'\r')
+            {
+                if (lineCount % LINES_PER_CHECKPOINT == 0)
+                    checkpoints.push_back(lineStart);
+
+                ++lineCount;
+                width = MeasureLine(m_indexWindow, lineStart, end, width);
+                lineStart = end;
+                break;
+            }
+        }
+    }
+
+    CThreadLock lock(m_indexLock);
+    m_checkpoints.insert(m_checkpoints.end(), checkpoints.begin(),
+        checkpoints.end());
+    m_lineCount = lineCount;
+    m_width     = width;
+    m_docEnd    = docEnd;
+    m_indexed   = (isComplete ? docEnd : lineStart);
+    m_scanned   = end;
+    return isComplete;
+}
+
+/*============================================================================*/
+    UINT WINAPI CDoc::
+IndexThreadProc(LPVOID pDoc)                                                /*
+
+    The indexing thread's procedure. Index the document in chunks,
+    notifying the view as the document grows, until the whole document
+    is indexed or StopIndexing is called. If the file can't be read, the
+    document ends at the last line indexed.
+*-----------------------------------------------------------------------------*/
+{
+    CDoc* pThis = static_cast<CDoc*>(pDoc);
+    BOOL isComplete = FALSE;
+    while (!isComplete && pThis->m_stopIndexing == 0)
+    {
+        try
+        {
+            isComplete = pThis->IndexLines(pThis->m_scanned +
+                INDEX_CHUNK_BYTES);
+        }
+        catch (const CFileException& e)
+        {
+            TRACE(e.GetText()); TRACE("\n");
+            CThreadLock lock(pThis->m_indexLock);
+            pThis->m_docEnd = pThis->m_indexed;
+            isComplete = TRUE;
+        }
+        pThis->NotifyIndexed(isComplete);
+    }
+
+    return 0;
+}
+
+/*============================================================================*/
+    BOOL CDoc::
+IsIndexing()                                                                /*
+
+    Return TRUE if the document is still being indexed, FALSE otherwise.
+*----------------------------------------------------------------------------*/
+{
+    CThreadLock lock(m_indexLock);
+    return (m_indexed < m_docEnd);
+}
+
 /*============================================================================*/
     BOOL CDoc::
 IsOpen() const                                                              /*
@@ -175,12 +617,68 @@ IsOpen() const                                                              /*
     return m_isOpen;
 }
 
+/*============================================================================*/
+    UINT CDoc::
+MeasureLine(CFileWindow& window, ULONGLONG start, ULONGLONG end,
+    UINT width) const                                                       /*
+
+    Return the greater of width and the number of characters in the line
+    from the start offset to the end offset, excluding a trailing carriage
+    return. UTF-8 characters are only counted when the line has more bytes
+    than width. The line is read through the window.
+*-----------------------------------------------------------------------------*/
+{
+    UINT charSize = GetCharSize();
+    if (end > start && GetCharAt(window, end - charSize) == L'\r')
+        end -= charSize;
+
+    ULONGLONG length = (end - start) / charSize;
+    if (length > width && (m_encoding == UTF8noBOM ||
+        m_encoding == UTF8wBOM))
+    {
+          // count the bytes that begin a character, up to
+          // INDEX_CHUNK_BYTES at a time
+        length = 0;
+        for (ULONGLONG first = start; first < end; first += INDEX_CHUNK_BYTES)
+        {
+            ULONGLONG last = MIN(end, first + INDEX_CHUNK_BYTES);
+            const char* p = window.Map(first, last);
+            for (size_t i = 0; i < static_cast<size_t>(last - first); i++)
+            {
+                if ((p[i] & 0xc0) != 0x80)
+                    ++length;
+            }
+        }
+    }
+
+    return MAX(width, static_cast<UINT>(length));
+}
+
+/*============================================================================*/
+    void CDoc::
+NotifyIndexed(BOOL isComplete)                                              /*
+
+    Post UWM_DOCINDEXED to the notify window, at most once every
+    NOTIFY_INTERVAL milliseconds, and when the indexing is complete.
+*-----------------------------------------------------------------------------*/
+{
+    DWORD now = ::GetTickCount();
+    if (isComplete || now - m_notifyTime >= NOTIFY_INTERVAL)
+    {
+        m_notifyTime = now;
+        if (::IsWindow(m_notifyWnd))
+            ::PostMessage(m_notifyWnd, UWM_DOCINDEXED,
+                static_cast<WPARAM>(isComplete), 0);
+    }
+}
+
 /*============================================================================*/
     BOOL CDoc::
 OpenDoc(LPCTSTR filename)                                                   /*
 
-    Open the document from the given filename and populate the record array.
-    State parameters that were serialized in the prior execution will have
+    Open the document from the given filename and index the start of it.
+    The rest of a large document is indexed by a separate thread. State
+    parameters that were serialized in the prior execution will have
     already been loaded.
 *-----------------------------------------------------------------------------*/
 {
@@ -210,41 +708,60 @@ OpenDoc(LPCTSTR filename)                                                   /*
             else
                 CloseDoc();
         }
-          // ok, now open the file, set the open flag, and record the path
+          // ok, now open the file, set the open flag, and record the path.
+          // The file's contents are read through views of a file mapping,
+          // which stays open until the document is closed. Empty files
+          // can't be mapped.
         m_file.Open(file, OPEN_EXISTING | CFile::modeRead);
         m_isOpen = TRUE;
         m_openPath = m_file.GetFilePath();
+        ULONGLONG doclen = m_file.GetLength();
+        if (doclen > 0)
+        {
+            m_mapping = ::CreateFileMapping(m_file, NULL, PAGE_READONLY, 0,
+                0, NULL);
+            if (m_mapping == 0)
+                throw CFileException(_T("Reading the file failed."));
+        }
+        m_indexWindow.SetMapping(m_mapping, doclen);
+        m_lineWindow.SetMapping(m_mapping, doclen);
           // try to determine whether the file is Unicode
           // use a test length of characters from the file
         UINT testlen = 100;
-        UINT doclen  = static_cast<UINT>(m_file.GetLength());
         if (doclen < testlen)
-            testlen = doclen;
-          // resize the file buffer to fit content
-        m_buffer.resize(doclen);
-          // read the entire file contents into the buffer
-        UINT n = m_file.Read((void*)&m_buffer[0], doclen);
-        if (n != doclen)
-            throw CFileException(_T("Reading the file failed."));
+            testlen = static_cast<UINT>(doclen);
 
         UINT offset = 0;
-        Encoding encoding = DetermineEncoding(testlen, offset);
-        m_doclines.clear();
-        switch (encoding)
+        m_encoding = DetermineEncoding(m_indexWindow.Map(0, testlen),
+            testlen, offset);
+        m_docStart = offset;
+        switch (m_encoding)
         {
             case ANSI:
             case UTF8wBOM:
             case UTF8noBOM:
-                ReadABytes(encoding, doclen, offset);
+                m_docEnd = doclen;
                 break;
 
             case UTF16LE:
             case UTF16BE:
-                ReadWBytes(encoding, doclen, offset);
+                  // ignore an incomplete last character
+                m_docEnd = offset + (doclen - offset) / 2 * 2;
                 break;
 
             default:
-                assert(TRUE);
+                  // the document is not displayed
+                m_docEnd = offset;
+        }
+        m_indexed = m_scanned = m_docStart;
+
+          // index the start of the document now, and the rest on the
+          // indexing thread
+        if (!IndexLines(m_docStart + FIRST_INDEX_BYTES))
+        {
+            m_stopIndexing = 0;
+            m_notifyTime = ::GetTickCount();
+            m_indexThread.CreateThread();
         }
         ok = TRUE;
     }
@@ -255,100 +772,24 @@ OpenDoc(LPCTSTR filename)                                                   /*
             e.GetText());
         ::MessageBox(0, msg, _T("Error"), MB_OK | MB_ICONEXCLAMATION |
             MB_TASKMODAL);
-        ok = m_isOpen = FALSE;
+        CloseDoc();
+        ok = FALSE;
         m_openPath.Empty();
     }
-    m_file.Close();
     return ok;
 }
 
 /*============================================================================*/
     void CDoc::
-ReadABytes(Encoding encoding, UINT docsize, UINT offset)                    /*
+StopIndexing()                                                              /*
 
-    Read the document file in single byte mode and deposit lines in the
-    document line string vector. Throw an exception if a failure occurs.
+    Stop the indexing thread, if it is running, and wait for it to end.
 *-----------------------------------------------------------------------------*/
 {
-      // add a terminating 0 to the buffer
-    UINT newSize = docsize + 1;
-    m_buffer.resize(newSize, '\0');
-      // determine the text conversion code page to use
-    UINT CPage = ((encoding == UTF8wBOM || encoding == UTF8noBOM) ?
-        CP_UTF8 : CP_ACP);
-      // convert the file buffer to wide chars using this code page
-    CAtoW wb(&m_buffer[0] + offset, CPage);
-      // get access to the converted array and its length
-    LPCWSTR pWStr = wb;
-    UINT length   = static_cast<UINT>(wcslen(pWStr));
-      // declare the entry string that will be added to the document and scan
-      // the converted array for end-of-line characters
-    CStringW entry;
-    for (UINT i = 0; i < length; i++)
+    if (m_indexThread.GetThread() != 0)
     {
-        wchar_t w = pWStr[i];
-        RecordEntry(w, entry) ;
+        ::InterlockedExchange(&m_stopIndexing, 1);
+        ::WaitForSingleObject(m_indexThread, INFINITE);
     }
-      // if there is a partial line, add it to the document
-    if (entry.GetLength() > 0)
-        AddRecord(entry);
-}
-
-/*============================================================================*/
-    void CDoc::
-ReadWBytes(Encoding encoding, UINT doclen, UINT offset)                     /*
-
-    Read the file buffer in wide character mode and deposit lines in the
-    document line string vector. Throw an exception if a failure occurs.
-*-----------------------------------------------------------------------------*/
-{
-    UINT length = doclen - offset;
-    UINT size   = length / 2;
-    UINT size1  = size + 1;
-      // copy the file character buffer into a wide-character array
-    std::vector<wchar_t> wideArray(size1, L'\0');
-    memcpy(&wideArray[0], &m_buffer[0] + offset, length);
-      // declare the entry string that will be added to the document and scan
-      // the wide array for end-of-line characters
-    CStringW entry;
-    for (UINT i = 0; i < size; i++)
-    {
-        wchar_t w = wideArray[i];
-          // if big-endian, reverse w's bytes
-        if (encoding == UTF16BE)
-            w = ByteReverse(w);
-
-        RecordEntry(w, entry) ;
-    }
-      // if there remains a partial entry, add it to the document
-    if (entry.GetLength() > 0)
-        AddRecord(entry);
-}
-
-/*============================================================================*/
-    void CDoc::
-RecordEntry(wchar_t w, CStringW& entry)                                     /*
-
-    If w is not an end-of-line or end_of_string character, append it to the
-    entry string. If it is an end-=of-line or end-of_string character, then
-    commit the entry into the document record array.
-*-----------------------------------------------------------------------------*/
-{
-      // skip return characters, if any
-    if (w == L'\r')
-        return;
-
-      // break on end-of-line or end-of-string
-    if (w == L'\n' || w == L'\0')
-    {
-          // enter the record
-        AddRecord(entry);
-          // record the longest length
-        m_width = MAX(m_width,
-            static_cast<UINT>(entry.GetLength()));
-        entry.Empty();
-    }
-    else
-        entry += w;
 }
 /*----------------------------------------------------------------------------*/
\ No newline at end of file
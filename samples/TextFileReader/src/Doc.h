@@ -29,6 +29,39 @@ enum Encoding
     UnicodeNoBOM
 };
 
+  // the message posted to the notify window as the document is indexed
+const UINT UWM_DOCINDEXED = WM_APP + 1;
+
+/*============================================================================*/
+    class
+CFileWindow                                                                 /*
+
+    A read only view of part of a file mapping. The view is moved when bytes
+    outside it are requested, so only a window of the file is mapped at a
+    time, however large the file is. A window is used by one thread at a time.
+*-----------------------------------------------------------------------------*/
+{
+    public:
+
+        CFileWindow();
+        ~CFileWindow();
+
+        const char* Map(ULONGLONG start, ULONGLONG end);
+        void        SetMapping(HANDLE mapping, ULONGLONG fileLength);
+        void        Unmap();
+
+    private:
+        CFileWindow(const CFileWindow&);             // disable copying
+        CFileWindow& operator=(const CFileWindow&);  // disable assignment
+
+        HANDLE      m_mapping;              // the file mapping object
+        ULONGLONG   m_fileLength;           // the length of the file
+        const char* m_pView;                // the mapped view, or NULL
+        ULONGLONG   m_viewStart;            // the file offset of the view
+        ULONGLONG   m_viewEnd;              // the file offset of the view's end
+        DWORD       m_granularity;          // the alignment of view offsets
+};
+
 /*============================================================================*/
     class
 CDoc                                                                        /*
@@ -36,36 +69,82 @@ CDoc                                                                        /*
     This class is the interface between the file to be displayed and the CView
     class, which displays it. Parameters of this class deemed to be persistent
     may be serialized.
+
+    The file is read through windowed views of a file mapping, so the
+    memory used doesn't depend on the size of the file. Rather than decoding
+    the whole file when it is opened, the document keeps an index of the
+    offset of every 32nd line, and decodes lines when they are requested.
+    Recently requested lines are kept in a cache. Large files are indexed by a
+    separate thread, which posts UWM_DOCINDEXED to the notify window as
+    the document grows.
 *-----------------------------------------------------------------------------*/
 {
     public:
 
         CDoc();
-        virtual ~CDoc(){}
+        virtual ~CDoc();
 
-        void        AddRecord(const CStringW& entry);
         UINT        GetLength();
+        const CStringW& GetLine(UINT);
         CStringW    GetRecord(UINT, UINT left = 0, UINT length = WXX_MAX_STRING_SIZE);
         UINT        GetWidth();
+        BOOL        IsIndexing();
         BOOL        IsOpen() const;
         BOOL        CloseDoc();
         BOOL        OpenDoc(LPCTSTR);
+        void        SetNotifyWnd(HWND wnd) { m_notifyWnd = wnd; }
 
     private:
-        WCHAR       ByteReverse(WCHAR w) // byte reversal function for UTF-16 BE
-                        { return (w >> 8) | ((w & 0xff) << 8); }
+          // byte reversal function for UTF-16 BE
+        static WCHAR ByteReverse(WCHAR w)
+            { return static_cast<WCHAR>((w >> 8) | ((w & 0xff) << 8)); }
+
+        CStringW&   AddToCache(UINT line);
+        void        DecodeLine(ULONGLONG start, ULONGLONG end,
+                        CStringW& text);
+        Encoding    DetermineEncoding(const char* buffer, UINT testlen,
+                        UINT& offset);
+        static void ExpandTabs(const WCHAR* source, int length,
+                        CStringW& text);
+        ULONGLONG   FindLineEnd(CFileWindow& window, ULONGLONG start,
+                        ULONGLONG end) const;
+        WCHAR       GetCharAt(CFileWindow& window, ULONGLONG offset) const;
+        UINT        GetCharSize() const;
+        BOOL        IndexLines(ULONGLONG end);
+        static UINT WINAPI IndexThreadProc(LPVOID pDoc);
+        UINT        MeasureLine(CFileWindow& window, ULONGLONG start,
+                        ULONGLONG end, UINT width) const;
+        void        NotifyIndexed(BOOL isComplete);
+        void        StopIndexing();
 
-        Encoding    DetermineEncoding(UINT testlen, UINT& offset);
-        void        ReadABytes(Encoding encoding, UINT doclen, UINT offset);
-        void        ReadWBytes(Encoding encoding, UINT doclen, UINT offset);
-        void        RecordEntry(wchar_t w, CStringW& entry);
+        typedef std::list<std::pair<UINT, CStringW> > LineCache;
 
         CFile       m_file;                 // the document file object
+        HANDLE      m_mapping;              // the file mapping object
+        CFileWindow m_indexWindow;          // the view used to index lines
+        CFileWindow m_lineWindow;           // the view used to decode lines
         BOOL        m_isOpen;               // the document status
         UINT        m_width;                // width, in characters
         CString     m_openPath;             // empty when closed
-        std::vector<CStringW>   m_doclines; // the document content
-        std::vector<char>       m_buffer;   // the file contents buffer
+        HWND        m_notifyWnd;            // receives UWM_DOCINDEXED
+
+          // the line index, shared with the indexing thread
+        CCriticalSection m_indexLock;       // guards the index members
+        std::vector<ULONGLONG> m_checkpoints; // the offset of every 32nd line
+        UINT        m_lineCount;            // the number of lines indexed
+        ULONGLONG   m_indexed;              // the end offset of the index
+        ULONGLONG   m_docEnd;               // the offset of the end of the text
+        Encoding    m_encoding;             // the file encoding
+        ULONGLONG   m_docStart;             // the offset after the BOM, if any
+        ULONGLONG   m_scanned;              // the offset the scan has reached
+        CWorkThread m_indexThread;          // indexes large files
+        volatile LONG m_stopIndexing;       // nonzero to stop indexing
+        DWORD       m_notifyTime;           // the tick count of the last notice
+
+          // the recently decoded lines, most recently used first
+        LineCache   m_cache;
+        std::map<UINT, LineCache::iterator> m_cacheIndex;
+        CStringW    m_emptyLine;
 };
 /*-----------------------------------------------------------------------------*/
 #endif //SDI_DOC_H
@@ -117,6 +117,27 @@ OnInitialUpdate()                                                           /*
     view.
 *-----------------------------------------------------------------------------*/
 {
+      // the document posts UWM_DOCINDEXED here as a large file is indexed
+    TheDoc().SetNotifyWnd(*this);
+}
+
+/*============================================================================*/
+    LRESULT CView::
+OnDocIndexed()                                                              /*
+
+    Called when the document has indexed more of its lines. Extend the
+    scrolling range to the lines indexed so far, keeping the current scroll
+    position.
+*-----------------------------------------------------------------------------*/
+{
+    CPoint sp = GetScrollPosition();
+    SetAppSize();
+      // the message may arrive after the document was closed
+    CSize totalSize = GetTotalScrollSize();
+    sp.x = MIN(sp.x, totalSize.cx);
+    sp.y = MIN(sp.y, totalSize.cy);
+    SetScrollPosition(sp);
+    return 0;
 }
 
 /*============================================================================*/
@@ -128,7 +149,8 @@ OnDraw(CDC& memDC)                                                          /*
     consists of lines of wide character text, where the top-left corner of
     the display is given as the current scroll position in the number of
     average character widths from the left and lines from the top of the
-    document.
+    document. Only the lines that intersect memDC's clipping rectangle are
+    drawn, so the time taken doesn't depend on the document's length.
 *-----------------------------------------------------------------------------*/
 {
       // select the window font
@@ -143,20 +165,46 @@ OnDraw(CDC& memDC)                                                          /*
     {
           // get scroll bar current position: sp is the
           // upper-left-most character in the display
+        CPoint sp = GetScrollPosition();
+        CSize  fs = GetFontSize();
+        fs.cx = MAX(fs.cx, 1);
+        fs.cy = MAX(fs.cy, 1);
+          // find the lines that intersect the area to be painted
+        CRect clip;
+        memDC.GetClipBox(clip);
+        UINT first = (sp.y + clip.top) / fs.cy;
+        UINT last  = MIN((sp.y + MAX(clip.bottom - 1, clip.top)) / fs.cy,
+            doc_length);
+          // limit the characters drawn to those that can reach the right of
+          // the area, allowing for characters narrower than the average
+        int maxChars = 4 * (sp.x + clip.right) / fs.cx + 16;
         CStringW fmt(L"%.4u | "),
             line_no;
           // display the current view
-        for (UINT i = 0; i <= doc_length; i++)
+        for (UINT i = first; i <= last; i++)
         {
-            if (m_showNumbers)
-                line_no.Format(fmt, i + 1);
             if (i == doc_length)
             {
-                if (m_endOfView != NULL)
+                  // the end of the document isn't known until it is indexed
+                if (m_endOfView != NULL && !TheDoc().IsIndexing())
                     TextLineOut(memDC, 0, i, m_endOfView);
             }
             else
-                TextLineOut(memDC, 0, i, line_no + TheDoc().GetRecord(i));
+            {
+                int left = 0;
+                if (m_showNumbers)
+                {
+                    line_no.Format(fmt, i + 1);
+                    TextLineOut(memDC, 0, i, line_no, line_no.GetLength());
+                    SIZE size;
+                    ::GetTextExtentPoint32W(memDC, line_no,
+                        line_no.GetLength(), &size);
+                    left = size.cx;
+                }
+                const CStringW& line = TheDoc().GetLine(i);
+                TextLineOut(memDC, left, i, line,
+                    MIN(line.GetLength(), maxChars));
+            }
         }
     }
     else
@@ -190,14 +238,18 @@ OnPaint(UINT, WPARAM, LPARAM)                                               /*
       // create a memory device context to print into
     CPaintDC dc(*this);
     CMemDC memDC(dc);
+      // only the invalid part of the window needs to be painted
+    CRect paintRect;
+    dc.GetClipBox(paintRect);
       // Create a bitmap big enough for our client rectangle.
     memDC.CreateCompatibleBitmap(dc, rc.Width(), rc.Height());
-    memDC.FillRect(rc, GetScrollBkgnd());
+    memDC.IntersectClipRect(paintRect);
+    memDC.FillRect(paintRect, GetScrollBkgnd());
       // here we would paint the client rc with app-dependent stuff
     OnDraw(memDC);
     // now we can rapidly copy the painted memory into the screen DC.
-    dc.BitBlt(rc.left, rc.top, rc.Width(), rc.Height(), memDC, 0, 0,
-        SRCCOPY);
+    dc.BitBlt(paintRect.left, paintRect.top, paintRect.Width(),
+        paintRect.Height(), memDC, paintRect.left, paintRect.top, SRCCOPY);
     return 0;
 }
 
@@ -325,11 +377,12 @@ SetScrollParameters()                                                       /*
 
 /*============================================================================*/
     void CView::
-TextLineOut(CDC& dc, UINT leftcol, UINT line, LPCWSTR s) const              /*
+TextLineOut(CDC& dc, UINT leftcol, UINT line, LPCWSTR s, int length) const /*
 
-    Output the wide character string s beginning at leftcol on the given line
-    of the client area with device context dc, within the client rectangle rc
-    using the given font sizes.
+    Output length characters of the wide character string s beginning at
+    leftcol on the given line of the client area with device context dc,
+    within the client rectangle rc using the given font sizes. The whole of
+    s is output if length is -1.
 *-----------------------------------------------------------------------------*/
 {
       // set TextOut() below to use device coordinates
@@ -337,7 +390,10 @@ TextLineOut(CDC& dc, UINT leftcol, UINT line, LPCWSTR s) const              /*
       // convert left column and line number to device coordinates
     CPoint pt(leftcol, line * GetFontSize().cy);
       // output the line to the view dc
-    TextOutW(dc, pt.x - sPos.x, pt.y - sPos.y, s, lstrlenW(s));
+    if (length < 0)
+        length = lstrlenW(s);
+
+    TextOutW(dc, pt.x - sPos.x, pt.y - sPos.y, s, length);
 }
 
 /*============================================================================*/
@@ -351,5 +407,20 @@ ToggleLineNumbers()                                                     /*
     SetAppSize(TRUE);
     return m_showNumbers;
 }
+
+/*============================================================================*/
+    LRESULT CView::
+WndProc(UINT msg, WPARAM wparam, LPARAM lparam)                             /*
+
+    Process the view's window messages.
+*-----------------------------------------------------------------------------*/
+{
+    switch (msg)
+    {
+        case UWM_DOCINDEXED:    return OnDocIndexed();
+    }
+
+    return WndProcDefault(msg, wparam, lparam);
+}
 /*----------------------------------------------------------------------------*/
 
@@ -73,14 +73,16 @@ CView : public CScrollView                                                  /*
 
     protected:
         void    OnInitialUpdate();
+        LRESULT OnDocIndexed();
         void    OnDraw(CDC& memDC);
         LRESULT OnPaint(UINT msg, WPARAM wparam, LPARAM lparam);
         void    PreCreate(CREATESTRUCT& cs);
         void    Serialize(CArchive& ar);
+        LRESULT WndProc(UINT msg, WPARAM wparam, LPARAM lparam);
 
     private:
         void    InitViewColors();
-        void    TextLineOut(CDC&, UINT, UINT, LPCWSTR) const;
+        void    TextLineOut(CDC&, UINT, UINT, LPCWSTR, int length = -1) const;
 
         CDoc     m_doc;           // the document
         CFontEx  m_fontEx;        // the view display font
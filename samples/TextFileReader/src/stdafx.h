@@ -47,6 +47,7 @@ typedef  unsigned char  byte;
 
 // Rarely modified header files should be included here
 #include <vector>               // Add support for std::vector
+#include <list>                 // Add support for std::list
 #include <map>                  // Add support for std::map
 #include <string>               // Add support for std::string
 #include <sstream>              // Add support for stringstream
@@ -94,6 +95,7 @@ typedef  unsigned char  byte;
 //#include <wxx_taskdialog.h>   // Add CTaskDialog
 #include <wxx_textconv.h>       // Add AtoT, AtoW, TtoA, TtoW, WtoA, WtoT etc.
 #include <wxx_themes.h>         // Add MenuTheme, ReBarTheme, StatusBarTheme, ToolBarTheme
+#include <wxx_thread.h>         // Add CWinThread, CWorkThread
 #include <wxx_time.h>           // Add CTime
 #include <wxx_toolbar.h>        // Add CToolBar
 #include <wxx_treeview.h>       // Add CTreeView
@@ -33,6 +33,329 @@ namespace Calc
 #pragma warning ( disable : 26812 )       // enum type is unscoped.
 #endif // (_MSC_VER) && (_MSC_VER >= 1400)
 
+    // The number of points each instruction is performed on at a time.
+    const size_t BLOCK_SIZE = 128;
+
+    // The minimum number of points evaluated by each thread pool task.
+    const size_t MIN_TASK_POINTS = 4096;
+
+    // Performs the arithmetic for an operator.
+    inline double Operate(eOpCode opCode, double left, double right)
+    {
+        switch (opCode)
+        {
+        case opAdd:         return left + right;
+        case opSubtract:    return left - right;
+        case opMultiply:    return left * right;
+        case opDivide:      return left / right;
+        default:            return pow(left, right);
+        }
+    }
+
+
+    ////////////////////////////////////////////////////////
+    // RunProgram is a function object which runs a program
+    // for part of a batch of points on a thread pool thread.
+    class RunProgram
+    {
+    public:
+        RunProgram(const Program& program, const double* slotValues, int pointSlot,
+                   const double* points, double* results, size_t count, double* finalValues)
+            : m_pProgram(&program), m_slotValues(slotValues), m_pointSlot(pointSlot),
+              m_points(points), m_results(results), m_count(count), m_finalValues(finalValues)
+        {}
+
+        void operator()() const
+        {
+            std::vector<double> work;
+            m_pProgram->Run(m_slotValues, m_pointSlot, m_points, m_results, m_count, m_finalValues, work);
+        }
+
+    private:
+        const Program* m_pProgram;
+        const double*  m_slotValues;
+        int            m_pointSlot;
+        const double*  m_points;
+        double*        m_results;
+        size_t         m_count;
+        double*        m_finalValues;
+    };
+
+
+    ////////////////////////////////////////
+    // Program function definitions.
+    //
+
+    // Constructor.
+    Program::Program() : m_depth(0), m_maxDepth(0), m_hasStore(false)
+    {
+    }
+
+    // Destructor.
+    Program::~Program()
+    {
+    }
+
+    // Adds a call to a math function. Functions of numbers are
+    // evaluated now, rather than each time the program is run.
+    void Program::AddFunction(PFun pFun)
+    {
+        if (!m_code.empty() && m_code.back().opCode == opNumber)
+        {
+            m_code.back().number = (*pFun)(m_code.back().number);
+            return;
+        }
+
+        Instruction instruction(opFunction);
+        instruction.pFun = pFun;
+        Push(instruction, 0);
+    }
+
+    // Adds an instruction to push the value of a variable.
+    void Program::AddLoad(const CString& symbol)
+    {
+        Instruction instruction(opLoad);
+        instruction.slot = GetSlot(symbol);
+        Push(instruction, 1);
+    }
+
+    // Adds an instruction to push a number.
+    void Program::AddNumber(double number)
+    {
+        Instruction instruction(opNumber);
+        instruction.number = number;
+        Push(instruction, 1);
+    }
+
+    // Adds an instruction to combine the top two values on the stack.
+    // Operations on two numbers are evaluated now, rather than each
+    // time the program is run.
+    void Program::AddOperator(eToken token)
+    {
+        eOpCode opCode;
+        switch (token)
+        {
+        case tPlus:     opCode = opAdd;       break;
+        case tMinus:    opCode = opSubtract;  break;
+        case tMultiply: opCode = opMultiply;  break;
+        case tDivide:   opCode = opDivide;    break;
+        case tPower:    opCode = opPower;     break;
+        default:
+            assert(false);
+            return;
+        }
+
+        size_t size = m_code.size();
+        if (size >= 2 && m_code[size - 1].opCode == opNumber && m_code[size - 2].opCode == opNumber)
+        {
+            m_code[size - 2].number = Operate(opCode, m_code[size - 2].number, m_code[size - 1].number);
+            m_code.pop_back();
+            --m_depth;
+            return;
+        }
+
+        Push(Instruction(opCode), -1);
+    }
+
+    // Adds an instruction to assign the value on top of the stack to a variable.
+    void Program::AddStore(const CString& symbol)
+    {
+        Instruction instruction(opStore);
+        instruction.slot = GetSlot(symbol);
+        m_hasStore = true;
+        Push(instruction, 0);
+    }
+
+    // Removes the instructions and variables from the program.
+    void Program::Clear()
+    {
+        m_code.clear();
+        m_symbols.clear();
+        m_depth = 0;
+        m_maxDepth = 0;
+        m_hasStore = false;
+    }
+
+    // Returns the slot of the specified variable, or -1 if the
+    // program doesn't use the variable.
+    int Program::FindSlot(const CString& symbol) const
+    {
+        for (size_t i = 0; i < m_symbols.size(); ++i)
+        {
+            if (m_symbols[i] == symbol)
+                return static_cast<int>(i);
+        }
+
+        return -1;
+    }
+
+    // Returns the slot of the specified variable, adding a slot if required.
+    int Program::GetSlot(const CString& symbol)
+    {
+        int slot = FindSlot(symbol);
+        if (slot < 0)
+        {
+            slot = static_cast<int>(m_symbols.size());
+            m_symbols.push_back(symbol);
+        }
+
+        return slot;
+    }
+
+    // Adds an instruction, and tracks the size of the stack it requires.
+    void Program::Push(const Instruction& instruction, int depthChange)
+    {
+        m_code.push_back(instruction);
+        m_depth += depthChange;
+        m_maxDepth = MAX(m_maxDepth, m_depth);
+    }
+
+    // Runs the program for each point.
+    //  slotValues:  The value of each variable in the program.
+    //  pointSlot:   The slot of the variable set to each point, or -1.
+    //  points:      The values of the variable for each point.
+    //  results:     Receives the result for each point.
+    //  count:       The number of points.
+    //  finalValues: Receives the value of each variable after the last
+    //               point, or NULL. Can be the same array as slotValues.
+    //  work:        The work area, resized as required. Reusing it avoids
+    //               allocating it for each call.
+    // Run can be called by several threads at once, with separate work areas.
+    // The points are independent. Values assigned to variables while
+    // evaluating one point aren't seen by the other points.
+    void Program::Run(const double* slotValues, int pointSlot, const double* points,
+                      double* results, size_t count, double* finalValues,
+                      std::vector<double>& work) const
+    {
+        if (count == 0 || m_code.empty())
+            return;
+
+        // The work area holds an unused block below the bottom of the stack,
+        // a block of values for each level of the stack, and a block of
+        // values for each variable. Blocks are smaller when there are
+        // fewer points.
+        size_t blockSize = MIN(BLOCK_SIZE, count);
+        size_t slots = m_symbols.size();
+        size_t workSize = (1 + m_maxDepth + slots) * blockSize;
+        if (work.size() < workSize)
+            work.resize(workSize);
+
+        double* stack = &work[blockSize];
+        double* slotBlocks = stack + m_maxDepth * blockSize;
+
+        size_t n = 0;
+        for (size_t first = 0; first < count; first += n)
+        {
+            n = MIN(blockSize, count - first);
+
+            for (size_t s = 0; s < slots; ++s)
+            {
+                double* pSlot = slotBlocks + s * blockSize;
+                if (static_cast<int>(s) == pointSlot)
+                {
+                    for (size_t i = 0; i < n; ++i)
+                        pSlot[i] = points[first + i];
+                }
+                else
+                {
+                    double value = slotValues[s];
+                    for (size_t i = 0; i < n; ++i)
+                        pSlot[i] = value;
+                }
+            }
+
+            double* pTop = &work[0];
+            std::vector<Instruction>::const_iterator it;
+            for (it = m_code.begin(); it != m_code.end(); ++it)
+            {
+                switch ((*it).opCode)
+                {
+                case opNumber:
+                {
+                    pTop += blockSize;
+                    double number = (*it).number;
+                    for (size_t i = 0; i < n; ++i)
+                        pTop[i] = number;
+                    break;
+                }
+                case opLoad:
+                {
+                    pTop += blockSize;
+                    const double* pSlot = slotBlocks + (*it).slot * blockSize;
+                    for (size_t i = 0; i < n; ++i)
+                        pTop[i] = pSlot[i];
+                    break;
+                }
+                case opStore:
+                {
+                    double* pSlot = slotBlocks + (*it).slot * blockSize;
+                    for (size_t i = 0; i < n; ++i)
+                        pSlot[i] = pTop[i];
+                    break;
+                }
+                case opAdd:
+                {
+                    double* pLeft = pTop - blockSize;
+                    for (size_t i = 0; i < n; ++i)
+                        pLeft[i] = pLeft[i] + pTop[i];
+                    pTop = pLeft;
+                    break;
+                }
+                case opSubtract:
+                {
+                    double* pLeft = pTop - blockSize;
+                    for (size_t i = 0; i < n; ++i)
+                        pLeft[i] = pLeft[i] - pTop[i];
+                    pTop = pLeft;
+                    break;
+                }
+                case opMultiply:
+                {
+                    double* pLeft = pTop - blockSize;
+                    for (size_t i = 0; i < n; ++i)
+                        pLeft[i] = pLeft[i] * pTop[i];
+                    pTop = pLeft;
+                    break;
+                }
+                case opDivide:
+                {
+                    double* pLeft = pTop - blockSize;
+                    for (size_t i = 0; i < n; ++i)
+                        pLeft[i] = pLeft[i] / pTop[i];
+                    pTop = pLeft;
+                    break;
+                }
+                case opPower:
+                {
+                    double* pLeft = pTop - blockSize;
+                    for (size_t i = 0; i < n; ++i)
+                        pLeft[i] = pow(pLeft[i], pTop[i]);
+                    pTop = pLeft;
+                    break;
+                }
+                case opFunction:
+                {
+                    PFun pFun = (*it).pFun;
+                    for (size_t i = 0; i < n; ++i)
+                        pTop[i] = (*pFun)(pTop[i]);
+                    break;
+                }
+                }
+            }
+
+            assert(pTop == stack);
+            for (size_t i = 0; i < n; ++i)
+                results[first + i] = stack[i];
+        }
+
+        if (finalValues != NULL)
+        {
+            for (size_t s = 0; s < slots; ++s)
+                finalValues[s] = slotBlocks[s * blockSize + n - 1];
+        }
+    }
+
+
     ////////////////////////////////////////
     // Calculator function definitions.
     //
@@ -41,37 +364,43 @@ namespace Calc
     Calculator::Calculator(const CString& buffer)
         : m_status(st_ERROR), m_parse(buffer)
     {
-        m_pTree = NULL;
     }
 
     // Destructor.
     Calculator::~Calculator()
     {
-        delete m_pTree; //deletes all nodes created
     }
 
     // Loads the calculator buffer, and checks for correct syntax.
     // Use Get_Status() to verify the expression syntax.
+    // A valid expression is compiled into a program.
     void Calculator::Input(const CString& buffer)
     {
         m_parse.Input(buffer);
 
-        // Delete the old node tree
-        delete m_pTree;
-        m_pTree = NULL;
+        // Remove the old program
+        m_program.Clear();
+        m_slotValues.clear();
 
         m_status = st_OK;
-        m_pTree = Expression();
+        Node* pTree = Expression();
 
         // Should be at the end of the buffer, otherwise the expression is invalid
         eToken Token = m_parse.GetToken();
         if ((Token != tEnd) || (m_status == st_ERROR))
         {
             m_status = st_ERROR;
-            // delete the invalid tree if it exists
-            delete m_pTree;
-            m_pTree = NULL;
         }
+        else
+        {
+            // Compile the node tree, and bind the variables to slots.
+            pTree->Compile(m_program);
+            const std::vector<CString>& symbols = m_program.GetSymbols();
+            for (size_t i = 0; i < symbols.size(); ++i)
+                m_slotValues.push_back(m_symTab.GetValue(symbols[i]));
+        }
+
+        delete pTree; //deletes all nodes created
     }
 
     // Returns the status of the previous operation.
@@ -95,7 +424,12 @@ namespace Calc
 
         if (m_status != st_ERROR)
         {
-            RetValue = m_pTree->Calc(); //calculate the value
+            //calculate the value
+            double* pSlotValues = m_slotValues.empty() ? NULL : &m_slotValues[0];
+            m_program.Run(pSlotValues, -1, NULL, &RetValue, 1, pSlotValues, m_work);
+            if (m_program.HasStore())
+                UpdateSymbols();
+
             if (IsOverflow(RetValue))
             {
                 m_status = st_OVERFLOW;
@@ -106,6 +440,69 @@ namespace Calc
         return RetValue;
     }
 
+    // Evaluates the expression for n values of x, and stores the results in ys.
+    // The points are split between the threads of the pool, if a running
+    // thread pool is specified. GetStatus() is set for the last point, as if
+    // the points were evaluated in turn. Use IsOverflow to check each result.
+    // Expressions which assign variables are evaluated one point at a time,
+    // so each point uses the values assigned by the point before it.
+    void Calculator::Eval(const double* xs, double* ys, size_t n, CThreadPool* pPool)
+    {
+        if (m_status == st_ERROR)
+        {
+            for (size_t i = 0; i < n; ++i)
+                ys[i] = 0;
+
+            return;
+        }
+
+        if (n == 0)
+            return;
+
+        int xSlot = m_program.FindSlot("x");
+        if (m_program.HasStore())
+        {
+            double* pSlotValues = m_slotValues.empty() ? NULL : &m_slotValues[0];
+            for (size_t i = 0; i < n; ++i)
+                m_program.Run(pSlotValues, xSlot, xs + i, ys + i, 1, pSlotValues, m_work);
+
+            UpdateSymbols();
+            m_status = IsOverflow(ys[n - 1]) ? st_OVERFLOW : st_OK;
+            return;
+        }
+
+        // The tasks read a copy of the values, as the task with the
+        // last point updates the values.
+        std::vector<double> slotValues = m_slotValues;
+        const double* pSlotValues = slotValues.empty() ? NULL : &slotValues[0];
+        double* pFinalValues = m_slotValues.empty() ? NULL : &m_slotValues[0];
+
+        if (pPool != NULL && pPool->IsRunning() && n >= 2 * MIN_TASK_POINTS)
+        {
+            size_t tasks = MIN(static_cast<size_t>(pPool->GetThreadCount()) * 4, n / MIN_TASK_POINTS);
+            size_t taskPoints = (n + tasks - 1) / tasks;
+
+            std::vector<PoolTaskPtr> submitted;
+            for (size_t first = 0; first < n; first += taskPoints)
+            {
+                size_t count = MIN(taskPoints, n - first);
+                double* pFinal = (first + count == n) ? pFinalValues : NULL;
+                RunProgram run(m_program, pSlotValues, xSlot, xs + first, ys + first, count, pFinal);
+                submitted.push_back(pPool->Submit(run));
+            }
+
+            for (size_t i = 0; i < submitted.size(); ++i)
+                submitted[i]->Wait();
+        }
+        else
+        {
+            m_program.Run(pSlotValues, xSlot, xs, ys, n, pFinalValues, m_work);
+        }
+
+        UpdateSymbols();
+        m_status = IsOverflow(ys[n - 1]) ? st_OVERFLOW : st_OK;
+    }
+
     // Builds the expression from branch nodes which are added or subtracted.
     // x-y+z is evaluated as:  (x-y) + z.
     Node* Calculator::Expression()
@@ -228,11 +625,11 @@ namespace Calc
             {
                 m_parse.AcceptToken();
                 Node* pNew = Expression();
-                pnode = new Node_Assign(pNew, m_symTab, m_parse.GetAlphaName());
+                pnode = new Node_Assign(pNew, m_parse.GetAlphaName());
             }
             else
             {
-                pnode = new Node_Variable(m_symTab, m_parse.GetAlphaName());
+                pnode = new Node_Variable(m_parse.GetAlphaName());
             }
         }
         break;
@@ -278,11 +675,25 @@ namespace Calc
         return pnode;
     }
 
+    // Sets the value of a variable.
     void Calculator::SetVar(const CString& Var, double Val)
     {
         m_symTab.SetValue(Var, Val);
+
+        int slot = m_program.FindSlot(Var);
+        if (slot >= 0)
+            m_slotValues[slot] = Val;
+    }
+
+    // Copies the values of the program's variables to the symbol table.
+    void Calculator::UpdateSymbols()
+    {
+        const std::vector<CString>& symbols = m_program.GetSymbols();
+        for (size_t i = 0; i < symbols.size(); ++i)
+            m_symTab.SetValue(symbols[i], m_slotValues[i]);
     }
 
+    // Returns true if the value is infinite or not a number.
     bool Calculator::IsOverflow(double value)
     {
         // This code could give rise to compatibility issues.
@@ -50,6 +50,71 @@ namespace Calc
 {
     class Node;
 
+    // The instructions of a compiled program.
+    enum eOpCode
+    {
+        opNumber,       // Push a number
+        opLoad,         // Push the value of a variable
+        opStore,        // Assign the value on top of the stack to a variable
+        opAdd,
+        opSubtract,
+        opMultiply,
+        opDivide,
+        opPower,
+        opFunction      // Call a math function on the value on top of the stack
+    };
+
+
+    //////////////////////////////////////////////////////////////
+    // Program is the expression compiled into a list of stack
+    // machine instructions. Variables are bound to slots, so they
+    // are not looked up while the program runs. Each instruction
+    // is performed on a block of points at a time, so the cost of
+    // decoding the instruction is shared by the points in the block,
+    // and the inner loops can be vectorized by the compiler.
+    class Program
+    {
+    public:
+        Program();
+        ~Program();
+
+        // Used by the nodes to compile the expression.
+        void AddFunction(PFun pFun);
+        void AddLoad(const CString& symbol);
+        void AddNumber(double number);
+        void AddOperator(eToken token);
+        void AddStore(const CString& symbol);
+
+        void Clear();
+        int  FindSlot(const CString& symbol) const;
+        const std::vector<CString>& GetSymbols() const { return m_symbols; }
+        bool HasStore() const { return m_hasStore; }
+        void Run(const double* slotValues, int pointSlot, const double* points,
+                 double* results, size_t count, double* finalValues,
+                 std::vector<double>& work) const;
+
+    private:
+        struct Instruction
+        {
+            Instruction(eOpCode opCode) : opCode(opCode), slot(0), number(0), pFun(0) {}
+
+            eOpCode opCode;
+            int     slot;
+            double  number;
+            PFun    pFun;
+        };
+
+        int  GetSlot(const CString& symbol);
+        void Push(const Instruction& instruction, int depthChange);
+
+        std::vector<Instruction> m_code;
+        std::vector<CString> m_symbols;     // The variable in each slot
+        int  m_depth;
+        int  m_maxDepth;
+        bool m_hasStore;
+    };
+
+
     //////////////////////////////////////////////////////
     // Calculator evaluates the expression supplied by the
     // Input function.
@@ -61,11 +126,15 @@ namespace Calc
 
         void        Input(const CString& buffer);
         double      Eval();
+        void        Eval(const double* xs, double* ys, size_t n, CThreadPool* pPool = NULL);
         int         Get_Status() const;
+        bool        HasStore() const { return m_program.HasStore(); }
         void        SetVar(const CString& szVar, double Val);
 
+        static bool IsOverflow(double value);
+
     private:
-        bool IsOverflow(double value);
+        void UpdateSymbols();
 
         ////////////////////////////////////////////////////////////////////////
         // A class used by the Calculator.  It loads m_buffer with the expression.
@@ -93,7 +162,9 @@ namespace Calc
         Node*       Power();
         Node*       Unit();
 
-        Node*       m_pTree;
+        Program     m_program;
+        std::vector<double> m_slotValues;   // The value of each variable in the program
+        std::vector<double> m_work;         // The work area used by m_program on this thread
         eStatus     m_status;
         SymbolTable m_symTab;
         Parser      m_parse;
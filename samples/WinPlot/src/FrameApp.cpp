@@ -5,6 +5,70 @@
 #include "stdafx.h"
 #include "FrameApp.h"
 
+// Returns the time in seconds since the start count.
+static double GetElapsedSeconds(const LARGE_INTEGER& start)
+{
+    LARGE_INTEGER end;
+    LARGE_INTEGER frequency;
+    ::QueryPerformanceCounter(&end);
+    ::QueryPerformanceFrequency(&frequency);
+    return static_cast<double>(end.QuadPart - start.QuadPart) / static_cast<double>(frequency.QuadPart);
+}
+
+// Measures the number of points per second the calculator evaluates for
+// some typical functions. The points are evaluated one at a time, in a
+// single batch, and in a batch split between the threads of a pool.
+static CString RunCalcBenchmark()
+{
+    const LPCTSTR functions[] = { _T("x"), _T("x^2 - 3*x - 4"), _T("10 * sin(pi * x) / x"),
+                                  _T("cos(5 * x) / exp(x^2 / 2)"), _T("sqrt(x + 10) + log(x + 11)") };
+    const size_t points = 1000000;
+
+    std::vector<double> xs(points);
+    std::vector<double> ys(points);
+    for (size_t i = 0; i < points; ++i)
+        xs[i] = -10.0 + 20.0 * i / (points - 1);
+
+    CThreadPool pool;
+    pool.Start();
+
+    CString report;
+    report.Format(_T("Points per second, %u points, %d threads\n\n"), static_cast<UINT>(points), pool.GetThreadCount());
+    report += _T("Function\tSingle\tBatch\tThreads\n");
+
+    for (size_t f = 0; f < sizeof(functions) / sizeof(functions[0]); ++f)
+    {
+        Calc::Calculator calc;
+        calc.Input(functions[f]);
+        if (calc.Get_Status() == Calc::st_ERROR)
+            continue;
+
+        LARGE_INTEGER start;
+        ::QueryPerformanceCounter(&start);
+        for (size_t i = 0; i < points; ++i)
+        {
+            calc.SetVar(_T("x"), xs[i]);
+            ys[i] = calc.Eval();
+        }
+        double single = points / GetElapsedSeconds(start);
+
+        ::QueryPerformanceCounter(&start);
+        calc.Eval(&xs[0], &ys[0], points);
+        double batch = points / GetElapsedSeconds(start);
+
+        ::QueryPerformanceCounter(&start);
+        calc.Eval(&xs[0], &ys[0], points, &pool);
+        double threaded = points / GetElapsedSeconds(start);
+
+        CString line;
+        line.Format(_T("%s\t%.3g\t%.3g\t%.3g\n"), functions[f], single, batch, threaded);
+        report += line;
+    }
+
+    pool.Stop();
+    return report;
+}
+
 //////////////////////////////////
 // CFrameApp function definitions.
 //
@@ -18,6 +82,15 @@ CFrameApp::~CFrameApp()
 
 BOOL CFrameApp::InitInstance()
 {
+    // Run the calculator benchmark instead if the /benchmark
+    // command line argument is specified.
+    std::vector<CString> args = GetCommandLineArgs();
+    if (std::find(args.begin(), args.end(), CString(_T("/benchmark"))) != args.end())
+    {
+        ::MessageBox(NULL, RunCalcBenchmark(), _T("Calculator Benchmark"), MB_OK);
+        return FALSE;
+    }
+
     //Create the Frame Window
     m_frame.Create();   // throws a CWinException on failure
 
@@ -10,6 +10,7 @@
 #include "enums.h"
 #include "Table.h"
 #include "Node.h"
+#include "Calc.h"
 
 namespace Calc
 {
@@ -21,9 +22,9 @@ namespace Calc
     {
     }
 
-    double Node_Number::Calc() const
+    void Node_Number::Compile(Program& program) const
     {
-        return m_number;
+        program.AddNumber(m_number);
     }
 
     ////////////////////////////////////
@@ -36,58 +37,36 @@ namespace Calc
             delete m_leaves[u];
     }
 
-    double Node_Branch::Calc() const
+    void Node_Branch::Compile(Program& program) const
     {
-        double Value = 0.0;
-        for (unsigned u = 0; u < m_leaves.size(); ++u)
+        // The first leaf is the initial value. Each of the other
+        // leaves is combined with the value using its operator.
+        m_leaves[0]->Compile(program);
+        for (unsigned u = 1; u < m_leaves.size(); ++u)
         {
-            double NodeVal = m_leaves[u]->Calc();
-            switch (m_tokens[u])
-            {
-            case tPlus:
-                Value += NodeVal;
-                break;
-
-            case tMinus:
-                Value -= NodeVal;
-                break;
-
-            case tMultiply:
-                Value *= NodeVal;
-                break;
-
-            case tDivide:
-                Value /= NodeVal;
-                break;
-
-            case tPower:
-                Value = pow(Value, NodeVal);
-                break;
-            default:
-                break;
-            }
+            m_leaves[u]->Compile(program);
+            program.AddOperator(m_tokens[u]);
         }
-        return Value;
     }
 
     //////////////////////////////////////
     // Node_Variable function definitions.
     //
-    Node_Variable::Node_Variable(SymbolTable& symTab, const CString& symbol)
-        : m_symTab(symTab), m_symbol(symbol)
+    Node_Variable::Node_Variable(const CString& symbol)
+        : m_symbol(symbol)
     {
     }
 
-    double Node_Variable::Calc() const
+    void Node_Variable::Compile(Program& program) const
     {
-        return m_symTab.GetValue(m_symbol);
+        program.AddLoad(m_symbol);
     }
 
     ////////////////////////////////////
     // Node_Assign function definitions.
     //
-    Node_Assign::Node_Assign(Node* pNode, SymbolTable& symTab, const CString& symbol)
-        : m_node(pNode), m_symTab(symTab), m_symbol(symbol)
+    Node_Assign::Node_Assign(Node* pNode, const CString& symbol)
+        : m_node(pNode), m_symbol(symbol)
     {
     }
 
@@ -96,11 +75,10 @@ namespace Calc
         delete m_node;
     }
 
-    double Node_Assign::Calc() const
+    void Node_Assign::Compile(Program& program) const
     {
-        double var = m_node->Calc();
-        m_symTab.SetValue(m_symbol, var);
-        return var;
+        m_node->Compile(program);
+        program.AddStore(m_symbol);
     }
 
     //////////////////////////////////////
@@ -117,13 +95,14 @@ namespace Calc
         delete m_pNode;
     }
 
-    double Node_Function::Calc() const
+    void Node_Function::Compile(Program& program) const
     {
         FunctionTable funTab;
         PFun pFun = funTab.GetFun(m_funcName);
 
         // call the function pointed to by pFun on the evaluated expression
-        return (*pFun)(m_pNode->Calc());
+        m_pNode->Compile(program);
+        program.AddFunction(pFun);
     }
 
 } // namespace Calc
@@ -10,6 +10,7 @@
 
 namespace Calc
 {
+    class Program;
 
 #if defined (_MSC_VER) && (_MSC_VER >= 1400)
 #pragma warning ( push )
@@ -19,15 +20,15 @@ namespace Calc
 
     ///////////////////////////////////////////////////////////
     // "Node" is the parent class of all nodes
-    // The member function "Calc" is a pure virtual function,
+    // The member function "Compile" is a pure virtual function,
     // This makes "Node" and abstract class, so no instances of
     // can be made of this class.  Classes inherited from this
-    // must implement the Calc function.
+    // must implement the Compile function.
     class Node
     {
     public:
         Node() {}
-        virtual double Calc() const = 0;
+        virtual void Compile(Program& program) const = 0;
         virtual ~Node() {}
     private:
         Node& operator=(const Node&);       // Disable copy constructor
@@ -41,7 +42,7 @@ namespace Calc
     {
     public:
         Node_Number(double Number);
-        virtual double Calc() const;
+        virtual void Compile(Program& program) const;
         virtual ~Node_Number() {}
 
     private:
@@ -71,7 +72,7 @@ namespace Calc
             m_leaves.push_back(pNode);
             m_tokens.push_back(Token);
         }
-        virtual double Calc() const;
+        virtual void Compile(Program& program) const;
 
     private:
         std::vector<Node*>  m_leaves;
@@ -80,16 +81,15 @@ namespace Calc
 
 
     /////////////////////////////////////////
-    // Retrieves values from the symbol table.
+    // Retrieves the value of a variable.
     class Node_Variable : public Node
     {
     public:
-        Node_Variable(SymbolTable& symTab, const CString& symbol);
+        Node_Variable(const CString& symbol);
         virtual ~Node_Variable() {}
-        virtual double Calc() const;
+        virtual void Compile(Program& program) const;
 
     private:
-        const SymbolTable& m_symTab;
         CString m_symbol;
     };
 
@@ -99,13 +99,12 @@ namespace Calc
     class Node_Assign : public Node
     {
     public:
-        Node_Assign(Node* pNode, SymbolTable& symTab, const CString& symbol);
+        Node_Assign(Node* pNode, const CString& symbol);
         virtual ~Node_Assign();
-        virtual double Calc() const;
+        virtual void Compile(Program& program) const;
 
     private:
         Node* m_node;
-        SymbolTable& m_symTab;
         CString m_symbol;
     };
 
@@ -117,7 +116,7 @@ namespace Calc
     public:
         Node_Function(CString funName, Node* pnode);
         virtual ~Node_Function();
-        virtual double Calc() const;
+        virtual void Compile(Program& program) const;
 
     private:
         CString         m_funcName;
@@ -14,7 +14,7 @@ using namespace Calc;
 //
 
 // Constructor
-CView::CView() : m_inputDlg(IDD_INPUT), m_ymin(0), m_ymax(0)
+CView::CView() : m_inputDlg(IDD_INPUT), m_ymin(0), m_ymax(0), m_resolution(0)
 {
 }
 
@@ -29,20 +29,27 @@ void CView::CalcPoints(double xmin, double xmax)
 
     int numPoints = int(0.8 * MIN(rect.bottom, rect.right));
     numPoints = MAX(10, numPoints);
+    m_resolution = numPoints;
     double d_incr = (xmax - xmin) / (numPoints - 1.0);
 
-    // Fill the points vector.
+    // Evaluate the function for all the points at once.
+    std::vector<double> xs(numPoints);
+    std::vector<double> ys(numPoints);
     for (int i = 0; i < numPoints; i++)
     {
-        double x;
         if (i == numPoints - 1)
-            x = xmax;
+            xs[i] = xmax;
         else
-            x = xmin + i * d_incr;
+            xs[i] = xmin + i * d_incr;
+    }
 
-        m_calc.SetVar("x", x);
-        double y = m_calc.Eval();
-        m_points.push_back(PointData(x, y, m_calc.Get_Status()));
+    m_calc.Eval(&xs[0], &ys[0], numPoints);
+
+    // Fill the points vector.
+    for (int i = 0; i < numPoints; i++)
+    {
+        int status = Calculator::IsOverflow(ys[i]) ? st_OVERFLOW : st_OK;
+        m_points.push_back(PointData(xs[i], ys[i], status));
     }
 
     // Find the first valid value.
@@ -81,6 +88,7 @@ void CView::CalcPoints(double xmin, double xmax)
 
         m_ymin = ymin;
         m_ymax = ymax;
+        RefinePoints();
     }
     else
     {
@@ -99,7 +107,7 @@ void CView::DoPlot(CDC& dc)
     assert(m_ymin < m_ymax);
 
     // Choose a resolution based on the number of points to minamise rounding errors.
-    int Resolution = static_cast<int>(m_points.size());
+    int Resolution = m_resolution;
     dc.SetMapMode(MM_ISOTROPIC);    // Scale X and Y equally
     dc.SetWindowExtEx(Resolution, Resolution);
 
@@ -128,7 +136,7 @@ void CView::DoPlot(CDC& dc)
 void CView::DrawLabel(CDC& dc)
 {
     // Select the font.
-    int pointSize = 20 + int(.2 * m_points.size());
+    int pointSize = 20 + int(.2 * m_resolution);
     dc.CreatePointFont(pointSize, _T("Candara"));
 
     // Draw the text.
@@ -163,7 +171,7 @@ void CView::PrepareDC(CDC& dc)
     dc.CreatePen(PS_SOLID, 2, RGB(195, 0, 0));
 
     // Select the font.
-    int pointSize = 20 + int(.15 * m_points.size());
+    int pointSize = 20 + int(.15 * m_resolution);
     dc.CreatePointFont(pointSize, _T("Microsoft Sans Serif"));
 
     // Select the color.
@@ -303,6 +311,67 @@ void CView::PlotFunction(CDC& dc, double xnorm, double ynorm, double xoffset, do
     }
 }
 
+// Adds points between the points where the function changes by more than
+// a few pixels, so the plot follows the curve more closely. The added
+// points are evaluated together. Added points outside the range of the
+// plot are discarded. The calculator's status is left as it was for the
+// last point of the plot. Expressions which assign a variable aren't
+// refined, as each point depends on the points evaluated before it.
+void CView::RefinePoints()
+{
+    if (m_calc.HasStore())
+        return;
+
+    const double maxStep = 2.0 * (m_ymax - m_ymin) / m_resolution;   // 2 pixels
+    const int maxDivisions = 16;
+
+    // Choose the number of divisions for each steep interval.
+    std::vector<int> divisions(m_points.size(), 1);
+    std::vector<double> xs;
+    for (size_t i = 0; i + 1 < m_points.size(); ++i)
+    {
+        const PointData& p0 = m_points[i];
+        const PointData& p1 = m_points[i + 1];
+        if (p0.status == st_OK && p1.status == st_OK)
+        {
+            double steps = fabs(p1.y - p0.y) / maxStep;
+            if (steps > 1.0)
+            {
+                divisions[i] = static_cast<int>(MIN(ceil(steps), double(maxDivisions)));
+                for (int d = 1; d < divisions[i]; ++d)
+                    xs.push_back(p0.x + (p1.x - p0.x) * d / divisions[i]);
+            }
+        }
+    }
+
+    if (xs.empty())
+        return;
+
+    std::vector<double> ys(xs.size());
+    m_calc.Eval(&xs[0], &ys[0], xs.size());
+
+    // Evaluate the last point again, so the status is the status at xmax.
+    double ylast = 0;
+    m_calc.Eval(&m_points.back().x, &ylast, 1);
+
+    // Merge the added points with the original points.
+    std::vector<PointData> points;
+    points.reserve(m_points.size() + xs.size());
+    size_t added = 0;
+    for (size_t i = 0; i < m_points.size(); ++i)
+    {
+        points.push_back(m_points[i]);
+        for (int d = 1; d < divisions[i]; ++d, ++added)
+        {
+            double y = ys[added];
+            if (!Calculator::IsOverflow(y) && y >= m_ymin && y <= m_ymax)
+                points.push_back(PointData(xs[added], y, st_OK));
+        }
+    }
+
+    m_points.swap(points);
+}
+
 // Set the CREATESTRUCT parameters before the window is created.
 void CView::PreCreate(CREATESTRUCT& cs)
 {
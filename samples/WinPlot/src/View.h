@@ -48,6 +48,7 @@ private:
     void PlotYAxis(CDC& dc, double xnorm, double ynorm, double xoffset, double yoffset);
     void PlotFunction(CDC& dc, double xnorm, double ynorm, double xoffset, double yoffset);
     void PrepareDC(CDC& dc);
+    void RefinePoints();
 
     // Member varuables
     Calc::Calculator m_calc;
@@ -56,6 +57,7 @@ private:
 
     double m_ymin;
     double m_ymax;
+    int    m_resolution;              // The number of points before they are refined
 };
 
 
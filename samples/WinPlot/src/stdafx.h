@@ -24,6 +24,7 @@
 #endif
 
 // Rarely modified header files should be included here
+#include <algorithm>            // Add support for std::find
 #include <vector>               // Add support for std::vector
 #include <map>                  // Add support for std::map
 #include <string>               // Add support for std::string
@@ -73,6 +74,7 @@
 #include <wxx_textconv.h>       // Add AtoT, AtoW, TtoA, TtoW, WtoA, WtoT etc.
 #include <wxx_themes.h>         // Add MenuTheme, ReBarTheme, StatusBarTheme, ToolBarTheme
 #include <wxx_thread.h>         // Add CWinThread
+#include <wxx_threadpool.h>     // Add CPoolTask, CThreadPool
 #include <wxx_time.h>           // Add CTime
 #include <wxx_toolbar.h>        // Add CToolBar
 #include <wxx_treeview.h>       // Add CTreeView